@@ -0,0 +1,422 @@
+// Microbenchmarks for the hot paths: MJPEG decode, CPU scaling into wl_shm buffers, GPU upload and
+// draw, CH9329 packet building and key code translation.
+//
+//   cmake -B build -DOPENTERFACE_BUILD_BENCHMARKS=ON && cmake --build build --target openterface_bench
+//   ./build/openterface_bench --benchmark_filter=Decode
+//
+// Decode benchmarks use OPENTERFACE_BENCH_FRAMES=<dir> (MJPEG frames recorded from the capture
+// card, one .jpg/.mjpg per file, grouped by picture size) when set. Otherwise they encode a
+// synthetic desktop-like picture in the MS2109's 4:2:2 layout at 720p and 1080p, once plain and
+// once with a restart marker per MCU row, so the threaded decoder has strips to split.
+
+#include "openterface/ch9329.hpp"
+#include "openterface/gpu_video_renderer.hpp"
+#include "openterface/gui_video.hpp"
+#include "openterface/jpeg_decoder.hpp"
+#include "openterface/keymap.hpp"
+#include "openterface/pixel_scale.hpp"
+#include "openterface/text_input.hpp"
+#include <benchmark/benchmark.h>
+#include <jpeglib.h>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace openterface;
+
+namespace {
+
+    struct Frame {
+        std::vector<uint8_t> jpeg;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Text-like blocks on a gradient: sharp edges and flat areas, like a desktop or a BIOS screen
+    std::vector<uint8_t> desktopPicture(int width, int height) {
+        std::vector<uint8_t> rgb((size_t)width * height * 3);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t *pixel = &rgb[((size_t)y * width + x) * 3];
+                bool glyph = (y % 20) < 14 && (x % 9) < 6 && ((x / 9 * 7 + y / 20 * 13) % 5) != 0 && x < width * 2 / 3;
+                if (glyph) {
+                    pixel[0] = pixel[1] = pixel[2] = 230;
+                } else {
+                    pixel[0] = static_cast<uint8_t>(20 + x * 40 / width);
+                    pixel[1] = static_cast<uint8_t>(30 + y * 60 / height);
+                    pixel[2] = 90;
+                }
+            }
+        }
+        return rgb;
+    }
+
+    Frame encodeFrame(int width, int height, bool restart_markers) {
+        std::vector<uint8_t> rgb = desktopPicture(width, height);
+
+        jpeg_compress_struct cinfo;
+        jpeg_error_mgr jerr;
+        cinfo.err = jpeg_std_error(&jerr);
+        jpeg_create_compress(&cinfo);
+
+        unsigned char *buffer = nullptr;
+        unsigned long size = 0;
+        jpeg_mem_dest(&cinfo, &buffer, &size);
+
+        cinfo.image_width = width;
+        cinfo.image_height = height;
+        cinfo.input_components = 3;
+        cinfo.in_color_space = JCS_RGB;
+        jpeg_set_defaults(&cinfo);
+        jpeg_set_quality(&cinfo, 85, TRUE);
+        cinfo.comp_info[0].h_samp_factor = 2;  // 4:2:2
+        cinfo.comp_info[0].v_samp_factor = 1;
+        if (restart_markers) {
+            cinfo.restart_in_rows = 1;
+        }
+
+        jpeg_start_compress(&cinfo, TRUE);
+        while (cinfo.next_scanline < cinfo.image_height) {
+            JSAMPROW row = &rgb[(size_t)cinfo.next_scanline * width * 3];
+            jpeg_write_scanlines(&cinfo, &row, 1);
+        }
+        jpeg_finish_compress(&cinfo);
+        jpeg_destroy_compress(&cinfo);
+
+        Frame frame;
+        frame.jpeg.assign(buffer, buffer + size);
+        frame.width = width;
+        frame.height = height;
+        free(buffer);
+        return frame;
+    }
+
+    // Recorded frames by picture height, or nothing when OPENTERFACE_BENCH_FRAMES isn't set
+    const std::map<int, std::vector<Frame>> &recordedFrames() {
+        static const std::map<int, std::vector<Frame>> frames = [] {
+            std::map<int, std::vector<Frame>> result;
+            const char *dir = getenv("OPENTERFACE_BENCH_FRAMES");
+            if (!dir) {
+                return result;
+            }
+            std::unique_ptr<JpegDecoder> probe = JpegDecoder::create();
+            DecodedFrame decoded;
+            for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+                std::string ext = entry.path().extension().string();
+                if (ext != ".jpg" && ext != ".jpeg" && ext != ".mjpg") {
+                    continue;
+                }
+                std::ifstream file(entry.path(), std::ios::binary);
+                Frame frame;
+                frame.jpeg.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                if (!probe->decode(frame.jpeg.data(), frame.jpeg.size(), decoded)) {
+                    fprintf(stderr, "Skipping %s: %s\n", entry.path().c_str(), probe->getLastError().c_str());
+                    continue;
+                }
+                frame.width = decoded.width;
+                frame.height = decoded.height;
+                result[frame.height].push_back(std::move(frame));
+            }
+            return result;
+        }();
+        return frames;
+    }
+
+    // Frames to decode at one picture height: the recorded ones, else a synthetic one
+    const std::vector<Frame> &framesFor(int height, bool restart_markers) {
+        const auto &recorded = recordedFrames();
+        if (!recorded.empty()) {
+            static const std::vector<Frame> none;
+            auto found = recorded.find(height);
+            return found != recorded.end() ? found->second : none;
+        }
+
+        static std::map<std::pair<int, bool>, std::vector<Frame>> synthetic;
+        auto &frames = synthetic[{height, restart_markers}];
+        if (frames.empty()) {
+            frames.push_back(encodeFrame(height * 16 / 9, height, restart_markers));
+        }
+        return frames;
+    }
+
+    // Args: picture height, restart markers (synthetic frames only), output PixelFormat
+    void decodeBenchmark(benchmark::State &state, std::unique_ptr<JpegDecoder> decoder, DecoderBackend expected) {
+        if (decoder->getBackend() != expected) {
+            state.SkipWithError("backend not available on this machine");
+            return;
+        }
+        const std::vector<Frame> &frames = framesFor(static_cast<int>(state.range(0)), state.range(1) != 0);
+        if (frames.empty()) {
+            state.SkipWithError("no recorded frames at this resolution");
+            return;
+        }
+        auto format = static_cast<PixelFormat>(state.range(2));
+        if (!decoder->setOutputFormat(format)) {
+            state.SkipWithError("output format not supported by this build");
+            return;
+        }
+
+        DecodedFrame output;
+        size_t index = 0;
+        int64_t bytes = 0;
+        for (auto _ : state) {
+            const Frame &frame = frames[index++ % frames.size()];
+            if (!decoder->decode(frame.jpeg.data(), frame.jpeg.size(), output)) {
+                state.SkipWithError(decoder->getLastError().c_str());
+                return;
+            }
+            benchmark::DoNotOptimize(output.rgb_data.data());
+            bytes += static_cast<int64_t>(frame.jpeg.size());
+        }
+        state.SetBytesProcessed(bytes);
+        state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    }
+
+    void decodeArgs(benchmark::internal::Benchmark *bench) {
+        bench->ArgNames({"height", "rst", "format"});
+        for (int height : {720, 1080}) {
+            for (int rst : {0, 1}) {
+                for (PixelFormat format : {PixelFormat::RGB24, PixelFormat::XRGB8888, PixelFormat::RGBX8888}) {
+                    bench->Args({height, rst, static_cast<int>(format)});
+                }
+            }
+        }
+    }
+
+    void BM_DecodeLibjpeg(benchmark::State &state) {
+        decodeBenchmark(state, JpegDecoder::create(DecoderBackend::Libjpeg), DecoderBackend::Libjpeg);
+    }
+    BENCHMARK(BM_DecodeLibjpeg)->Apply(decodeArgs)->Unit(benchmark::kMillisecond);
+
+    void BM_DecodeSliced(benchmark::State &state) {
+        decodeBenchmark(state, createSliceJpegDecoder(4), DecoderBackend::Libjpeg);
+    }
+    BENCHMARK(BM_DecodeSliced)->Apply(decodeArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    void BM_DecodeVaapi(benchmark::State &state) {
+        decodeBenchmark(state, JpegDecoder::create(DecoderBackend::Vaapi), DecoderBackend::Vaapi);
+    }
+    BENCHMARK(BM_DecodeVaapi)->Apply(decodeArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    void BM_DecodeV4l2M2m(benchmark::State &state) {
+        decodeBenchmark(state, JpegDecoder::create(DecoderBackend::V4l2M2m), DecoderBackend::V4l2M2m);
+    }
+    BENCHMARK(BM_DecodeV4l2M2m)->Apply(decodeArgs)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    // 1080p decoded for a smaller window (DCT scaling). Args: window width, height, decode threads
+    void BM_DecodeScaled(benchmark::State &state) {
+        int threads = static_cast<int>(state.range(2));
+        std::unique_ptr<JpegDecoder> decoder =
+            threads > 1 ? createSliceJpegDecoder(threads) : JpegDecoder::create(DecoderBackend::Libjpeg);
+        decoder->setOutputFormat(PixelFormat::XRGB8888);
+        decoder->setScaleTarget(static_cast<int>(state.range(0)), static_cast<int>(state.range(1)));
+        const std::vector<Frame> &frames = framesFor(1080, threads > 1);
+        if (frames.empty()) {
+            state.SkipWithError("no recorded frames at this resolution");
+            return;
+        }
+
+        DecodedFrame output;
+        size_t index = 0;
+        for (auto _ : state) {
+            const Frame &frame = frames[index++ % frames.size()];
+            if (!decoder->decode(frame.jpeg.data(), frame.jpeg.size(), output)) {
+                state.SkipWithError(decoder->getLastError().c_str());
+                return;
+            }
+            benchmark::DoNotOptimize(output.rgb_data.data());
+        }
+        state.counters["decoded_width"] = output.width;
+        state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    }
+    BENCHMARK(BM_DecodeScaled)
+        ->ArgNames({"width", "height", "threads"})
+        ->Args({1920, 1080, 1})
+        ->Args({960, 540, 1})
+        ->Args({480, 270, 1})
+        ->Args({240, 135, 1})
+        ->Args({960, 540, 4})
+        ->Unit(benchmark::kMillisecond)
+        ->UseRealTime();
+
+    // libjpeg to YCbCr planes for the GPU shaders (no colour conversion or upsampling)
+    void BM_DecodeYuvPlanes(benchmark::State &state) {
+        std::unique_ptr<JpegDecoder> decoder = JpegDecoder::create();
+        const std::vector<Frame> &frames = framesFor(static_cast<int>(state.range(0)), false);
+        if (frames.empty()) {
+            state.SkipWithError("no recorded frames at this resolution");
+            return;
+        }
+
+        std::vector<uint8_t> storage;
+        YuvPlanes planes;
+        size_t index = 0;
+        for (auto _ : state) {
+            const Frame &frame = frames[index++ % frames.size()];
+            if (!decoder->decodeToYuvPlanes(frame.jpeg.data(), frame.jpeg.size(), storage, planes)) {
+                state.SkipWithError(decoder->getLastError().c_str());
+                return;
+            }
+            benchmark::DoNotOptimize(storage.data());
+        }
+        state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    }
+    BENCHMARK(BM_DecodeYuvPlanes)->ArgName("height")->Arg(720)->Arg(1080)->Unit(benchmark::kMillisecond);
+
+    VideoFrame rgbFrame(int width, int height, PixelFormat format) {
+        VideoFrame frame;
+        frame.width = width;
+        frame.height = height;
+        frame.is_rgb = true;
+        frame.format = format;
+
+        std::vector<uint8_t> rgb = desktopPicture(width, height);
+        int bpp = bytesPerPixel(format);
+        frame.data.resize((size_t)width * height * bpp);
+        for (size_t i = 0; i < (size_t)width * height; i++) {
+            uint8_t *out = &frame.data[i * bpp];
+            const uint8_t *in = &rgb[i * 3];
+            if (format == PixelFormat::XRGB8888) {
+                out[0] = in[2], out[1] = in[1], out[2] = in[0], out[3] = 0xFF;
+            } else {
+                out[0] = in[0], out[1] = in[1], out[2] = in[2];
+                if (bpp == 4) {
+                    out[3] = 0xFF;
+                }
+            }
+        }
+        return frame;
+    }
+
+    // 1080p capture scaled into a window. Args: window width, height, source PixelFormat
+    void BM_RenderVideoToBuffer(benchmark::State &state) {
+        int window_width = static_cast<int>(state.range(0));
+        int window_height = static_cast<int>(state.range(1));
+        VideoFrame frame = rgbFrame(1920, 1080, static_cast<PixelFormat>(state.range(2)));
+        std::vector<uint32_t> buffer((size_t)window_width * window_height);
+
+        for (auto _ : state) {
+            renderVideoToBuffer(buffer.data(), window_width, window_height, frame);
+            benchmark::DoNotOptimize(buffer.data());
+            benchmark::ClobberMemory();
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * window_width * window_height * 4);
+    }
+    BENCHMARK(BM_RenderVideoToBuffer)
+        ->ArgNames({"width", "height", "format"})
+        ->Args({1280, 720, static_cast<int>(PixelFormat::XRGB8888)})
+        ->Args({1920, 1080, static_cast<int>(PixelFormat::XRGB8888)})
+        ->Args({2560, 1440, static_cast<int>(PixelFormat::XRGB8888)})
+        ->Args({3840, 2160, static_cast<int>(PixelFormat::XRGB8888)})
+        ->Args({1280, 720, static_cast<int>(PixelFormat::RGB24)})
+        ->Args({1920, 1080, static_cast<int>(PixelFormat::RGB24)})
+        ->Unit(benchmark::kMicrosecond);
+
+    // One offscreen renderer for all GPU benchmarks; nullptr without a usable EGL/GLES2 driver
+    GPUVideoRenderer *offscreenRenderer() {
+        static GPUVideoRenderer renderer;
+        static bool ready = renderer.initializeOffscreen(1920, 1080) && renderer.initializeInCurrentThread();
+        return ready ? &renderer : nullptr;
+    }
+
+    // Upload + draw of a 1080p frame into a 1080p pbuffer; glFinish makes the GPU work part of
+    // the measurement. Args: 0 = RGBX8888, 1 = YCbCr planes
+    void BM_GpuRenderFrame(benchmark::State &state) {
+        GPUVideoRenderer *renderer = offscreenRenderer();
+        if (!renderer) {
+            state.SkipWithError("no offscreen EGL context");
+            return;
+        }
+
+        VideoFrame frame;
+        if (state.range(0) == 0) {
+            frame = rgbFrame(1920, 1080, PixelFormat::RGBX8888);
+        } else {
+            if (!renderer->supportsYuv()) {
+                state.SkipWithError("YUV shaders unavailable");
+                return;
+            }
+            const std::vector<Frame> &frames = framesFor(1080, false);
+            if (frames.empty()) {
+                state.SkipWithError("no recorded frames at this resolution");
+                return;
+            }
+            std::unique_ptr<JpegDecoder> decoder = JpegDecoder::create();
+            const Frame &jpeg = frames.front();
+            if (!decoder->decodeToYuvPlanes(jpeg.jpeg.data(), jpeg.jpeg.size(), frame.data, frame.planes)) {
+                state.SkipWithError(decoder->getLastError().c_str());
+                return;
+            }
+            frame.width = frame.planes.width;
+            frame.height = frame.planes.height;
+            frame.is_yuv = true;
+        }
+
+        for (auto _ : state) {
+            if (!renderer->renderFrame(frame)) {
+                state.SkipWithError(renderer->getLastError().c_str());
+                return;
+            }
+            glFinish();
+        }
+        state.counters["fps"] = benchmark::Counter(static_cast<double>(state.iterations()), benchmark::Counter::kIsRate);
+    }
+    BENCHMARK(BM_GpuRenderFrame)->ArgName("yuv")->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    void BM_Ch9329AbsoluteMouse(benchmark::State &state) {
+        int x = 0;
+        for (auto _ : state) {
+            auto packet = ch9329::absoluteMouse(0x01, x, 4095 - x);
+            benchmark::DoNotOptimize(packet);
+            x = (x + 7) & 0xFFF;
+        }
+    }
+    BENCHMARK(BM_Ch9329AbsoluteMouse);
+
+    void BM_Ch9329Keyboard(benchmark::State &state) {
+        std::array<uint8_t, 6> keys = {0x04, 0x05, 0x06, 0, 0, 0};
+        for (auto _ : state) {
+            auto packet = ch9329::keyboard(0x02, keys);
+            benchmark::DoNotOptimize(packet);
+            keys[0] = static_cast<uint8_t>(keys[0] + 1);
+        }
+    }
+    BENCHMARK(BM_Ch9329Keyboard);
+
+    // Every evdev code through the shared table (what each wl_keyboard.key costs)
+    void BM_EvdevToHid(benchmark::State &state) {
+        for (auto _ : state) {
+            unsigned sum = 0;
+            for (uint32_t code = 0; code < 256; code++) {
+                sum += evdevToHid(code);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+        state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) * 256);
+    }
+    BENCHMARK(BM_EvdevToHid);
+
+    void BM_TextEncode(benchmark::State &state) {
+        TextEncoder encoder;
+        std::string text;
+        for (int i = 0; i < 16; i++) {
+            text += "The quick brown fox jumps over the lazy dog 0123456789!\n";
+        }
+        std::vector<KeyboardReport> reports;
+        for (auto _ : state) {
+            reports.clear();
+            encoder.encode(text, reports);
+            benchmark::DoNotOptimize(reports.data());
+        }
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) * text.size());
+    }
+    BENCHMARK(BM_TextEncode);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace openterface {
+
+    // CH9329 serial protocol frames: 57 AB <address> <command> <length> <payload...> <checksum>,
+    // the checksum being the low byte of the sum of everything before it.
+    //
+    // Packets are fixed-size std::arrays stamped from compile-time templates (header, command and
+    // length already filled in); the builders patch the variable bytes and the checksum in place,
+    // so building a report never allocates.
+    namespace ch9329 {
+
+        constexpr uint8_t kHeader0 = 0x57;
+        constexpr uint8_t kHeader1 = 0xAB;
+        constexpr uint8_t kAddress = 0x00;
+        constexpr size_t kFrameOverhead = 6;  // Header, address, command, length, checksum
+
+        enum Command : uint8_t {
+            CMD_GET_INFO = 0x01,
+            CMD_SEND_KB_GENERAL_DATA = 0x02,
+            CMD_SEND_MS_ABS_DATA = 0x04,
+            CMD_SEND_MS_REL_DATA = 0x05,
+            CMD_GET_PARA_CFG = 0x08,
+            CMD_SET_PARA_CFG = 0x09,
+            CMD_RESET = 0x0F,
+        };
+
+        template <size_t PayloadSize>
+        using Packet = std::array<uint8_t, PayloadSize + kFrameOverhead>;
+
+        using CommandPacket = Packet<0>;
+        using KeyboardPacket = Packet<8>;       // Modifiers, reserved, 6 key codes
+        using AbsoluteMousePacket = Packet<7>;  // 0x02, buttons, x (LE), y (LE), wheel
+        using RelativeMousePacket = Packet<5>;  // 0x01, buttons, dx, dy, wheel
+
+        constexpr uint8_t checksum(const uint8_t *data, size_t size) {
+            uint8_t sum = 0;
+            for (size_t i = 0; i < size; i++) {
+                sum = static_cast<uint8_t>(sum + data[i]);
+            }
+            return sum;
+        }
+
+        template <size_t N>
+        constexpr void finish(std::array<uint8_t, N> &packet) {
+            packet[N - 1] = checksum(packet.data(), N - 1);
+        }
+
+        template <uint8_t Cmd, size_t PayloadSize>
+        constexpr Packet<PayloadSize> makeTemplate() {
+            Packet<PayloadSize> packet{};
+            packet[0] = kHeader0;
+            packet[1] = kHeader1;
+            packet[2] = kAddress;
+            packet[3] = Cmd;
+            packet[4] = static_cast<uint8_t>(PayloadSize);
+            finish(packet);
+            return packet;
+        }
+
+        template <uint8_t Cmd, size_t PayloadSize>
+        inline constexpr Packet<PayloadSize> kTemplate = makeTemplate<Cmd, PayloadSize>();
+
+        // Payload-less commands (CMD_GET_INFO, CMD_GET_PARA_CFG, CMD_RESET)
+        template <uint8_t Cmd>
+        constexpr CommandPacket command() {
+            return kTemplate<Cmd, 0>;
+        }
+
+        // Boot keyboard report; key 0 = all keys released
+        constexpr KeyboardPacket keyboard(uint8_t modifiers, uint8_t key) {
+            KeyboardPacket packet = kTemplate<CMD_SEND_KB_GENERAL_DATA, 8>;
+            packet[5] = modifiers;
+            packet[7] = key;
+            finish(packet);
+            return packet;
+        }
+
+        // Boot keyboard report with up to six keys pressed together (unused slots 0)
+        constexpr KeyboardPacket keyboard(uint8_t modifiers, const std::array<uint8_t, 6> &keys) {
+            KeyboardPacket packet = kTemplate<CMD_SEND_KB_GENERAL_DATA, 8>;
+            packet[5] = modifiers;
+            for (size_t i = 0; i < keys.size(); i++) {
+                packet[7 + i] = keys[i];
+            }
+            finish(packet);
+            return packet;
+        }
+
+        // Absolute pointer, x and y in 0..4095
+        constexpr AbsoluteMousePacket absoluteMouse(uint8_t buttons, int x, int y, int8_t wheel = 0) {
+            AbsoluteMousePacket packet = kTemplate<CMD_SEND_MS_ABS_DATA, 7>;
+            packet[5] = 0x02;
+            packet[6] = buttons;
+            packet[7] = static_cast<uint8_t>(x & 0xFF);
+            packet[8] = static_cast<uint8_t>((x >> 8) & 0xFF);
+            packet[9] = static_cast<uint8_t>(y & 0xFF);
+            packet[10] = static_cast<uint8_t>((y >> 8) & 0xFF);
+            packet[11] = static_cast<uint8_t>(wheel);
+            finish(packet);
+            return packet;
+        }
+
+        // Relative pointer; deltas are clamped to -127..127 by the caller
+        constexpr RelativeMousePacket relativeMouse(uint8_t buttons, int dx, int dy, int8_t wheel = 0) {
+            RelativeMousePacket packet = kTemplate<CMD_SEND_MS_REL_DATA, 5>;
+            packet[5] = 0x01;
+            packet[6] = buttons;
+            packet[7] = static_cast<uint8_t>(static_cast<int8_t>(dx));
+            packet[8] = static_cast<uint8_t>(static_cast<int8_t>(dy));
+            packet[9] = static_cast<uint8_t>(wheel);
+            finish(packet);
+            return packet;
+        }
+
+        // Checked against frames captured from the original Qt client
+        static_assert(command<CMD_GET_INFO>() == CommandPacket{0x57, 0xAB, 0x00, 0x01, 0x00, 0x03});
+        static_assert(keyboard(0, 0).back() == 0x0C);
+        static_assert(absoluteMouse(0, 4095, 4095)[7] == 0xFF && absoluteMouse(0, 4095, 4095)[8] == 0x0F);
+
+    } // namespace ch9329
+
+} // namespace openterface
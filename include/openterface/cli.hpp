@@ -3,6 +3,7 @@
 #include <CLI/CLI.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace openterface {
 
@@ -11,6 +12,7 @@ namespace openterface {
     class Video;
     class Input;
     class GUI;
+    struct KVMDevice;
 
     class CLI {
       public:
@@ -29,6 +31,39 @@ namespace openterface {
         bool no_serial = false;
         std::string serial_port;
         std::string video_device;
+        std::string decoder_backend = "libjpeg";
+        std::string capture_format = "mjpg";
+        std::string capture_preference;
+        std::string capture_memory = "mmap";
+        int capture_buffers = 4;
+        bool latest_frame = false;
+        int decode_threads = 0;
+        bool show_stats = false;
+        int stats_interval = 5;
+        bool negotiate_baud = false;
+        int max_baud = 0;
+        int bench_round_trips = 200;
+        int bench_packets = 1000;
+        std::string type_text;
+        std::string type_file;
+        std::string type_layout = "us";
+        int type_rollover = 6;
+        std::string replay_file;
+        bool replay_fast = false;
+        std::string record_output;
+        int record_frames = 0;
+        int record_seconds = 0;
+        std::vector<std::string> multi_targets;
+        std::string multi_window = "640x360";
+        int pool_threads = 0;
+        int thumbnail_fps = 10;
+        int unfocused_fps = 5;
+        int hidden_fps = 1;
+        bool fixed_quality = false;
+        std::string serve_address = "127.0.0.1";
+        int serve_port = 8080;
+        int serve_max_clients = 32;
+        bool serve_allow_input = false;
 
         // Module instances
         std::unique_ptr<Serial> serial;
@@ -38,8 +73,10 @@ namespace openterface {
 
         void setupCommands();
 
-        // Device detection helpers
+        // Device detection helpers (DeviceDiscovery: one cached pass, nothing opened)
         std::string getVideoDeviceName(const std::string &device_path);
+        // First unit with both its video and serial node, else the first unit found
+        bool findOpenterfaceDevice(KVMDevice &device);
         std::vector<std::string> findOpenterfaceSerialPorts();
         std::vector<std::string> findOpenterfaceVideoDevices();
     };
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace openterface {
+
+    // Worker threads shared by the video pipelines of several KVM sessions in one process, so N
+    // sessions cost one pool of decode threads instead of N idle ones.
+    //
+    // Every worker has its own task deques. A task submitted from a worker goes onto that worker's
+    // deque, others are dealt round-robin; a worker with nothing of its own steals from the back of
+    // the others', so a burst from one session spreads over every core. High-priority tasks run
+    // before any low-priority one, wherever they are queued. Idle workers sleep on a condition
+    // variable - no polling.
+    class DecodePool {
+    public:
+        enum class Priority {
+            High,  // Windows being looked at
+            Low,   // Thumbnails: only run when no high-priority work is waiting
+        };
+
+        using Task = std::function<void()>;
+
+        // 0 threads = one per core
+        explicit DecodePool(int threads = 0);
+        ~DecodePool();  // Tasks still queued are dropped; running ones finish first
+
+        DecodePool(const DecodePool&) = delete;
+        DecodePool& operator=(const DecodePool&) = delete;
+
+        void submit(Task task, Priority priority = Priority::High);
+
+        int getThreadCount() const { return static_cast<int>(workers.size()); }
+
+        // Tasks run so far, and how many of them by a worker other than the one they were queued on
+        uint64_t getCompletedCount() const { return completed.load(std::memory_order_relaxed); }
+        uint64_t getStolenCount() const { return stolen.load(std::memory_order_relaxed); }
+
+    private:
+        struct Worker;
+
+        void workerLoop(size_t index);
+        bool takeTask(size_t index, Task& task);
+
+        std::vector<std::unique_ptr<Worker>> workers;
+        std::atomic<size_t> next_worker{0};  // Round-robin target for submissions from outside the pool
+        std::atomic<size_t> queued{0};       // Tasks in any deque
+        std::atomic<uint64_t> completed{0};
+        std::atomic<uint64_t> stolen{0};
+
+        // Sleeping workers; submit() takes the mutex before notifying so a worker between its
+        // emptiness check and the wait can't miss the task
+        std::mutex sleep_mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+    };
+
+} // namespace openterface
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "openterface/kvm.hpp"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace openterface {
+
+    enum class HotplugAction {
+        Added,    // A unit appeared
+        Changed,  // One of its nodes appeared or went away (the video and tty nodes arrive separately)
+        Removed,  // Both of its nodes are gone
+    };
+
+    // Called on the monitor thread with the unit that changed
+    using HotplugCallback = std::function<void(HotplugAction action, const KVMDevice &device)>;
+
+    // Finds Openterface units (the MS2109 capture chip and the CH9329's USB serial bridge behind
+    // one hub) in a single pass over the udev database, without opening any device node, and
+    // pairs the two functions by USB topology: the unit's id is the sysfs name of the hub they
+    // share ("1-2"), so it stays the same across replugs into the same port. The result is cached;
+    // once the hotplug monitor runs, netlink events keep the cache current instead of rescans.
+    //
+    // Without libudev at build time the same pass reads sysfs directly and hotplug monitoring is
+    // unavailable.
+    class DeviceDiscovery {
+      public:
+        DeviceDiscovery();
+        ~DeviceDiscovery();  // Stops the monitor
+
+        DeviceDiscovery(const DeviceDiscovery &) = delete;
+        DeviceDiscovery &operator=(const DeviceDiscovery &) = delete;
+
+        // Process-wide instance, so every caller shares one cache and one monitor
+        static DeviceDiscovery &shared();
+
+        // Units found, sorted by id. Scans on the first call or with `refresh`, otherwise returns
+        // the cache. Units with only one function present have the other path empty.
+        std::vector<KVMDevice> getDevices(bool refresh = false);
+        // The unit a video or serial node belongs to
+        bool findByPath(const std::string &node_path, KVMDevice &device);
+
+        // Watch udev netlink events on a background thread. The callback may be empty when only
+        // the cache (and waitForDevice) should follow hotplugs. False without libudev.
+        bool startMonitor(HotplugCallback callback = nullptr);
+        void stopMonitor();
+        bool isMonitoring() const;
+
+        // Block until unit `device_id` has both its video and serial node (e.g. after a replug),
+        // up to timeout_ms. Starts the monitor if needed; without it the cache is rescanned every
+        // 100 ms instead.
+        bool waitForDevice(const std::string &device_id, int timeout_ms, KVMDevice &device);
+
+        // Baud rate the CH9329 of the unit behind serial node `serial_path` last answered at,
+        // kept in $XDG_CACHE_HOME/openterface/baud-rates so the next connect starts there instead
+        // of going through the fallback rates. 115200 (the chip's default) when none is known.
+        static int baudRateHint(const std::string &serial_path);
+        static void rememberBaudRate(const std::string &serial_path, int baudrate);
+
+      private:
+        class Impl;
+        std::unique_ptr<Impl> pImpl;
+    };
+
+} // namespace openterface
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace openterface {
+
+    struct VideoFrame;
+
+    struct DamageRect {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    // Destination rectangle whose pixels depend on the `rect` area of a src_width x src_height image
+    // stretched over dst_width x dst_height. Grown by one source pixel on every side, which covers
+    // both nearest and bilinear sampling (CPU scaler and GL texture filtering).
+    DamageRect mapDamage(const DamageRect& rect, int src_width, int src_height, int dst_width, int dst_height);
+
+    // Tile-by-tile comparison of decoded frames against the previous one, for static remote
+    // screens (firmware setup, consoles, installers) where most frames change little or nothing.
+    //
+    // Keeps a copy of the last frame; rows are compared with memcmp first, so unchanged rows cost
+    // one pass over both copies and only differing tiles are copied over.
+    class FrameChangeDetector {
+    public:
+        static constexpr int kTileSize = 64;    // Picture pixels (luma samples for YCbCr)
+        static constexpr size_t kMaxRects = 32; // More dirty areas than this collapse to their bounding box
+
+        // Compare `frame` (RGB, packed YUYV or YCbCr planes) with the previous frame and fill
+        // frame.damage / frame.full_damage. Returns false when no tile changed.
+        bool update(VideoFrame& frame);
+
+        // Forget the previous frame: the next one is reported as fully damaged
+        void reset();
+
+    private:
+        // Shape of the stored frame; any difference means there is nothing to compare against
+        struct Layout {
+            int width = 0;
+            int height = 0;
+            int kind = 0;
+            int format = 0;
+            int subsample_x = 1;
+            int subsample_y = 1;
+            size_t size = 0;
+            bool operator==(const Layout& other) const = default;
+        };
+
+        void comparePlane(const uint8_t* current, uint8_t* reference, size_t row_bytes, int rows, size_t tile_bytes,
+                          int tile_rows);
+        void collectRects(std::vector<DamageRect>& rects) const;
+
+        Layout layout;
+        std::vector<uint8_t> reference;
+        int tile_columns = 0;
+        int tile_rows = 0;
+        std::vector<uint8_t> dirty;  // One flag per tile
+    };
+
+    // Damage of the last few published frames, for redrawing buffers and textures that hold an
+    // older frame. Written by the decode thread, read by the render and Wayland threads.
+    class DamageHistory {
+    public:
+        static constexpr size_t kDepth = 16;
+
+        // `sequence` changed `rects` relative to sequence - 1; full = everything
+        void record(uint64_t sequence, int width, int height, bool full, const std::vector<DamageRect>& rects);
+
+        // Area that differs between frames `from` and `to` (picture coordinates of `to`). Returns
+        // false when that isn't known - unknown or too old a frame, a full update or a geometry
+        // change in between - and everything has to be redrawn.
+        bool collect(uint64_t from, uint64_t to, std::vector<DamageRect>& out) const;
+
+        void clear();
+
+    private:
+        struct Entry {
+            uint64_t sequence = 0;
+            int width = 0;
+            int height = 0;
+            bool full = true;
+            std::vector<DamageRect> rects;
+        };
+
+        mutable std::mutex mutex;
+        std::array<Entry, kDepth> entries;
+    };
+
+} // namespace openterface
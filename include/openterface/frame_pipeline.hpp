@@ -0,0 +1,312 @@
+#pragma once
+
+#include "openterface/gui_video.hpp"
+#include "openterface/video.hpp"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace openterface {
+
+    // Monotonic time in microseconds - the clock UVC uses for V4L2 buffer timestamps
+    uint64_t monotonicMicros();
+
+    // Lock-free single-producer/single-consumer queue of pre-allocated slots with a drop-oldest policy.
+    //
+    // Every slot is owned by exactly one party at a time: the producer (acquire -> publish), the
+    // ready ring (published, not yet taken) or the consumer (take -> release). When the ready ring
+    // is full the producer reclaims its oldest entry, so a slow consumer always gets the newest
+    // frame and the producer never blocks or allocates. Slots keep their contents between uses, so
+    // vectors inside them keep their capacity.
+    template <typename T, size_t Depth>
+    class FrameQueue {
+        static_assert(Depth >= 1, "FrameQueue needs at least one ready entry");
+
+    public:
+        // Depth ready + one being written + one being read
+        static constexpr size_t kSlots = Depth + 2;
+
+        FrameQueue() {
+            for (uint32_t i = 0; i < kSlots; i++) {
+                free_ring[i].store(i, std::memory_order_relaxed);
+            }
+            free_tail.store(kSlots, std::memory_order_release);
+        }
+
+        FrameQueue(const FrameQueue&) = delete;
+        FrameQueue& operator=(const FrameQueue&) = delete;
+
+        // Producer: get a slot to fill. Never fails; may drop the oldest ready entry.
+        T* acquire() {
+            if (spare != kNoSlot) {
+                uint32_t index = spare;
+                spare = kNoSlot;
+                return &slots[index];
+            }
+
+            while (true) {
+                uint64_t head = ready_head.load(std::memory_order_acquire);
+                uint64_t tail = ready_tail.load(std::memory_order_relaxed);
+                if (tail - head >= Depth) {
+                    // Consumer is behind: recycle the oldest ready slot
+                    uint32_t index = ready_ring[head % Depth].load(std::memory_order_relaxed);
+                    if (ready_head.compare_exchange_strong(head, head + 1, std::memory_order_acq_rel)) {
+                        dropped.fetch_add(1, std::memory_order_relaxed);
+                        return &slots[index];
+                    }
+                    continue; // The consumer took it first, so there is room now
+                }
+
+                // With the ring below Depth at most one slot is outside it and the free ring
+                // (the consumer's), so a free slot is guaranteed
+                uint64_t free_pos = free_head.load(std::memory_order_relaxed);
+                if (free_pos != free_tail.load(std::memory_order_acquire)) {
+                    uint32_t index = free_ring[free_pos % kSlots].load(std::memory_order_relaxed);
+                    free_head.store(free_pos + 1, std::memory_order_release);
+                    return &slots[index];
+                }
+            }
+        }
+
+        // Producer: hand a filled slot to the consumer
+        void publish(T* slot) {
+            uint64_t tail = ready_tail.load(std::memory_order_relaxed);
+            ready_ring[tail % Depth].store(indexOf(slot), std::memory_order_relaxed);
+            ready_tail.store(tail + 1, std::memory_order_release);
+        }
+
+        // Producer: give back an acquired slot without publishing it (e.g. the decode failed)
+        void discard(T* slot) { spare = indexOf(slot); }
+
+        // Consumer: oldest ready slot, or nullptr when empty. Must be released before the next take.
+        T* take() {
+            uint64_t head = ready_head.load(std::memory_order_relaxed);
+            while (head != ready_tail.load(std::memory_order_acquire)) {
+                uint32_t index = ready_ring[head % Depth].load(std::memory_order_relaxed);
+                if (ready_head.compare_exchange_weak(head, head + 1, std::memory_order_acq_rel)) {
+                    return &slots[index];
+                }
+                // head was reloaded by the failed exchange (the producer dropped an entry)
+            }
+            return nullptr;
+        }
+
+        // Consumer: newest ready slot; older ready entries are released and counted as dropped
+        T* takeLatest() {
+            T* latest = take();
+            if (!latest) {
+                return nullptr;
+            }
+            while (T* newer = take()) {
+                release(latest);
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                latest = newer;
+            }
+            return latest;
+        }
+
+        // Consumer: return a taken slot to the producer
+        void release(T* slot) {
+            uint64_t tail = free_tail.load(std::memory_order_relaxed);
+            free_ring[tail % kSlots].store(indexOf(slot), std::memory_order_relaxed);
+            free_tail.store(tail + 1, std::memory_order_release);
+        }
+
+        bool empty() const {
+            return ready_head.load(std::memory_order_acquire) == ready_tail.load(std::memory_order_acquire);
+        }
+
+        // Frames discarded by the drop-oldest policy (either side)
+        uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    private:
+        static constexpr uint32_t kNoSlot = UINT32_MAX;
+
+        uint32_t indexOf(const T* slot) const { return static_cast<uint32_t>(slot - slots.data()); }
+
+        std::array<T, kSlots> slots;
+
+        // Published slot indices; head is advanced by the consumer (take) and by the producer
+        // (drop), tail only by the producer. Positions are 64-bit and never wrap, so a stale
+        // compare-exchange can't succeed.
+        std::array<std::atomic<uint32_t>, Depth> ready_ring{};
+        alignas(64) std::atomic<uint64_t> ready_head{0};
+        alignas(64) std::atomic<uint64_t> ready_tail{0};
+
+        // Released slot indices, consumer -> producer
+        std::array<std::atomic<uint32_t>, kSlots> free_ring{};
+        alignas(64) std::atomic<uint64_t> free_head{0};
+        alignas(64) std::atomic<uint64_t> free_tail{0};
+
+        uint32_t spare = kNoSlot; // Producer-local
+        std::atomic<uint64_t> dropped{0};
+    };
+
+    // Per-frame stage timestamps (monotonicMicros), 0 = stage not reached
+    struct FrameTimestamps {
+        uint64_t capture = 0;       // Driver timestamp of the capture buffer
+        uint64_t queued = 0;        // Copied out of the capture buffer
+        uint64_t decode_start = 0;
+        uint64_t decoded = 0;
+        uint64_t render_start = 0;  // Taken by the render thread
+        uint64_t uploaded = 0;      // Texture upload (GPU) or scale into the wl_shm buffer (CPU) submitted
+        uint64_t committed = 0;     // eglSwapBuffers returned / wl_surface_commit
+        uint64_t presented = 0;     // On screen, from wp_presentation feedback
+    };
+
+    // Capture payload copied out of the V4L2 buffer so the buffer can be requeued immediately
+    struct CapturedFrame {
+        std::vector<uint8_t> payload;
+        FrameData info{};  // Metadata; info.data is only pointed at payload by the decode stage
+        FrameTimestamps times;
+    };
+
+    struct PipelineFrame {
+        VideoFrame frame;
+        FrameTimestamps times;
+    };
+
+    // Latency distribution that any number of threads can record into without locking.
+    //
+    // Buckets are log-linear (8 per power of two above 16us, so a reported percentile is within
+    // 12.5% of the true value); the maximum is exact. drain() reads and clears it in one pass,
+    // which loses nothing recorded concurrently - a sample lands before or after the drain.
+    class LatencyHistogram {
+    public:
+        struct Summary {
+            uint64_t count = 0;
+            uint64_t p50_us = 0;
+            uint64_t p99_us = 0;
+            uint64_t max_us = 0;
+        };
+
+        void record(uint64_t us);
+        Summary drain();
+
+    private:
+        static constexpr size_t kLinear = 16;                   // 0..15us exact
+        static constexpr size_t kSubBuckets = 8;
+        static constexpr size_t kBuckets = kLinear + 22 * kSubBuckets;  // Up to ~67s
+
+        static size_t bucketOf(uint64_t us);
+        static uint64_t bucketValue(size_t bucket);  // Upper bound
+
+        std::array<std::atomic<uint32_t>, kBuckets> buckets{};
+        std::atomic<uint64_t> max{0};
+    };
+
+    // Latency of every stage from the V4L2 buffer to the photons, plus input to serial. Stages are
+    // recorded by whichever thread completes them (render, Wayland, input).
+    class PipelineStats {
+    public:
+        enum Stage {
+            CAPTURE,  // capture -> queued (driver timestamp to copy-out)
+            QUEUE,    // queued -> decode_start
+            DECODE,   // decode_start -> decoded
+            WAIT,     // decoded -> render_start (pacing to the compositor)
+            UPLOAD,   // render_start -> uploaded
+            COMMIT,   // uploaded -> committed
+            PRESENT,  // committed -> presented
+            TOTAL,    // capture -> presented (committed without presentation feedback)
+            INPUT,    // Wayland input event -> handed to the serial link
+            kStageCount
+        };
+
+        // Stages up to the commit; TOTAL too unless presentation feedback will follow
+        void recordFrame(const FrameTimestamps& times, bool awaiting_presentation);
+        // PRESENT and TOTAL, once the compositor reports the frame on screen
+        void recordPresented(const FrameTimestamps& times);
+        void recordInput(uint64_t us) { stages[INPUT].record(us); }
+
+        uint64_t frames() const { return frame_count.load(std::memory_order_relaxed); }
+
+        // p50/p99/max of every stage with samples since the last call, which clears them, e.g.
+        // "decode 4.0/6.3/7.1ms total 9.8/14.0/16.2ms ... (p50/p99/max over 300 frames)"
+        std::string summary();
+
+        // The same, one stage per line, for --stats
+        std::string report();
+
+    private:
+        static const char* stageName(Stage stage);
+        void add(Stage stage, uint64_t from, uint64_t to);
+
+        std::array<LatencyHistogram, kStageCount> stages;
+        std::atomic<uint64_t> frame_count{0};
+    };
+
+    // Feedback from the pipeline's own timings to how much work it is given, so a stage that can't
+    // keep up sheds load instead of letting latency grow:
+    //
+    //   - a window that isn't focused, or is hidden (xdg_toplevel "suspended"), takes only
+    //     unfocused_fps / hidden_fps frames a second; the rest are skipped on the capture thread
+    //     before they are even copied out
+    //   - an active window whose decode (queue wait included) no longer fits the capture interval
+    //     decodes at half, then a quarter of the window size (cheap with libjpeg DCT scaling)
+    //   - if that isn't enough, or rendering is the slow side, it takes only as many frames a
+    //     second as its slowest stage sustains
+    //
+    // Levels are judged over kWindowFrames frames; load is shed at once and given back one step at
+    // a time, at least kHoldUs apart, when the stage would still fit the interval a step up.
+    class FrameGovernor {
+    public:
+        enum class Visibility { Active, Unfocused, Hidden };
+
+        struct Policy {
+            int unfocused_fps = 5;  // 0 = full rate
+            int hidden_fps = 1;     // 0 = full rate
+            bool adaptive = true;   // Shed load while active; off = full rate and size always
+        };
+
+        void setPolicy(const Policy& policy);
+        Policy getPolicy() const;
+
+        // Wayland thread, from the configure states. True when it changed.
+        bool setVisibility(Visibility visibility);
+        Visibility getVisibility() const;
+
+        // Capture thread: whether the frame captured at `capture_us` goes on (false = skip it)
+        bool admit(uint64_t capture_us);
+
+        // Committing thread: timings of a frame that reached the screen. True when the load level
+        // (decodeShift() or the rate) changed.
+        bool recordFrame(const FrameTimestamps& times);
+
+        // Decode at the window size divided by 2^decodeShift()
+        int decodeShift() const { return decode_shift.load(std::memory_order_relaxed); }
+        // Frames a second the window takes right now, 0 = every captured frame
+        int rateCap() const;
+        uint64_t skipped() const { return skipped_frames.load(std::memory_order_relaxed); }
+        // e.g. "unfocused, 5 fps" or "active, 24 fps, 1/2-size decode"
+        std::string describe() const;
+
+    private:
+        static constexpr uint64_t kWindowFrames = 30;
+        static constexpr uint64_t kHoldUs = 2000000;
+        static constexpr int kMaxShift = 2;
+
+        int rateCapLocked() const;
+        void updatePeriod();  // Holds mutex
+
+        mutable std::mutex mutex;  // Everything below up to the atomics
+        Policy policy;
+        Visibility visibility = Visibility::Active;
+        int load_fps = 0;             // Rate the slowest stage sustains, 0 = not limited
+        uint64_t last_change = 0;     // Commit time of the last load step
+        uint64_t window_frames = 0;
+        uint64_t window_decode = 0;   // Sums over the window, us
+        uint64_t window_render = 0;
+
+        std::atomic<int> decode_shift{0};
+        std::atomic<uint64_t> period_us{0};         // Admit interval, 0 = every frame
+        std::atomic<uint64_t> capture_interval{0};  // Smoothed capture-to-capture time, us
+        std::atomic<uint64_t> skipped_frames{0};
+        uint64_t last_capture = 0;  // Capture thread
+        uint64_t next_frame = 0;    // Capture thread: earliest capture time admitted next
+    };
+
+} // namespace openterface
@@ -3,13 +3,19 @@
 #include <wayland-client.h>
 #include <wayland-egl.h>
 #include <EGL/egl.h>
+#include <EGL/eglext.h>
 #include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace openterface {
 
     struct VideoFrame;
+    struct DmaBufFrame;
+    struct DamageRect;
 
     class GPUVideoRenderer {
     public:
@@ -19,11 +25,31 @@ namespace openterface {
         // Initialize EGL context with Wayland surface
         bool initialize(struct wl_display* display, struct wl_surface* surface, int width, int height);
         
+        // Initialize EGL with a width x height pbuffer on the default display instead of a window,
+        // for rendering without a compositor (benchmarks). Then initializeInCurrentThread() as usual.
+        bool initializeOffscreen(int width, int height);
+
+        // The wl_display is shared with other windows' renderers: cleanup() then leaves the EGL display
+        // initialised, since eglTerminate would take their contexts down too. Call before initialize().
+        void setSharedDisplay(bool shared) { shared_display = shared; }
+
         // Initialize EGL context in current thread (for threading)
         bool initializeInCurrentThread();
         
-        // Render video frame using GPU acceleration
-        bool renderFrame(const VideoFrame& frame);
+        // Render video frame using GPU acceleration (RGB, or YCbCr converted in the fragment shader).
+        // `damage` lists what changed since the frame rendered last (picture coordinates): only those
+        // rows are uploaded, and only that part of the window is reported to the compositor.
+        bool renderFrame(const VideoFrame& frame, const std::vector<DamageRect>* damage = nullptr);
+        bool supportsYuv() const { return yuv_supported; }
+
+        // Zero-copy path: wrap a DMA-BUF (hardware JPEG decoder surface) in an
+        // EGLImage and sample it as GL_TEXTURE_EXTERNAL_OES. Needs EGL_EXT_image_dma_buf_import.
+        bool renderDmaBuf(const DmaBufFrame& frame);
+        bool supportsDmaBuf() const { return dmabuf_supported; }
+
+        // monotonicMicros() when the last render had submitted its texture upload (or bound the
+        // imported DMA-BUF), for the pipeline's upload stage
+        uint64_t getUploadTime() const { return upload_time; }
         
         // Resize the rendering surface
         bool resize(int width, int height);
@@ -38,9 +64,47 @@ namespace openterface {
         const std::string& getLastError() const { return last_error; }
 
     private:
+        // Allocated storage of a streaming texture; glTexImage2D runs only when this changes
+        struct TextureStorage {
+            int width = 0;
+            int height = 0;
+            GLenum format = 0;
+            bool matches(GLenum f, int w, int h) const { return width == w && height == h && format == f; }
+        };
+
+        // Picture rows [begin, end) to upload for a partial update
+        struct RowSpan {
+            int begin;
+            int end;
+        };
+
+        // Part of the staging data that a partial update reads
+        struct ByteRange {
+            size_t offset;
+            size_t length;
+        };
+
+        static constexpr int kPixelBufferCount = 3;
+
         bool setupEGL();
         bool createShaders();
+        bool createYuvShaders();
+        bool drawYuvFrame(const VideoFrame& frame);
+        void setupPixelBuffers();
+        const uint8_t* stageUpload(const uint8_t* data, size_t size);
+        void finishUpload();
+        void uploadTexture(GLuint tex, TextureStorage& storage, GLenum format, int width, int height, const void* pixels,
+                           int row_divisor = 1);
+        void setDirtyRows(const std::vector<DamageRect>* damage, int height);
+        void addUploadRanges(size_t offset, size_t row_bytes, int row_divisor, int rows);
+        void setSwapDamage(const std::vector<DamageRect>* damage, int frame_width, int frame_height);
         bool setupVertexBuffer();
+        bool setupDmaBufImport();
+        GLuint compileProgram(const char* vertex_source, const char* fragment_source);
+        void drawTexturedQuad(GLuint program, GLint position, GLint texcoord, GLint sampler, GLenum target, GLuint tex);
+        bool presentFrame();
+        EGLImageKHR importDmaBuf(const DmaBufFrame& frame);
+        void releaseDmaBufImages();
         void printEGLError(const std::string& operation);
         void printGLError(const std::string& operation);
 
@@ -54,10 +118,12 @@ namespace openterface {
         struct wl_egl_window* egl_window = nullptr;
         struct wl_display* wayland_display = nullptr;
         struct wl_surface* wayland_surface = nullptr;
+        bool shared_display = false;
         
         // OpenGL resources
         GLuint shader_program = 0;
         GLuint texture = 0;
+        TextureStorage texture_storage;
         GLuint vbo = 0;
         GLuint vao = 0;
         
@@ -65,6 +131,66 @@ namespace openterface {
         GLint position_attr = -1;
         GLint texcoord_attr = -1;
         GLint texture_uniform = -1;
+
+        // YCbCr -> RGB programs: planar JPEG output (3 luminance textures) and packed YUYV
+        // (RGBA texture holding two pixels per texel)
+        bool yuv_supported = false;
+        GLuint planar_program = 0;
+        GLint planar_position_attr = -1;
+        GLint planar_texcoord_attr = -1;
+        GLint planar_y_uniform = -1;
+        GLint planar_cb_uniform = -1;
+        GLint planar_cr_uniform = -1;
+        GLint planar_luma_scale_uniform = -1;
+        GLint planar_chroma_scale_uniform = -1;
+        GLuint plane_textures[3] = {};
+        TextureStorage plane_storage[3];
+        GLuint yuyv_program = 0;
+        GLint yuyv_position_attr = -1;
+        GLint yuyv_texcoord_attr = -1;
+        GLint yuyv_texture_uniform = -1;
+        GLint yuyv_width_uniform = -1;
+        GLuint yuyv_texture = 0;
+        TextureStorage yuyv_storage;
+
+        // Upload staging ring (GLES3 or NV_pixel_buffer_object); without it uploads read client memory
+        bool pbo_supported = false;
+        GLuint pixel_buffers[kPixelBufferCount] = {};
+        size_t pixel_buffer_sizes[kPixelBufferCount] = {};
+        int pixel_buffer_index = 0;
+        PFNGLMAPBUFFERRANGEEXTPROC gl_map_buffer_range = nullptr;
+        PFNGLUNMAPBUFFEROESPROC gl_unmap_buffer = nullptr;
+
+        // Partial updates of mostly static pictures: dirty rows go to the textures with
+        // glTexSubImage2D, the window damage to eglSwapBuffersWithDamage (KHR or EXT)
+        bool partial_upload = false;
+        std::vector<RowSpan> dirty_rows;       // Merged, sorted
+        std::vector<ByteRange> upload_ranges;  // Staging data covering dirty_rows
+        std::vector<EGLint> swap_damage;       // x, y, width, height quads, bottom-left origin
+        bool surface_damaged = true;           // Resized: the next swap has to cover everything
+        uint64_t upload_time = 0;
+        PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC egl_swap_buffers_with_damage = nullptr;
+
+        // DMA-BUF import (external OES sampling, YUV conversion done by the driver)
+        struct DmaBufImage {
+            unsigned long inode = 0;  // dma-buf inode identifies the buffer even if an fd number is reused
+            uint32_t offset = 0;
+            int width = 0;
+            int height = 0;
+            uint32_t drm_format = 0;
+            EGLImageKHR image = EGL_NO_IMAGE_KHR;
+            GLuint texture = 0;
+        };
+        std::vector<DmaBufImage> dmabuf_images;  // One per recycled capture/decoder buffer
+        bool dmabuf_supported = false;
+        bool dmabuf_modifiers = false;
+        GLuint external_program = 0;
+        GLint external_position_attr = -1;
+        GLint external_texcoord_attr = -1;
+        GLint external_texture_uniform = -1;
+        PFNEGLCREATEIMAGEKHRPROC egl_create_image = nullptr;
+        PFNEGLDESTROYIMAGEKHRPROC egl_destroy_image = nullptr;
+        PFNGLEGLIMAGETARGETTEXTURE2DOESPROC gl_image_target_texture = nullptr;
         
         // State
         bool initialized = false;
@@ -1,15 +1,19 @@
 #pragma once
 
+#include "openterface/jpeg_decoder.hpp"
 #include <functional>
 #include <memory>
 #include <string>
 
+struct wl_display;
+
 namespace openterface {
 
     // Forward declarations
     class Video;
     class Input;
     class Serial;
+    class DecodePool;
 
     struct GUIInfo {
         bool window_created = false;
@@ -20,12 +24,30 @@ namespace openterface {
         int window_height = 1080;
     };
 
+    // Wayland connection shared by the windows of several KVM sessions in one process. Each window
+    // still dispatches its own objects on its own thread, through a private event queue.
+    class WaylandConnection {
+      public:
+        ~WaylandConnection();
+
+        // Connect to the compositor ($WAYLAND_DISPLAY); nullptr when there is none
+        static std::shared_ptr<WaylandConnection> connect();
+
+        struct wl_display *getDisplay() const { return display; }
+
+      private:
+        explicit WaylandConnection(struct wl_display *display) : display(display) {}
+
+        struct wl_display *display;
+    };
+
     class GUI {
       public:
         GUI();
         ~GUI();
 
         // GUI lifecycle
+        void setWaylandConnection(std::shared_ptr<WaylandConnection> connection); // Call before initialize()
         bool initialize();
         void shutdown();
         bool isInitialized() const;
@@ -37,6 +59,18 @@ namespace openterface {
 
         // Video display
         void setVideoSource(std::shared_ptr<Video> video);
+        void setDecoderBackend(DecoderBackend backend); // Call before startVideoDisplay()
+        void setDecodeThreads(int threads);             // 0 = auto; call before startVideoDisplay()
+        // Decode frames as tasks on a pool shared with other windows instead of on a thread of this
+        // window's own. Call before startVideoDisplay().
+        void setDecodePool(std::shared_ptr<DecodePool> pool);
+        // A window no larger than max_width x max_height is a thumbnail: it shows at most `fps`
+        // frames a second (0 = all) and its decodes yield to the other windows' on the shared pool
+        void setThumbnailPolicy(int max_width, int max_height, int fps);
+        // Frames a second the window takes while not focused / while hidden (0 = all; default 5
+        // and 1), and whether an active window decodes smaller and then takes fewer frames when
+        // a pipeline stage can't keep up with capture (default on)
+        void setGovernorPolicy(int unfocused_fps, int hidden_fps, bool adaptive);
         bool startVideoDisplay();
         void stopVideoDisplay();
         bool isVideoDisplaying() const;
@@ -60,6 +94,9 @@ namespace openterface {
 
         // Debug
         void setDebugMode(bool enabled);
+        // Print per-stage latency percentiles (capture to screen, input to serial) every `seconds`
+        // from runEventLoop(); 0 (default) logs a one-line summary every 300 frames instead
+        void setStatsInterval(int seconds);
 
         // Status
         GUIInfo getInfo() const;
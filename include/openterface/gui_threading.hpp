@@ -1,6 +1,7 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <functional>
 #include <mutex>
@@ -35,11 +36,13 @@ namespace openterface {
         std::queue<SurfaceCommitRequest> queue;
     };
 
-    // Input event for thread processing
+    // Input event handed from the Wayland callbacks to the input thread. Positions are already in
+    // CH9329 absolute coordinates and keys in HID usages, so the input thread needs no window state.
     struct InputEvent {
         enum Type { 
             MOUSE_MOVE, 
             MOUSE_BUTTON, 
+            MOUSE_SCROLL,
             KEY_PRESS, 
             KEY_RELEASE 
         };
@@ -49,19 +52,24 @@ namespace openterface {
         int button = 0;
         int key = 0;
         int modifiers = 0;
+        int scroll = 0;  // Wheel notches, positive = down
         bool pressed = false;
+        std::chrono::steady_clock::time_point timestamp;  // When the Wayland event arrived
     };
 
     // Thread management helpers
     class ThreadManager {
     public:
-        ThreadManager() = default;
+        ThreadManager();
         ~ThreadManager();
 
         // Start/stop threads
         void startWaylandEventThread(std::function<void()> func);
         void stopWaylandEventThread();
         
+        void startDecodeThread(std::function<void()> func);
+        void stopDecodeThread();
+
         void startRenderThread(std::function<void()> func);
         void stopRenderThread();
         
@@ -70,21 +78,39 @@ namespace openterface {
 
         // Thread state
         bool isWaylandThreadRunning() const { return wayland_thread_running.load(); }
+        bool isDecodeThreadRunning() const { return decode_thread_running.load(); }
         bool isRenderThreadRunning() const { return render_thread_running.load(); }
         bool isInputThreadRunning() const { return input_thread_running.load(); }
 
-        // Synchronization
-        void notifyRender() { render_cv.notify_one(); }
-        void notifyInput() { input_cv.notify_one(); }
+        // Synchronization. Taking the mutex orders the notify after a waiter's predicate check, so a
+        // frame published between the check and the wait can't be missed.
+        void notifyDecode() {
+            { std::lock_guard<std::mutex> lock(decode_mutex); }
+            decode_cv.notify_one();
+        }
+        void notifyRender() {
+            { std::lock_guard<std::mutex> lock(render_mutex); }
+            render_cv.notify_one();
+        }
+        void notifyInput() {
+            { std::lock_guard<std::mutex> lock(input_mutex); }
+            input_cv.notify_one();
+        }
+
+        // Wake the Wayland thread out of poll() (eventfd, polled alongside the display fd)
+        void wakeWayland();
+        int getWaylandWakeFd() const { return wayland_wake_fd; }
+        void clearWaylandWake();
 
         // Thread-safe flags
         std::atomic<bool> wayland_thread_running{false};
+        std::atomic<bool> decode_thread_running{false};
         std::atomic<bool> render_thread_running{false};
         std::atomic<bool> input_thread_running{false};
-        std::atomic<bool> frame_ready_for_render{false};
-        std::atomic<bool> buffer_swap_ready{false};
 
         // Synchronization primitives
+        std::mutex decode_mutex;
+        std::condition_variable decode_cv;
         std::mutex render_mutex;
         std::condition_variable render_cv;
         std::mutex input_mutex;
@@ -92,8 +118,10 @@ namespace openterface {
 
     private:
         std::thread wayland_event_thread;
+        std::thread decode_thread;
         std::thread render_thread;
         std::thread input_thread;
+        int wayland_wake_fd = -1;
     };
 
 } // namespace openterface
\ No newline at end of file
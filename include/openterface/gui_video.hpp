@@ -4,11 +4,13 @@
 #include <vector>
 #include <memory>
 #include <mutex>
+#include <string>
+#include "openterface/frame_damage.hpp"
+#include "openterface/jpeg_decoder.hpp"
 
 namespace openterface {
 
     // Forward declarations
-    class JpegDecoder;
     struct FrameData;
 
     // Video frame processing functions
@@ -16,7 +18,19 @@ namespace openterface {
         std::vector<uint8_t> data;
         int width = 0;
         int height = 0;
-        bool is_rgb = false;
+        bool is_rgb = false;  // Holds decoded pixels (in `format` layout)
+        PixelFormat format = PixelFormat::RGB24;
+        bool has_dmabuf = false;  // Zero-copy frame: `dmabuf` describes it, `data` is not filled
+        DmaBufFrame dmabuf;
+        bool is_yuv = false;      // `data` holds YCbCr for the GPU shaders: JPEG planes or packed YUYV
+        bool is_yuyv = false;     // Packed limited-range YUYV, rows tightly packed (width * 2 bytes)
+        YuvPlanes planes;         // Geometry of the full-range planes when is_yuv && !is_yuyv
+
+        // Change detection (VideoProcessor::setChangeDetection)
+        bool unchanged = false;            // Same picture as the last published frame: don't display it
+        uint64_t sequence = 0;             // Counts published frames; 0 = no change tracking
+        bool full_damage = true;           // Everything may differ from frame sequence - 1 ...
+        std::vector<DamageRect> damage;    // ... otherwise only these areas do (picture coordinates)
     };
 
     class VideoProcessor {
@@ -24,20 +38,76 @@ namespace openterface {
         VideoProcessor();
         ~VideoProcessor();
 
-        // Process incoming frame data
+        // Process incoming frame data. Succeeds with output.unchanged set when change detection
+        // found nothing new to display.
         bool processFrame(const FrameData& frame, VideoFrame& output);
-        
+
+        // Choose the decoded pixel layout (XRGB8888 for wl_shm, RGBX8888 for GL). Returns false and
+        // keeps RGB24 when the decoder cannot produce it; callers then rely on the repacking paths.
+        bool setOutputFormat(PixelFormat format);
+        PixelFormat getOutputFormat() const;
+
+        // Switch decoder implementation; unavailable hardware backends fall back to libjpeg.
+        // A hardware decoder that fails on a frame is also replaced by libjpeg for the rest of the session.
+        void setDecoderBackend(DecoderBackend backend);
+        DecoderBackend getDecoderBackend() const;
+
+        // Software decode threads: frames with restart markers are split into strips decoded in
+        // parallel; without markers decoding stays on one thread and overlaps with capture and
+        // rendering instead. 0 = one per core (up to 4), 1 = single-threaded.
+        void setDecodeThreads(int threads);
+        int getDecodeThreads() const { return decode_threads; }
+
+        // Size the picture is displayed at (the window). Software MJPEG decoding to packed pixels
+        // then runs at the smallest libjpeg DCT scale (1/2, 1/4, 1/8) that still covers it, so a
+        // 1080p stream in a 960x540 window decodes a quarter of the pixels. 0 x 0 = full size.
+        void setTargetSize(int width, int height);
+
+        // Hand frames to the renderer as DMA-BUFs when possible (YUYV capture buffers, hardware
+        // decoder output) instead of decoding to CPU memory. Only enable with a renderer that can import them.
+        void setZeroCopy(bool enabled) { zero_copy = enabled; resetChangeDetection(); }
+        bool getZeroCopy() const { return zero_copy; }
+
+        // Leave YCbCr -> RGB to the renderer: JPEG frames are decoded to planes (raw_data_out) and
+        // YUYV frames are passed through. Only enable with a renderer that has the YUV shaders.
+        void setYuvOutput(bool enabled) { yuv_output = enabled; resetChangeDetection(); }
+        bool getYuvOutput() const { return yuv_output; }
+
+        // Skip frames that show the same picture as the previous one: MJPEG payloads identical to
+        // the last one are dropped before decoding, and decoded frames are compared tile by tile.
+        // Frames that do change are numbered and carry the changed areas (VideoFrame::damage).
+        void setChangeDetection(bool enabled) { change_detection = enabled; resetChangeDetection(); }
+        bool getChangeDetection() const { return change_detection; }
+
         // Get last error message
         const std::string& getLastError() const { return last_error; }
 
     private:
+        bool decodeFrame(const FrameData& frame, VideoFrame& output);
+        bool processYuyvFrame(const FrameData& frame, VideoFrame& output);
+        std::unique_ptr<JpegDecoder> createSoftwareDecoder() const;
+        bool isRepeatedPayload(const FrameData& frame, uint64_t& payload_hash) const;
+        void trackChanges(const FrameData& frame, uint64_t payload_hash, VideoFrame& output);
+        void resetChangeDetection();
+
         std::unique_ptr<JpegDecoder> jpeg_decoder;
+        bool zero_copy = false;
+        bool yuv_output = false;
+        int decode_threads = 1;
+        int target_width = 0;
+        int target_height = 0;
+
+        bool change_detection = false;
+        uint64_t sequence = 0;
+        uint64_t last_payload_hash = 0;  // Fingerprint of the last published MJPEG payload
+        size_t last_payload_size = 0;    // 0 = none
+        FrameChangeDetector change_detector;
         std::string last_error;
     };
 
-    // Buffer rendering functions
+    // Buffer rendering functions. With `region` (buffer coordinates) only that part is redrawn.
     void renderVideoToBuffer(void* buffer, int buffer_width, int buffer_height,
-                            const VideoFrame& frame);
+                            const VideoFrame& frame, const DamageRect* region = nullptr);
     
     void fillBufferWithPattern(void* buffer, int width, int height, uint8_t frame_counter);
     
@@ -3,12 +3,13 @@
 #include <wayland-client.h>
 #include <wayland-cursor.h>
 #include "wayland/xdg-shell-client-protocol.h"
+#include "wayland/presentation-time-client-protocol.h"
+#include "openterface/gui_threading.hpp"
+#include <atomic>
+#include <chrono>
 #include <functional>
 #include <string>
 #include <memory>
-#include <queue>
-#include <mutex>
-#include <condition_variable>
 
 namespace openterface {
 
@@ -20,10 +21,14 @@ namespace openterface {
     // Helper struct for Wayland callbacks
     struct WaylandCallbackData {
         struct wl_compositor *compositor = nullptr;
+        uint32_t compositor_version = 0;  // Bound version; wl_surface.damage_buffer needs 4
         struct wl_shell *shell = nullptr;
         struct wl_shm *shm = nullptr;
         struct xdg_wm_base *xdg_wm_base = nullptr;
         struct wl_seat *seat = nullptr;
+        uint32_t seat_version = 0;  // wl_pointer.frame needs 5
+        struct wp_presentation *presentation = nullptr;
+        uint32_t presentation_clock = 1;  // clockid_t of presentation timestamps (CLOCK_MONOTONIC until told)
         std::function<void(const std::string &)> log_func;
 
         // Input state tracking
@@ -33,14 +38,18 @@ namespace openterface {
 
         // Window and buffer management
         struct wl_surface *surface = nullptr;
-        struct wl_buffer **buffer_ptr = nullptr;
         void **shm_data_ptr = nullptr;
         int *shm_fd_ptr = nullptr;
         int *current_width = nullptr;
         int *current_height = nullptr;
         bool *needs_resize = nullptr;
 
+        // States of the last xdg_toplevel configure; "suspended" needs xdg_wm_base version 6
+        bool window_activated = true;
+        bool window_suspended = false;
+
         // Resize state tracking
+        std::chrono::steady_clock::time_point last_configure;  // Configure rate limiting, per window
         bool is_resizing = false;
         int resize_edge = 0;
         int last_mouse_x = 0;
@@ -63,10 +72,11 @@ namespace openterface {
         std::shared_ptr<Input> *input_ptr = nullptr;
         std::shared_ptr<Serial> *serial_ptr = nullptr;
 
-        // Input queue for non-blocking event processing
-        void *input_queue_ptr = nullptr;  // Will be cast to proper type in implementation
-        std::mutex *input_mutex_ptr = nullptr;
-        std::condition_variable *input_cv_ptr = nullptr;
+        // Hands events to the input thread, which does the (blocking) serial writes
+        std::function<void(const InputEvent &)> queue_input;
+
+        // Motion since the last wl_pointer.frame, sent as one absolute move when the frame ends
+        bool motion_pending = false;
 
         // Resize constants
         static constexpr int RESIZE_BORDER = 10; // 10px border for resize detection
@@ -74,9 +84,9 @@ namespace openterface {
         // Keyboard modifier tracking
         uint32_t current_modifiers = 0;
         
-        // Video frame information for accurate mouse coordinate mapping
-        int *video_width_ptr = nullptr;
-        int *video_height_ptr = nullptr;
+        // Video frame information for accurate mouse coordinate mapping (written by the decode thread)
+        const std::atomic<int> *video_width_ptr = nullptr;
+        const std::atomic<int> *video_height_ptr = nullptr;
     };
 
     // Wayland protocol callbacks
@@ -100,6 +110,9 @@ namespace openterface {
     void registry_global_remove(void *data, struct wl_registry *registry, uint32_t id);
     extern const struct wl_registry_listener registry_listener;
     
+    void presentation_clock_id(void *data, struct wp_presentation *presentation, uint32_t clk_id);
+    extern const struct wp_presentation_listener presentation_listener;
+
     void simple_seat_capabilities(void *data, struct wl_seat *seat, uint32_t capabilities);
     void simple_seat_name(void *data, struct wl_seat *seat, const char *name);
     extern const struct wl_seat_listener simple_seat_listener;
@@ -2,30 +2,202 @@
 
 #include <vector>
 #include <cstdint>
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <atomic>
 
 namespace openterface {
 
+// Pixel layouts the decoder can write directly
+enum class PixelFormat {
+    RGB24,     // R,G,B bytes - always available
+    XRGB8888,  // B,G,R,X bytes (little-endian 0xXXRRGGBB) - same layout as WL_SHM_FORMAT_XRGB8888
+    RGBX8888,  // R,G,B,X bytes - uploads directly as GL_RGBA
+};
+
+constexpr int bytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::RGB24 ? 3 : 4;
+}
+
+// Decoder implementations selectable at runtime
+enum class DecoderBackend {
+    Libjpeg,   // Software decode (libjpeg / libjpeg-turbo), always available
+    Vaapi,     // VA-API VLD JPEG baseline decode on a DRM render node
+    V4l2M2m,   // V4L2 mem2mem JPEG decoder (/dev/videoN taking JPEG on its OUTPUT queue)
+    Auto,      // First working hardware backend, else libjpeg
+};
+
+const char* decoderBackendName(DecoderBackend backend);
+bool parseDecoderBackend(const std::string& name, DecoderBackend& backend);
+
+// A decoder-owned picture buffer and its exported DMA-BUF fds. While it is lent out the decoder
+// won't decode into it again, and the fds stay open until the decoder and every holder let go.
+struct DmaBufLease {
+    DmaBufLease() = default;
+    DmaBufLease(const DmaBufLease&) = delete;
+    DmaBufLease& operator=(const DmaBufLease&) = delete;
+    ~DmaBufLease();
+
+    std::atomic<bool> lent{false};
+    std::vector<int> fds;
+
+    bool available() const { return !lent.load(std::memory_order_acquire); }
+    // Marks the buffer lent; it comes back when the last copy of the returned token is dropped
+    static std::shared_ptr<void> lend(const std::shared_ptr<DmaBufLease>& lease);
+};
+
+// Hardware-decoded picture exported as DMA-BUF planes (DRM PRIME), for zero-copy import into EGL
+struct DmaBufFrame {
+    static constexpr int kMaxPlanes = 4;
+
+    int width = 0;
+    int height = 0;
+    uint32_t drm_format = 0;   // DRM fourcc of the image (e.g. NV12, YUYV)
+    uint64_t modifier = 0;     // DRM format modifier (0 = linear)
+    int num_planes = 0;
+    int fds[kMaxPlanes] = {-1, -1, -1, -1};  // Owned by the decoder, valid while hold is set
+    uint32_t offsets[kMaxPlanes] = {};
+    uint32_t pitches[kMaxPlanes] = {};
+    bool full_range = true;    // YCbCr range (JPEG output is full range, UVC YUYV is limited)
+    std::shared_ptr<void> hold;  // Keeps the buffer out of the decoder's rotation; reset once on screen
+};
+
+// Planar YCbCr picture straight from the IDCT (libjpeg raw_data_out): no colour conversion or
+// chroma upsampling on the CPU. Planes are stored back to back, padded to whole DCT blocks, with
+// tightly packed rows; only the top-left width x height (divided by the subsampling) is picture.
+struct YuvPlanes {
+    static constexpr int kNumPlanes = 3;  // Y, Cb, Cr
+
+    int width = 0;        // Visible picture size
+    int height = 0;
+    int subsample_x = 1;  // Chroma subsampling: 2x2 for 4:2:0, 2x1 for 4:2:2, 1x1 for 4:4:4
+    int subsample_y = 1;
+    int plane_widths[kNumPlanes] = {};   // Allocated plane size in samples (= row stride in bytes)
+    int plane_heights[kNumPlanes] = {};
+    size_t offsets[kNumPlanes] = {};     // Plane start within the storage buffer
+};
+
 struct DecodedFrame {
-    std::vector<uint8_t> rgb_data;  // RGB24 pixel data
+    std::vector<uint8_t> rgb_data;  // Pixel data in `format` layout
     int width;
     int height;
-    int channels;  // Should be 3 for RGB
+    int channels;  // Bytes per pixel (3 for RGB24, 4 for the 32-bit formats)
+    PixelFormat format = PixelFormat::RGB24;
 };
 
+// MJPEG decoder interface. Backends implement decodeFrame(); destination handling is shared.
 class JpegDecoder {
 public:
-    JpegDecoder();
-    ~JpegDecoder();
+    virtual ~JpegDecoder();
 
-    // Decode MJPEG frame to RGB24
+    // Create a decoder for the requested backend. A hardware backend that can't be opened on
+    // this machine falls back to libjpeg, so this always returns a usable decoder.
+    static std::unique_ptr<JpegDecoder> create(DecoderBackend backend = DecoderBackend::Libjpeg);
+
+    virtual DecoderBackend getBackend() const = 0;
+
+    // Select the output layout. Returns false (and keeps the current format) when the backend
+    // cannot produce it (libjpeg needs libjpeg-turbo's extended colour spaces for 32-bit output).
+    bool setOutputFormat(PixelFormat format);
+    PixelFormat getOutputFormat() const { return output_format; }
+    virtual bool supportsFormat(PixelFormat format) const = 0;
+
+    // Size the picture will be shown at. Packed-pixel decodes then use the smallest DCT scale (1/1, 1/2,
+    // 1/4 or 1/8) whose output still covers width x height, which skips most of the IDCT, upsampling
+    // and colour conversion work for small windows. (0, 0) = always full size. Backends that can't
+    // scale ignore it, as do the planar and DMA-BUF paths, so callers go by the decoded width/height.
+    void setScaleTarget(int width, int height);
+
+    // Decode MJPEG frame in the output format (reuses output.rgb_data storage when the size is unchanged)
     bool decode(const uint8_t* jpeg_data, size_t jpeg_size, DecodedFrame& output);
-    
+
+    // Decode MJPEG frame in the output format directly into a caller-owned buffer.
+    // dst_stride is the destination row pitch in bytes (0 = tightly packed).
+    // width/height are always set once the header has been parsed, so a caller whose
+    // buffer was too small can grow it and retry.
+    bool decodeInto(const uint8_t* jpeg_data, size_t jpeg_size, uint8_t* dst, size_t dst_capacity,
+                    size_t dst_stride, int& width, int& height);
+
+    // Decode without CPU readback and describe the result as DMA-BUF planes.
+    // Only hardware backends support this; the default implementation fails.
+    virtual bool decodeToDmaBuf(const uint8_t* jpeg_data, size_t jpeg_size, DmaBufFrame& frame);
+
+    // Decode to full-range YCbCr planes in `storage` (resized only when the geometry changes),
+    // leaving colour conversion to the GPU. Fails for greyscale/CMYK or unusual subsampling;
+    // the default implementation always fails.
+    virtual bool decodeToYuvPlanes(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>& storage,
+                                   YuvPlanes& planes);
+
     // Get last error message
     std::string getLastError() const;
 
-private:
+protected:
+    JpegDecoder() = default;
+
+    // Backend decode; when grow_buffer is set it is resized to fit and used as the destination
+    virtual bool decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                             uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) = 0;
+
+    // Resolve the destination for a width x height frame in the current output format.
+    // Grows grow_buffer when set; returns nullptr (with last_error) if the target doesn't fit.
+    uint8_t* prepareTarget(int width, int height, std::vector<uint8_t>* grow_buffer, uint8_t* dst,
+                           size_t dst_capacity, size_t dst_stride, size_t& row_stride);
+
+    // Scale denominator (1, 2, 4 or 8) for a width x height picture under the current scale target
+    int scaleDenominator(int width, int height) const;
+
+    PixelFormat output_format = PixelFormat::RGB24;
+    int scale_target_width = 0;
+    int scale_target_height = 0;
+    int fixed_scale_denom = 0;
     std::string last_error;
 };
 
-} // namespace openterface
\ No newline at end of file
+// Software decoder built on libjpeg(-turbo)
+class LibjpegDecoder : public JpegDecoder {
+public:
+    LibjpegDecoder();
+    ~LibjpegDecoder() override;
+
+    DecoderBackend getBackend() const override { return DecoderBackend::Libjpeg; }
+    bool supportsFormat(PixelFormat format) const override;
+
+    bool decodeToYuvPlanes(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>& storage,
+                           YuvPlanes& planes) override;
+
+    // Decode at exactly 1/denom size regardless of the scale target (0 = follow the target); used
+    // for strips of a larger picture, which must all be scaled alike
+    void setScaleDenominator(int denom) { fixed_scale_denom = denom; }
+
+    // decodeToYuvPlanes() into caller-owned planes, each with row stride planes.plane_widths[c]
+    // and at least dst_capacity[c] bytes (used to write slices straight into a larger frame)
+    bool decodeYuvPlanesInto(const uint8_t* jpeg_data, size_t jpeg_size, uint8_t* const dst[YuvPlanes::kNumPlanes],
+                             const size_t dst_capacity[YuvPlanes::kNumPlanes], YuvPlanes& planes);
+
+protected:
+    bool decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                     uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) override;
+
+private:
+    bool validateLayout();
+    bool decodeRaw(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* storage, uint8_t* const* dst,
+                   const size_t* dst_capacity, YuvPlanes& planes);
+
+    // Persistent libjpeg decompressor (kept out of the header to avoid leaking jpeglib.h)
+    struct State;
+    std::unique_ptr<State> state;
+};
+
+// Hardware backends (jpeg_decoder_vaapi.cpp / jpeg_decoder_v4l2.cpp). Return nullptr with
+// `error` set when the backend isn't compiled in or no suitable device is present.
+std::unique_ptr<JpegDecoder> createVaapiJpegDecoder(std::string& error);
+std::unique_ptr<JpegDecoder> createV4l2M2mJpegDecoder(std::string& error);
+
+// Multi-threaded libjpeg decoder (jpeg_decoder_parallel.cpp). Frames with restart markers at MCU
+// row boundaries are cut into strips that `threads` workers decode concurrently, each straight
+// into its own rows of the output; other frames decode on the calling thread. Reports the
+// Libjpeg backend.
+std::unique_ptr<JpegDecoder> createSliceJpegDecoder(int threads);
+
+} // namespace openterface
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace openterface {
+
+// Baseline JPEG headers split out for hardware decoders, which take the tables and the
+// entropy-coded scan separately instead of the whole file
+struct JpegHeaderInfo {
+    static constexpr int kMaxComponents = 4;
+    static constexpr int kMaxTables = 4;
+
+    struct Component {
+        uint8_t id = 0;
+        uint8_t h_samp = 1;
+        uint8_t v_samp = 1;
+        uint8_t quant_table = 0;
+    };
+
+    struct ScanComponent {
+        uint8_t id = 0;
+        uint8_t dc_table = 0;
+        uint8_t ac_table = 0;
+    };
+
+    struct HuffmanTable {
+        bool present = false;
+        uint8_t bits[16] = {};     // Number of codes of each length 1..16
+        uint8_t values[162] = {};  // Symbols in code order (162 is the AC maximum)
+        int num_values = 0;
+    };
+
+    int width = 0;
+    int height = 0;
+    size_t sof_offset = 0;  // Offset of the SOFn marker (frame height is at +5)
+    bool baseline = false;  // SOF0/SOF1 with 8-bit samples (what VA-API / M2M decoders accept)
+
+    int num_components = 0;
+    Component components[kMaxComponents];
+    int max_h_samp = 1;
+    int max_v_samp = 1;
+
+    bool quant_present[kMaxTables] = {};
+    uint8_t quant_tables[kMaxTables][64] = {};  // 8-bit tables in zig-zag (file) order
+
+    HuffmanTable dc_tables[kMaxTables];
+    HuffmanTable ac_tables[kMaxTables];
+
+    int restart_interval = 0;
+
+    int scan_num_components = 0;
+    ScanComponent scan_components[kMaxComponents];
+
+    // Entropy-coded data following the SOS header, up to (not including) EOI
+    size_t scan_offset = 0;
+    size_t scan_size = 0;
+
+    // MCU grid for the (interleaved) scan
+    int mcusPerRow() const { return (width + 8 * max_h_samp - 1) / (8 * max_h_samp); }
+    int mcuRows() const { return (height + 8 * max_v_samp - 1) / (8 * max_v_samp); }
+};
+
+// Parse SOI..SOS of a single-scan JPEG. Missing Huffman tables (common in MJPEG, which relies
+// on the Annex K defaults) are filled in with the standard tables.
+bool parseJpegHeader(const uint8_t* data, size_t size, JpegHeaderInfo& info, std::string& error);
+
+// Offsets of the RSTn markers inside the scan described by `info`, in stream order
+void findRestartMarkers(const uint8_t* data, const JpegHeaderInfo& info, std::vector<size_t>& positions);
+
+// Offset of the SOS marker of a JPEG without a DHT segment, 0 when it has its tables (or can't be
+// walked). Readers other than libjpeg - browsers - don't fall back to the Annex K defaults, so a
+// frame served to them needs standardHuffmanSegment() inserted at that offset.
+size_t findMissingHuffmanTables(const uint8_t* data, size_t size);
+
+// DHT segment (marker included) with the four Annex K tables
+const std::vector<uint8_t>& standardHuffmanSegment();
+
+} // namespace openterface
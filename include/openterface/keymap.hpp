@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace openterface {
+
+    namespace keymap {
+
+        // USB HID keyboard page usage -> Linux evdev key code, as the kernel's usbkbd driver maps
+        // them (0 = no key). Usages 0xE0-0xE7 are the modifiers.
+        inline constexpr uint8_t kHidToEvdev[0xE8] = {
+            0,   0,   0,   0,   30,  48,  46,  32,  18,  33,  34,  35,  23,  36,  37,  38,   // 0x00
+            50,  49,  24,  25,  16,  19,  31,  20,  22,  47,  17,  45,  21,  44,  2,   3,    // 0x10
+            4,   5,   6,   7,   8,   9,   10,  11,  28,  1,   14,  15,  57,  12,  13,  26,   // 0x20
+            27,  43,  43,  39,  40,  41,  51,  52,  53,  58,  59,  60,  61,  62,  63,  64,   // 0x30
+            65,  66,  67,  68,  87,  88,  99,  70,  119, 110, 102, 104, 111, 107, 109, 106,  // 0x40
+            105, 108, 103, 69,  98,  55,  74,  78,  96,  79,  80,  81,  75,  76,  77,  71,   // 0x50
+            72,  73,  82,  83,  86,  127, 116, 117, 183, 184, 185, 186, 187, 188, 189, 190,  // 0x60
+            191, 192, 193, 194, 134, 138, 130, 132, 128, 129, 131, 137, 133, 135, 136, 113,  // 0x70
+            115, 114, 0,   0,   0,   121, 0,   89,  93,  124, 92,  94,  95,  0,   0,   0,    // 0x80
+            122, 123, 90,  91,  85,  0,   0,   0,   0,   0,   0,   0,   111, 0,   0,   0,    // 0x90
+            0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,    // 0xA0
+            0,   0,   0,   0,   0,   0,   179, 180, 0,   0,   0,   0,   0,   0,   0,   0,    // 0xB0
+            0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,    // 0xC0
+            0,   0,   0,   0,   0,   0,   0,   0,   111, 0,   0,   0,   0,   0,   0,   0,    // 0xD0
+            29,  42,  56,  125, 97,  54,  100, 126,                                          // 0xE0
+        };
+
+        // Every evdev key code below KEY_MAX that has a keyboard-page usage is below 256
+        constexpr size_t kEvdevCodes = 256;
+
+        // The inverse, indexed by evdev code. Where several usages share a key (backslash / ISO
+        // hash, Delete / Clear) the lowest usage - the one on a standard keyboard - wins.
+        constexpr std::array<uint8_t, kEvdevCodes> makeEvdevToHid() {
+            std::array<uint8_t, kEvdevCodes> table{};
+            for (size_t usage = 0xE7; usage > 0; usage--) {
+                if (kHidToEvdev[usage] != 0) {
+                    table[kHidToEvdev[usage]] = static_cast<uint8_t>(usage);
+                }
+            }
+            return table;
+        }
+
+        inline constexpr std::array<uint8_t, kEvdevCodes> kEvdevToHid = makeEvdevToHid();
+
+    } // namespace keymap
+
+    // HID usage for a Linux evdev key code (what wl_keyboard and the input layer deliver); 0 when
+    // the key has no USB keyboard equivalent
+    constexpr uint8_t evdevToHid(uint32_t code) {
+        return code < keymap::kEvdevCodes ? keymap::kEvdevToHid[code] : 0;
+    }
+
+    static_assert(evdevToHid(30) == 0x04, "KEY_A");
+    static_assert(evdevToHid(43) == 0x31, "KEY_BACKSLASH");
+    static_assert(evdevToHid(88) == 0x45, "KEY_F12");
+    static_assert(evdevToHid(111) == 0x4C, "KEY_DELETE");
+    static_assert(evdevToHid(125) == 0xE3, "KEY_LEFTMETA");
+
+} // namespace openterface
@@ -11,6 +11,8 @@ namespace openterface {
     class Video;
     class Input;
     class GUI;
+    class DecodePool;
+    class WaylandConnection;
 
     struct KVMDeviceInfo {
         std::string device_id;
@@ -30,6 +32,7 @@ namespace openterface {
         std::string serial_number;
         std::string serial_path;
         std::string video_path;
+        std::string usb_path;  // sysfs path of the hub the unit's functions share
         std::string description;
     };
 
@@ -38,14 +41,19 @@ namespace openterface {
         KVMManager();
         ~KVMManager();
 
-        // Device discovery
-        std::vector<KVMDevice> scanForDevices();
+        // Device discovery (DeviceDiscovery::shared(): cached, kept current by hotplug events
+        // while its monitor runs)
+        std::vector<KVMDevice> scanForDevices(bool refresh = false);
         bool isOpenterfaceDevice(const std::string &device_path);
 
         // Connection management
         bool connect(const std::string &device_id = ""); // Auto-detect if empty
         bool connectByPaths(const std::string &serial_path, const std::string &video_path);
         void disconnect();
+        // Disconnect, wait up to timeout_ms for the same unit (same USB port) to reappear - its
+        // nodes may be renumbered after a replug - and connect to it again, restarting the session
+        // if one was running
+        bool reconnect(int timeout_ms = 5000);
         bool isConnected() const;
 
         // Module access
@@ -67,6 +75,16 @@ namespace openterface {
         void stopKVMSession();
         bool isKVMSessionActive() const;
 
+        // Several sessions in one process (one per target): decode on a pool and open the window on
+        // a Wayland connection shared with the other sessions, instead of a decode thread and a
+        // connection per session. Call before startKVMSession().
+        void setSharedResources(std::shared_ptr<DecodePool> pool, std::shared_ptr<WaylandConnection> connection);
+        // Window startGUI() opens; "Openterface KVM" at 1920x1080 unless set
+        void setWindow(const std::string &title, int width, int height);
+        // Blocks on the session window's event loop (GUI::runEventLoop) until requestExit()
+        int runEventLoop();
+        void requestExit();
+
         // Information
         KVMDeviceInfo getDeviceInfo() const;
         std::string getDeviceDescription() const;
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "openterface/frame_damage.hpp"
+#include "openterface/jpeg_decoder.hpp"
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace openterface {
+
+enum class ScaleFilter {
+    Nearest,   // Point sampling - sharpest, aliases when shrinking
+    Bilinear,  // 2x2 taps in 1/128 steps, centre-aligned
+};
+
+// Instruction set of the row kernels chosen for this CPU: "avx2", "sse4.1", "neon" or "scalar"
+const char* pixelKernelName();
+
+// Force a kernel set by name (benchmarks, comparisons). Returns false if this CPU/build lacks it.
+bool selectPixelKernels(const std::string& name);
+
+// Convert one row of `format` pixels to XRGB8888 words (X = 0xFF)
+void convertRowToXrgb(const uint8_t* src, PixelFormat format, uint32_t* dst, int width);
+
+// Decoded frame -> XRGB8888 buffer conversion with scaling for the wl_shm path. Sampling tables and
+// row scratch are kept between frames and rebuilt only when the geometry or filter changes.
+class PixelScaler {
+public:
+    void setFilter(ScaleFilter filter) { this->filter = filter; }
+    ScaleFilter getFilter() const { return filter; }
+
+    // Stretch the source over the whole dst_width x dst_height destination; every destination
+    // pixel is written, so the buffer needs no clearing first. Strides are in bytes. With `region`
+    // (destination coordinates) only those pixels are computed, from the source pixels they sample.
+    void scale(const uint8_t* src, int src_width, int src_height, size_t src_stride, PixelFormat format,
+               uint32_t* dst, int dst_width, int dst_height, size_t dst_stride, const DamageRect* region = nullptr);
+
+private:
+    struct Tap {
+        int index;   // First source sample
+        int weight;  // Blend towards index + 1, 0..128
+    };
+
+    static void buildTaps(std::vector<Tap>& taps, int src, int dst, bool bilinear);
+    void prepare(int src_width, int src_height, int dst_width, int dst_height, ScaleFilter active);
+    const uint32_t* sourceRow(int y);
+
+    ScaleFilter filter = ScaleFilter::Bilinear;
+
+    // Geometry the tables were built for
+    ScaleFilter prepared_filter = ScaleFilter::Nearest;
+    int src_w = 0;
+    int src_h = 0;
+    int dst_w = 0;
+    int dst_h = 0;
+    std::vector<Tap> x_taps;  // Nearest: weight always 0
+    std::vector<Tap> y_taps;
+
+    // Current frame
+    const uint8_t* frame = nullptr;
+    size_t frame_stride = 0;
+    PixelFormat frame_format = PixelFormat::RGB24;
+    std::vector<uint32_t> converted[2];  // Source rows converted to XRGB, cached by row parity
+    int converted_row[2] = {-1, -1};
+    int span_begin = 0;                  // Source columns sampled by the region being drawn
+    int span_end = 0;
+    std::vector<uint32_t> blended;       // Vertically interpolated row
+};
+
+} // namespace openterface
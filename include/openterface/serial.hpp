@@ -19,6 +19,18 @@ namespace openterface {
         bool connecting = false;
     };
 
+    struct KeyboardReport;
+
+    // Result of Serial::runBenchmark()
+    struct SerialBenchmark {
+        int baudrate = 0;
+        std::vector<double> latencies_ms;  // Completed CMD_GET_INFO round trips, sorted
+        int timeouts = 0;                  // Round trips without a reply within 100 ms
+        int packets_sent = 0;
+        int packets_acked = 0;
+        double seconds = 0.0;              // First packet written to the last acknowledgement
+    };
+
     // Callback for connection status updates
     using ConnectionCallback = std::function<void(bool success, const std::string& message)>;
 
@@ -34,18 +46,41 @@ namespace openterface {
         bool isConnecting() const;
 
         bool sendData(const std::vector<uint8_t> &data);
+        // Replies received that no command was waiting for (a reader thread owns the port)
         std::vector<uint8_t> readData();
 
-        // CH9329 specific commands
+        // CH9329 specific commands. Once connected these only queue the packet for a background
+        // writer and return (false = not connected or queue full), so they are safe to call from
+        // event callbacks. Commands keep their order; mouse moves pending behind them coalesce.
         bool sendKeyPress(int key_code, int modifiers = 0);
         bool sendKeyRelease(int key_code, int modifiers = 0);
         bool sendMouseMove(int x, int y, bool absolute = true);
         bool sendMouseButton(int button, bool pressed, int x = 0, int y = 0, bool absolute = true);
+        bool sendMouseWheel(int steps);  // Positive = scroll up
+        // Type UTF-8 text with the US layout (see TextEncoder for others). Blocks until the last
+        // report is queued, paced to what the chip acknowledges.
         bool sendText(const std::string &text);
+        bool sendKeyboardReports(const std::vector<KeyboardReport> &reports);
         bool sendCtrlAltDel();
         bool resetHID();
         bool factoryReset();
 
+        // Log every packet (hex dumps, key and button events); off by default so the input path
+        // formats nothing
+        void setVerbose(bool enabled);
+
+        // Move the link to the fastest UART rate (up to max_baud, 0 = any) that passes a round-trip
+        // test, and save it in the chip's configuration; connect() finds it again on its own.
+        // Returns true if the rate changed. Blocks for up to a few seconds.
+        bool negotiateBaudRate(int max_baud = 0);
+
+        // Time `round_trips` info requests, then push `packets` input reports back to back
+        bool runBenchmark(int round_trips, int packets, SerialBenchmark &result);
+
+        // Ask the chip for its status and wait for the reply (target_connected in getInfo());
+        // returns as soon as it arrives, false if it doesn't within timeout_ms
+        bool refreshInfo(int timeout_ms = 100);
+
         SerialInfo getInfo() const;
         std::vector<std::string> getAvailablePorts() const;
 
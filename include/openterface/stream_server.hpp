@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace openterface {
+
+    struct FrameData;
+    class Serial;
+
+    struct StreamServerStats {
+        int clients = 0;               // Connected viewers (stream and WebSocket)
+        uint64_t frames_published = 0; // Frames copied for viewers (none while nobody is connected)
+        uint64_t frames_sent = 0;      // Frames written out in full, summed over viewers
+        uint64_t frames_dropped = 0;   // Frames viewers skipped because they were still sending an older one
+        uint64_t bytes_sent = 0;
+        uint64_t input_events = 0;     // Remote input commands forwarded to the serial link
+    };
+
+    // Headless re-serving of the capture stream: MJPEG frames go out to network viewers exactly as
+    // the card compressed them, nothing is decoded.
+    //
+    //   GET /          Page showing the stream
+    //   GET /stream    multipart/x-mixed-replace MJPEG (an <img> source)
+    //   GET /snapshot  The next frame as one image/jpeg
+    //   GET /ws        WebSocket: one binary message per frame; text messages from the viewer are
+    //                  input commands (with an input target set):
+    //                    key <hid usage> <modifiers> down|up
+    //                    move <x> <y>                           absolute, 0..4095
+    //                    button left|right|middle down|up <x> <y>
+    //                    wheel <steps>                          positive = up
+    //                  Upgrades from a page on another origin (Origin not matching Host) are refused.
+    //
+    // publishFrame() copies each frame once into a reference-counted buffer that every viewer sends
+    // from with scatter I/O (part header, payload, trailer in one sendmsg). One thread runs every
+    // socket through epoll; a viewer still writing a frame skips to the newest one when it is done,
+    // so a slow viewer drops frames instead of holding back capture or the other viewers.
+    class StreamServer {
+      public:
+        StreamServer();
+        ~StreamServer();  // Stops the server
+
+        StreamServer(const StreamServer &) = delete;
+        StreamServer &operator=(const StreamServer &) = delete;
+
+        // Listen on address:port (IPv4, "0.0.0.0" = every interface) and start the I/O thread
+        bool start(const std::string &address, int port);
+        void stop();  // Stop feeding publishFrame() first
+        bool isRunning() const;
+
+        // Viewers beyond this are turned away with 503 (default 32). Connections count from the
+        // start; one that hasn't completed its request (or taken its response) within 10 s is
+        // closed, so idle sockets can't hold the slots. Set before start().
+        void setMaxClients(int count);
+        // Where WebSocket input commands go; none (the default) = view only. Set before start().
+        void setInputTarget(std::shared_ptr<Serial> serial);
+
+        // Safe from the capture callback: copies the payload and wakes the I/O thread, never
+        // waits on a viewer. Frames that aren't MJPEG are ignored.
+        void publishFrame(const FrameData &frame);
+
+        StreamServerStats getStats() const;
+        const std::string &getLastError() const;
+
+      private:
+        class Impl;
+        std::unique_ptr<Impl> pImpl;
+    };
+
+} // namespace openterface
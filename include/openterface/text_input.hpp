@@ -0,0 +1,60 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace openterface {
+
+    // One boot keyboard report: modifier bits (Ctrl=0x01, Shift=0x02, Alt=0x04, Meta=0x08,
+    // AltGr=0x40) and up to six pressed key usages
+    struct KeyboardReport {
+        uint8_t modifiers = 0;
+        std::array<uint8_t, 6> keys{};
+    };
+
+    // Names accepted by TextEncoder::setLayout()
+    std::vector<std::string> textLayouts();
+
+    // Turns text into the keyboard reports that type it on a target using a given keyboard layout.
+    //
+    // Consecutive characters that need the same modifiers and different keys share one report (up
+    // to the rollover limit), followed by a release, so a run of plain text costs two reports per
+    // six characters instead of two per character. Targets that lose keys pressed together (some
+    // firmware setup screens) want a rollover of 1.
+    class TextEncoder {
+    public:
+        TextEncoder();
+
+        // "us" (default), "gb" or "de"; false if unknown
+        bool setLayout(const std::string &name);
+        const std::string &getLayout() const { return layout; }
+
+        // Keys per report, 1..6
+        void setRollover(int keys);
+        int getRollover() const { return rollover; }
+
+        // Append the reports typing `text` (UTF-8). "\r\n" and lone "\r" type Enter. Returns the
+        // number of characters the layout can't type, which are skipped.
+        size_t encode(std::string_view text, std::vector<KeyboardReport> &reports) const;
+
+    private:
+        struct Stroke {
+            uint8_t usage = 0;
+            uint8_t modifiers = 0;
+        };
+        struct Keys {
+            Stroke strokes[2];
+            uint8_t count = 0;  // 2 = dead key followed by its base (typed alone)
+        };
+
+        std::string layout;
+        int rollover = 6;
+        std::unordered_map<char32_t, Keys> keymap;
+    };
+
+} // namespace openterface
@@ -4,11 +4,13 @@
 #include <functional>
 #include <memory>
 #include <string>
+#include <vector>
 
 namespace openterface {
 
     struct VideoInfo {
         std::string device_path;
+        std::string device_id;  // Card name and USB bus path (stable across /dev/videoN renumbering)
         int width = 1920;
         int height = 1080;
         int fps = 30;
@@ -23,8 +25,38 @@ namespace openterface {
         int width;
         int height;
         uint64_t timestamp;
+        uint32_t pixel_format = 0;  // V4L2 fourcc of the payload (MJPEG, YUYV)
+        uint32_t bytesperline = 0;  // Row pitch for uncompressed formats
     };
 
+    // One capture format/size with the frame rates the device offers for it (highest first)
+    struct VideoMode {
+        uint32_t pixel_format = 0; // V4L2 fourcc
+        std::string format;        // MJPG, YUYV
+        int width = 0;
+        int height = 0;
+        std::vector<int> frame_rates;
+    };
+
+    // How selectMode trades resolution against frame rate
+    enum class CapturePreference {
+        Latency, // Highest frame rate the display can show, then the cheapest mode to capture and decode
+        Quality, // Most picture detail the window can show, then frame rate
+    };
+
+    // Who allocates the capture buffers
+    enum class CaptureMemory {
+        Mmap,    // Driver buffers mapped into the process
+        UserPtr, // Page-aligned process memory the driver DMAs into
+        DmaBuf,  // Buffers from /dev/dma_heap/system queued by fd, read by the CPU like the others
+    };
+
+    const char *captureMemoryName(CaptureMemory memory);
+    bool parseCaptureMemory(const std::string &name, CaptureMemory &memory);
+
+    const char *capturePreferenceName(CapturePreference preference);
+    bool parseCapturePreference(const std::string &name, CapturePreference &preference);
+
     class Video {
       public:
         Video();
@@ -40,16 +72,45 @@ namespace openterface {
         void stopCapture();
         bool isCapturing() const;
 
+        // Buffering (applied by the next startCapture). More buffers ride out decode hiccups without
+        // the driver dropping frames; latest-frame mode drains every ready buffer and delivers only
+        // the newest, so a slow consumer sees the current picture instead of working through a backlog.
+        bool setBufferCount(int count); // 2..32, default 4
+        void setLatestFrameOnly(bool enabled);
+        bool setCaptureMemory(CaptureMemory memory);
+
         // Configuration
         bool setResolution(int width, int height);
+        // While capturing, the change is applied by the capture thread before its next buffer and
+        // getInfo().fps follows once it has; false then means an earlier change was refused
         bool setFrameRate(int fps);
         bool setFormat(const std::string &format); // MJPG, YUYV, etc.
+        bool setMode(uint32_t pixel_format, int width, int height, int fps = 0); // 0 = keep the frame rate
+
+        // Pick and apply a mode from getSupportedModes() for a window of display_width x display_height
+        // refreshing at display_fps. `format` restricts the choice to one fourcc name (empty = any).
+        bool selectMode(CapturePreference preference, int display_width, int display_height, int display_fps,
+                        const std::string &format = "");
 
         // Frame handling
         using FrameCallback = std::function<void(const FrameData &)>;
         void setFrameCallback(FrameCallback callback);
         bool getFrame(FrameData &frame, int timeout_ms = 1000);
 
+        // Recording (video_recording.hpp): the capture thread appends every frame it dequeues,
+        // up to `max_frames` (0 = until stopRecording)
+        bool startRecording(const std::string &path, uint64_t max_frames = 0);
+        void stopRecording();
+        bool isRecording() const;
+        uint64_t getRecordedFrames() const;
+
+        // Use a recording instead of a device. startCapture() then feeds FrameCallback from the
+        // mapped file at the recorded cadence, or back to back when `realtime` is false, restarting
+        // at the end when `loop` is set. Frames are stamped with the replay time so pipeline
+        // latency stats stay meaningful.
+        bool openReplay(const std::string &path, bool realtime = true, bool loop = true);
+        bool isReplay() const;
+
         // Wayland display
         bool createWaylandWindow(const std::string &title = "Openterface KVM");
         void destroyWaylandWindow();
@@ -61,6 +122,9 @@ namespace openterface {
         std::vector<std::string> getAvailableDevices() const;
         std::vector<std::string> getSupportedFormats() const;
         std::vector<std::pair<int, int>> getSupportedResolutions() const;
+        // Formats the pipeline can take (MJPEG, YUYV), probed with VIDIOC_ENUM_FMT / ENUM_FRAMESIZES /
+        // ENUM_FRAMEINTERVALS once per device ID and cached for the life of the process
+        std::vector<VideoMode> getSupportedModes() const;
 
       private:
         class Impl;
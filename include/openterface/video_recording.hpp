@@ -0,0 +1,108 @@
+#pragma once
+
+#include "openterface/video.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace openterface {
+
+    // Capture recordings: the compressed frames exactly as the capture card delivered them, with
+    // their V4L2 timestamps, so the decode and render pipeline can be profiled or a field issue
+    // reproduced without hardware.
+    //
+    // Layout (little-endian, everything 8-byte aligned so the file can be used in place through
+    // mmap):
+    //
+    //   RecordingHeader                      32 bytes
+    //   { RecordedFrameHeader, payload, pad to 8 } per frame
+    //
+    // The writer patches frame_count into the header when it is closed. A recording cut short
+    // (crash, unplug) still replays: the reader walks records until the data runs out.
+    namespace recording {
+
+        constexpr char kMagic[8] = {'O', 'T', 'M', 'J', 'P', 'E', 'G', '1'};
+        constexpr uint32_t kVersion = 1;
+
+        struct RecordingHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t pixel_format;  // V4L2 fourcc (MJPEG)
+            uint32_t width;
+            uint32_t height;
+            uint64_t frame_count;   // 0 until the writer is closed
+        };
+
+        struct RecordedFrameHeader {
+            uint64_t timestamp_us;  // V4L2 buffer timestamp (CLOCK_MONOTONIC)
+            uint32_t size;          // Payload bytes, not counting the padding
+            uint32_t reserved;
+        };
+
+        static_assert(sizeof(RecordingHeader) == 32 && sizeof(RecordedFrameHeader) == 16);
+
+        constexpr size_t align(size_t size) { return (size + 7) & ~size_t(7); }
+
+    } // namespace recording
+
+    // Appends frames to a recording. Not thread-safe: called from the capture thread only.
+    class RecordingWriter {
+    public:
+        RecordingWriter() = default;
+        ~RecordingWriter();
+
+        RecordingWriter(const RecordingWriter&) = delete;
+        RecordingWriter& operator=(const RecordingWriter&) = delete;
+
+        bool open(const std::string& path, int width, int height, uint32_t pixel_format);
+        bool write(const FrameData& frame);
+        void close();  // Writes the final frame count
+
+        bool isOpen() const { return fd >= 0; }
+        uint64_t getFrameCount() const { return frame_count; }
+        uint64_t getBytesWritten() const { return bytes_written; }
+        const std::string& getLastError() const { return last_error; }
+
+    private:
+        int fd = -1;
+        uint64_t frame_count = 0;
+        uint64_t bytes_written = 0;
+        std::string last_error;
+    };
+
+    // A recording mapped read-only; frames point straight into the mapping
+    class RecordingReader {
+    public:
+        struct Frame {
+            const uint8_t* data;
+            size_t size;
+            uint64_t timestamp_us;
+        };
+
+        RecordingReader() = default;
+        ~RecordingReader();
+
+        RecordingReader(const RecordingReader&) = delete;
+        RecordingReader& operator=(const RecordingReader&) = delete;
+
+        bool open(const std::string& path);
+        void close();
+
+        int getWidth() const { return width; }
+        int getHeight() const { return height; }
+        uint32_t getPixelFormat() const { return pixel_format; }
+        const std::vector<Frame>& getFrames() const { return frames; }
+        const std::string& getLastError() const { return last_error; }
+
+    private:
+        void* mapping = nullptr;
+        size_t mapping_size = 0;
+        int width = 0;
+        int height = 0;
+        uint32_t pixel_format = 0;
+        std::vector<Frame> frames;
+        std::string last_error;
+    };
+
+} // namespace openterface
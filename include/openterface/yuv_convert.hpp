@@ -0,0 +1,32 @@
+#pragma once
+
+#include "openterface/jpeg_decoder.hpp"
+#include <cstdint>
+#include <cstddef>
+
+namespace openterface {
+
+// YCbCr memory layouts produced by hardware decoders and V4L2 capture
+enum class YuvLayout {
+    I420,  // Planar 4:2:0 (Y, Cb, Cr)
+    NV12,  // Y plane + interleaved CbCr 4:2:0
+    I422,  // Planar 4:2:2
+    NV16,  // Y plane + interleaved CbCr 4:2:2
+    I444,  // Planar 4:4:4
+    YUYV,  // Packed 4:2:2 (Y0 Cb Y1 Cr)
+    Gray,  // Luma only
+};
+
+struct YuvImage {
+    YuvLayout layout = YuvLayout::NV12;
+    int width = 0;
+    int height = 0;
+    const uint8_t* planes[3] = {};  // Y, Cb (or CbCr), Cr - unused planes may be null
+    size_t strides[3] = {};
+    bool full_range = true;  // JFIF/JPEG decoders are full range; UVC YUYV capture is limited (16-235)
+};
+
+// Convert BT.601 YCbCr to `format`. dst_stride is the destination row pitch in bytes.
+bool convertYuvToPixels(const YuvImage& src, PixelFormat format, uint8_t* dst, size_t dst_stride);
+
+} // namespace openterface
@@ -1,18 +1,29 @@
 #include "openterface/cli.hpp"
+#include "openterface/decode_pool.hpp"
+#include "openterface/device_discovery.hpp"
 #include "openterface/gui.hpp"
 #include "openterface/input.hpp"
+#include "openterface/jpeg_decoder.hpp"
+#include "openterface/kvm.hpp"
 #include "openterface/serial.hpp"
+#include "openterface/stream_server.hpp"
+#include "openterface/text_input.hpp"
 #include "openterface/video.hpp"
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <sstream>
-#include <unistd.h> // for access()
+#include <thread>
+#include <unistd.h> // for close()
 #include <vector>
 
 // Linux headers for device detection
 #ifdef __linux__
-#include <cstring>
-#include <dirent.h>
 #include <fcntl.h>
 #include <linux/videodev2.h>
 #include <sys/ioctl.h>
@@ -20,6 +31,25 @@
 
 namespace openterface {
 
+    namespace {
+        // Set by SIGINT while `record` runs
+        std::atomic<bool> record_interrupted{false};
+        // Set by SIGINT while `multi` runs
+        std::atomic<bool> multi_interrupted{false};
+        // Set by SIGINT while `serve` runs
+        std::atomic<bool> serve_interrupted{false};
+
+        // Windows up to this size count as thumbnails in `multi`
+        constexpr int kThumbnailWidth = 640;
+        constexpr int kThumbnailHeight = 360;
+
+        // Initial window size, and the refresh rate --prefer assumes for it (the compositor's
+        // output rate isn't known before the window is mapped)
+        constexpr int kWindowWidth = 1920;
+        constexpr int kWindowHeight = 1080;
+        constexpr int kDisplayRefresh = 60;
+    }
+
     CLI::CLI() : app("Openterface USB KVM CLI", "openterface") {
         std::cout << "DEBUG: CLI constructor - starting" << std::endl;
 
@@ -58,7 +88,43 @@ namespace openterface {
         connect_cmd->add_flag("--no-serial", no_serial, "Disable input forwarding (even if device detected)");
         connect_cmd->add_flag("--dummy", dummy_mode, "Run in dummy mode (no device connection, GUI only)");
         connect_cmd->add_flag("--debug", debug_input, "Enable debug output for input events (mouse/keyboard)");
-        connect_cmd->callback([this]() {
+        connect_cmd->add_option("--decoder", decoder_backend,
+                                "MJPEG decoder: libjpeg, vaapi, v4l2m2m or auto (hardware falls back to libjpeg)")
+            ->check(::CLI::IsMember({"libjpeg", "vaapi", "v4l2m2m", "auto"}));
+        connect_cmd->add_option("--capture-format", capture_format,
+                                "Capture format: mjpg or yuyv (uncompressed, converted on the GPU where supported)")
+            ->check(::CLI::IsMember({"mjpg", "yuyv"}));
+        connect_cmd->add_option("--prefer", capture_preference,
+                                "Pick the capture mode: latency (highest displayable fps, cheapest decode) or quality "
+                                "(most detail the window shows)")
+            ->check(::CLI::IsMember({"latency", "quality"}));
+        connect_cmd->add_option("--capture-buffers", capture_buffers, "V4L2 capture buffers")
+            ->check(::CLI::Range(2, 32));
+        connect_cmd->add_flag("--latest-frame", latest_frame,
+                              "Drain every ready capture buffer and show only the newest (drops stale frames)");
+        connect_cmd->add_option("--capture-memory", capture_memory,
+                                "Capture buffer memory: mmap, userptr (process memory) or dmabuf (DMA heap buffers)")
+            ->check(::CLI::IsMember({"mmap", "userptr", "dmabuf"}));
+        connect_cmd->add_flag("--negotiate-baud", negotiate_baud,
+                              "Move the CH9329 link to the fastest UART rate that passes a round-trip test (saved on the chip)");
+        connect_cmd->add_option("--decode-threads", decode_threads,
+                                "Software MJPEG decode threads, used for streams with restart markers (0 = auto)")
+            ->check(::CLI::Range(0, 16));
+        connect_cmd->add_flag("--stats", show_stats,
+                              "Print p50/p99/max latency of every pipeline stage (capture to screen, input to serial)");
+        connect_cmd->add_option("--stats-interval", stats_interval, "Seconds between --stats reports")
+            ->check(::CLI::Range(1, 3600));
+        connect_cmd->add_option("--unfocused-fps", unfocused_fps, "Frame rate while the window isn't focused (0 = full rate)")
+            ->check(::CLI::Range(0, 240));
+        connect_cmd->add_option("--hidden-fps", hidden_fps, "Frame rate while the window is hidden (0 = full rate)")
+            ->check(::CLI::Range(0, 240));
+        connect_cmd->add_flag("--fixed-quality", fixed_quality,
+                              "Never decode smaller or drop the frame rate when decode or render falls behind");
+        connect_cmd->add_option("--replay", replay_file, "Play a file made with `record` instead of a capture device")
+            ->check(::CLI::ExistingFile);
+        connect_cmd->add_flag("--replay-fast", replay_fast,
+                              "Replay frames back to back instead of at the recorded rate (decode/render load test)");
+        connect_cmd->callback([this, connect_cmd]() {
             std::cout << "DEBUG: Enter connect callback" << std::endl;
 
             if (verbose)
@@ -66,32 +132,43 @@ namespace openterface {
 
             std::cout << "DEBUG: Checked verbose flag" << std::endl;
 
+            // Packet dumps cost a string per event, so they are only built when asked for
+            serial->setVerbose(verbose || debug_input);
+
+            ConnectionCallback on_serial;  // Set when a serial link is opened, for reconnects after a replug
+
             if (dummy_mode) {
                 std::cout << "Starting Openterface KVM in dummy mode..." << std::endl;
                 std::cout << "No device connections will be made." << std::endl;
             } else {
                 std::cout << "DEBUG: About to start device connection logic" << std::endl;
                 
-                // Auto-discovery logic
-                if (video_device.empty() && !no_video) {
-                    std::cout << "Auto-detecting video devices..." << std::endl;
-                    auto video_devices = findOpenterfaceVideoDevices();
-                    if (!video_devices.empty()) {
-                        video_device = video_devices[0];
-                        std::cout << "✓ Found video device: " << video_device << std::endl;
-                    } else {
-                        std::cout << "- No Openterface video devices detected" << std::endl;
-                    }
+                // A recording stands in for the capture device
+                if (!replay_file.empty() && !no_video) {
+                    video_device = replay_file;
                 }
-                
-                if (serial_port.empty() && !no_serial) {
-                    std::cout << "Auto-detecting serial devices..." << std::endl;
-                    auto serial_devices = findOpenterfaceSerialPorts();
-                    if (!serial_devices.empty()) {
-                        serial_port = serial_devices[0];
-                        std::cout << "✓ Found serial device: " << serial_port << std::endl;
-                    } else {
-                        std::cout << "- No Openterface serial devices detected" << std::endl;
+
+                // Auto-discovery logic: the video and serial node of one unit
+                if ((video_device.empty() && !no_video) || (serial_port.empty() && !no_serial)) {
+                    std::cout << "Auto-detecting Openterface devices..." << std::endl;
+                    KVMDevice device;
+                    findOpenterfaceDevice(device);
+
+                    if (video_device.empty() && !no_video) {
+                        if (!device.video_path.empty()) {
+                            video_device = device.video_path;
+                            std::cout << "✓ Found video device: " << video_device << std::endl;
+                        } else {
+                            std::cout << "- No Openterface video devices detected" << std::endl;
+                        }
+                    }
+                    if (serial_port.empty() && !no_serial) {
+                        if (!device.serial_path.empty()) {
+                            serial_port = device.serial_path;
+                            std::cout << "✓ Found serial device: " << serial_port << std::endl;
+                        } else {
+                            std::cout << "- No Openterface serial devices detected" << std::endl;
+                        }
                     }
                 }
                 
@@ -117,9 +194,41 @@ namespace openterface {
                 }
 
                 // Connect video if specified
-                if (has_video) {
+                if (has_video && !replay_file.empty()) {
+                    if (video->openReplay(replay_file, !replay_fast)) {
+                        auto info = video->getInfo();
+                        std::cout << "✓ Replaying " << info.width << "x" << info.height << " " << info.format
+                                  << (replay_fast ? " as fast as possible" : " at the recorded rate") << std::endl;
+                    } else {
+                        std::cout << "✗ Cannot replay " << replay_file << std::endl;
+                        return;
+                    }
+                } else if (has_video) {
                     if (video->connect(video_device)) {
                         std::cout << "✓ Video connected" << std::endl;
+                        CaptureMemory memory = CaptureMemory::Mmap;
+                        parseCaptureMemory(capture_memory, memory);
+                        video->setCaptureMemory(memory);
+                        video->setBufferCount(capture_buffers);
+                        video->setLatestFrameOnly(latest_frame);
+                        CapturePreference preference;
+                        if (parseCapturePreference(capture_preference, preference)) {
+                            // An explicit --capture-format limits the choice to that format
+                            std::string format;
+                            if (connect_cmd->count("--capture-format") > 0) {
+                                format = capture_format == "yuyv" ? "YUYV" : "MJPG";
+                            }
+                            if (video->selectMode(preference, kWindowWidth, kWindowHeight, kDisplayRefresh, format)) {
+                                auto info = video->getInfo();
+                                std::cout << "✓ Capturing " << info.format << " " << info.width << "x" << info.height
+                                          << " @ " << info.fps << " fps" << std::endl;
+                            } else {
+                                std::cout << "✗ No mode matches --prefer " << capture_preference
+                                          << ", keeping the default" << std::endl;
+                            }
+                        } else if (capture_format == "yuyv" && !video->setFormat("YUYV")) {
+                            std::cout << "✗ YUYV capture not available, keeping MJPEG" << std::endl;
+                        }
                     } else {
                         std::cout << "✗ Video connection failed" << std::endl;
                         return;
@@ -132,16 +241,21 @@ namespace openterface {
                 if (has_serial) {
                     std::cout << "Connecting to serial port..." << std::endl;
                     
-                    // Start async connection
-                    serial->connectAsync(serial_port, 115200, [this](bool success, const std::string& message) {
+                    // Start async connection, at the rate the chip answered at last time
+                    on_serial = [this](bool success, const std::string& message) {
                         if (success) {
-                            std::cout << "✓ Serial connected" << std::endl;
+                            if (negotiate_baud) {
+                                serial->negotiateBaudRate();
+                            }
+                            std::cout << "✓ Serial connected @ " << serial->getInfo().baudrate << " baud" << std::endl;
+                            DeviceDiscovery::rememberBaudRate(serial_port, serial->getInfo().baudrate);
                             // Setup input forwarding only if serial is available
                             input->setSerial(std::shared_ptr<Serial>(serial.get(), [](Serial *) {}));
                         } else {
                             std::cout << "✗ Serial connection failed: " << message << std::endl;
                         }
-                    });
+                    };
+                    serial->connectAsync(serial_port, DeviceDiscovery::baudRateHint(serial_port), on_serial);
                     
                     // Continue immediately without waiting - connection happens in background
                     // This allows the GUI event loop to start and remain responsive
@@ -180,7 +294,7 @@ namespace openterface {
                 }
             }
             
-            if (!gui->createWindow(window_title, 1920, 1080)) {
+            if (!gui->createWindow(window_title, kWindowWidth, kWindowHeight)) {
                 std::cout << "✗ Failed to create window" << std::endl;
                 std::cout << "DEBUG: Window creation failed, about to shutdown GUI" << std::endl;
                 gui->shutdown();
@@ -192,6 +306,11 @@ namespace openterface {
 
             // Setup video display only if video is enabled
             if (!video_device.empty() || dummy_mode) {
+                DecoderBackend backend = DecoderBackend::Libjpeg;
+                parseDecoderBackend(decoder_backend, backend);
+                gui->setDecodeThreads(decode_threads);
+                gui->setDecoderBackend(backend);
+
                 gui->setVideoSource(std::shared_ptr<Video>(video.get(), [](Video *) {}));
                 if (gui->startVideoDisplay()) {
                     if (dummy_mode) {
@@ -210,6 +329,10 @@ namespace openterface {
             if (debug_input) {
                 gui->setDebugMode(true);
             }
+            if (show_stats) {
+                gui->setStatsInterval(stats_interval);
+            }
+            gui->setGovernorPolicy(unfocused_fps, hidden_fps, !fixed_quality);
 
             // Setup input capture and forwarding only if serial is enabled
             if (!serial_port.empty() || dummy_mode) {
@@ -248,10 +371,33 @@ namespace openterface {
             }
             std::cout << "- Close window or press Ctrl+C to exit" << std::endl;
 
+            // Follow replugs of the unit: the serial link is reopened as soon as its node is back
+            KVMDevice unit;
+            if (on_serial && DeviceDiscovery::shared().findByPath(serial_port, unit)) {
+                std::string unit_id = unit.device_id;
+                DeviceDiscovery::shared().startMonitor(
+                    [this, unit_id, on_serial](HotplugAction action, const KVMDevice &device) {
+                        if (device.device_id != unit_id) {
+                            return;
+                        }
+                        if (action == HotplugAction::Removed || device.serial_path.empty()) {
+                            if (serial->isConnected()) {
+                                std::cout << "- Serial device unplugged" << std::endl;
+                                serial->disconnect();
+                            }
+                        } else if (!serial->isConnected() && !serial->isConnecting()) {
+                            serial_port = device.serial_path;
+                            std::cout << "Serial device back at " << serial_port << ", reconnecting..." << std::endl;
+                            serial->connectAsync(serial_port, DeviceDiscovery::baudRateHint(serial_port), on_serial);
+                        }
+                    });
+            }
+
             std::cout << "DEBUG: About to run GUI event loop" << std::endl;
 
             // Run the GUI event loop (blocking)
             int result = gui->runEventLoop();
+            DeviceDiscovery::shared().stopMonitor();
             std::cout << "\nGUI exited with code: " << result << std::endl;
 
             std::cout << "DEBUG: GUI event loop finished, starting cleanup" << std::endl;
@@ -290,6 +436,7 @@ namespace openterface {
                 std::cout << "Usage: openterface reset --serial /dev/ttyUSB0" << std::endl;
                 return;
             }
+            serial->setVerbose(verbose);
 
             std::cout << "=== CH9329 Factory Reset ===" << std::endl;
             std::cout << "Connecting to serial port: " << serial_port << std::endl;
@@ -320,6 +467,435 @@ namespace openterface {
             }
         });
 
+        // Serial benchmark - link latency and throughput, for picking a baud rate per site
+        auto bench_cmd = app.add_subcommand("serial-bench", "Measure CH9329 link latency and input report throughput");
+        bench_cmd->add_option("--serial", serial_port, "Serial device path (optional - auto-detected if omitted)");
+        bench_cmd->add_flag("--negotiate", negotiate_baud, "Negotiate the fastest stable UART rate before measuring");
+        bench_cmd->add_option("--max-baud", max_baud, "Highest rate --negotiate may pick (0 = no limit)");
+        bench_cmd->add_option("--round-trips", bench_round_trips, "Info requests timed one at a time")
+            ->check(::CLI::Range(1, 100000));
+        bench_cmd->add_option("--packets", bench_packets, "Input reports sent back to back")
+            ->check(::CLI::Range(1, 1000000));
+        bench_cmd->callback([this]() {
+            serial->setVerbose(verbose);
+
+            if (serial_port.empty()) {
+                auto serial_devices = findOpenterfaceSerialPorts();
+                if (serial_devices.empty()) {
+                    std::cout << "Error: no Openterface serial device found, pass --serial" << std::endl;
+                    return;
+                }
+                serial_port = serial_devices[0];
+            }
+
+            std::cout << "=== CH9329 Link Benchmark ===" << std::endl;
+            if (!serial->connect(serial_port, DeviceDiscovery::baudRateHint(serial_port))) {
+                std::cout << "✗ Failed to connect to serial port: " << serial_port << std::endl;
+                return;
+            }
+            if (negotiate_baud) {
+                serial->negotiateBaudRate(max_baud);
+            }
+            DeviceDiscovery::rememberBaudRate(serial_port, serial->getInfo().baudrate);
+
+            SerialBenchmark result;
+            bool complete = serial->runBenchmark(bench_round_trips, bench_packets, result);
+            serial->disconnect();
+
+            auto percentile = [&result](double p) {
+                size_t index = static_cast<size_t>(p * (result.latencies_ms.size() - 1) + 0.5);
+                return result.latencies_ms[index];
+            };
+
+            std::cout << std::fixed << std::setprecision(2);
+            std::cout << "Link: " << serial_port << " @ " << result.baudrate << " baud" << std::endl;
+            std::cout << "Round trips: " << result.latencies_ms.size() << " (" << result.timeouts << " timed out)"
+                      << std::endl;
+            if (!result.latencies_ms.empty()) {
+                std::cout << "Latency: min " << result.latencies_ms.front() << " ms, p50 " << percentile(0.50)
+                          << " ms, p95 " << percentile(0.95) << " ms, p99 " << percentile(0.99) << " ms, max "
+                          << result.latencies_ms.back() << " ms" << std::endl;
+            }
+            if (result.seconds > 0.0) {
+                std::cout << "Throughput: " << result.packets_sent << " packets in " << result.seconds << " s = "
+                          << result.packets_sent / result.seconds << " packets/s (" << result.packets_acked
+                          << " acknowledged)" << std::endl;
+            }
+            if (!complete) {
+                std::cout << "✗ Link failed during the benchmark" << std::endl;
+            }
+        });
+
+        // Record command - capture frames as delivered for offline profiling (connect --replay)
+        auto record_cmd = app.add_subcommand("record", "Record the capture stream to a file for connect --replay");
+        record_cmd->add_option("output", record_output, "Recording file to write")->required();
+        record_cmd->add_option("--video", video_device, "Video device path (optional - auto-detected if omitted)");
+        record_cmd->add_option("--capture-format", capture_format, "Capture format: mjpg or yuyv")
+            ->check(::CLI::IsMember({"mjpg", "yuyv"}));
+        record_cmd->add_option("--frames", record_frames, "Stop after this many frames (0 = no limit)")
+            ->check(::CLI::Range(0, 100000000));
+        record_cmd->add_option("--seconds", record_seconds, "Stop after this many seconds (0 = no limit)")
+            ->check(::CLI::Range(0, 86400 * 7));
+        record_cmd->callback([this]() {
+            if (video_device.empty()) {
+                auto video_devices = findOpenterfaceVideoDevices();
+                if (video_devices.empty()) {
+                    std::cout << "Error: no Openterface video device found, pass --video" << std::endl;
+                    return;
+                }
+                video_device = video_devices[0];
+            }
+
+            if (!video->connect(video_device)) {
+                std::cout << "✗ Failed to open video device: " << video_device << std::endl;
+                return;
+            }
+            if (capture_format == "yuyv" && !video->setFormat("YUYV")) {
+                std::cout << "✗ YUYV capture not available, recording MJPEG" << std::endl;
+            }
+            if (!video->startRecording(record_output, static_cast<uint64_t>(record_frames))) {
+                video->disconnect();
+                return;
+            }
+            if (!video->startCapture()) {
+                std::cout << "✗ Failed to start capture" << std::endl;
+                video->disconnect();
+                return;
+            }
+
+            auto info = video->getInfo();
+            std::cout << "Recording " << video_device << " (" << info.width << "x" << info.height << " "
+                      << info.format << ") to " << record_output << " - Ctrl+C to stop" << std::endl;
+
+            record_interrupted = false;
+            auto previous_handler = std::signal(SIGINT, [](int) { record_interrupted = true; });
+            auto start = std::chrono::steady_clock::now();
+            auto deadline = start + std::chrono::seconds(record_seconds);
+            while (!record_interrupted && video->isRecording() &&
+                   (record_seconds == 0 || std::chrono::steady_clock::now() < deadline)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            std::signal(SIGINT, previous_handler);
+
+            uint64_t frames = video->getRecordedFrames();
+            video->disconnect(); // Stops capture, then writes the frame count
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "✓ Recorded " << frames << " frames in " << std::fixed << std::setprecision(1) << seconds
+                      << " s" << std::endl;
+        });
+
+        // Multi command - several targets in one process: one KVMManager session and window per target,
+        // all decoding on one shared pool over one Wayland connection
+        auto multi_cmd = app.add_subcommand("multi", "Watch several KVM targets at once, one window each");
+        multi_cmd->add_option("--target", multi_targets,
+                              "SERIAL,VIDEO device pair, repeated per target (default: pair up the devices found)");
+        multi_cmd->add_option("--window", multi_window,
+                              "Initial window size WxH; windows up to 640x360 are thumbnails (reduced rate and priority)");
+        multi_cmd->add_option("--thumbnail-fps", thumbnail_fps, "Frame rate of thumbnail windows (0 = full rate)")
+            ->check(::CLI::Range(0, 240));
+        multi_cmd->add_option("--unfocused-fps", unfocused_fps, "Frame rate of windows that aren't focused (0 = full rate)")
+            ->check(::CLI::Range(0, 240));
+        multi_cmd->add_option("--hidden-fps", hidden_fps, "Frame rate of hidden windows (0 = full rate)")
+            ->check(::CLI::Range(0, 240));
+        multi_cmd->add_flag("--fixed-quality", fixed_quality,
+                            "Never decode smaller or drop the frame rate when the shared pool falls behind");
+        multi_cmd->add_option("--pool-threads", pool_threads, "MJPEG decode threads shared by all targets (0 = one per core)")
+            ->check(::CLI::Range(0, 64));
+        multi_cmd->add_option("--decoder", decoder_backend,
+                              "MJPEG decoder: libjpeg, vaapi, v4l2m2m or auto (hardware falls back to libjpeg)")
+            ->check(::CLI::IsMember({"libjpeg", "vaapi", "v4l2m2m", "auto"}));
+        multi_cmd->add_flag("--stats", show_stats, "Print per-window pipeline latency every --stats-interval seconds");
+        multi_cmd->add_option("--stats-interval", stats_interval, "Seconds between --stats reports")
+            ->check(::CLI::Range(1, 3600));
+        multi_cmd->callback([this]() {
+            int window_width = 0;
+            int window_height = 0;
+            if (sscanf(multi_window.c_str(), "%dx%d", &window_width, &window_height) != 2 || window_width < 64 ||
+                window_height < 64) {
+                std::cout << "Error: --window takes WIDTHxHEIGHT, e.g. 640x360" << std::endl;
+                return;
+            }
+
+            // SERIAL,VIDEO pairs; without --target every unit found with both functions
+            std::vector<std::pair<std::string, std::string>> targets;
+            for (const auto &target : multi_targets) {
+                size_t comma = target.find(',');
+                if (comma == std::string::npos || comma == 0 || comma + 1 == target.size()) {
+                    std::cout << "Error: --target takes SERIAL,VIDEO (got " << target << ")" << std::endl;
+                    return;
+                }
+                targets.emplace_back(target.substr(0, comma), target.substr(comma + 1));
+            }
+            if (targets.empty()) {
+                for (const auto &device : DeviceDiscovery::shared().getDevices()) {
+                    if (!device.serial_path.empty() && !device.video_path.empty()) {
+                        targets.emplace_back(device.serial_path, device.video_path);
+                    }
+                }
+            }
+            if (targets.empty()) {
+                std::cout << "Error: no Openterface devices found, pass --target SERIAL,VIDEO" << std::endl;
+                return;
+            }
+
+            auto connection = WaylandConnection::connect();
+            if (!connection) {
+                std::cout << "✗ Cannot connect to the Wayland compositor" << std::endl;
+                return;
+            }
+            auto pool = std::make_shared<DecodePool>(pool_threads);
+            DecoderBackend backend = DecoderBackend::Libjpeg;
+            parseDecoderBackend(decoder_backend, backend);
+
+            // Declared after the pool and the connection, so every session is gone before they are
+            std::vector<std::unique_ptr<KVMManager>> sessions;
+            for (const auto &[serial_path, video_path] : targets) {
+                auto session = std::make_unique<KVMManager>();
+                if (!session->connectByPaths(serial_path, video_path)) {
+                    std::cout << "✗ Skipping " << serial_path << " + " << video_path << std::endl;
+                    continue;
+                }
+                session->setSharedResources(pool, connection);
+                session->setWindow("Openterface KVM - " + video_path, window_width, window_height);
+                auto session_gui = session->getGUI();
+                // The pool provides the parallelism, across windows
+                session_gui->setDecodeThreads(1);
+                session_gui->setDecoderBackend(backend);
+                session_gui->setThumbnailPolicy(kThumbnailWidth, kThumbnailHeight, thumbnail_fps);
+                session_gui->setGovernorPolicy(unfocused_fps, hidden_fps, !fixed_quality);
+                if (show_stats) {
+                    session_gui->setStatsInterval(stats_interval);
+                }
+                if (!session->startKVMSession()) {
+                    std::cout << "✗ " << video_path << " started with failures" << std::endl;
+                }
+                sessions.push_back(std::move(session));
+            }
+            if (sessions.empty()) {
+                std::cout << "✗ No target could be connected" << std::endl;
+                return;
+            }
+            std::cout << "✓ " << sessions.size() << " targets, decoding on " << pool->getThreadCount()
+                      << " shared threads - Ctrl+C to exit" << std::endl;
+
+            std::atomic<size_t> running{sessions.size()};
+            std::vector<std::thread> event_loops;
+            for (auto &session : sessions) {
+                event_loops.emplace_back([&running, kvm = session.get()]() {
+                    kvm->runEventLoop();
+                    running--;
+                });
+            }
+
+            multi_interrupted = false;
+            auto previous_handler = std::signal(SIGINT, [](int) { multi_interrupted = true; });
+            while (!multi_interrupted && running > 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            std::signal(SIGINT, previous_handler);
+
+            for (auto &session : sessions) {
+                session->requestExit();
+            }
+            for (auto &loop : event_loops) {
+                loop.join();
+            }
+            sessions.clear();
+
+            std::cout << "✓ Ran " << pool->getCompletedCount() << " decode tasks on the shared pool ("
+                      << pool->getStolenCount() << " stolen between threads)" << std::endl;
+        });
+
+        // Serve command - headless: re-serve the compressed capture stream to web viewers
+        auto serve_cmd = app.add_subcommand("serve", "Stream the capture to web viewers as MJPEG over HTTP/WebSocket");
+        serve_cmd->add_option("--video", video_device, "Video device path (optional - auto-detected if omitted)");
+        serve_cmd->add_option("--replay", replay_file, "Serve a recording (from `record`) instead of a device");
+        serve_cmd->add_option("--listen", serve_address, "IPv4 address to listen on (0.0.0.0 = every interface)");
+        serve_cmd->add_option("--port", serve_port, "TCP port")->check(::CLI::Range(1, 65535));
+        serve_cmd->add_option("--max-clients", serve_max_clients, "Connections served at once")
+            ->check(::CLI::Range(1, 1024));
+        serve_cmd->add_flag("--allow-input", serve_allow_input,
+                            "Forward keyboard/mouse commands from WebSocket viewers to the target");
+        serve_cmd->add_option("--serial", serial_port, "Serial device for --allow-input (optional - auto-detected)");
+        serve_cmd->add_flag("--stats", show_stats, "Print viewer and throughput counters every --stats-interval seconds");
+        serve_cmd->add_option("--stats-interval", stats_interval, "Seconds between --stats reports")
+            ->check(::CLI::Range(1, 3600));
+        serve_cmd->callback([this]() {
+            serial->setVerbose(verbose);
+
+            if (!replay_file.empty()) {
+                if (!video->openReplay(replay_file)) {
+                    std::cout << "✗ Cannot replay " << replay_file << std::endl;
+                    return;
+                }
+            } else {
+                if (video_device.empty() || (serve_allow_input && serial_port.empty())) {
+                    KVMDevice device;
+                    findOpenterfaceDevice(device);
+                    if (video_device.empty()) {
+                        video_device = device.video_path;
+                    }
+                    if (serve_allow_input && serial_port.empty()) {
+                        serial_port = device.serial_path;
+                    }
+                }
+                if (video_device.empty()) {
+                    std::cout << "Error: no Openterface video device found, pass --video" << std::endl;
+                    return;
+                }
+                if (!video->connect(video_device)) {
+                    std::cout << "✗ Failed to open video device: " << video_device << std::endl;
+                    return;
+                }
+                // Viewers get the card's JPEGs as they are, so the capture has to be MJPEG
+                if (video->getInfo().format != "MJPG" && !video->setFormat("MJPG")) {
+                    std::cout << "✗ " << video_device << " can't capture MJPEG" << std::endl;
+                    video->disconnect();
+                    return;
+                }
+            }
+
+            StreamServer server;
+            server.setMaxClients(serve_max_clients);
+            if (serve_allow_input) {
+                if (serial_port.empty()) {
+                    std::cout << "- No serial device found, serving view-only" << std::endl;
+                } else if (serial->connect(serial_port, DeviceDiscovery::baudRateHint(serial_port))) {
+                    DeviceDiscovery::rememberBaudRate(serial_port, serial->getInfo().baudrate);
+                    server.setInputTarget(std::shared_ptr<Serial>(serial.get(), [](Serial *) {}));
+                    std::cout << "✓ Remote input goes to " << serial_port << std::endl;
+                    if (serve_address != "127.0.0.1") {
+                        std::cout << "! Anyone who can reach " << serve_address << ":" << serve_port
+                                  << " can type on the target" << std::endl;
+                    }
+                } else {
+                    std::cout << "✗ Serial connection failed, serving view-only" << std::endl;
+                }
+            }
+
+            if (!server.start(serve_address, serve_port)) {
+                std::cout << "✗ " << server.getLastError() << std::endl;
+                video->disconnect();
+                serial->disconnect();
+                return;
+            }
+            video->setFrameCallback([&server](const FrameData &frame) { server.publishFrame(frame); });
+            if (!video->startCapture()) {
+                std::cout << "✗ Failed to start capture" << std::endl;
+                video->setFrameCallback(nullptr);
+                server.stop();
+                video->disconnect();
+                serial->disconnect();
+                return;
+            }
+
+            auto info = video->getInfo();
+            std::string url = "http://" + serve_address + ":" + std::to_string(serve_port);
+            std::cout << "✓ Serving " << info.width << "x" << info.height << " MJPEG at " << url << "/ - Ctrl+C to stop"
+                      << std::endl;
+            std::cout << "  " << url << "/stream (multipart), " << url << "/snapshot, ws://" << serve_address << ":"
+                      << serve_port << "/ws" << std::endl;
+
+            serve_interrupted = false;
+            auto previous_handler = std::signal(SIGINT, [](int) { serve_interrupted = true; });
+            auto interval = std::chrono::seconds(stats_interval);
+            auto next_report = std::chrono::steady_clock::now() + interval;
+            StreamServerStats reported;
+            while (!serve_interrupted) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (!show_stats || std::chrono::steady_clock::now() < next_report) {
+                    continue;
+                }
+                auto stats = server.getStats();
+                std::cout << std::fixed << std::setprecision(1) << "[STREAM] " << stats.clients << " viewers, "
+                          << (stats.frames_sent - reported.frames_sent) / double(stats_interval) << " frames/s out ("
+                          << stats.frames_dropped - reported.frames_dropped << " skipped by slow viewers), "
+                          << (stats.bytes_sent - reported.bytes_sent) / (1024.0 * 1024.0 * stats_interval)
+                          << " MiB/s, " << stats.input_events - reported.input_events << " input events" << std::endl;
+                reported = stats;
+                next_report += interval;
+            }
+            std::signal(SIGINT, previous_handler);
+
+            video->stopCapture();
+            video->setFrameCallback(nullptr);
+            server.stop();
+            video->disconnect();
+            serial->disconnect();
+
+            auto stats = server.getStats();
+            std::cout << "✓ Sent " << stats.frames_sent << " frames (" << stats.frames_dropped
+                      << " skipped by slow viewers), " << stats.input_events << " input events" << std::endl;
+        });
+
+        // Type command - paste scripts and passwords into consoles, installers and firmware setup
+        auto type_cmd = app.add_subcommand("type", "Type text on the target keyboard");
+        type_cmd->add_option("text", type_text, "Text to type (read from --file or stdin if omitted)");
+        type_cmd->add_option("--file", type_file, "Read the text from a file ('-' for stdin)");
+        type_cmd->add_option("--serial", serial_port, "Serial device path (optional - auto-detected if omitted)");
+        type_cmd->add_option("--layout", type_layout, "Keyboard layout the target uses: us, gb or de")
+            ->check(::CLI::IsMember(textLayouts()));
+        type_cmd->add_option("--rollover", type_rollover,
+                             "Keys per HID report (1 for targets that drop keys pressed together)")
+            ->check(::CLI::Range(1, 6));
+        type_cmd->callback([this]() {
+            serial->setVerbose(verbose);
+
+            std::string text = type_text;
+            if (text.empty()) {
+                if (type_file.empty() || type_file == "-") {
+                    text.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+                } else {
+                    std::ifstream file(type_file, std::ios::binary);
+                    if (!file) {
+                        std::cout << "Error: cannot read " << type_file << std::endl;
+                        return;
+                    }
+                    text.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+                }
+            }
+            if (text.empty()) {
+                std::cout << "Nothing to type" << std::endl;
+                return;
+            }
+
+            TextEncoder encoder;
+            encoder.setLayout(type_layout);
+            encoder.setRollover(type_rollover);
+            std::vector<KeyboardReport> reports;
+            size_t skipped = encoder.encode(text, reports);
+            if (skipped > 0) {
+                std::cout << "- Skipping " << skipped << " characters the " << type_layout
+                          << " layout can't type" << std::endl;
+            }
+
+            if (serial_port.empty()) {
+                auto serial_devices = findOpenterfaceSerialPorts();
+                if (serial_devices.empty()) {
+                    std::cout << "Error: no Openterface serial device found, pass --serial" << std::endl;
+                    return;
+                }
+                serial_port = serial_devices[0];
+            }
+            if (!serial->connect(serial_port, DeviceDiscovery::baudRateHint(serial_port))) {
+                std::cout << "✗ Failed to connect to serial port: " << serial_port << std::endl;
+                return;
+            }
+            DeviceDiscovery::rememberBaudRate(serial_port, serial->getInfo().baudrate);
+
+            std::cout << "Typing " << text.size() << " bytes as " << reports.size() << " HID reports..." << std::endl;
+            auto start = std::chrono::steady_clock::now();
+            bool success = serial->sendKeyboardReports(reports);
+            serial->disconnect(); // Returns once the queue is on the wire
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (success) {
+                std::cout << "✓ Typed in " << std::fixed << std::setprecision(2) << seconds << " s" << std::endl;
+            } else {
+                std::cout << "✗ Typing interrupted - the serial link failed" << std::endl;
+            }
+        });
+
         // Status command
         auto status_cmd = app.add_subcommand("status", "Show device status");
         status_cmd->callback([this]() {
@@ -353,34 +929,36 @@ namespace openterface {
 
             std::cout << "Scanning for Openterface USB KVM devices..." << std::endl;
 
-            // Find video devices by checking device description
-            std::cout << "\n=== Video Devices ===" << std::endl;
-            std::vector<std::string> video_paths;
-            for (int i = 0; i < 10; i++) {
-                std::string device = "/dev/video" + std::to_string(i);
-                if (access(device.c_str(), F_OK) == 0) {
-                    // Check if this is an Openterface device by reading device info
-                    std::string device_name = getVideoDeviceName(device);
-                    if (device_name.find("Openterface") != std::string::npos) {
-                        std::cout << "Found: " << device << " (" << device_name << ")" << std::endl;
-                        video_paths.push_back(device);
-                    } else if (verbose) {
-                        std::cout << "Found: " << device << " (" << device_name << ") - not Openterface" << std::endl;
+            // One pass over the udev database: units paired by USB port, no device opened
+            auto devices = DeviceDiscovery::shared().getDevices();
+
+            std::cout << "\n=== Devices ===" << std::endl;
+            for (const auto &device : devices) {
+                std::cout << "Found: " << device.description << " on USB port " << device.device_id << std::endl;
+                std::cout << "  Video:  " << (device.video_path.empty() ? "-" : device.video_path);
+                if (verbose && !device.video_path.empty()) {
+                    std::cout << " (" << getVideoDeviceName(device.video_path) << ")";
+                }
+                std::cout << std::endl;
+                std::cout << "  Serial: " << (device.serial_path.empty() ? "-" : device.serial_path) << std::endl;
+
+                if (verbose && !device.video_path.empty() && video->connect(device.video_path)) {
+                    for (const auto &mode : video->getSupportedModes()) {
+                        std::cout << "  " << mode.format << " " << mode.width << "x" << mode.height << " @";
+                        for (int fps : mode.frame_rates) {
+                            std::cout << " " << fps;
+                        }
+                        std::cout << " fps" << std::endl;
                     }
+                    video->disconnect();
                 }
             }
 
-            // Find serial devices by checking VID:PID
-            std::cout << "\n=== Serial Devices ===" << std::endl;
-            std::vector<std::string> serial_paths = findOpenterfaceSerialPorts();
-            for (const auto &device : serial_paths) {
-                std::cout << "Found: " << device << " (VID:PID 0x1A86:0x7523)" << std::endl;
-            }
-
             std::cout << "\n=== Recommended Connection ===" << std::endl;
-            if (!video_paths.empty() && !serial_paths.empty()) {
-                std::cout << "Try: openterface connect --video=" << video_paths[0] << " --serial=" << serial_paths[0]
-                          << std::endl;
+            KVMDevice device;
+            if (findOpenterfaceDevice(device) && !device.video_path.empty() && !device.serial_path.empty()) {
+                std::cout << "Try: openterface connect --video=" << device.video_path
+                          << " --serial=" << device.serial_path << std::endl;
             } else {
                 std::cout << "No Openterface devices detected." << std::endl;
                 std::cout << "Ensure device is plugged in and recognized by the system." << std::endl;
@@ -420,66 +998,38 @@ namespace openterface {
 #endif
     }
 
-    std::vector<std::string> CLI::findOpenterfaceSerialPorts() {
-        std::vector<std::string> openterface_ports;
-
-#ifdef __linux__
-        // Read /sys/class/tty entries to find CH341 devices (VID:PID 0x1A86:0x7523)
-        DIR *dir = opendir("/sys/class/tty");
-        if (!dir) {
-            return openterface_ports;
+    bool CLI::findOpenterfaceDevice(KVMDevice &device) {
+        auto devices = DeviceDiscovery::shared().getDevices();
+        for (const auto &candidate : devices) {
+            if (!candidate.serial_path.empty() && !candidate.video_path.empty()) {
+                device = candidate;
+                return true;
+            }
         }
+        if (devices.empty()) {
+            return false;
+        }
+        device = devices[0]; // Only one function present
+        return true;
+    }
 
-        struct dirent *entry;
-        while ((entry = readdir(dir)) != nullptr) {
-            if (strncmp(entry->d_name, "ttyUSB", 6) == 0 || strncmp(entry->d_name, "ttyACM", 6) == 0) {
-
-                std::string uevent_path = "/sys/class/tty/" + std::string(entry->d_name) + "/device/../uevent";
-                std::ifstream uevent_file(uevent_path);
-
-                if (uevent_file.is_open()) {
-                    std::string line;
-                    bool is_openterface = false;
-
-                    while (std::getline(uevent_file, line)) {
-                        // Check for CH341 VID:PID (Openterface serial device)
-                        if (line.find("PRODUCT=1a86/7523/") == 0) {
-                            is_openterface = true;
-                            break;
-                        }
-                    }
-
-                    if (is_openterface) {
-                        std::string device_path = "/dev/" + std::string(entry->d_name);
-                        if (access(device_path.c_str(), F_OK) == 0) {
-                            openterface_ports.push_back(device_path);
-                        }
-                    }
-                }
+    std::vector<std::string> CLI::findOpenterfaceSerialPorts() {
+        std::vector<std::string> openterface_ports;
+        for (const auto &device : DeviceDiscovery::shared().getDevices()) {
+            if (!device.serial_path.empty()) {
+                openterface_ports.push_back(device.serial_path);
             }
         }
-
-        closedir(dir);
-#endif
-
         return openterface_ports;
     }
 
     std::vector<std::string> CLI::findOpenterfaceVideoDevices() {
         std::vector<std::string> openterface_videos;
-
-        // Find video devices by checking device description
-        for (int i = 0; i < 10; i++) {
-            std::string device = "/dev/video" + std::to_string(i);
-            if (access(device.c_str(), F_OK) == 0) {
-                // Check if this is an Openterface device by reading device info
-                std::string device_name = getVideoDeviceName(device);
-                if (device_name.find("Openterface") != std::string::npos) {
-                    openterface_videos.push_back(device);
-                }
+        for (const auto &device : DeviceDiscovery::shared().getDevices()) {
+            if (!device.video_path.empty()) {
+                openterface_videos.push_back(device.video_path);
             }
         }
-
         return openterface_videos;
     }
 
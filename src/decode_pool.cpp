@@ -0,0 +1,118 @@
+#include "openterface/decode_pool.hpp"
+#include <algorithm>
+#include <deque>
+#include <thread>
+
+namespace openterface {
+
+    namespace {
+        constexpr size_t kPriorities = 2;
+
+        // Pool and worker index of the calling thread, for submissions from inside a task
+        thread_local const DecodePool* current_pool = nullptr;
+        thread_local size_t current_worker = 0;
+    } // namespace
+
+    struct DecodePool::Worker {
+        std::mutex mutex;
+        std::deque<Task> tasks[kPriorities];  // Indexed by Priority
+        std::thread thread;
+    };
+
+    DecodePool::DecodePool(int threads) {
+        if (threads <= 0) {
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+
+        workers.reserve(threads);
+        for (int i = 0; i < threads; i++) {
+            workers.push_back(std::make_unique<Worker>());
+        }
+        // Started only once every deque exists, since workers steal from all of them
+        for (size_t i = 0; i < workers.size(); i++) {
+            workers[i]->thread = std::thread([this, i]() { workerLoop(i); });
+        }
+    }
+
+    DecodePool::~DecodePool() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+    }
+
+    void DecodePool::submit(Task task, Priority priority) {
+        size_t index = current_pool == this ? current_worker
+                                            : next_worker.fetch_add(1, std::memory_order_relaxed) % workers.size();
+        Worker& worker = *workers[index];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks[static_cast<size_t>(priority)].push_back(std::move(task));
+            queued.fetch_add(1, std::memory_order_release);  // Under the lock, so takers never count below zero
+        }
+
+        { std::lock_guard<std::mutex> lock(sleep_mutex); }
+        wake.notify_one();
+    }
+
+    bool DecodePool::takeTask(size_t index, Task& task) {
+        for (size_t priority = 0; priority < kPriorities; priority++) {
+            // Own deque first, oldest task first
+            {
+                Worker& own = *workers[index];
+                std::lock_guard<std::mutex> lock(own.mutex);
+                auto& tasks = own.tasks[priority];
+                if (!tasks.empty()) {
+                    task = std::move(tasks.front());
+                    tasks.pop_front();
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+
+            // Then steal the newest task of another worker, leaving its owner the ones it queued first
+            for (size_t offset = 1; offset < workers.size(); offset++) {
+                Worker& victim = *workers[(index + offset) % workers.size()];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                auto& tasks = victim.tasks[priority];
+                if (!tasks.empty()) {
+                    task = std::move(tasks.back());
+                    tasks.pop_back();
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                    stolen.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    void DecodePool::workerLoop(size_t index) {
+        current_pool = this;
+        current_worker = index;
+
+        Task task;
+        while (true) {
+            if (takeTask(index, task)) {
+                task();
+                task = nullptr;  // Drop captured state before sleeping
+                completed.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            wake.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+            if (stopping) {
+                break;
+            }
+        }
+    }
+
+} // namespace openterface
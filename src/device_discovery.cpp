@@ -0,0 +1,577 @@
+#include "openterface/device_discovery.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+#include <libudev.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace openterface {
+
+    namespace {
+        struct UsbId {
+            const char *vendor;
+            const char *product;
+        };
+
+        // MS2109 capture chip (MacroSilicon id on early units, Openterface id on later ones)
+        constexpr UsbId kVideoIds[] = {{"534d", "2109"}, {"345f", "2109"}};
+        // CH340 UART bridge in front of the CH9329, and the CH32V208 bridge of later units
+        constexpr UsbId kSerialIds[] = {{"1a86", "7523"}, {"1a86", "fe0c"}};
+
+        constexpr int kDefaultBaudRate = 115200;
+
+        template <size_t N> bool matchesId(const UsbId (&ids)[N], const std::string &vendor, const std::string &product) {
+            for (const auto &id : ids) {
+                if (vendor == id.vendor && product == id.product) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // One video or serial node of an Openterface unit
+        struct FunctionNode {
+            bool video = false;
+            std::string node;       // /dev path
+            std::string unit;       // Hub the function hangs off (its own USB device when on a root port)
+            std::string unit_path;  // sysfs path of `unit`
+            std::string vendor_id;
+            std::string product_id;
+            std::string serial_number;
+        };
+
+        // The unit of a USB function: the hub both chips sit behind. A function plugged straight into
+        // a root hub ("usb1") pairs with nothing, so it is its own unit.
+        void assignUnit(FunctionNode &node, const std::string &usb_name, const std::string &usb_path,
+                        const std::string &hub_name, const std::string &hub_path) {
+            if (hub_name.empty() || hub_name.rfind("usb", 0) == 0) {
+                node.unit = usb_name;
+                node.unit_path = usb_path;
+            } else {
+                node.unit = hub_name;
+                node.unit_path = hub_path;
+            }
+        }
+
+        std::vector<KVMDevice> pairFunctions(const std::vector<FunctionNode> &nodes) {
+            std::map<std::string, KVMDevice> units;  // Sorted by id
+            for (const auto &node : nodes) {
+                KVMDevice &device = units[node.unit];
+                device.device_id = node.unit;
+                device.usb_path = node.unit_path;
+                if (node.video) {
+                    if (!device.video_path.empty()) {
+                        continue;  // Keep the first capture node of a unit
+                    }
+                    device.video_path = node.node;
+                } else {
+                    if (!device.serial_path.empty()) {
+                        continue;
+                    }
+                    device.serial_path = node.node;
+                }
+                // The capture chip identifies the unit; the serial bridge only when there is no video
+                if (node.video || device.vendor_id.empty()) {
+                    device.vendor_id = node.vendor_id;
+                    device.product_id = node.product_id;
+                    device.serial_number = node.serial_number;
+                }
+            }
+
+            std::vector<KVMDevice> devices;
+            devices.reserve(units.size());
+            for (auto &[id, device] : units) {
+                device.description = "Openterface Mini KVM (" + device.vendor_id + ":" + device.product_id + ")";
+                devices.push_back(std::move(device));
+            }
+            return devices;
+        }
+
+        bool isComplete(const KVMDevice &device) { return !device.video_path.empty() && !device.serial_path.empty(); }
+
+        bool sameNodes(const KVMDevice &a, const KVMDevice &b) {
+            return a.video_path == b.video_path && a.serial_path == b.serial_path;
+        }
+
+#ifndef OPENTERFACE_HAVE_LIBUDEV
+        std::string readAttribute(const std::filesystem::path &path) {
+            std::ifstream file(path);
+            std::string value;
+            std::getline(file, value);
+            value.erase(value.find_last_not_of(" \t\r\n") + 1);
+            return value;
+        }
+
+        // USB device directory (the one with idVendor) a class device belongs to
+        std::filesystem::path usbDeviceOf(std::filesystem::path path) {
+            std::error_code error;
+            while (!path.empty() && path != path.root_path()) {
+                if (std::filesystem::exists(path / "idVendor", error)) {
+                    return path;
+                }
+                path = path.parent_path();
+            }
+            return {};
+        }
+
+        // Same pass as the udev scan, over /sys/class: resolve each node's device link to its USB
+        // device and read the ids from there. Class devices that aren't USB are skipped unread.
+        void scanClass(const char *class_dir, bool video, std::vector<FunctionNode> &nodes) {
+            std::error_code error;
+            for (const auto &entry : std::filesystem::directory_iterator(class_dir, error)) {
+                std::string name = entry.path().filename().string();
+                if (!video && name.rfind("ttyUSB", 0) != 0 && name.rfind("ttyACM", 0) != 0) {
+                    continue;
+                }
+                if (video && readAttribute(entry.path() / "index") != "0") {
+                    continue;  // Metadata node of a capture device
+                }
+
+                std::error_code link_error;
+                auto device_path = std::filesystem::canonical(entry.path() / "device", link_error);
+                if (link_error) {
+                    continue;
+                }
+                auto usb = usbDeviceOf(device_path);
+                if (usb.empty()) {
+                    continue;
+                }
+
+                FunctionNode node;
+                node.video = video;
+                node.vendor_id = readAttribute(usb / "idVendor");
+                node.product_id = readAttribute(usb / "idProduct");
+                if (video ? !matchesId(kVideoIds, node.vendor_id, node.product_id)
+                          : !matchesId(kSerialIds, node.vendor_id, node.product_id)) {
+                    continue;
+                }
+                node.node = "/dev/" + name;
+                node.serial_number = readAttribute(usb / "serial");
+
+                auto hub = usb.parent_path();
+                bool hub_is_usb = std::filesystem::exists(hub / "idVendor", link_error);
+                assignUnit(node, usb.filename().string(), usb.string(), hub_is_usb ? hub.filename().string() : "",
+                           hub.string());
+                nodes.push_back(std::move(node));
+            }
+        }
+#endif
+
+        std::string baudCachePath() {
+            const char *cache_home = std::getenv("XDG_CACHE_HOME");
+            if (cache_home && *cache_home) {
+                return std::string(cache_home) + "/openterface/baud-rates";
+            }
+            const char *home = std::getenv("HOME");
+            if (home && *home) {
+                return std::string(home) + "/.cache/openterface/baud-rates";
+            }
+            return "";
+        }
+
+        // "<device id> <baud rate>" per line
+        std::map<std::string, int> readBaudCache(const std::string &path) {
+            std::map<std::string, int> rates;
+            std::ifstream file(path);
+            std::string id;
+            int baudrate = 0;
+            while (file >> id >> baudrate) {
+                if (baudrate > 0) {
+                    rates[id] = baudrate;
+                }
+            }
+            return rates;
+        }
+
+        std::mutex baud_cache_mutex;
+    } // namespace
+
+    class DeviceDiscovery::Impl {
+      public:
+        // Cache, shared by callers and the monitor thread
+        mutable std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<KVMDevice> devices;
+        bool scanned = false;
+        HotplugCallback callback;
+
+        std::atomic<bool> monitoring{false};
+        std::thread monitor_thread;
+
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        // libudev isn't thread-safe: every call on the context or the monitor holds udev_mutex
+        std::mutex udev_mutex;
+        struct udev *udev = nullptr;
+        struct udev_monitor *monitor = nullptr;
+        int stop_fd = -1;
+#endif
+
+        void log(const std::string &msg) { std::cout << "[DISCOVERY] " << msg << std::endl; }
+
+        std::vector<KVMDevice> scan();
+        // Rescan and update the cache; with `notify`, report the differences to the callback
+        void rescan(bool notify);
+        void monitorLoop();
+    };
+
+    std::vector<KVMDevice> DeviceDiscovery::Impl::scan() {
+        std::vector<FunctionNode> nodes;
+
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        std::lock_guard<std::mutex> lock(udev_mutex);
+        if (!udev) {
+            return {};
+        }
+
+        struct udev_enumerate *enumerate = udev_enumerate_new(udev);
+        if (!enumerate) {
+            return {};
+        }
+        // Both subsystems in one enumeration (matches are OR-ed); nothing is opened, the
+        // attributes come from the udev database and sysfs
+        udev_enumerate_add_match_subsystem(enumerate, "video4linux");
+        udev_enumerate_add_match_subsystem(enumerate, "tty");
+        udev_enumerate_scan_devices(enumerate);
+
+        struct udev_list_entry *entry;
+        udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+            struct udev_device *device = udev_device_new_from_syspath(udev, udev_list_entry_get_name(entry));
+            if (!device) {
+                continue;
+            }
+
+            const char *devnode = udev_device_get_devnode(device);
+            const char *subsystem = udev_device_get_subsystem(device);
+            // Parents belong to `device`, they are released with it
+            struct udev_device *usb = udev_device_get_parent_with_subsystem_devtype(device, "usb", "usb_device");
+            if (devnode && subsystem && usb) {
+                FunctionNode node;
+                node.video = std::strcmp(subsystem, "video4linux") == 0;
+                const char *index = node.video ? udev_device_get_sysattr_value(device, "index") : nullptr;
+                const char *vendor = udev_device_get_sysattr_value(usb, "idVendor");
+                const char *product = udev_device_get_sysattr_value(usb, "idProduct");
+
+                bool capture_node = !node.video || (index && std::strcmp(index, "0") == 0);
+                if (capture_node && vendor && product) {
+                    node.vendor_id = vendor;
+                    node.product_id = product;
+                    if (node.video ? matchesId(kVideoIds, node.vendor_id, node.product_id)
+                                   : matchesId(kSerialIds, node.vendor_id, node.product_id)) {
+                        const char *serial = udev_device_get_sysattr_value(usb, "serial");
+                        node.node = devnode;
+                        node.serial_number = serial ? serial : "";
+
+                        struct udev_device *hub = udev_device_get_parent_with_subsystem_devtype(usb, "usb", "usb_device");
+                        assignUnit(node, udev_device_get_sysname(usb), udev_device_get_syspath(usb),
+                                   hub ? udev_device_get_sysname(hub) : "", hub ? udev_device_get_syspath(hub) : "");
+                        nodes.push_back(std::move(node));
+                    }
+                }
+            }
+            udev_device_unref(device);
+        }
+        udev_enumerate_unref(enumerate);
+#else
+        scanClass("/sys/class/video4linux", true, nodes);
+        scanClass("/sys/class/tty", false, nodes);
+#endif
+
+        return pairFunctions(nodes);
+    }
+
+    void DeviceDiscovery::Impl::rescan(bool notify) {
+        std::vector<KVMDevice> found = scan();
+
+        std::vector<std::pair<HotplugAction, KVMDevice>> events;
+        HotplugCallback report;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (notify && callback) {
+                report = callback;
+                // Both lists are sorted by id
+                auto old_it = devices.begin();
+                auto new_it = found.begin();
+                while (old_it != devices.end() || new_it != found.end()) {
+                    if (new_it == found.end() || (old_it != devices.end() && old_it->device_id < new_it->device_id)) {
+                        events.emplace_back(HotplugAction::Removed, *old_it++);
+                    } else if (old_it == devices.end() || new_it->device_id < old_it->device_id) {
+                        events.emplace_back(HotplugAction::Added, *new_it++);
+                    } else {
+                        if (!sameNodes(*old_it, *new_it)) {
+                            events.emplace_back(HotplugAction::Changed, *new_it);
+                        }
+                        ++old_it;
+                        ++new_it;
+                    }
+                }
+            }
+            devices = std::move(found);
+            scanned = true;
+        }
+        changed.notify_all();
+
+        for (const auto &[action, device] : events) {
+            report(action, device);
+        }
+    }
+
+    void DeviceDiscovery::Impl::monitorLoop() {
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        struct pollfd fds[2] = {};
+        fds[0].fd = stop_fd;
+        fds[0].events = POLLIN;
+        {
+            std::lock_guard<std::mutex> lock(udev_mutex);
+            fds[1].fd = udev_monitor_get_fd(monitor);
+        }
+        fds[1].events = POLLIN;
+
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log("Hotplug monitor failed: " + std::string(std::strerror(errno)));
+                break;
+            }
+            if (fds[0].revents & POLLIN) {
+                break;
+            }
+            if (!(fds[1].revents & POLLIN)) {
+                continue;
+            }
+
+            // Drain the burst a plug or unplug produces (one event per interface and node), then
+            // rescan once. The socket is non-blocking, so this stops when the queue is empty.
+            bool relevant = false;
+            {
+                std::lock_guard<std::mutex> lock(udev_mutex);
+                while (struct udev_device *device = udev_monitor_receive_device(monitor)) {
+                    relevant = relevant || udev_device_get_devnode(device) != nullptr;
+                    udev_device_unref(device);
+                }
+            }
+            if (relevant) {
+                rescan(true);
+            }
+        }
+#endif
+    }
+
+    DeviceDiscovery::DeviceDiscovery() : pImpl(std::make_unique<Impl>()) {
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        pImpl->udev = udev_new();
+        if (!pImpl->udev) {
+            pImpl->log("Cannot create udev context");
+        }
+#endif
+    }
+
+    DeviceDiscovery::~DeviceDiscovery() {
+        stopMonitor();
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        if (pImpl->udev) {
+            udev_unref(pImpl->udev);
+        }
+#endif
+    }
+
+    DeviceDiscovery &DeviceDiscovery::shared() {
+        static DeviceDiscovery discovery;
+        return discovery;
+    }
+
+    std::vector<KVMDevice> DeviceDiscovery::getDevices(bool refresh) {
+        {
+            std::lock_guard<std::mutex> lock(pImpl->mutex);
+            // A running monitor keeps the cache current, a refresh would find nothing new
+            if (pImpl->scanned && (!refresh || pImpl->monitoring)) {
+                return pImpl->devices;
+            }
+        }
+        pImpl->rescan(false);
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        return pImpl->devices;
+    }
+
+    bool DeviceDiscovery::findByPath(const std::string &node_path, KVMDevice &device) {
+        // Also accept links such as /dev/serial/by-id/...
+        std::error_code error;
+        std::string resolved = std::filesystem::canonical(node_path, error).string();
+
+        for (const auto &candidate : getDevices()) {
+            for (const std::string *path : {&candidate.video_path, &candidate.serial_path}) {
+                if (!path->empty() && (*path == node_path || *path == resolved)) {
+                    device = candidate;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool DeviceDiscovery::startMonitor(HotplugCallback callback) {
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        {
+            std::lock_guard<std::mutex> lock(pImpl->mutex);
+            if (callback) {
+                pImpl->callback = std::move(callback);
+            }
+            if (pImpl->monitoring) {
+                return true;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pImpl->udev_mutex);
+            if (!pImpl->udev) {
+                return false;
+            }
+            // "udev" rather than "kernel" events: they arrive once the rules ran and the node exists
+            pImpl->monitor = udev_monitor_new_from_netlink(pImpl->udev, "udev");
+            if (!pImpl->monitor) {
+                pImpl->log("Cannot open the udev netlink socket");
+                return false;
+            }
+            udev_monitor_filter_add_match_subsystem_devtype(pImpl->monitor, "video4linux", nullptr);
+            udev_monitor_filter_add_match_subsystem_devtype(pImpl->monitor, "tty", nullptr);
+            pImpl->stop_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (udev_monitor_enable_receiving(pImpl->monitor) < 0 || pImpl->stop_fd < 0) {
+                pImpl->log("Cannot start the hotplug monitor");
+                udev_monitor_unref(pImpl->monitor);
+                pImpl->monitor = nullptr;
+                if (pImpl->stop_fd >= 0) {
+                    close(pImpl->stop_fd);
+                    pImpl->stop_fd = -1;
+                }
+                return false;
+            }
+        }
+
+        // Scan after the socket receives, so nothing plugged in between is missed
+        pImpl->rescan(false);
+        pImpl->monitoring = true;
+        pImpl->monitor_thread = std::thread([this]() { pImpl->monitorLoop(); });
+        return true;
+#else
+        (void)callback;
+        return false;
+#endif
+    }
+
+    void DeviceDiscovery::stopMonitor() {
+#ifdef OPENTERFACE_HAVE_LIBUDEV
+        if (!pImpl->monitoring) {
+            return;
+        }
+
+        uint64_t one = 1;
+        if (write(pImpl->stop_fd, &one, sizeof(one)) < 0) {
+            pImpl->log("Cannot signal the hotplug monitor to stop");
+        }
+        if (pImpl->monitor_thread.joinable()) {
+            pImpl->monitor_thread.join();
+        }
+        pImpl->monitoring = false;
+
+        std::lock_guard<std::mutex> lock(pImpl->udev_mutex);
+        udev_monitor_unref(pImpl->monitor);
+        pImpl->monitor = nullptr;
+        close(pImpl->stop_fd);
+        pImpl->stop_fd = -1;
+#endif
+    }
+
+    bool DeviceDiscovery::isMonitoring() const { return pImpl->monitoring; }
+
+    bool DeviceDiscovery::waitForDevice(const std::string &device_id, int timeout_ms, KVMDevice &device) {
+        bool monitored = startMonitor();
+        if (!monitored) {
+            getDevices(true);
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+        std::unique_lock<std::mutex> lock(pImpl->mutex);
+        while (true) {
+            for (const auto &candidate : pImpl->devices) {
+                if (candidate.device_id == device_id && isComplete(candidate)) {
+                    device = candidate;
+                    return true;
+                }
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+
+            if (monitored) {
+                pImpl->changed.wait_until(lock, deadline);
+            } else {
+                lock.unlock();
+                std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+                    std::chrono::milliseconds(100), deadline - std::chrono::steady_clock::now()));
+                pImpl->rescan(false);
+                lock.lock();
+            }
+        }
+    }
+
+    int DeviceDiscovery::baudRateHint(const std::string &serial_path) {
+        KVMDevice device;
+        std::string path = baudCachePath();
+        if (path.empty() || !shared().findByPath(serial_path, device)) {
+            return kDefaultBaudRate;
+        }
+
+        std::lock_guard<std::mutex> lock(baud_cache_mutex);
+        auto rates = readBaudCache(path);
+        auto it = rates.find(device.device_id);
+        return it != rates.end() ? it->second : kDefaultBaudRate;
+    }
+
+    void DeviceDiscovery::rememberBaudRate(const std::string &serial_path, int baudrate) {
+        KVMDevice device;
+        std::string path = baudCachePath();
+        if (path.empty() || baudrate <= 0 || !shared().findByPath(serial_path, device)) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(baud_cache_mutex);
+        auto rates = readBaudCache(path);
+        if (rates[device.device_id] == baudrate) {
+            return;
+        }
+        rates[device.device_id] = baudrate;
+
+        // Written aside and renamed, so another instance never reads half a file
+        std::error_code error;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), error);
+        std::string temp_path = path + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::trunc);
+            for (const auto &[id, rate] : rates) {
+                file << id << " " << rate << "\n";
+            }
+            if (!file) {
+                return;
+            }
+        }
+        std::filesystem::rename(temp_path, path, error);
+    }
+
+} // namespace openterface
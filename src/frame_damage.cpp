@@ -0,0 +1,220 @@
+#include "openterface/frame_damage.hpp"
+#include "openterface/gui_video.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace openterface {
+
+    namespace {
+
+        enum FrameKind { FRAME_NONE, FRAME_RGB, FRAME_YUYV, FRAME_PLANES };
+
+        void collapseToBounds(std::vector<DamageRect>& rects) {
+            int x0 = rects[0].x, y0 = rects[0].y;
+            int x1 = x0 + rects[0].width, y1 = y0 + rects[0].height;
+            for (const DamageRect& rect : rects) {
+                x0 = std::min(x0, rect.x);
+                y0 = std::min(y0, rect.y);
+                x1 = std::max(x1, rect.x + rect.width);
+                y1 = std::max(y1, rect.y + rect.height);
+            }
+            rects.assign(1, DamageRect{x0, y0, x1 - x0, y1 - y0});
+        }
+
+    } // namespace
+
+    DamageRect mapDamage(const DamageRect& rect, int src_width, int src_height, int dst_width, int dst_height) {
+        if (src_width <= 0 || src_height <= 0) {
+            return DamageRect{};
+        }
+
+        // One extra destination pixel on each side absorbs the rounding of the 1/128 tap positions
+        auto map = [](int begin, int end, int src, int dst, int& out_begin, int& out_end) {
+            double ratio = static_cast<double>(dst) / src;
+            out_begin = std::clamp(static_cast<int>(std::floor((begin - 1) * ratio)) - 1, 0, dst);
+            out_end = std::clamp(static_cast<int>(std::ceil((end + 1) * ratio)) + 1, 0, dst);
+        };
+
+        int x0, x1, y0, y1;
+        map(rect.x, rect.x + rect.width, src_width, dst_width, x0, x1);
+        map(rect.y, rect.y + rect.height, src_height, dst_height, y0, y1);
+        return DamageRect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    bool FrameChangeDetector::update(VideoFrame& frame) {
+        frame.damage.clear();
+        frame.full_damage = true;
+
+        Layout current;
+        current.width = frame.width;
+        current.height = frame.height;
+        if (frame.is_rgb) {
+            current.kind = FRAME_RGB;
+            current.format = static_cast<int>(frame.format);
+            current.size = (size_t)frame.width * frame.height * bytesPerPixel(frame.format);
+        } else if (frame.is_yuv && frame.is_yuyv) {
+            current.kind = FRAME_YUYV;
+            current.size = (size_t)frame.width * 2 * frame.height;
+        } else if (frame.is_yuv) {
+            const YuvPlanes& planes = frame.planes;
+            current.kind = FRAME_PLANES;
+            current.subsample_x = planes.subsample_x;
+            current.subsample_y = planes.subsample_y;
+            current.size = planes.offsets[2] + (size_t)planes.plane_widths[2] * planes.plane_heights[2];
+        }
+
+        // DMA-BUF frames never reach CPU memory, and odd sizes aren't worth special cases
+        if (current.kind == FRAME_NONE || frame.width <= 0 || frame.height <= 0 || frame.data.size() < current.size ||
+            kTileSize % std::max(current.subsample_x, current.subsample_y) != 0) {
+            reset();
+            return true;
+        }
+
+        if (!(current == layout)) {
+            layout = current;
+            reference.assign(frame.data.begin(), frame.data.begin() + current.size);
+            tile_columns = (frame.width + kTileSize - 1) / kTileSize;
+            tile_rows = (frame.height + kTileSize - 1) / kTileSize;
+            dirty.assign((size_t)tile_columns * tile_rows, 0);
+            return true;
+        }
+
+        std::fill(dirty.begin(), dirty.end(), 0);
+        const uint8_t* data = frame.data.data();
+        switch (current.kind) {
+        case FRAME_RGB: {
+            size_t bpp = bytesPerPixel(frame.format);
+            comparePlane(data, reference.data(), frame.width * bpp, frame.height, kTileSize * bpp, kTileSize);
+            break;
+        }
+        case FRAME_YUYV:
+            comparePlane(data, reference.data(), (size_t)frame.width * 2, frame.height, kTileSize * 2, kTileSize);
+            break;
+        default: {
+            const YuvPlanes& planes = frame.planes;
+            for (int p = 0; p < YuvPlanes::kNumPlanes; p++) {
+                int sx = p == 0 ? 1 : planes.subsample_x;
+                int sy = p == 0 ? 1 : planes.subsample_y;
+                comparePlane(data + planes.offsets[p], reference.data() + planes.offsets[p], planes.plane_widths[p],
+                             planes.plane_heights[p], kTileSize / sx, kTileSize / sy);
+            }
+            break;
+        }
+        }
+
+        collectRects(frame.damage);
+        frame.full_damage = false;
+        return !frame.damage.empty();
+    }
+
+    void FrameChangeDetector::reset() {
+        layout = Layout();
+        reference.clear();
+        dirty.clear();
+        tile_columns = 0;
+        tile_rows = 0;
+    }
+
+    void FrameChangeDetector::comparePlane(const uint8_t* current, uint8_t* reference, size_t row_bytes, int rows,
+                                           size_t tile_bytes, int rows_per_tile) {
+        for (int y = 0; y < rows; y++) {
+            const uint8_t* row = current + (size_t)y * row_bytes;
+            uint8_t* stored = reference + (size_t)y * row_bytes;
+            if (memcmp(row, stored, row_bytes) == 0) {
+                continue;
+            }
+
+            // Padding rows and columns of allocated planes count towards the last tile
+            uint8_t* flags = &dirty[(size_t)std::min(y / rows_per_tile, tile_rows - 1) * tile_columns];
+            int column = 0;
+            for (size_t x = 0; x < row_bytes; x += tile_bytes, column++) {
+                size_t length = std::min(tile_bytes, row_bytes - x);
+                if (memcmp(row + x, stored + x, length) != 0) {
+                    memcpy(stored + x, row + x, length);
+                    flags[std::min(column, tile_columns - 1)] = 1;
+                }
+            }
+        }
+    }
+
+    void FrameChangeDetector::collectRects(std::vector<DamageRect>& rects) const {
+        rects.clear();
+        for (int ty = 0; ty < tile_rows; ty++) {
+            const uint8_t* flags = &dirty[(size_t)ty * tile_columns];
+            for (int tx = 0; tx < tile_columns; tx++) {
+                if (!flags[tx]) {
+                    continue;
+                }
+                int begin = tx;
+                while (tx < tile_columns && flags[tx]) {
+                    tx++;
+                }
+
+                DamageRect run;
+                run.x = begin * kTileSize;
+                run.y = ty * kTileSize;
+                run.width = std::min(tx * kTileSize, layout.width) - run.x;
+                run.height = std::min(run.y + kTileSize, layout.height) - run.y;
+
+                // Grow a rectangle from the row above that covers the same columns
+                auto above = std::find_if(rects.begin(), rects.end(), [&run](const DamageRect& rect) {
+                    return rect.x == run.x && rect.width == run.width && rect.y + rect.height == run.y;
+                });
+                if (above != rects.end()) {
+                    above->height += run.height;
+                } else {
+                    rects.push_back(run);
+                }
+            }
+        }
+
+        if (rects.size() > kMaxRects) {
+            collapseToBounds(rects);
+        }
+    }
+
+    void DamageHistory::record(uint64_t sequence, int width, int height, bool full,
+                               const std::vector<DamageRect>& rects) {
+        std::lock_guard<std::mutex> lock(mutex);
+        Entry& entry = entries[sequence % kDepth];
+        entry.sequence = sequence;
+        entry.width = width;
+        entry.height = height;
+        entry.full = full;
+        entry.rects = rects;
+    }
+
+    bool DamageHistory::collect(uint64_t from, uint64_t to, std::vector<DamageRect>& out) const {
+        out.clear();
+        if (from == 0 || to < from || to - from > kDepth) {
+            return false;
+        }
+        if (from == to) {
+            return true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        const Entry& last = entries[to % kDepth];
+        for (uint64_t sequence = from + 1; sequence <= to; sequence++) {
+            const Entry& entry = entries[sequence % kDepth];
+            if (entry.sequence != sequence || entry.full || entry.width != last.width ||
+                entry.height != last.height) {
+                out.clear();
+                return false;
+            }
+            out.insert(out.end(), entry.rects.begin(), entry.rects.end());
+        }
+
+        if (out.size() > FrameChangeDetector::kMaxRects) {
+            collapseToBounds(out);
+        }
+        return true;
+    }
+
+    void DamageHistory::clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        entries = {};
+    }
+
+} // namespace openterface
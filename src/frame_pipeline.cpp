@@ -0,0 +1,286 @@
+#include "openterface/frame_pipeline.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <time.h>
+
+namespace openterface {
+
+    uint64_t monotonicMicros() {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+    }
+
+    size_t LatencyHistogram::bucketOf(uint64_t us) {
+        if (us < kLinear) {
+            return us;
+        }
+        int msb = 63 - __builtin_clzll(us);  // >= 4
+        size_t sub = (us >> (msb - 3)) & (kSubBuckets - 1);
+        size_t bucket = kLinear + (msb - 4) * kSubBuckets + sub;
+        return bucket < kBuckets ? bucket : kBuckets - 1;
+    }
+
+    uint64_t LatencyHistogram::bucketValue(size_t bucket) {
+        if (bucket < kLinear) {
+            return bucket;
+        }
+        size_t msb = (bucket - kLinear) / kSubBuckets + 4;
+        uint64_t sub = (bucket - kLinear) % kSubBuckets;
+        return ((kSubBuckets + sub + 1) << (msb - 3)) - 1;
+    }
+
+    void LatencyHistogram::record(uint64_t us) {
+        buckets[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (us > current && !max.compare_exchange_weak(current, us, std::memory_order_relaxed)) {
+        }
+    }
+
+    LatencyHistogram::Summary LatencyHistogram::drain() {
+        std::array<uint32_t, kBuckets> counts;
+        Summary summary;
+        for (size_t i = 0; i < kBuckets; i++) {
+            counts[i] = buckets[i].exchange(0, std::memory_order_relaxed);
+            summary.count += counts[i];
+        }
+        summary.max_us = max.exchange(0, std::memory_order_relaxed);
+        if (summary.count == 0) {
+            return summary;
+        }
+
+        // Nearest-rank percentiles; never above the exact maximum
+        auto percentile = [&](uint64_t rank) {
+            uint64_t seen = 0;
+            for (size_t i = 0; i < kBuckets; i++) {
+                seen += counts[i];
+                if (seen >= rank) {
+                    return std::min(bucketValue(i), summary.max_us);
+                }
+            }
+            return summary.max_us;
+        };
+        summary.p50_us = percentile((summary.count + 1) / 2);
+        summary.p99_us = percentile((summary.count * 99 + 99) / 100);
+        return summary;
+    }
+
+    const char* PipelineStats::stageName(Stage stage) {
+        static const char* const names[kStageCount] = {"capture", "queue",   "decode", "wait", "upload",
+                                                       "commit",  "present", "total",  "input"};
+        return names[stage];
+    }
+
+    void PipelineStats::add(Stage stage, uint64_t from, uint64_t to) {
+        // A stage the frame didn't go through (e.g. no driver timestamp) isn't a zero sample
+        if (from && to >= from) {
+            stages[stage].record(to - from);
+        }
+    }
+
+    void PipelineStats::recordFrame(const FrameTimestamps& times, bool awaiting_presentation) {
+        frame_count.fetch_add(1, std::memory_order_relaxed);
+        add(CAPTURE, times.capture, times.queued);
+        add(QUEUE, times.queued, times.decode_start);
+        add(DECODE, times.decode_start, times.decoded);
+        add(WAIT, times.decoded, times.render_start);
+        add(UPLOAD, times.render_start, times.uploaded);
+        add(COMMIT, times.uploaded, times.committed);
+        if (!awaiting_presentation) {
+            add(TOTAL, times.capture ? times.capture : times.queued, times.committed);
+        }
+    }
+
+    void PipelineStats::recordPresented(const FrameTimestamps& times) {
+        add(PRESENT, times.committed, times.presented);
+        add(TOTAL, times.capture ? times.capture : times.queued, times.presented);
+    }
+
+    std::string PipelineStats::summary() {
+        uint64_t frames = frame_count.exchange(0, std::memory_order_relaxed);
+        std::string text;
+        for (int i = 0; i < kStageCount; i++) {
+            LatencyHistogram::Summary stage = stages[i].drain();
+            if (stage.count == 0) {
+                continue;
+            }
+            char part[80];
+            snprintf(part, sizeof(part), "%s%s %.1f/%.1f/%.1fms", text.empty() ? "" : " ",
+                     stageName(static_cast<Stage>(i)), stage.p50_us / 1000.0, stage.p99_us / 1000.0,
+                     stage.max_us / 1000.0);
+            text += part;
+        }
+        if (text.empty()) {
+            return "no frames";
+        }
+        return text + " (p50/p99/max over " + std::to_string(frames) + " frames)";
+    }
+
+    std::string PipelineStats::report() {
+        uint64_t frames = frame_count.exchange(0, std::memory_order_relaxed);
+        std::string text = "stage        count     p50ms     p99ms     maxms\n";
+        for (int i = 0; i < kStageCount; i++) {
+            LatencyHistogram::Summary stage = stages[i].drain();
+            char line[96];
+            snprintf(line, sizeof(line), "%-8s %9llu %9.2f %9.2f %9.2f\n", stageName(static_cast<Stage>(i)),
+                     static_cast<unsigned long long>(stage.count), stage.p50_us / 1000.0, stage.p99_us / 1000.0,
+                     stage.max_us / 1000.0);
+            text += line;
+        }
+        return text + std::to_string(frames) + " frames rendered";
+    }
+
+    void FrameGovernor::setPolicy(const Policy& new_policy) {
+        std::lock_guard<std::mutex> lock(mutex);
+        policy = new_policy;
+        policy.unfocused_fps = std::max(0, policy.unfocused_fps);
+        policy.hidden_fps = std::max(0, policy.hidden_fps);
+        if (!policy.adaptive) {
+            load_fps = 0;
+            decode_shift.store(0, std::memory_order_relaxed);
+        }
+        updatePeriod();
+    }
+
+    FrameGovernor::Policy FrameGovernor::getPolicy() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return policy;
+    }
+
+    bool FrameGovernor::setVisibility(Visibility new_visibility) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (visibility == new_visibility) {
+            return false;
+        }
+        visibility = new_visibility;
+        // Timings from a throttled window say nothing about the full rate; start over
+        window_frames = window_decode = window_render = 0;
+        updatePeriod();
+        return true;
+    }
+
+    FrameGovernor::Visibility FrameGovernor::getVisibility() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return visibility;
+    }
+
+    bool FrameGovernor::admit(uint64_t capture_us) {
+        if (last_capture != 0 && capture_us > last_capture) {
+            // Smoothed over ~8 frames, skipped ones included: the budget every stage must fit
+            uint64_t interval = capture_us - last_capture;
+            uint64_t average = capture_interval.load(std::memory_order_relaxed);
+            average = average == 0 ? interval : average - average / 8 + interval / 8;
+            capture_interval.store(average, std::memory_order_relaxed);
+        }
+        last_capture = capture_us;
+
+        uint64_t period = period_us.load(std::memory_order_relaxed);
+        if (period == 0) {
+            return true;
+        }
+        if (capture_us < next_frame) {
+            skipped_frames.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Keep to the grid unless capture stalled for longer than a period
+        next_frame = capture_us - next_frame > period ? capture_us + period : next_frame + period;
+        return true;
+    }
+
+    bool FrameGovernor::recordFrame(const FrameTimestamps& times) {
+        if (times.committed == 0 || times.decoded < times.queued || times.committed < times.render_start) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        window_decode += times.decoded - times.queued;
+        window_render += times.committed - times.render_start;
+        if (++window_frames < kWindowFrames) {
+            return false;
+        }
+        uint64_t decode = window_decode / window_frames;
+        uint64_t render = window_render / window_frames;
+        window_frames = window_decode = window_render = 0;
+
+        uint64_t interval = capture_interval.load(std::memory_order_relaxed);
+        if (!policy.adaptive || visibility != Visibility::Active || interval == 0) {
+            return false;
+        }
+
+        // Each stage works on one frame at a time, so each must finish within the time between
+        // frames it is given
+        uint64_t budget = load_fps > 0 ? std::max(interval, uint64_t(1000000 / load_fps)) : interval;
+        uint64_t slowest = std::max(decode, render);
+        int shift = decodeShift();
+        if (slowest > budget * 9 / 10) {
+            if (decode >= render && shift < kMaxShift) {
+                decode_shift.store(shift + 1, std::memory_order_relaxed);
+            } else {
+                int sustainable = std::max(1, static_cast<int>(800000 / slowest));
+                if (load_fps != 0 && sustainable >= load_fps) {
+                    return false;  // Already there
+                }
+                load_fps = sustainable;
+            }
+            last_change = times.committed;
+            updatePeriod();
+            return true;
+        }
+
+        if (times.committed - last_change < kHoldUs) {
+            return false;
+        }
+        // Give back the rate first - it costs latency - then the decode size. A decode twice the
+        // size is taken to cost twice as much: the entropy decoding doesn't shrink with it.
+        if (load_fps > 0) {
+            int full_rate = static_cast<int>((1000000 + interval / 2) / interval);
+            int sustainable = static_cast<int>(700000 / std::max<uint64_t>(slowest, 1));
+            if (sustainable <= load_fps) {
+                return false;
+            }
+            load_fps = sustainable >= full_rate ? 0 : sustainable;
+        } else if (shift > 0 && decode * 2 < interval * 7 / 10 && render < interval * 7 / 10) {
+            decode_shift.store(shift - 1, std::memory_order_relaxed);
+        } else {
+            return false;
+        }
+        last_change = times.committed;
+        updatePeriod();
+        return true;
+    }
+
+    int FrameGovernor::rateCapLocked() const {
+        int visible_fps = visibility == Visibility::Hidden      ? policy.hidden_fps
+                          : visibility == Visibility::Unfocused ? policy.unfocused_fps
+                                                                : 0;
+        if (visible_fps == 0 || load_fps == 0) {
+            return std::max(visible_fps, load_fps);
+        }
+        return std::min(visible_fps, load_fps);
+    }
+
+    int FrameGovernor::rateCap() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return rateCapLocked();
+    }
+
+    void FrameGovernor::updatePeriod() {
+        int fps = rateCapLocked();
+        period_us.store(fps > 0 ? 1000000 / fps : 0, std::memory_order_relaxed);
+    }
+
+    std::string FrameGovernor::describe() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        int fps = rateCapLocked();
+        std::string text = visibility == Visibility::Hidden      ? "hidden"
+                           : visibility == Visibility::Unfocused ? "unfocused"
+                                                                 : "active";
+        text += fps > 0 ? ", " + std::to_string(fps) + " fps" : ", full rate";
+        int shift = decodeShift();
+        if (shift > 0) {
+            text += ", 1/" + std::to_string(1 << shift) + "-size decode";
+        }
+        return text;
+    }
+
+} // namespace openterface
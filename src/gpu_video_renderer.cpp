@@ -1,7 +1,13 @@
 #include "openterface/gpu_video_renderer.hpp"
+#include "openterface/frame_damage.hpp"
+#include "openterface/frame_pipeline.hpp"
 #include "openterface/gui_video.hpp"
+#include <algorithm>
 #include <iostream>
 #include <cstring>
+#include <cstdint>
+#include <limits>
+#include <sys/stat.h>
 
 namespace openterface {
 
@@ -28,6 +34,95 @@ namespace openterface {
         }
     )";
 
+    // Fragment shader for DMA-BUF frames; the driver samples (and colour-converts) the image
+    const char* external_fragment_shader_source = R"(
+        #extension GL_OES_EGL_image_external : require
+        precision mediump float;
+        uniform samplerExternalOES texture;
+        varying vec2 v_texcoord;
+
+        void main() {
+            gl_FragColor = texture2D(texture, v_texcoord);
+        }
+    )";
+
+    // Planar YCbCr (libjpeg raw output) -> RGB, JFIF full-range BT.601. Planes are padded to whole
+    // DCT blocks, so the scales map the quad onto the visible part of each plane.
+    const char* planar_fragment_shader_source = R"(
+        #ifdef GL_FRAGMENT_PRECISION_HIGH
+        precision highp float;
+        #else
+        precision mediump float;
+        #endif
+        uniform sampler2D y_texture;
+        uniform sampler2D cb_texture;
+        uniform sampler2D cr_texture;
+        uniform vec2 luma_scale;
+        uniform vec2 chroma_scale;
+        varying vec2 v_texcoord;
+
+        void main() {
+            float y = texture2D(y_texture, v_texcoord * luma_scale).r;
+            float cb = texture2D(cb_texture, v_texcoord * chroma_scale).r - 0.501961;
+            float cr = texture2D(cr_texture, v_texcoord * chroma_scale).r - 0.501961;
+            gl_FragColor = vec4(y + 1.402 * cr, y - 0.344136 * cb - 0.714136 * cr, y + 1.772 * cb, 1.0);
+        }
+    )";
+
+    // Packed YUYV -> RGB, limited-range BT.601 (UVC). Each RGBA texel holds Y0 Cb Y1 Cr for a
+    // pixel pair; nearest sampling picks the pair and the fractional position picks the luma.
+    const char* yuyv_fragment_shader_source = R"(
+        #ifdef GL_FRAGMENT_PRECISION_HIGH
+        precision highp float;
+        #else
+        precision mediump float;
+        #endif
+        uniform sampler2D texture;
+        uniform float frame_width;
+        varying vec2 v_texcoord;
+
+        void main() {
+            vec4 texel = texture2D(texture, v_texcoord);
+            float odd = step(0.5, fract(v_texcoord.x * frame_width * 0.5));
+            float y = (mix(texel.r, texel.b, odd) - 0.062745) * 1.164384;
+            float cb = (texel.g - 0.501961) * 1.138393;
+            float cr = (texel.a - 0.501961) * 1.138393;
+            gl_FragColor = vec4(y + 1.402 * cr, y - 0.344136 * cb - 0.714136 * cr, y + 1.772 * cb, 1.0);
+        }
+    )";
+
+    // GL_PIXEL_UNPACK_BUFFER in GLES3, same enum as GL_PIXEL_UNPACK_BUFFER_NV
+    static constexpr GLenum kPixelUnpackBuffer = GL_PIXEL_UNPACK_BUFFER_NV;
+
+    static int glFormatBytesPerPixel(GLenum format) {
+        switch (format) {
+        case GL_RGBA:
+            return 4;
+        case GL_RGB:
+            return 3;
+        default:
+            return 1; // GL_LUMINANCE
+        }
+    }
+
+    // Offset into the bound PBO (or client memory) as glTexSubImage2D expects it
+    static const void* uploadSource(const uint8_t* base, size_t offset) {
+        return reinterpret_cast<const void*>(reinterpret_cast<uintptr_t>(base) + offset);
+    }
+
+    // End of a dirty row span that reaches the bottom of the picture: it also covers the padding
+    // rows of textures allocated taller than the picture (JPEG planes round up to whole MCUs)
+    static constexpr int kRowsToBottom = std::numeric_limits<int>::max();
+
+    // Rows of a `rows` tall texture holding one row per `divisor` picture rows that a span touches
+    static void spanRows(int span_begin, int span_end, int divisor, int rows, int& begin, int& end) {
+        begin = std::min(span_begin / divisor, rows);
+        end = span_end == kRowsToBottom ? rows : std::min(rows, (span_end + divisor - 1) / divisor);
+    }
+
+    // DRM_FORMAT_MOD_INVALID: the producer didn't report a modifier
+    static constexpr uint64_t kDrmFormatModInvalid = 0x00ffffffffffffffULL;
+
     GPUVideoRenderer::GPUVideoRenderer() = default;
 
     GPUVideoRenderer::~GPUVideoRenderer() {
@@ -48,6 +143,10 @@ namespace openterface {
         return true;
     }
 
+    bool GPUVideoRenderer::initializeOffscreen(int width, int height) {
+        return initialize(nullptr, nullptr, width, height);
+    }
+
     bool GPUVideoRenderer::initializeInCurrentThread() {
         if (!initialized || context_created) {
             return context_created;
@@ -59,6 +158,20 @@ namespace openterface {
             return false;
         }
 
+        // The GUI paces rendering with wl_surface_frame callbacks. A throttled swap would block
+        // the render thread and present a frame that is already stale by the time it lands.
+        eglSwapInterval(egl_display, 0);
+
+        // Lets static frames tell the compositor which part of the window changed
+        const char* egl_extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+        if (egl_extensions && strstr(egl_extensions, "EGL_KHR_swap_buffers_with_damage")) {
+            egl_swap_buffers_with_damage =
+                reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(eglGetProcAddress("eglSwapBuffersWithDamageKHR"));
+        } else if (egl_extensions && strstr(egl_extensions, "EGL_EXT_swap_buffers_with_damage")) {
+            egl_swap_buffers_with_damage =
+                reinterpret_cast<PFNEGLSWAPBUFFERSWITHDAMAGEKHRPROC>(eglGetProcAddress("eglSwapBuffersWithDamageEXT"));
+        }
+
         if (!createShaders()) {
             return false;
         }
@@ -77,13 +190,220 @@ namespace openterface {
 
         printGLError("texture creation");
 
+        setupPixelBuffers();
+
+        // Optional GPU colour conversion; RGB frames still render without it
+        yuv_supported = createYuvShaders();
+        if (!yuv_supported) {
+            std::cerr << "[GPU] YUV shaders unavailable: " << last_error << std::endl;
+        }
+
+        // Optional zero-copy path; the upload path keeps working without it
+        dmabuf_supported = setupDmaBufImport();
+        std::cout << "[GPU] DMA-BUF import " << (dmabuf_supported ? "available" : "not available") << std::endl;
+
         context_created = true;
         return true;
     }
 
+    void GPUVideoRenderer::setupPixelBuffers() {
+        // GLES3 has PBOs and buffer mapping in core; on GLES2 NV_pixel_buffer_object provides the
+        // unpack target and EXT_map_buffer_range (optional) the mapping
+        const char* version = reinterpret_cast<const char*>(glGetString(GL_VERSION));
+        const char* extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        bool gles3 = version && strncmp(version, "OpenGL ES 3", 11) == 0;
+        bool nv_pbo = extensions && strstr(extensions, "GL_NV_pixel_buffer_object");
+        if (!gles3 && !nv_pbo) {
+            std::cout << "[GPU] Pixel buffer objects not available, uploading from client memory" << std::endl;
+            return;
+        }
+
+        if (gles3) {
+            gl_map_buffer_range = reinterpret_cast<PFNGLMAPBUFFERRANGEEXTPROC>(eglGetProcAddress("glMapBufferRange"));
+            gl_unmap_buffer = reinterpret_cast<PFNGLUNMAPBUFFEROESPROC>(eglGetProcAddress("glUnmapBuffer"));
+        } else if (extensions && strstr(extensions, "GL_EXT_map_buffer_range")) {
+            gl_map_buffer_range = reinterpret_cast<PFNGLMAPBUFFERRANGEEXTPROC>(eglGetProcAddress("glMapBufferRangeEXT"));
+            gl_unmap_buffer = reinterpret_cast<PFNGLUNMAPBUFFEROESPROC>(eglGetProcAddress("glUnmapBufferOES"));
+        }
+        if (!gl_map_buffer_range || !gl_unmap_buffer) {
+            gl_map_buffer_range = nullptr;
+            gl_unmap_buffer = nullptr;
+        }
+
+        glGenBuffers(kPixelBufferCount, pixel_buffers);
+        pbo_supported = true;
+        std::cout << "[GPU] Streaming uploads through " << kPixelBufferCount << " pixel buffer objects ("
+                  << (gl_map_buffer_range ? "mapped" : "glBufferSubData") << ")" << std::endl;
+    }
+
+    const uint8_t* GPUVideoRenderer::stageUpload(const uint8_t* data, size_t size) {
+        if (!pbo_supported) {
+            return data;
+        }
+
+        // Round-robin through the ring: the buffer written now was last read by the upload two or
+        // three frames ago, so mapping it doesn't wait for the GPU and this frame's copy into the
+        // texture runs asynchronously while the previous frame is still being drawn
+        int index = pixel_buffer_index;
+        pixel_buffer_index = (pixel_buffer_index + 1) % kPixelBufferCount;
+        glBindBuffer(kPixelUnpackBuffer, pixel_buffers[index]);
+
+        if (pixel_buffer_sizes[index] != size) {
+            glBufferData(kPixelUnpackBuffer, size, nullptr, GL_STREAM_DRAW);
+            pixel_buffer_sizes[index] = size;
+        }
+
+        // A partial update copies only the rows it uploads; the rest of the buffer is never read
+        if (gl_map_buffer_range) {
+            void* mapped = gl_map_buffer_range(kPixelUnpackBuffer, 0, size,
+                                               GL_MAP_WRITE_BIT_EXT | GL_MAP_INVALIDATE_BUFFER_BIT_EXT);
+            if (mapped) {
+                if (upload_ranges.empty()) {
+                    memcpy(mapped, data, size);
+                } else {
+                    for (const ByteRange& range : upload_ranges) {
+                        memcpy(static_cast<uint8_t*>(mapped) + range.offset, data + range.offset, range.length);
+                    }
+                }
+                if (gl_unmap_buffer(kPixelUnpackBuffer)) {
+                    return nullptr; // Offsets are relative to the start of the PBO
+                }
+            }
+        }
+
+        if (upload_ranges.empty()) {
+            glBufferSubData(kPixelUnpackBuffer, 0, size, data);
+        } else {
+            for (const ByteRange& range : upload_ranges) {
+                glBufferSubData(kPixelUnpackBuffer, range.offset, range.length, data + range.offset);
+            }
+        }
+        return nullptr;
+    }
+
+    void GPUVideoRenderer::finishUpload() {
+        if (pbo_supported) {
+            glBindBuffer(kPixelUnpackBuffer, 0);
+        }
+        upload_time = monotonicMicros();
+    }
+
+    void GPUVideoRenderer::uploadTexture(GLuint tex, TextureStorage& storage, GLenum format, int width, int height,
+                                         const void* pixels, int row_divisor) {
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, glFormatBytesPerPixel(format) == 4 ? 4 : 1);
+
+        // Storage is (re)allocated only when the frame geometry changes; every other frame
+        // updates it in place
+        if (!storage.matches(format, width, height)) {
+            glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, nullptr);
+            storage.width = width;
+            storage.height = height;
+            storage.format = format;
+        } else if (partial_upload) {
+            // Full-width row bands: GLES2 has no GL_UNPACK_ROW_LENGTH for narrower sub-rectangles
+            size_t row_bytes = (size_t)width * glFormatBytesPerPixel(format);
+            for (const RowSpan& span : dirty_rows) {
+                int begin, end;
+                spanRows(span.begin, span.end, row_divisor, height, begin, end);
+                if (end > begin) {
+                    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, begin, width, end - begin, format, GL_UNSIGNED_BYTE,
+                                    uploadSource(static_cast<const uint8_t*>(pixels), begin * row_bytes));
+                }
+            }
+            return;
+        }
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, format, GL_UNSIGNED_BYTE, pixels);
+    }
+
+    void GPUVideoRenderer::setDirtyRows(const std::vector<DamageRect>* damage, int height) {
+        dirty_rows.clear();
+        upload_ranges.clear();
+        if (damage) {
+            for (const DamageRect& rect : *damage) {
+                int begin = std::clamp(rect.y, 0, height);
+                int end = std::clamp(rect.y + rect.height, begin, height);
+                if (end > begin) {
+                    dirty_rows.push_back({begin, end == height ? kRowsToBottom : end});
+                }
+            }
+        }
+
+        std::sort(dirty_rows.begin(), dirty_rows.end(),
+                  [](const RowSpan& a, const RowSpan& b) { return a.begin < b.begin; });
+        size_t merged = 0;
+        for (const RowSpan& span : dirty_rows) {
+            if (merged > 0 && span.begin <= dirty_rows[merged - 1].end) {
+                dirty_rows[merged - 1].end = std::max(dirty_rows[merged - 1].end, span.end);
+            } else {
+                dirty_rows[merged++] = span;
+            }
+        }
+        dirty_rows.resize(merged);
+
+        // Callers drop back to a full upload when a texture has to be reallocated
+        partial_upload = !dirty_rows.empty();
+    }
+
+    void GPUVideoRenderer::addUploadRanges(size_t offset, size_t row_bytes, int row_divisor, int rows) {
+        for (const RowSpan& span : dirty_rows) {
+            int begin, end;
+            spanRows(span.begin, span.end, row_divisor, rows, begin, end);
+            if (end > begin) {
+                upload_ranges.push_back({offset + begin * row_bytes, (end - begin) * row_bytes});
+            }
+        }
+    }
+
+    void GPUVideoRenderer::setSwapDamage(const std::vector<DamageRect>* damage, int frame_width, int frame_height) {
+        swap_damage.clear();
+        if (!damage || !egl_swap_buffers_with_damage || surface_damaged) {
+            return;
+        }
+        for (const DamageRect& rect : *damage) {
+            DamageRect area = mapDamage(rect, frame_width, frame_height, surface_width, surface_height);
+            if (area.width > 0 && area.height > 0) {
+                swap_damage.insert(swap_damage.end(),
+                                   {area.x, surface_height - area.y - area.height, area.width, area.height});
+            }
+        }
+    }
+
+    bool GPUVideoRenderer::setupDmaBufImport() {
+        const char* egl_extensions = eglQueryString(egl_display, EGL_EXTENSIONS);
+        const char* gl_extensions = reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS));
+        if (!egl_extensions || !gl_extensions || !strstr(egl_extensions, "EGL_EXT_image_dma_buf_import") ||
+            !strstr(gl_extensions, "GL_OES_EGL_image_external")) {
+            return false;
+        }
+        dmabuf_modifiers = strstr(egl_extensions, "EGL_EXT_image_dma_buf_import_modifiers") != nullptr;
+
+        egl_create_image = reinterpret_cast<PFNEGLCREATEIMAGEKHRPROC>(eglGetProcAddress("eglCreateImageKHR"));
+        egl_destroy_image = reinterpret_cast<PFNEGLDESTROYIMAGEKHRPROC>(eglGetProcAddress("eglDestroyImageKHR"));
+        gl_image_target_texture =
+            reinterpret_cast<PFNGLEGLIMAGETARGETTEXTURE2DOESPROC>(eglGetProcAddress("glEGLImageTargetTexture2DOES"));
+        if (!egl_create_image || !egl_destroy_image || !gl_image_target_texture) {
+            return false;
+        }
+
+        external_program = compileProgram(vertex_shader_source, external_fragment_shader_source);
+        if (!external_program) {
+            std::cerr << "[GPU] " << last_error << std::endl;
+            return false;
+        }
+        external_position_attr = glGetAttribLocation(external_program, "position");
+        external_texcoord_attr = glGetAttribLocation(external_program, "texcoord");
+        external_texture_uniform = glGetUniformLocation(external_program, "texture");
+        return true;
+    }
+
     bool GPUVideoRenderer::setupEGL() {
+        // No surface: offscreen rendering into a pbuffer
+        bool offscreen = wayland_surface == nullptr;
+
         // Get EGL display
-        egl_display = eglGetDisplay((EGLNativeDisplayType)wayland_display);
+        egl_display = offscreen ? eglGetDisplay(EGL_DEFAULT_DISPLAY)
+                                : eglGetDisplay((EGLNativeDisplayType)wayland_display);
         if (egl_display == EGL_NO_DISPLAY) {
             last_error = "Failed to get EGL display";
             return false;
@@ -100,7 +420,7 @@ namespace openterface {
 
         // Configure EGL
         EGLint config_attribs[] = {
-            EGL_SURFACE_TYPE, EGL_WINDOW_BIT,
+            EGL_SURFACE_TYPE, offscreen ? EGL_PBUFFER_BIT : EGL_WINDOW_BIT,
             EGL_RED_SIZE, 8,
             EGL_GREEN_SIZE, 8,
             EGL_BLUE_SIZE, 8,
@@ -115,18 +435,31 @@ namespace openterface {
             return false;
         }
 
-        // Create Wayland EGL window
-        egl_window = wl_egl_window_create(wayland_surface, surface_width, surface_height);
-        if (!egl_window) {
-            last_error = "Failed to create Wayland EGL window";
-            return false;
-        }
+        if (offscreen) {
+            EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, surface_width,
+                EGL_HEIGHT, surface_height,
+                EGL_NONE
+            };
+            egl_surface = eglCreatePbufferSurface(egl_display, egl_config, pbuffer_attribs);
+            if (egl_surface == EGL_NO_SURFACE) {
+                printEGLError("eglCreatePbufferSurface");
+                return false;
+            }
+        } else {
+            // Create Wayland EGL window
+            egl_window = wl_egl_window_create(wayland_surface, surface_width, surface_height);
+            if (!egl_window) {
+                last_error = "Failed to create Wayland EGL window";
+                return false;
+            }
 
-        // Create EGL surface
-        egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)egl_window, nullptr);
-        if (egl_surface == EGL_NO_SURFACE) {
-            printEGLError("eglCreateWindowSurface");
-            return false;
+            // Create EGL surface
+            egl_surface = eglCreateWindowSurface(egl_display, egl_config, (EGLNativeWindowType)egl_window, nullptr);
+            if (egl_surface == EGL_NO_SURFACE) {
+                printEGLError("eglCreateWindowSurface");
+                return false;
+            }
         }
 
         // Bind OpenGL ES API
@@ -162,10 +495,10 @@ namespace openterface {
         return true;
     }
 
-    bool GPUVideoRenderer::createShaders() {
+    GLuint GPUVideoRenderer::compileProgram(const char* vertex_source, const char* fragment_source) {
         // Compile vertex shader
         GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex_shader, 1, &vertex_shader_source, nullptr);
+        glShaderSource(vertex_shader, 1, &vertex_source, nullptr);
         glCompileShader(vertex_shader);
 
         GLint compile_status;
@@ -174,12 +507,13 @@ namespace openterface {
             GLchar info_log[512];
             glGetShaderInfoLog(vertex_shader, 512, nullptr, info_log);
             last_error = "Vertex shader compilation failed: " + std::string(info_log);
-            return false;
+            glDeleteShader(vertex_shader);
+            return 0;
         }
 
         // Compile fragment shader
         GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment_shader, 1, &fragment_shader_source, nullptr);
+        glShaderSource(fragment_shader, 1, &fragment_source, nullptr);
         glCompileShader(fragment_shader);
 
         glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &compile_status);
@@ -188,29 +522,38 @@ namespace openterface {
             glGetShaderInfoLog(fragment_shader, 512, nullptr, info_log);
             last_error = "Fragment shader compilation failed: " + std::string(info_log);
             glDeleteShader(vertex_shader);
-            return false;
+            glDeleteShader(fragment_shader);
+            return 0;
         }
 
         // Create shader program
-        shader_program = glCreateProgram();
-        glAttachShader(shader_program, vertex_shader);
-        glAttachShader(shader_program, fragment_shader);
-        glLinkProgram(shader_program);
+        GLuint program = glCreateProgram();
+        glAttachShader(program, vertex_shader);
+        glAttachShader(program, fragment_shader);
+        glLinkProgram(program);
+
+        // Clean up shaders (they're linked into the program now)
+        glDeleteShader(vertex_shader);
+        glDeleteShader(fragment_shader);
 
         GLint link_status;
-        glGetProgramiv(shader_program, GL_LINK_STATUS, &link_status);
+        glGetProgramiv(program, GL_LINK_STATUS, &link_status);
         if (!link_status) {
             GLchar info_log[512];
-            glGetProgramInfoLog(shader_program, 512, nullptr, info_log);
+            glGetProgramInfoLog(program, 512, nullptr, info_log);
             last_error = "Shader program linking failed: " + std::string(info_log);
-            glDeleteShader(vertex_shader);
-            glDeleteShader(fragment_shader);
-            return false;
+            glDeleteProgram(program);
+            return 0;
         }
 
-        // Clean up shaders (they're linked into the program now)
-        glDeleteShader(vertex_shader);
-        glDeleteShader(fragment_shader);
+        return program;
+    }
+
+    bool GPUVideoRenderer::createShaders() {
+        shader_program = compileProgram(vertex_shader_source, fragment_shader_source);
+        if (!shader_program) {
+            return false;
+        }
 
         // Get attribute and uniform locations
         position_attr = glGetAttribLocation(shader_program, "position");
@@ -222,6 +565,46 @@ namespace openterface {
         return true;
     }
 
+    bool GPUVideoRenderer::createYuvShaders() {
+        planar_program = compileProgram(vertex_shader_source, planar_fragment_shader_source);
+        if (!planar_program) {
+            return false;
+        }
+        planar_position_attr = glGetAttribLocation(planar_program, "position");
+        planar_texcoord_attr = glGetAttribLocation(planar_program, "texcoord");
+        planar_y_uniform = glGetUniformLocation(planar_program, "y_texture");
+        planar_cb_uniform = glGetUniformLocation(planar_program, "cb_texture");
+        planar_cr_uniform = glGetUniformLocation(planar_program, "cr_texture");
+        planar_luma_scale_uniform = glGetUniformLocation(planar_program, "luma_scale");
+        planar_chroma_scale_uniform = glGetUniformLocation(planar_program, "chroma_scale");
+
+        yuyv_program = compileProgram(vertex_shader_source, yuyv_fragment_shader_source);
+        if (!yuyv_program) {
+            return false;
+        }
+        yuyv_position_attr = glGetAttribLocation(yuyv_program, "position");
+        yuyv_texcoord_attr = glGetAttribLocation(yuyv_program, "texcoord");
+        yuyv_texture_uniform = glGetUniformLocation(yuyv_program, "texture");
+        yuyv_width_uniform = glGetUniformLocation(yuyv_program, "frame_width");
+
+        // Plane textures filter linearly (that is the chroma upsampling); the YUYV texture must not
+        // blend neighbouring pixel pairs
+        glGenTextures(3, plane_textures);
+        glGenTextures(1, &yuyv_texture);
+        for (GLuint tex : {plane_textures[0], plane_textures[1], plane_textures[2], yuyv_texture}) {
+            GLint filter = tex == yuyv_texture ? GL_NEAREST : GL_LINEAR;
+            glBindTexture(GL_TEXTURE_2D, tex);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+
+        printGLError("YUV shader creation");
+
+        return true;
+    }
+
     bool GPUVideoRenderer::setupVertexBuffer() {
         // Fullscreen quad vertices (position + texcoord)
         float vertices[] = {
@@ -241,57 +624,309 @@ namespace openterface {
         return true;
     }
 
-    bool GPUVideoRenderer::renderFrame(const VideoFrame& frame) {
-        if (!initialized || !context_created || !frame.is_rgb || frame.data.empty()) {
+    bool GPUVideoRenderer::renderFrame(const VideoFrame& frame, const std::vector<DamageRect>* damage) {
+        if (!initialized || !context_created || !(frame.is_rgb || frame.is_yuv) || frame.data.empty()) {
+            return false;
+        }
+
+        if (frame.is_yuv && !yuv_supported) {
+            last_error = "YUV frames need the YUV shaders";
+            return false;
+        }
+
+        // GLES2 has no BGRA upload in core, so XRGB8888 (wl_shm layout) frames can't be used here
+        if (frame.is_rgb && frame.format == PixelFormat::XRGB8888) {
+            last_error = "XRGB8888 frames are not supported by the GPU renderer";
             return false;
         }
 
         // Context should already be current in this thread
         // No need to call eglMakeCurrent again
 
+        setDirtyRows(damage, frame.height);
+
         // Set viewport
         glViewport(0, 0, surface_width, surface_height);
 
         // Clear screen
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // Upload video frame to texture
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frame.width, frame.height, 0, GL_RGB, GL_UNSIGNED_BYTE, frame.data.data());
+        if (frame.is_yuv) {
+            if (!drawYuvFrame(frame)) {
+                return false;
+            }
+        } else {
+            // Upload video frame to texture
+            // RGBX8888 frames from the decoder upload as-is; RGB24 rows are only 1-byte aligned
+            GLenum format = frame.format == PixelFormat::RGBX8888 ? GL_RGBA : GL_RGB;
+            size_t size = (size_t)frame.width * frame.height * glFormatBytesPerPixel(format);
+            if (frame.data.size() < size) {
+                last_error = "Frame data too small";
+                return false;
+            }
+
+            partial_upload = partial_upload && texture_storage.matches(format, frame.width, frame.height);
+            if (partial_upload) {
+                addUploadRanges(0, (size_t)frame.width * glFormatBytesPerPixel(format), 1, frame.height);
+            }
+
+            const uint8_t* source = stageUpload(frame.data.data(), size);
+            glActiveTexture(GL_TEXTURE0);
+            uploadTexture(texture, texture_storage, format, frame.width, frame.height, uploadSource(source, 0));
+            finishUpload();
 
+            drawTexturedQuad(shader_program, position_attr, texcoord_attr, texture_uniform, GL_TEXTURE_2D, texture);
+        }
+
+        // The whole quad is redrawn (the back buffer's age is unknown), but the compositor only
+        // needs to recomposite what changed
+        setSwapDamage(partial_upload ? damage : nullptr, frame.width, frame.height);
+        if (!presentFrame()) {
+            return false;
+        }
+
+        printGLError("renderFrame");
+
+        return true;
+    }
+
+    bool GPUVideoRenderer::drawYuvFrame(const VideoFrame& frame) {
+        if (frame.is_yuyv) {
+            if (frame.width % 2 != 0 || frame.data.size() < (size_t)frame.width * 2 * frame.height) {
+                last_error = "Invalid YUYV frame";
+                return false;
+            }
+
+            partial_upload = partial_upload && yuyv_storage.matches(GL_RGBA, frame.width / 2, frame.height);
+            if (partial_upload) {
+                addUploadRanges(0, (size_t)frame.width * 2, 1, frame.height);
+            }
+
+            const uint8_t* source = stageUpload(frame.data.data(), (size_t)frame.width * 2 * frame.height);
+            glActiveTexture(GL_TEXTURE0);
+            uploadTexture(yuyv_texture, yuyv_storage, GL_RGBA, frame.width / 2, frame.height, uploadSource(source, 0));
+            finishUpload();
+
+            glUseProgram(yuyv_program);
+            glUniform1f(yuyv_width_uniform, (float)frame.width);
+            drawTexturedQuad(yuyv_program, yuyv_position_attr, yuyv_texcoord_attr, yuyv_texture_uniform, GL_TEXTURE_2D,
+                             yuyv_texture);
+            return true;
+        }
+
+        const YuvPlanes& planes = frame.planes;
+        size_t cr_end = planes.offsets[2] + (size_t)planes.plane_widths[2] * planes.plane_heights[2];
+        if (planes.width <= 0 || planes.height <= 0 || planes.plane_widths[0] <= 0 || planes.plane_widths[1] <= 0 ||
+            frame.data.size() < cr_end) {
+            last_error = "Invalid YCbCr planes";
+            return false;
+        }
+
+        for (int p = 0; p < YuvPlanes::kNumPlanes; p++) {
+            partial_upload = partial_upload && plane_storage[p].matches(GL_LUMINANCE, planes.plane_widths[p],
+                                                                        planes.plane_heights[p]);
+        }
+        if (partial_upload) {
+            for (int p = 0; p < YuvPlanes::kNumPlanes; p++) {
+                addUploadRanges(planes.offsets[p], planes.plane_widths[p], p == 0 ? 1 : planes.subsample_y,
+                                planes.plane_heights[p]);
+            }
+        }
+
+        // Half (4:2:0) or two thirds (4:2:2) of the bytes of an RGB24 upload; the planes are
+        // contiguous, so one staging copy covers all three
+        const uint8_t* source = stageUpload(frame.data.data(), cr_end);
+        for (int p = 0; p < YuvPlanes::kNumPlanes; p++) {
+            glActiveTexture(GL_TEXTURE0 + p);
+            uploadTexture(plane_textures[p], plane_storage[p], GL_LUMINANCE, planes.plane_widths[p],
+                          planes.plane_heights[p], uploadSource(source, planes.offsets[p]),
+                          p == 0 ? 1 : planes.subsample_y);
+        }
+        finishUpload();
+
+        glUseProgram(planar_program);
+        glUniform1i(planar_cb_uniform, 1);
+        glUniform1i(planar_cr_uniform, 2);
+        glUniform2f(planar_luma_scale_uniform, (float)planes.width / planes.plane_widths[0],
+                    (float)planes.height / planes.plane_heights[0]);
+        glUniform2f(planar_chroma_scale_uniform, (float)planes.width / (planes.subsample_x * planes.plane_widths[1]),
+                    (float)planes.height / (planes.subsample_y * planes.plane_heights[1]));
+
+        // Binds the Y plane to unit 0 (already bound there) and draws
+        drawTexturedQuad(planar_program, planar_position_attr, planar_texcoord_attr, planar_y_uniform, GL_TEXTURE_2D,
+                         plane_textures[0]);
+        return true;
+    }
+
+    bool GPUVideoRenderer::renderDmaBuf(const DmaBufFrame& frame) {
+        if (!initialized || !context_created || !dmabuf_supported) {
+            last_error = "DMA-BUF import not available";
+            return false;
+        }
+        if (frame.num_planes <= 0 || frame.fds[0] < 0 || frame.width <= 0 || frame.height <= 0) {
+            last_error = "Invalid DMA-BUF frame";
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(frame.fds[0], &st) != 0) {
+            last_error = "Invalid DMA-BUF fd";
+            return false;
+        }
+
+        // Capture and decoder buffers are recycled, so after the first few frames every buffer
+        // already has an EGLImage and rendering is import-free
+        DmaBufImage* entry = nullptr;
+        for (auto& image : dmabuf_images) {
+            if (image.inode == st.st_ino && image.offset == frame.offsets[0] && image.width == frame.width &&
+                image.height == frame.height && image.drm_format == frame.drm_format) {
+                entry = &image;
+                break;
+            }
+        }
+
+        if (!entry) {
+            // More distinct buffers than any producer keeps in flight: it reallocated, drop the stale ones
+            if (dmabuf_images.size() >= 16) {
+                releaseDmaBufImages();
+            }
+
+            EGLImageKHR egl_image = importDmaBuf(frame);
+            if (egl_image == EGL_NO_IMAGE_KHR) {
+                return false;
+            }
+
+            DmaBufImage image;
+            image.inode = st.st_ino;
+            image.offset = frame.offsets[0];
+            image.width = frame.width;
+            image.height = frame.height;
+            image.drm_format = frame.drm_format;
+            image.image = egl_image;
+
+            glGenTextures(1, &image.texture);
+            glBindTexture(GL_TEXTURE_EXTERNAL_OES, image.texture);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_EXTERNAL_OES, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            gl_image_target_texture(GL_TEXTURE_EXTERNAL_OES, static_cast<GLeglImageOES>(egl_image));
+
+            dmabuf_images.push_back(image);
+            entry = &dmabuf_images.back();
+        }
+
+        upload_time = monotonicMicros();
+        glViewport(0, 0, surface_width, surface_height);
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        drawTexturedQuad(external_program, external_position_attr, external_texcoord_attr, external_texture_uniform,
+                         GL_TEXTURE_EXTERNAL_OES, entry->texture);
+
+        if (!presentFrame()) {
+            return false;
+        }
+
+        printGLError("renderDmaBuf");
+
+        return true;
+    }
+
+    EGLImageKHR GPUVideoRenderer::importDmaBuf(const DmaBufFrame& frame) {
+        static const EGLint plane_fd[] = {EGL_DMA_BUF_PLANE0_FD_EXT, EGL_DMA_BUF_PLANE1_FD_EXT,
+                                          EGL_DMA_BUF_PLANE2_FD_EXT};
+        static const EGLint plane_offset[] = {EGL_DMA_BUF_PLANE0_OFFSET_EXT, EGL_DMA_BUF_PLANE1_OFFSET_EXT,
+                                              EGL_DMA_BUF_PLANE2_OFFSET_EXT};
+        static const EGLint plane_pitch[] = {EGL_DMA_BUF_PLANE0_PITCH_EXT, EGL_DMA_BUF_PLANE1_PITCH_EXT,
+                                             EGL_DMA_BUF_PLANE2_PITCH_EXT};
+        static const EGLint plane_modifier_lo[] = {EGL_DMA_BUF_PLANE0_MODIFIER_LO_EXT,
+                                                   EGL_DMA_BUF_PLANE1_MODIFIER_LO_EXT,
+                                                   EGL_DMA_BUF_PLANE2_MODIFIER_LO_EXT};
+        static const EGLint plane_modifier_hi[] = {EGL_DMA_BUF_PLANE0_MODIFIER_HI_EXT,
+                                                   EGL_DMA_BUF_PLANE1_MODIFIER_HI_EXT,
+                                                   EGL_DMA_BUF_PLANE2_MODIFIER_HI_EXT};
+
+        std::vector<EGLint> attribs = {
+            EGL_WIDTH, frame.width,
+            EGL_HEIGHT, frame.height,
+            EGL_LINUX_DRM_FOURCC_EXT, static_cast<EGLint>(frame.drm_format),
+        };
+
+        bool pass_modifier = dmabuf_modifiers && frame.modifier != 0 && frame.modifier != kDrmFormatModInvalid;
+        for (int p = 0; p < frame.num_planes && p < 3; p++) {
+            attribs.insert(attribs.end(), {plane_fd[p], frame.fds[p],
+                                           plane_offset[p], static_cast<EGLint>(frame.offsets[p]),
+                                           plane_pitch[p], static_cast<EGLint>(frame.pitches[p])});
+            if (pass_modifier) {
+                attribs.insert(attribs.end(), {plane_modifier_lo[p], static_cast<EGLint>(frame.modifier & 0xffffffff),
+                                               plane_modifier_hi[p], static_cast<EGLint>(frame.modifier >> 32)});
+            }
+        }
+
+        // Colour hints only matter for YUV formats; RGB formats ignore them
+        attribs.insert(attribs.end(), {EGL_YUV_COLOR_SPACE_HINT_EXT, EGL_ITU_REC601_EXT,
+                                       EGL_SAMPLE_RANGE_HINT_EXT,
+                                       frame.full_range ? EGL_YUV_FULL_RANGE_EXT : EGL_YUV_NARROW_RANGE_EXT,
+                                       EGL_NONE});
+
+        EGLImageKHR image = egl_create_image(egl_display, EGL_NO_CONTEXT, EGL_LINUX_DMA_BUF_EXT, nullptr, attribs.data());
+        if (image == EGL_NO_IMAGE_KHR) {
+            printEGLError("eglCreateImageKHR(dma-buf)");
+        }
+        return image;
+    }
+
+    void GPUVideoRenderer::releaseDmaBufImages() {
+        for (auto& image : dmabuf_images) {
+            if (image.texture) {
+                glDeleteTextures(1, &image.texture);
+            }
+            if (image.image != EGL_NO_IMAGE_KHR && egl_destroy_image) {
+                egl_destroy_image(egl_display, image.image);
+            }
+        }
+        dmabuf_images.clear();
+    }
+
+    void GPUVideoRenderer::drawTexturedQuad(GLuint program, GLint position, GLint texcoord, GLint sampler,
+                                            GLenum target, GLuint tex) {
         // Use shader program
-        glUseProgram(shader_program);
+        glUseProgram(program);
 
         // Bind vertex buffer
         glBindBuffer(GL_ARRAY_BUFFER, vbo);
 
         // Set up vertex attributes
-        glEnableVertexAttribArray(position_attr);
-        glVertexAttribPointer(position_attr, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(position);
+        glVertexAttribPointer(position, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
 
-        glEnableVertexAttribArray(texcoord_attr);
-        glVertexAttribPointer(texcoord_attr, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(texcoord);
+        glVertexAttribPointer(texcoord, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
 
         // Set texture uniform
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        glUniform1i(texture_uniform, 0);
+        glBindTexture(target, tex);
+        glUniform1i(sampler, 0);
 
         // Draw fullscreen quad
         glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
         // Disable vertex attributes
-        glDisableVertexAttribArray(position_attr);
-        glDisableVertexAttribArray(texcoord_attr);
+        glDisableVertexAttribArray(position);
+        glDisableVertexAttribArray(texcoord);
+    }
 
-        // Present frame
-        if (!eglSwapBuffers(egl_display, egl_surface)) {
+    bool GPUVideoRenderer::presentFrame() {
+        bool swapped = swap_damage.empty()
+                           ? eglSwapBuffers(egl_display, egl_surface)
+                           : egl_swap_buffers_with_damage(egl_display, egl_surface, swap_damage.data(),
+                                                          static_cast<EGLint>(swap_damage.size() / 4));
+        swap_damage.clear();
+        if (!swapped) {
             printEGLError("eglSwapBuffers");
             return false;
         }
-
-        printGLError("renderFrame");
-
+        surface_damaged = false;
         return true;
     }
 
@@ -302,6 +937,7 @@ namespace openterface {
 
         surface_width = width;
         surface_height = height;
+        surface_damaged = true;
 
         wl_egl_window_resize(egl_window, width, height, 0, 0);
 
@@ -310,6 +946,7 @@ namespace openterface {
 
     void GPUVideoRenderer::cleanup() {
         if (egl_display != EGL_NO_DISPLAY) {
+            releaseDmaBufImages();
             eglMakeCurrent(egl_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
 
             if (texture) {
@@ -317,6 +954,19 @@ namespace openterface {
                 texture = 0;
             }
 
+            if (pbo_supported) {
+                glDeleteBuffers(kPixelBufferCount, pixel_buffers);
+                memset(pixel_buffers, 0, sizeof(pixel_buffers));
+                memset(pixel_buffer_sizes, 0, sizeof(pixel_buffer_sizes));
+                pbo_supported = false;
+            }
+
+            texture_storage = TextureStorage();
+            yuyv_storage = TextureStorage();
+            for (auto& storage : plane_storage) {
+                storage = TextureStorage();
+            }
+
             if (vbo) {
                 glDeleteBuffers(1, &vbo);
                 vbo = 0;
@@ -327,6 +977,31 @@ namespace openterface {
                 shader_program = 0;
             }
 
+            if (external_program) {
+                glDeleteProgram(external_program);
+                external_program = 0;
+            }
+
+            if (planar_program) {
+                glDeleteProgram(planar_program);
+                planar_program = 0;
+            }
+
+            if (yuyv_program) {
+                glDeleteProgram(yuyv_program);
+                yuyv_program = 0;
+            }
+
+            if (plane_textures[0]) {
+                glDeleteTextures(3, plane_textures);
+                memset(plane_textures, 0, sizeof(plane_textures));
+            }
+
+            if (yuyv_texture) {
+                glDeleteTextures(1, &yuyv_texture);
+                yuyv_texture = 0;
+            }
+
             if (egl_context != EGL_NO_CONTEXT) {
                 eglDestroyContext(egl_display, egl_context);
                 egl_context = EGL_NO_CONTEXT;
@@ -342,11 +1017,15 @@ namespace openterface {
                 egl_window = nullptr;
             }
 
-            eglTerminate(egl_display);
+            if (!shared_display) {
+                eglTerminate(egl_display);
+            }
             egl_display = EGL_NO_DISPLAY;
         }
 
         initialized = false;
+        yuv_supported = false;
+        dmabuf_supported = false;
     }
 
     void GPUVideoRenderer::printEGLError(const std::string& operation) {
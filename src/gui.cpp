@@ -3,7 +3,10 @@
 #include "openterface/gui_input.hpp"
 #include "openterface/gui_video.hpp"
 #include "openterface/gui_threading.hpp"
+#include "openterface/decode_pool.hpp"
 #include "openterface/gpu_video_renderer.hpp"
+#include "openterface/frame_damage.hpp"
+#include "openterface/frame_pipeline.hpp"
 #include "openterface/input.hpp"
 #include "openterface/serial.hpp"
 #include "openterface/video.hpp"
@@ -46,6 +49,9 @@
 
 namespace {
     int create_memfd(const char *name, unsigned int flags) { return syscall(__NR_memfd_create, name, flags); }
+
+    // Compositors stop sending frame events for hidden surfaces; keep rendering at a trickle then
+    constexpr auto kFrameCallbackTimeout = std::chrono::milliseconds(100);
 } // namespace
 
 namespace openterface {
@@ -57,16 +63,25 @@ namespace openterface {
         std::shared_ptr<Input> input;
         std::shared_ptr<Serial> serial;
         std::atomic<bool> exit_requested{false};
+        std::mutex exit_mutex;
+        std::condition_variable exit_cv;
         bool initialized = false;
 
         // Wayland objects
         struct wl_display *display = nullptr;
+        // Shared connection (multi-session): `display` belongs to it, and this window's objects are
+        // created through display_wrapper so their events land on event_queue, dispatched only here
+        std::shared_ptr<WaylandConnection> shared_connection;
+        struct wl_event_queue *event_queue = nullptr;
+        struct wl_display *display_wrapper = nullptr;
         struct wl_registry *registry = nullptr;
         struct wl_compositor *compositor = nullptr;
+        uint32_t compositor_version = 0;
         struct wl_surface *surface = nullptr;
         struct wl_shell *shell = nullptr;
         struct wl_shell_surface *shell_surface = nullptr;
         struct wl_shm *shm = nullptr;
+        struct wp_presentation *presentation = nullptr;
 
         // XDG shell objects
         struct xdg_wm_base *xdg_wm_base = nullptr;
@@ -87,9 +102,27 @@ namespace openterface {
         bool mouse_over_surface = false;
         bool input_grabbed = false;
 
-        // Buffer for rendering
-        struct wl_buffer *buffer = nullptr;
-        void *shm_data = nullptr;
+        // Buffers for CPU rendering: kShmBufferCount wl_buffers carved out of one memfd. The render
+        // thread draws straight into a buffer the compositor has released and hands it to the
+        // Wayland thread (ready_buffer), which attaches it - no intermediate copy, and a buffer is
+        // never written while the compositor may still be reading it.
+        static constexpr int kShmBufferCount = 3;
+        enum ShmBufferState { SHM_FREE, SHM_OWNED, SHM_ATTACHED };  // OWNED: being drawn or ready
+        struct ShmBuffer {
+            struct wl_buffer *buffer = nullptr;
+            void *data = nullptr;
+            std::atomic<int> state{SHM_FREE};
+            uint64_t sequence = 0;  // Frame drawn into it (VideoFrame::sequence), 0 = unknown
+            FrameTimestamps times;  // Of that frame, up to the draw
+            int frame_width = 0;    // Picture size of that frame
+            int frame_height = 0;
+        };
+        ShmBuffer shm_buffers[kShmBufferCount];
+        std::atomic<int> ready_buffer{-1};  // Newest drawn buffer not yet attached, -1 = none
+        int presented_buffer = -1;          // Last attached buffer (Wayland thread)
+        uint64_t presented_sequence = 0;    // Frame it showed when attached (Wayland thread)
+        void *shm_data = nullptr;           // Whole pool mapping
+        size_t shm_size = 0;
         int shm_fd = -1;
         bool needs_resize = false;
         
@@ -102,10 +135,49 @@ namespace openterface {
         std::atomic<bool> resize_in_progress{false};
         std::chrono::steady_clock::time_point last_resize_time;
 
-        // Video frame storage
-        VideoFrame current_frame;
-        std::mutex frame_mutex;
-        bool has_new_frame = false;
+        // Video pipeline: capture thread -> decode thread -> render thread, each hop a lock-free
+        // drop-oldest queue of pre-allocated slots. Declared before thread_manager so the queues
+        // outlive the threads using them.
+        FrameQueue<CapturedFrame, 2> capture_queue;
+        FrameQueue<PipelineFrame, 1> render_queue;
+        std::mutex frame_mutex;  // Guards video_processor (decode thread vs. format/backend changes)
+
+        // Shared decode pool (multi-session), used instead of the decode thread. decode_requests
+        // counts frames published since the running task started; the frame that raises it from 0
+        // submits the next task, so a window has at most one decode queued or running at a time.
+        std::shared_ptr<DecodePool> decode_pool;
+        std::atomic<bool> pooled_decode{false};
+        std::atomic<uint64_t> decode_requests{0};
+        uint64_t decoded_frames = 0;  // Decode stage only
+
+        // Thumbnail windows (setThumbnailPolicy): fewer frames, and lower priority on the pool
+        int thumbnail_max_width = 640;
+        int thumbnail_max_height = 360;
+        int thumbnail_fps = 0;
+        std::atomic<bool> thumbnail{false};        // Wayland thread writes
+        uint64_t next_thumbnail_frame = 0;         // Capture thread: earliest capture time shown next
+        std::atomic<uint64_t> thumbnail_skipped{0};
+
+        // Feedback from stage timings and window state (FrameGovernor): frames skipped on the
+        // capture thread, the decode size, and the device's own rate where it can change while
+        // streaming (Wayland thread applies the last two)
+        FrameGovernor governor;
+        int restore_capture_fps = 0;      // Device rate before a throttled window lowered it, 0 = untouched
+        bool capture_rate_fixed = false;  // The device refused a rate change while capturing
+
+        // Static screens: frames identical to the last one stop at the decode thread; the others
+        // carry their changed areas, kept here so buffers and textures holding an older frame can
+        // be brought up to date by redrawing only those
+        DamageHistory damage_history;
+        std::atomic<uint64_t> unchanged_frames{0};
+        std::vector<DamageRect> render_damage;   // Render thread scratch
+        std::vector<DamageRect> present_damage;  // Wayland thread scratch
+        uint64_t gpu_sequence = 0;               // Frame in the GPU textures (render thread), 0 = unknown
+
+        // Dimensions of the last decoded frame, for input coordinate mapping (decode thread writes,
+        // Wayland thread reads)
+        std::atomic<int> video_width{0};
+        std::atomic<int> video_height{0};
 
         // Debug mode
         bool debug_input = false;
@@ -122,11 +194,34 @@ namespace openterface {
 
         // Thread management
         ThreadManager thread_manager;
-        void *render_buffer = nullptr;
+
+        // Per-stage latency, recorded by the render, Wayland and input threads. With stats_interval
+        // set the application thread prints it every that many seconds, otherwise a one-line
+        // summary is logged every kStatsFrames frames.
+        static constexpr uint64_t kStatsFrames = 300;
+        PipelineStats pipeline_stats;
+        int stats_interval = 0;
+
+        // Frames waiting for their wp_presentation feedback. Whichever side finishes last - the
+        // thread that committed the frame or the Wayland thread receiving presented/discarded -
+        // records it and frees the slot. More frames in flight than slots go unmeasured.
+        struct PresentationSlot {
+            Impl *impl = nullptr;
+            FrameTimestamps times;    // Committing thread
+            uint64_t presented = 0;   // Wayland thread; 0 = discarded
+            std::atomic<int> pending{0};
+            std::atomic<bool> in_use{false};
+        };
+        static constexpr int kPresentationSlots = 4;
+        PresentationSlot presentation_slots[kPresentationSlots];
+
+        // Set while a wl_surface_frame callback is outstanding: the compositor hasn't shown the
+        // last commit yet, so the next frame waits rather than queueing behind it
+        std::atomic<bool> frame_callback_pending{false};
+        std::chrono::steady_clock::time_point last_cpu_commit;  // Wayland thread only
         
-        // Inter-thread communication queues
-        std::queue<InputEvent> input_queue;
-        std::mutex input_queue_mutex;
+        // Events from the Wayland callbacks to the input thread, guarded by thread_manager.input_mutex
+        std::vector<InputEvent> input_queue;
 
         WaylandCallbackData callback_data;
 
@@ -141,16 +236,84 @@ namespace openterface {
         bool createWaylandWindow();
         bool createBuffer(int width, int height);
         void destroyBuffer();
+        void selectDecodeFormat();
         void onVideoFrame(const FrameData &frame);
+        void decodeThreadFunction();
+        void decodeCaptured(CapturedFrame *captured);
+        void submitDecode();
+        void pooledDecode();
+        void drainPooledDecode();
+        void updateThumbnail(int width, int height);
+        void updateVisibility();
+        void applyCaptureRate();
+        int dispatchPending();
+        int prepareRead();
         void renderThreadFunction();
         void waylandEventThreadFunction();
         void inputThreadFunction();
         void queueInputEvent(const InputEvent& event);
+        void forwardInputEvent(const InputEvent &event);
         void processSurfaceUpdates();
+        void requestFrameCallback();
+        PresentationSlot *requestPresentationFeedback();
+        void frameCommitted(PresentationSlot *slot, const FrameTimestamps &times);
+        void finishPresentation(PresentationSlot *slot);
+        std::string dropSummary() const;
+        int acquireShmBuffer();
+        void presentCpuFrame();
+        void signalExit();
+
+        static void frameDone(void *data, struct wl_callback *callback, uint32_t time);
+        static const struct wl_callback_listener frame_listener;
+        static void feedbackSyncOutput(void *data, struct wp_presentation_feedback *feedback, struct wl_output *output);
+        static void feedbackPresented(void *data, struct wp_presentation_feedback *feedback, uint32_t tv_sec_hi,
+                                      uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi,
+                                      uint32_t seq_lo, uint32_t flags);
+        static void feedbackDiscarded(void *data, struct wp_presentation_feedback *feedback);
+        static const struct wp_presentation_feedback_listener feedback_listener;
+        static void bufferRelease(void *data, struct wl_buffer *buffer);
+        static const struct wl_buffer_listener buffer_listener;
     };
+
+    const struct wl_callback_listener GUI::Impl::frame_listener = {
+        GUI::Impl::frameDone,
+    };
+
+    const struct wl_buffer_listener GUI::Impl::buffer_listener = {
+        GUI::Impl::bufferRelease,
+    };
+
+    const struct wp_presentation_feedback_listener GUI::Impl::feedback_listener = {
+        GUI::Impl::feedbackSyncOutput,
+        GUI::Impl::feedbackPresented,
+        GUI::Impl::feedbackDiscarded,
+    };
+
+    WaylandConnection::~WaylandConnection() {
+        if (display) {
+            wl_display_disconnect(display);
+        }
+    }
+
+    std::shared_ptr<WaylandConnection> WaylandConnection::connect() {
+        struct wl_display *display = wl_display_connect(nullptr);
+        if (!display) {
+            return nullptr;
+        }
+        return std::shared_ptr<WaylandConnection>(new WaylandConnection(display));
+    }
+
     GUI::GUI() : pImpl(std::make_unique<Impl>()) {}
 
-    GUI::~GUI() { shutdown(); }
+    GUI::~GUI() {
+        shutdown();
+        // A pool task may still be queued for this window even with capture stopped
+        pImpl->drainPooledDecode();
+    }
+
+    void GUI::setWaylandConnection(std::shared_ptr<WaylandConnection> connection) {
+        pImpl->shared_connection = connection;
+    }
 
     bool GUI::initialize() {
         std::cout << "DEBUG: GUI::initialize() called" << std::endl;
@@ -190,6 +353,8 @@ namespace openterface {
         pImpl->info.window_width = width;
         pImpl->info.window_height = height;
 
+        pImpl->updateThumbnail(width, height);
+
         pImpl->log("Creating Wayland window: " + title + " (" + std::to_string(width) + "x" + std::to_string(height) +
                    ")");
 
@@ -241,6 +406,40 @@ namespace openterface {
         pImpl->log("Video source set");
     }
 
+    void GUI::setDecoderBackend(DecoderBackend backend) {
+        std::lock_guard<std::mutex> lock(pImpl->frame_mutex);
+        pImpl->video_processor.setDecoderBackend(backend);
+        pImpl->log(std::string("MJPEG decoder: ") + decoderBackendName(pImpl->video_processor.getDecoderBackend()));
+    }
+
+    void GUI::setDecodeThreads(int threads) {
+        std::lock_guard<std::mutex> lock(pImpl->frame_mutex);
+        pImpl->video_processor.setDecodeThreads(threads);
+        pImpl->log("MJPEG decode threads: " + std::to_string(pImpl->video_processor.getDecodeThreads()));
+    }
+
+    void GUI::setDecodePool(std::shared_ptr<DecodePool> pool) {
+        pImpl->decode_pool = pool;
+        if (pool) {
+            pImpl->log("Decoding on the shared pool (" + std::to_string(pool->getThreadCount()) + " threads)");
+        }
+    }
+
+    void GUI::setThumbnailPolicy(int max_width, int max_height, int fps) {
+        pImpl->thumbnail_max_width = std::max(0, max_width);
+        pImpl->thumbnail_max_height = std::max(0, max_height);
+        pImpl->thumbnail_fps = std::max(0, fps);
+        pImpl->updateThumbnail(pImpl->info.window_width, pImpl->info.window_height);
+    }
+
+    void GUI::setGovernorPolicy(int unfocused_fps, int hidden_fps, bool adaptive) {
+        FrameGovernor::Policy policy;
+        policy.unfocused_fps = unfocused_fps;
+        policy.hidden_fps = hidden_fps;
+        policy.adaptive = adaptive;
+        pImpl->governor.setPolicy(policy);
+    }
+
     bool GUI::startVideoDisplay() {
         if (!pImpl->video) {
             pImpl->log("No video source available");
@@ -253,6 +452,10 @@ namespace openterface {
         }
 
         pImpl->log("Starting video display");
+        {
+            std::lock_guard<std::mutex> lock(pImpl->frame_mutex);
+            pImpl->video_processor.setChangeDetection(true);
+        }
 
         // Set up frame callback from video source
         pImpl->video->setFrameCallback([this](const FrameData &frame) { pImpl->onVideoFrame(frame); });
@@ -265,17 +468,12 @@ namespace openterface {
 
         pImpl->info.video_displayed = true;
         
-        // Allocate render buffer before starting thread
-        if (pImpl->buffer_width > 0 && pImpl->buffer_height > 0) {
-            size_t buffer_size = pImpl->buffer_width * pImpl->buffer_height * 4;
-            pImpl->render_buffer = malloc(buffer_size);
-            if (!pImpl->render_buffer) {
-                pImpl->log("Failed to allocate render buffer");
-                return false;
-            }
+        // Start the decode and render stages of the video pipeline
+        if (pImpl->decode_pool) {
+            pImpl->pooled_decode = true;
+        } else {
+            pImpl->thread_manager.startDecodeThread([this]() { pImpl->decodeThreadFunction(); });
         }
-        
-        // Start render thread for non-blocking frame processing
         pImpl->thread_manager.startRenderThread([this]() { pImpl->renderThreadFunction(); });
         
         pImpl->log("Video display and capture started successfully");
@@ -286,15 +484,12 @@ namespace openterface {
         if (pImpl->info.video_displayed) {
             pImpl->log("Stopping video display");
             
-            // Stop render thread
+            // Stop the pipeline threads (decode first, it feeds the render thread)
+            pImpl->thread_manager.stopDecodeThread();
+            pImpl->pooled_decode = false;
+            pImpl->drainPooledDecode();
             pImpl->thread_manager.stopRenderThread();
             
-            // Free render buffer
-            if (pImpl->render_buffer) {
-                free(pImpl->render_buffer);
-                pImpl->render_buffer = nullptr;
-            }
-            
             pImpl->info.video_displayed = false;
         }
     }
@@ -376,42 +571,19 @@ namespace openterface {
 
         pImpl->log("All threads started - application running");
 
-        // Simplified application main thread - just handle buffer swaps and exit condition
-        auto last_frame_time = std::chrono::steady_clock::now();
-        const auto frame_duration = std::chrono::milliseconds(16); // Target 60 FPS
-
-        // Application control loop (much simpler than Wayland event loop)
-        while (!pImpl->exit_requested && pImpl->display) {
-            auto now = std::chrono::steady_clock::now();
-
-            // Simplified application thread - just handle buffer swaps
-            if (now - last_frame_time > frame_duration) {
-                if (pImpl->surface && pImpl->buffer && pImpl->shm_data) {
-                    // Lightweight frame update - just swap buffers if render thread completed processing
-                    if (pImpl->thread_manager.buffer_swap_ready.load()) {
-                        // Quick buffer swap - no heavy processing in main thread
-                        if (pImpl->render_buffer && pImpl->shm_data && 
-                            pImpl->buffer_width > 0 && pImpl->buffer_height > 0) {
-                            
-                            size_t buffer_size = pImpl->buffer_width * pImpl->buffer_height * 4;
-                            
-                            // Fast memory copy from render buffer to display buffer
-                            memcpy(pImpl->shm_data, pImpl->render_buffer, buffer_size);
-                            
-                            static int swap_count = 0;
-                            if (++swap_count % 30 == 1) {
-                                pImpl->log("Buffer swap #" + std::to_string(swap_count) + " (render thread -> display)");
-                            }
-                            
-                            // Leave buffer_swap_ready = true so Wayland thread can commit the surface
-                        }
-                    }
+        // Nothing to do on the application thread until exit but the --stats report: presenting
+        // happens on the Wayland thread
+        {
+            std::unique_lock<std::mutex> lock(pImpl->exit_mutex);
+            auto exiting = [this] { return pImpl->exit_requested.load() || !pImpl->display; };
+            if (pImpl->stats_interval > 0) {
+                while (!pImpl->exit_cv.wait_for(lock, std::chrono::seconds(pImpl->stats_interval), exiting)) {
+                    pImpl->log("Latency over the last " + std::to_string(pImpl->stats_interval) + "s:\n" +
+                               pImpl->pipeline_stats.report() + ", " + pImpl->dropSummary());
                 }
-                last_frame_time = now;
+            } else {
+                pImpl->exit_cv.wait(lock, exiting);
             }
-            
-            // Short sleep to avoid busy waiting while keeping responsive
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
         }
 
         // Stop all threads before exiting
@@ -424,12 +596,16 @@ namespace openterface {
     }
 
     void GUI::requestExit() {
-        pImpl->exit_requested = true;
+        pImpl->signalExit();
         pImpl->log("Exit requested");
     }
 
     GUIInfo GUI::getInfo() const { return pImpl->info; }
 
+    void GUI::setStatsInterval(int seconds) {
+        pImpl->stats_interval = std::max(0, seconds);
+    }
+
     void GUI::setDebugMode(bool enabled) {
         pImpl->debug_input = enabled;
         pImpl->callback_data.debug_mode = enabled;  // Update callback data too
@@ -444,18 +620,27 @@ namespace openterface {
 
         // Connect to Wayland display
         std::cout << "DEBUG: About to connect to Wayland display" << std::endl;
-        display = wl_display_connect(nullptr);
-        if (!display) {
-            log("Failed to connect to Wayland display");
-            std::cout << "DEBUG: wl_display_connect failed" << std::endl;
-            return false;
+        if (shared_connection) {
+            // Globals are bound again per window; every proxy made from them inherits the queue
+            display = shared_connection->getDisplay();
+            event_queue = wl_display_create_queue(display);
+            display_wrapper = static_cast<struct wl_display *>(wl_proxy_create_wrapper(display));
+            wl_proxy_set_queue(reinterpret_cast<struct wl_proxy *>(display_wrapper), event_queue);
+            log("Using the shared Wayland connection");
+        } else {
+            display = wl_display_connect(nullptr);
+            if (!display) {
+                log("Failed to connect to Wayland display");
+                std::cout << "DEBUG: wl_display_connect failed" << std::endl;
+                return false;
+            }
+            log("Connected to Wayland display");
         }
-        log("Connected to Wayland display");
         std::cout << "DEBUG: Successfully connected to Wayland display" << std::endl;
 
         // Get registry
         std::cout << "DEBUG: About to get registry" << std::endl;
-        registry = wl_display_get_registry(display);
+        registry = wl_display_get_registry(display_wrapper ? display_wrapper : display);
         if (!registry) {
             log("Failed to get Wayland registry");
             std::cout << "DEBUG: wl_display_get_registry failed" << std::endl;
@@ -475,16 +660,22 @@ namespace openterface {
         // Process registry events to get globals
         std::cout << "DEBUG: About to process registry events" << std::endl;
         wl_display_flush(display);
-        wl_display_dispatch(display);
+        if (event_queue) {
+            wl_display_roundtrip_queue(display, event_queue);
+        } else {
+            wl_display_dispatch(display);
+        }
         std::cout << "DEBUG: Registry events processed" << std::endl;
 
         // Copy results back from callback data
         std::cout << "DEBUG: Copying results from callback data" << std::endl;
         compositor = callback_data.compositor;
+        compositor_version = callback_data.compositor_version;
         shell = callback_data.shell;
         shm = callback_data.shm;
         xdg_wm_base = callback_data.xdg_wm_base;
         seat = callback_data.seat;
+        presentation = callback_data.presentation;
         std::cout << "DEBUG: compositor=" << (compositor ? "found" : "null") << std::endl;
         std::cout << "DEBUG: shell=" << (shell ? "found" : "null") << std::endl;
         std::cout << "DEBUG: shm=" << (shm ? "found" : "null") << std::endl;
@@ -502,7 +693,7 @@ namespace openterface {
 
             // Process seat events without blocking
             wl_display_flush(display);
-            wl_display_dispatch_pending(display);
+            dispatchPending();
             log("Seat listener setup complete");
         }
 
@@ -599,6 +790,12 @@ namespace openterface {
             seat = nullptr;
         }
 
+        if (presentation) {
+            wp_presentation_destroy(presentation);
+            presentation = nullptr;
+            callback_data.presentation = nullptr;
+        }
+
         // Clean up wl_shell objects
         if (shell_surface) {
             wl_shell_surface_destroy(shell_surface);
@@ -632,7 +829,16 @@ namespace openterface {
             registry = nullptr;
         }
 
-        if (display) {
+        if (event_queue) {
+            // Let the compositor answer for the destroyed surface (discarded presentation feedback)
+            // while this window's listeners still exist, then leave the connection to the others
+            wl_display_roundtrip_queue(display, event_queue);
+            wl_proxy_wrapper_destroy(display_wrapper);
+            display_wrapper = nullptr;
+            wl_event_queue_destroy(event_queue);
+            event_queue = nullptr;
+            display = nullptr;
+        } else if (display) {
             wl_display_disconnect(display);
             display = nullptr;
         }
@@ -662,7 +868,6 @@ namespace openterface {
         callback_data.seat = seat;
         callback_data.log_func = [this](const std::string &msg) { this->log(msg); };
         callback_data.surface = surface;
-        callback_data.buffer_ptr = &buffer;
         callback_data.shm_data_ptr = &shm_data;
         callback_data.shm_fd_ptr = &shm_fd;
         callback_data.current_width = &info.window_width;
@@ -676,10 +881,11 @@ namespace openterface {
         callback_data.keyboard_ptr = &keyboard;
         callback_data.input_ptr = &input;
         callback_data.serial_ptr = &serial;
+        callback_data.queue_input = [this](const InputEvent &event) { queueInputEvent(event); };
         
         // Video frame dimensions for accurate mouse coordinate mapping
-        callback_data.video_width_ptr = &current_frame.width;
-        callback_data.video_height_ptr = &current_frame.height;
+        callback_data.video_width_ptr = &video_width;
+        callback_data.video_height_ptr = &video_height;
 
         // Use xdg_shell if available (modern), fall back to wl_shell (deprecated)
         if (xdg_wm_base) {
@@ -718,8 +924,8 @@ namespace openterface {
             xdg_toplevel_set_app_id(xdg_toplevel, "com.openterface.openterfaceQT");
 
             // Make window resizable with reasonable constraints
-            // Set minimum size (don't go smaller than this)
-            xdg_toplevel_set_min_size(xdg_toplevel, 640, 480);
+            // Set minimum size (don't go smaller than this, or than a thumbnail window starts at)
+            xdg_toplevel_set_min_size(xdg_toplevel, std::min(640, info.window_width), std::min(480, info.window_height));
 
             // Set maximum size (0, 0 means no maximum - fully resizable)
             xdg_toplevel_set_max_size(xdg_toplevel, 0, 0);
@@ -732,11 +938,12 @@ namespace openterface {
 
             // Process initial configure events without blocking
             wl_display_flush(display);
-            wl_display_dispatch_pending(display);
+            dispatchPending();
 
             // Initialize GPU acceleration if available
             if (use_gpu_acceleration) {
                 log("Initializing GPU-accelerated video rendering...");
+                gpu_renderer.setSharedDisplay(shared_connection != nullptr);
                 if (gpu_renderer.initialize(display, surface, info.window_width, info.window_height)) {
                     log("GPU acceleration enabled (like QT)");
                     // Skip CPU buffer creation when using GPU
@@ -746,6 +953,10 @@ namespace openterface {
                 }
             }
 
+            // Have the decoder emit the final pixel layout for the chosen path so neither the
+            // shm copy nor the texture upload has to repack (falls back to RGB24 without libjpeg-turbo)
+            selectDecodeFormat();
+
             // Create CPU buffer only if not using GPU acceleration
             if (!use_gpu_acceleration) {
                 if (!createBuffer(info.window_width, info.window_height)) {
@@ -755,8 +966,10 @@ namespace openterface {
             }
 
             // Attach buffer and commit (only for CPU rendering)
-            if (!use_gpu_acceleration && buffer) {
-                wl_surface_attach(surface, buffer, 0, 0);
+            if (!use_gpu_acceleration && shm_buffers[0].buffer) {
+                shm_buffers[0].state = SHM_ATTACHED;
+                presented_buffer = 0;
+                wl_surface_attach(surface, shm_buffers[0].buffer, 0, 0);
                 wl_surface_damage(surface, 0, 0, info.window_width, info.window_height);
                 wl_surface_commit(surface);
             }
@@ -814,10 +1027,12 @@ namespace openterface {
         }
 
         int stride = width * 4; // RGBA32
-        int size = stride * height;
+        size_t buffer_size = static_cast<size_t>(stride) * height;
+        size_t size = buffer_size * kShmBufferCount;
 
-        log("Creating buffer: " + std::to_string(width) + "x" + std::to_string(height) +
-            " (stride=" + std::to_string(stride) + ", size=" + std::to_string(size) + " bytes)");
+        log("Creating " + std::to_string(kShmBufferCount) + " buffers: " + std::to_string(width) + "x" +
+            std::to_string(height) + " (stride=" + std::to_string(stride) + ", pool size=" + std::to_string(size) +
+            " bytes)");
         
         // Store actual buffer dimensions
         buffer_width = width;
@@ -841,12 +1056,14 @@ namespace openterface {
         shm_data = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
         if (shm_data == MAP_FAILED) {
             log("Failed to mmap buffer: " + std::string(strerror(errno)));
+            shm_data = nullptr;
             close(shm_fd);
             shm_fd = -1;
             return false;
         }
+        shm_size = size;
 
-        // Create wl_shm_pool and buffer
+        // One wl_shm_pool, one wl_buffer per slice of it
         struct wl_shm_pool *pool = wl_shm_create_pool(shm, shm_fd, size);
         if (!pool) {
             log("Failed to create shm pool");
@@ -854,35 +1071,28 @@ namespace openterface {
             return false;
         }
 
-        buffer = wl_shm_pool_create_buffer(pool, 0, width, height, stride, WL_SHM_FORMAT_XRGB8888);
-        wl_shm_pool_destroy(pool);
-
-        if (!buffer) {
-            log("Failed to create buffer");
-            destroyBuffer();
-            return false;
-        }
-
-        // Fill buffer with video frame data or gradient pattern
-        uint32_t *pixels = static_cast<uint32_t *>(shm_data);
-
-        {
-            std::lock_guard<std::mutex> lock(frame_mutex);
-
-            if (has_new_frame && current_frame.is_rgb && !current_frame.data.empty() && 
-                current_frame.width > 0 && current_frame.height > 0) {
-                log("Rendering decoded video frame: " + std::to_string(current_frame.width) + "x" +
-                    std::to_string(current_frame.height) + " (" + std::to_string(current_frame.data.size()) + " bytes RGB)");
-
-                renderVideoToBuffer(pixels, width, height, current_frame);
-                log("RGB video frame rendered successfully with scaling");
-                has_new_frame = false; // Mark frame as processed
-            } else {
-                // Fill with black background
-                fillBufferWithBlack(pixels, width, height);
-                log("No video frame available, using black background");
+        for (int i = 0; i < kShmBufferCount; i++) {
+            ShmBuffer &shm_buffer = shm_buffers[i];
+            shm_buffer.data = static_cast<uint8_t *>(shm_data) + buffer_size * i;
+            shm_buffer.buffer = wl_shm_pool_create_buffer(pool, buffer_size * i, width, height, stride,
+                                                          WL_SHM_FORMAT_XRGB8888);
+            if (!shm_buffer.buffer) {
+                log("Failed to create buffer");
+                wl_shm_pool_destroy(pool);
+                destroyBuffer();
+                return false;
             }
+            wl_buffer_add_listener(shm_buffer.buffer, &buffer_listener, &shm_buffer);
+            shm_buffer.state = SHM_FREE;
+            shm_buffer.sequence = 0;
+
+            // Start black; the render thread paints decoded frames into free buffers
+            fillBufferWithBlack(shm_buffer.data, width, height);
         }
+        wl_shm_pool_destroy(pool);
+        ready_buffer = -1;
+        presented_buffer = -1;
+        presented_sequence = 0;
 
         log("Buffer created successfully");
         return true;
@@ -892,33 +1102,30 @@ namespace openterface {
         std::lock_guard<std::mutex> lock(resize_mutex);
         log("Destroying buffer...");
 
-        // Destroy Wayland buffer first
-        if (buffer) {
-            wl_buffer_destroy(buffer);
-            buffer = nullptr;
-            log("Wayland buffer destroyed");
-        }
-
-        // Unmap shared memory using the original size from when it was mapped
-        if (shm_data && shm_data != MAP_FAILED) {
-            // Use fstat to get the actual file size instead of calculating from window dimensions
-            struct stat sb;
-            if (shm_fd != -1 && fstat(shm_fd, &sb) == 0) {
-                int result = munmap(shm_data, sb.st_size);
-                if (result != 0) {
-                    log("Warning: munmap failed: " + std::string(strerror(errno)));
-                } else {
-                    log("Shared memory unmapped successfully");
-                }
+        // Destroy Wayland buffers first
+        for (ShmBuffer &shm_buffer : shm_buffers) {
+            if (shm_buffer.buffer) {
+                wl_buffer_destroy(shm_buffer.buffer);
+                shm_buffer.buffer = nullptr;
+            }
+            shm_buffer.data = nullptr;
+            shm_buffer.state = SHM_FREE;
+            shm_buffer.sequence = 0;
+        }
+        ready_buffer = -1;
+        presented_buffer = -1;
+        presented_sequence = 0;
+        log("Wayland buffers destroyed");
+
+        // Unmap the whole pool
+        if (shm_data) {
+            if (munmap(shm_data, shm_size) != 0) {
+                log("Warning: munmap failed: " + std::string(strerror(errno)));
             } else {
-                log("Warning: Cannot determine buffer size, attempting graceful cleanup");
-                // Fallback: unmap with current calculated size but this is less safe
-                int buffer_size = info.window_width * info.window_height * 4;
-                if (buffer_size > 0) {
-                    munmap(shm_data, buffer_size);
-                }
+                log("Shared memory unmapped successfully");
             }
             shm_data = nullptr;
+            shm_size = 0;
         }
 
         // Close file descriptor
@@ -935,48 +1142,247 @@ namespace openterface {
         log("Buffer destruction complete");
     }
 
-    void GUI::Impl::onVideoFrame(const FrameData &frame) {
+    int GUI::Impl::acquireShmBuffer() {
+        for (int i = 0; i < kShmBufferCount; i++) {
+            int expected = SHM_FREE;
+            if (shm_buffers[i].buffer && shm_buffers[i].state.compare_exchange_strong(expected, SHM_OWNED)) {
+                return i;
+            }
+        }
+
+        // Everything else is with the compositor: redraw the frame that is still waiting to be attached
+        return ready_buffer.exchange(-1);
+    }
+
+    void GUI::Impl::bufferRelease(void *data, struct wl_buffer *buffer) {
+        (void)buffer;
+        // The compositor is done reading; the render thread may draw into it again
+        static_cast<ShmBuffer *>(data)->state = SHM_FREE;
+    }
+
+    void GUI::Impl::selectDecodeFormat() {
         std::lock_guard<std::mutex> lock(frame_mutex);
 
-        // ALWAYS clear previous frame data first to prevent stale data issues
-        has_new_frame = false;  // Set this FIRST to stop any rendering immediately
-        current_frame.data.clear();
-        current_frame.width = 0;
-        current_frame.height = 0;
-        current_frame.is_rgb = false;
-
-        // Store the frame data
-        if (frame.data && frame.size > 0) {
-            static int frame_count = 0;
-            frame_count++;
-
-            // Only log every 30 frames to reduce spam
-            if (frame_count % 30 == 1) {
-                log("Video frame " + std::to_string(frame_count) + ": " + std::to_string(frame.width) + "x" +
-                    std::to_string(frame.height) + " size=" + std::to_string(frame.size) + " bytes");
+        PixelFormat format = use_gpu_acceleration ? PixelFormat::RGBX8888 : PixelFormat::XRGB8888;
+        if (video_processor.setOutputFormat(format)) {
+            log(std::string("Decoding directly to ") + (use_gpu_acceleration ? "RGBX8888" : "XRGB8888"));
+        } else {
+            video_processor.setOutputFormat(PixelFormat::RGB24);
+            log("Decoding to RGB24: " + video_processor.getLastError());
+        }
+
+        // Shader conversion and DMA-BUF import are only known once the GL context exists in the render thread
+        bool yuv_output = use_gpu_acceleration && gpu_renderer.supportsYuv();
+        if (yuv_output != video_processor.getYuvOutput()) {
+            video_processor.setYuvOutput(yuv_output);
+            log(std::string("GPU YCbCr conversion ") + (yuv_output ? "enabled" : "disabled"));
+        }
+
+        bool zero_copy = use_gpu_acceleration && gpu_renderer.supportsDmaBuf();
+        if (zero_copy != video_processor.getZeroCopy()) {
+            video_processor.setZeroCopy(zero_copy);
+            log(std::string("Zero-copy DMA-BUF frames ") + (zero_copy ? "enabled" : "disabled"));
+        }
+    }
+
+    void GUI::Impl::onVideoFrame(const FrameData &frame) {
+        if (!frame.data || frame.size == 0) {
+            return;
+        }
+
+        // Unfocused, hidden or overloaded windows skip frames the same way (and first, so the
+        // governor sees every capture interval)
+        if (!governor.admit(frame.timestamp)) {
+            return;
+        }
+
+        // Thumbnails show every few frames only: the rest isn't even copied out
+        if (thumbnail_fps > 0 && thumbnail.load(std::memory_order_relaxed)) {
+            if (frame.timestamp < next_thumbnail_frame) {
+                thumbnail_skipped.fetch_add(1, std::memory_order_relaxed);
+                return;
             }
+            uint64_t interval = 1000000 / thumbnail_fps;
+            // Keep to the grid unless capture stalled for longer than a period
+            next_thumbnail_frame = frame.timestamp - next_thumbnail_frame > interval ? frame.timestamp + interval
+                                                                                    : next_thumbnail_frame + interval;
+        }
 
-            // Process the frame using VideoProcessor
-            if (video_processor.processFrame(frame, current_frame)) {
-                has_new_frame = true;
-                
-                // Signal rendering thread to process the frame
-                thread_manager.frame_ready_for_render = true;
-                thread_manager.notifyRender();
-                
-                if (frame_count % 30 == 1) {
-                    log("MJPEG frame decoded successfully: " + std::to_string(current_frame.width) + "x" + 
-                        std::to_string(current_frame.height) + " RGB");
+        // Runs on the V4L2 capture thread: copy the payload out and return, so the buffer goes
+        // back to the driver (VIDIOC_QBUF) without waiting for any decode work. If the decoder
+        // is behind, the oldest waiting frame is dropped.
+        uint64_t now = monotonicMicros();
+        CapturedFrame *slot = capture_queue.acquire();
+        slot->payload.assign(frame.data, frame.data + frame.size);
+        slot->info = frame;
+        slot->info.data = nullptr;
+        slot->times = FrameTimestamps();
+        slot->times.capture = frame.timestamp;
+        slot->times.queued = now;
+        capture_queue.publish(slot);
+
+        if (decode_pool) {
+            // Counted before pooled_decode is checked, so stopVideoDisplay() either sees the request
+            // and waits for it or has already cleared the flag and gets it withdrawn here
+            if (decode_requests.fetch_add(1) == 0) {
+                if (pooled_decode.load()) {
+                    submitDecode();
+                } else if (decode_requests.fetch_sub(1) == 1) {
+                    { std::lock_guard<std::mutex> lock(thread_manager.decode_mutex); }
+                    thread_manager.decode_cv.notify_all();
                 }
-            } else {
-                // MJPEG decode failed
+            }
+        } else {
+            thread_manager.notifyDecode();
+        }
+    }
+
+    void GUI::Impl::decodeThreadFunction() {
+        log("Decode thread started");
+
+        while (thread_manager.decode_thread_running.load()) {
+            {
+                std::unique_lock<std::mutex> lock(thread_manager.decode_mutex);
+                thread_manager.decode_cv.wait(lock, [this] {
+                    return !capture_queue.empty() || !thread_manager.decode_thread_running.load();
+                });
+            }
+            if (!thread_manager.decode_thread_running.load()) break;
+
+            CapturedFrame *captured = capture_queue.takeLatest();
+            if (captured) {
+                decodeCaptured(captured);
+            }
+        }
+
+        log("Decode thread stopped");
+    }
+
+    void GUI::Impl::submitDecode() {
+        auto priority = thumbnail.load(std::memory_order_relaxed) ? DecodePool::Priority::Low
+                                                                  : DecodePool::Priority::High;
+        decode_pool->submit([this]() { pooledDecode(); }, priority);
+    }
+
+    void GUI::Impl::pooledDecode() {
+        // One frame per task - the newest - so windows take turns on the pool and a thumbnail's
+        // next frame queues behind the other windows' work again
+        uint64_t requests = decode_requests.load(std::memory_order_acquire);
+        if (pooled_decode.load()) {
+            if (CapturedFrame *captured = capture_queue.takeLatest()) {
+                decodeCaptured(captured);
+            }
+        }
+
+        // Frames published meanwhile weren't covered by this task
+        if (decode_requests.fetch_sub(requests, std::memory_order_acq_rel) != requests) {
+            submitDecode();
+            return;
+        }
+        { std::lock_guard<std::mutex> lock(thread_manager.decode_mutex); }
+        thread_manager.decode_cv.notify_all();
+    }
+
+    void GUI::Impl::drainPooledDecode() {
+        std::unique_lock<std::mutex> lock(thread_manager.decode_mutex);
+        thread_manager.decode_cv.wait(lock, [this] { return decode_requests.load(std::memory_order_acquire) == 0; });
+    }
+
+    void GUI::Impl::decodeCaptured(CapturedFrame *captured) {
+        decoded_frames++;
+        captured->info.data = captured->payload.data();
+        captured->info.size = captured->payload.size();
+
+        // Only log every 30 frames to reduce spam
+        if (decoded_frames % 30 == 1) {
+            log("Video frame " + std::to_string(decoded_frames) + ": " + std::to_string(captured->info.width) + "x" +
+                std::to_string(captured->info.height) + " size=" + std::to_string(captured->info.size) + " bytes");
+        }
+
+        // Decode straight into a render slot; its storage persists across frames
+        PipelineFrame *decoded = render_queue.acquire();
+        decoded->times = captured->times;
+        decoded->times.decode_start = monotonicMicros();
+        bool ok;
+        {
+            std::lock_guard<std::mutex> lock(frame_mutex);
+            ok = video_processor.processFrame(captured->info, decoded->frame);
+            if (!ok) {
                 log("MJPEG decode failed: " + video_processor.getLastError());
-                has_new_frame = false;
             }
+        }
+        decoded->times.decoded = monotonicMicros();
+        capture_queue.release(captured);
+
+        if (!ok) {
+            render_queue.discard(decoded);
+            return;
+        }
+
+        // Nothing new on screen: no render, upload or commit for this frame
+        if (decoded->frame.unchanged) {
+            render_queue.discard(decoded);
+            unchanged_frames.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        const VideoFrame &frame = decoded->frame;
+        damage_history.record(frame.sequence, frame.width, frame.height, frame.full_damage, frame.damage);
+
+        video_width = decoded->frame.width;
+        video_height = decoded->frame.height;
+        render_queue.publish(decoded);
+        thread_manager.notifyRender();
+    }
+
+    void GUI::Impl::updateThumbnail(int width, int height) {
+        bool small = width <= thumbnail_max_width && height <= thumbnail_max_height;
+        if (small != thumbnail.exchange(small) && thumbnail_fps > 0) {
+            log(small ? "Thumbnail window: showing at most " + std::to_string(thumbnail_fps) + " fps, low decode priority"
+                      : "Full-rate window");
+        }
+    }
+
+    void GUI::Impl::updateVisibility() {
+        auto visibility = callback_data.window_suspended   ? FrameGovernor::Visibility::Hidden
+                          : callback_data.window_activated ? FrameGovernor::Visibility::Active
+                                                           : FrameGovernor::Visibility::Unfocused;
+        if (governor.setVisibility(visibility)) {
+            log("Window " + governor.describe());
+            applyCaptureRate();
+        }
+    }
 
-            // Don't force buffer recreation - let event loop handle updates
-            // needs_resize = true;
+    void GUI::Impl::applyCaptureRate() {
+        // Lowering the device rate too spares USB and the capture thread, but uvcvideo refuses
+        // VIDIOC_S_PARM while streaming; then skipping frames in onVideoFrame() is all there is.
+        // The capture thread applies the change, so a refusal only shows on the next request.
+        if (!video || !info.video_displayed || capture_rate_fixed) {
+            return;
         }
+        int fps = governor.getVisibility() == FrameGovernor::Visibility::Active ? 0 : governor.rateCap();
+        if (fps > 0) {
+            int device_fps = restore_capture_fps > 0 ? restore_capture_fps : video->getInfo().fps;
+            if (fps >= device_fps) {
+                return;
+            }
+            if (video->setFrameRate(fps)) {
+                restore_capture_fps = device_fps;
+            } else {
+                capture_rate_fixed = true;
+                log("Capture rate can't change while streaming: skipping frames instead");
+            }
+        } else if (restore_capture_fps > 0) {
+            video->setFrameRate(restore_capture_fps);
+            restore_capture_fps = 0;
+        }
+    }
+
+    int GUI::Impl::dispatchPending() {
+        return event_queue ? wl_display_dispatch_queue_pending(display, event_queue) : wl_display_dispatch_pending(display);
+    }
+
+    int GUI::Impl::prepareRead() {
+        return event_queue ? wl_display_prepare_read_queue(display, event_queue) : wl_display_prepare_read(display);
     }
 
     void GUI::Impl::renderThreadFunction() {
@@ -988,60 +1394,116 @@ namespace openterface {
             if (gpu_renderer.initializeInCurrentThread()) {
                 log("GPU context initialized in render thread");
                 gpu_initialized_in_thread = true;
+                selectDecodeFormat();
             } else {
                 log("GPU context initialization failed in render thread: " + gpu_renderer.getLastError());
                 use_gpu_acceleration = false;
+                selectDecodeFormat();
             }
         }
-        
+
         while (thread_manager.render_thread_running.load()) {
-            std::unique_lock<std::mutex> lock(thread_manager.render_mutex);
-            
-            // Use timeout to prevent blocking and check for frames regularly
-            auto timeout = std::chrono::milliseconds(1);  // 1ms timeout for responsive rendering
-            thread_manager.render_cv.wait_for(lock, timeout, [this] { 
-                return thread_manager.frame_ready_for_render.load() || !thread_manager.render_thread_running.load(); 
-            });
-            
-            if (!thread_manager.render_thread_running.load()) break;
-            if (!thread_manager.frame_ready_for_render.load()) continue;
-            
-            // Process the frame in this background thread with minimal locking
             {
-                std::lock_guard<std::mutex> frame_lock(frame_mutex);
+                std::unique_lock<std::mutex> lock(thread_manager.render_mutex);
+                thread_manager.render_cv.wait(lock, [this] {
+                    return !render_queue.empty() || !thread_manager.render_thread_running.load();
+                });
+
+                // Pace to the compositor: hold the newest frame until the previous one is on screen,
+                // then render whatever is latest by then
+                thread_manager.render_cv.wait_for(lock, kFrameCallbackTimeout, [this] {
+                    return !frame_callback_pending.load() || !thread_manager.render_thread_running.load();
+                });
+            }
+            if (!thread_manager.render_thread_running.load()) break;
+
+            // Always show the newest decoded frame; anything older is dropped
+            PipelineFrame *pipeline_frame = render_queue.takeLatest();
+            if (!pipeline_frame) continue;
+            pipeline_frame->times.render_start = monotonicMicros();
+            const VideoFrame &current_frame = pipeline_frame->frame;
+            bool rendered = false;
+
+            bool has_pixels = current_frame.is_rgb && !current_frame.data.empty();
+            bool has_yuv = current_frame.is_yuv && !current_frame.data.empty();
+            if ((has_pixels || has_yuv || current_frame.has_dmabuf) &&
+                current_frame.width > 0 && current_frame.height > 0) {
                 
-                if (has_new_frame && current_frame.is_rgb && !current_frame.data.empty() && 
-                    current_frame.width > 0 && current_frame.height > 0) {
-                    
-                    if (use_gpu_acceleration && gpu_initialized_in_thread) {
-                        // GPU-accelerated rendering (like QT) - much faster!
-                        if (gpu_renderer.renderFrame(current_frame)) {
-                            // GPU rendering is complete, no need for buffer swap
-                            has_new_frame = false;
-                            if (debug_input) {
-                                log("[GPU] Frame rendered successfully (" + std::to_string(current_frame.width) + "x" + std::to_string(current_frame.height) + 
-                                    " -> " + std::to_string(info.window_width) + "x" + std::to_string(info.window_height) + ")");
-                            }
-                        } else {
-                            log("GPU rendering failed: " + gpu_renderer.getLastError());
+                if (use_gpu_acceleration && gpu_initialized_in_thread) {
+                    // GPU-accelerated rendering (like QT) - much faster! The frame callback rides
+                    // on the commit done by eglSwapBuffers.
+                    requestFrameCallback();
+                    PresentationSlot *feedback = requestPresentationFeedback();
+                    bool partial = !current_frame.has_dmabuf &&
+                                   damage_history.collect(gpu_sequence, current_frame.sequence, render_damage);
+                    rendered = current_frame.has_dmabuf
+                                   ? gpu_renderer.renderDmaBuf(current_frame.dmabuf)
+                                   : gpu_renderer.renderFrame(current_frame, partial ? &render_damage : nullptr);
+                    gpu_sequence = rendered && !current_frame.has_dmabuf ? current_frame.sequence : 0;
+                    if (rendered) {
+                        pipeline_frame->times.uploaded = gpu_renderer.getUploadTime();
+                        pipeline_frame->times.committed = monotonicMicros();
+                        frameCommitted(feedback, pipeline_frame->times);
+                    } else if (feedback) {
+                        // Nothing committed; the feedback belongs to whatever commits next
+                        feedback->times = FrameTimestamps();
+                        finishPresentation(feedback);
+                    }
+                    if (!rendered && current_frame.has_dmabuf) {
+                        // Import rejected by the driver: decode to memory from the next frame on
+                        log("DMA-BUF import failed, disabling zero-copy: " + gpu_renderer.getLastError());
+                        std::lock_guard<std::mutex> lock(frame_mutex);
+                        video_processor.setZeroCopy(false);
+                    } else if (rendered) {
+                        // GPU rendering is complete, no need for buffer swap
+                        if (debug_input) {
+                            log("[GPU] Frame rendered successfully (" + std::to_string(current_frame.width) + "x" + std::to_string(current_frame.height) + 
+                                " -> " + std::to_string(info.window_width) + "x" + std::to_string(info.window_height) + ")");
                         }
-                    } else if (shm_data && render_buffer) {
-                        // CPU fallback rendering
+                    } else {
+                        log("GPU rendering failed: " + gpu_renderer.getLastError());
+                    }
+                } else if (shm_data && has_pixels) {
+                    // CPU fallback rendering, straight into a wl_buffer the compositor isn't using
+                    int index = acquireShmBuffer();
+                    if (index >= 0) {
                         if (debug_input) {
                             log("[CPU] Rendering frame (" + std::to_string(current_frame.width) + "x" + std::to_string(current_frame.height) + 
                                 " -> " + std::to_string(buffer_width) + "x" + std::to_string(buffer_height) + ")");
                         }
-                        renderVideoToBuffer(render_buffer, buffer_width, buffer_height, current_frame);
-                        
-                        // Signal that buffer is ready for swap IMMEDIATELY
-                        thread_manager.buffer_swap_ready = true;
-                        has_new_frame = false;
+                        // The buffer still holds an older frame: redraw only what changed since then
+                        ShmBuffer &target = shm_buffers[index];
+                        if (damage_history.collect(target.sequence, current_frame.sequence, render_damage)) {
+                            for (const DamageRect &rect : render_damage) {
+                                DamageRect area = mapDamage(rect, current_frame.width, current_frame.height,
+                                                            buffer_width, buffer_height);
+                                renderVideoToBuffer(target.data, buffer_width, buffer_height, current_frame, &area);
+                            }
+                        } else {
+                            renderVideoToBuffer(target.data, buffer_width, buffer_height, current_frame);
+                        }
+                        target.sequence = current_frame.sequence;
+                        target.times = pipeline_frame->times;
+                        target.times.uploaded = monotonicMicros();
+                        target.frame_width = current_frame.width;
+                        target.frame_height = current_frame.height;
+
+                        // Hand it to the Wayland thread; a drawn buffer it hasn't picked up yet is superseded
+                        int superseded = ready_buffer.exchange(index);
+                        if (superseded >= 0) {
+                            shm_buffers[superseded].state = SHM_FREE;
+                        }
+                        thread_manager.wakeWayland();
+                        rendered = true;
+                    } else if (debug_input) {
+                        log("[CPU] No free buffer, frame skipped");
                     }
                 }
             }
-            
-            // Clear frame ready flag IMMEDIATELY after processing
-            thread_manager.frame_ready_for_render = false;
+
+            // The picture is on screen: the decoder may reuse its buffer once it rotates back to it
+            pipeline_frame->frame.dmabuf.hold.reset();
+            render_queue.release(pipeline_frame);
         }
         
         log("Rendering thread stopped");
@@ -1049,14 +1511,25 @@ namespace openterface {
 
 
     void GUI::Impl::waylandEventThreadFunction() {
-        // CRITICAL: This thread must handle ALL Wayland events but NOT block on serial I/O
-        // Also prioritize video frame updates for smooth 30fps display
-        
+        // CRITICAL: This thread must handle ALL Wayland events but NOT block on serial I/O.
+        // It sleeps in poll() until the compositor sends something (input, pings, frame callbacks)
+        // or another thread wakes it through the eventfd, so an idle window costs no CPU.
+        struct pollfd fds[2];
+        fds[0].fd = wl_display_get_fd(display);
+        fds[1].fd = thread_manager.getWaylandWakeFd();
+        fds[1].events = POLLIN;
+        int target_width = 0;
+        int target_height = 0;
+        int target_shift = 0;
+
         while (thread_manager.wayland_thread_running.load() && display) {
             
             // Handle all Wayland events (ping-pong, input, etc) - this is critical for responsiveness
-            wl_display_dispatch_pending(display);
-            wl_display_flush(display);
+            if (dispatchPending() < 0) {
+                log("Wayland connection error: " + std::string(strerror(errno)));
+                signalExit();
+                break;
+            }
             
             // CRITICAL: Handle window resize events for GPU renderer
             if (needs_resize && use_gpu_acceleration) {
@@ -1068,44 +1541,244 @@ namespace openterface {
                 }
                 needs_resize = false;
             }
-            
-            // PRIORITY: Check for video frame updates FREQUENTLY for smooth 30fps
-            // Only handle CPU buffer swaps (GPU renders directly to surface)
-            if (!use_gpu_acceleration && thread_manager.buffer_swap_ready.load() && surface && buffer) {
-                wl_surface_attach(surface, buffer, 0, 0);
-                wl_surface_damage(surface, 0, 0, buffer_width, buffer_height);
-                wl_surface_commit(surface);
-                thread_manager.buffer_swap_ready = false;
-                
-                // Immediately flush after video frame commit for minimal latency
-                wl_display_flush(display);
+
+            updateVisibility();
+
+            // Decode no more pixels than the window shows, fewer while the governor sheds load
+            // (only blocks on a decode when the size changed)
+            int shift = governor.decodeShift();
+            if (info.window_width != target_width || info.window_height != target_height || shift != target_shift) {
+                target_width = info.window_width;
+                target_height = info.window_height;
+                target_shift = shift;
+                updateThumbnail(target_width, target_height);
+                std::lock_guard<std::mutex> lock(frame_mutex);
+                video_processor.setTargetSize(target_width >> shift, target_height >> shift);
             }
             
-            // Poll for new events with very short timeout to maintain responsiveness
-            struct pollfd pfd;
-            pfd.fd = wl_display_get_fd(display);
-            pfd.events = POLLIN;
-            
-            // Use non-blocking poll first
-            if (poll(&pfd, 1, 0) > 0) {
-                wl_display_dispatch(display);
+            // Only handle CPU buffer commits here (GPU renders directly to the surface)
+            presentCpuFrame();
+
+            // Events queued by another thread's roundtrip must be dispatched before we may read
+            if (prepareRead() != 0) {
+                continue;
+            }
+
+            // A full socket is retried once poll() says it is writable again
+            fds[0].events = POLLIN;
+            if (wl_display_flush(display) < 0 && errno == EAGAIN) {
+                fds[0].events |= POLLOUT;
+            }
+
+            if (poll(fds, 2, -1) < 0) {
+                wl_display_cancel_read(display);
+                if (errno == EINTR) {
+                    continue;
+                }
+                log("Wayland poll failed: " + std::string(strerror(errno)));
+                signalExit();
+                break;
+            }
+
+            if (fds[0].revents & POLLIN) {
+                wl_display_read_events(display);
+            } else {
+                wl_display_cancel_read(display);
+            }
+            if (fds[0].revents & (POLLERR | POLLHUP)) {
+                log("Wayland display disconnected");
+                signalExit();
+                break;
+            }
+            if (fds[1].revents & POLLIN) {
+                thread_manager.clearWaylandWake();
             }
-            
-            // Ultra-minimal sleep to allow 30fps video updates (33ms per frame)
-            // Use nanosleep for sub-millisecond timing
-            struct timespec ts = {0, 1000000}; // 1ms sleep = 1000fps max update rate
-            nanosleep(&ts, nullptr);
         }
     }
 
+    void GUI::Impl::presentCpuFrame() {
+        if (use_gpu_acceleration || ready_buffer.load() < 0 || !surface) {
+            return;
+        }
+
+        // Same pacing as the GPU path, including the fallback for hidden windows
+        auto now = std::chrono::steady_clock::now();
+        if (frame_callback_pending.load() && now - last_cpu_commit < kFrameCallbackTimeout) {
+            return;
+        }
+        last_cpu_commit = now;
+
+        int index = ready_buffer.exchange(-1);
+        if (index < 0) {
+            return;  // Taken back by the render thread for a newer frame
+        }
+        ShmBuffer &shm_buffer = shm_buffers[index];
+        shm_buffer.state = SHM_ATTACHED;
+        presented_buffer = index;
+
+        requestFrameCallback();
+        PresentationSlot *feedback = requestPresentationFeedback();
+        wl_surface_attach(surface, shm_buffer.buffer, 0, 0);
+
+        // Damage only what differs from the frame on screen, so the compositor doesn't re-upload
+        // and recomposite a static picture. Buffer and surface coordinates coincide (scale 1).
+        auto damage = [this](int x, int y, int width, int height) {
+            if (compositor_version >= 4) {
+                wl_surface_damage_buffer(surface, x, y, width, height);
+            } else {
+                wl_surface_damage(surface, x, y, width, height);
+            }
+        };
+        if (damage_history.collect(presented_sequence, shm_buffer.sequence, present_damage)) {
+            for (const DamageRect &rect : present_damage) {
+                DamageRect area = mapDamage(rect, shm_buffer.frame_width, shm_buffer.frame_height, buffer_width,
+                                            buffer_height);
+                damage(area.x, area.y, area.width, area.height);
+            }
+        } else {
+            damage(0, 0, buffer_width, buffer_height);
+        }
+        presented_sequence = shm_buffer.sequence;
+        wl_surface_commit(surface);
+
+        FrameTimestamps times = shm_buffer.times;
+        times.committed = monotonicMicros();
+        frameCommitted(feedback, times);
+    }
+
+    void GUI::Impl::requestFrameCallback() {
+        // Must be requested before the commit it belongs to; done fires on the Wayland thread
+        frame_callback_pending = true;
+        struct wl_callback *callback = wl_surface_frame(surface);
+        wl_callback_add_listener(callback, &frame_listener, this);
+    }
+
+    GUI::Impl::PresentationSlot *GUI::Impl::requestPresentationFeedback() {
+        // Like the frame callback, this attaches to the next commit on the surface
+        if (!presentation || !surface) {
+            return nullptr;
+        }
+        for (PresentationSlot &slot : presentation_slots) {
+            bool expected = false;
+            if (slot.in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                slot.impl = this;
+                slot.presented = 0;
+                slot.pending.store(2, std::memory_order_relaxed);
+                struct wp_presentation_feedback *feedback = wp_presentation_feedback(presentation, surface);
+                wp_presentation_feedback_add_listener(feedback, &feedback_listener, &slot);
+                return &slot;
+            }
+        }
+        return nullptr;
+    }
+
+    void GUI::Impl::frameCommitted(PresentationSlot *slot, const FrameTimestamps &times) {
+        pipeline_stats.recordFrame(times, slot != nullptr);
+        if (governor.recordFrame(times)) {
+            log("Frame governor: " + governor.describe());
+            thread_manager.wakeWayland();  // Applies the decode size
+        }
+        if (slot) {
+            slot->times = times;
+            finishPresentation(slot);
+        }
+
+        if (stats_interval == 0 && pipeline_stats.frames() >= kStatsFrames) {
+            log("Pipeline latency: " + pipeline_stats.summary() + ", " + dropSummary());
+        }
+    }
+
+    void GUI::Impl::finishPresentation(PresentationSlot *slot) {
+        if (slot->pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;  // The other side still has to report
+        }
+        if (slot->presented != 0) {
+            FrameTimestamps times = slot->times;
+            times.presented = slot->presented;
+            pipeline_stats.recordPresented(times);
+        }
+        slot->in_use.store(false, std::memory_order_release);
+    }
+
+    std::string GUI::Impl::dropSummary() const {
+        std::string summary = "dropped " + std::to_string(capture_queue.droppedCount()) + " before decode, " +
+                              std::to_string(render_queue.droppedCount()) + " before render, skipped " +
+                              std::to_string(unchanged_frames.load()) + " unchanged, " +
+                              std::to_string(governor.skipped()) + " by the governor";
+        if (thumbnail_fps > 0) {
+            summary += " and " + std::to_string(thumbnail_skipped.load()) + " over the thumbnail rate";
+        }
+        return summary;
+    }
+
+    void GUI::Impl::feedbackSyncOutput(void *data, struct wp_presentation_feedback *feedback,
+                                       struct wl_output *output) {
+        (void)data;
+        (void)feedback;
+        (void)output;
+    }
+
+    void GUI::Impl::feedbackPresented(void *data, struct wp_presentation_feedback *feedback, uint32_t tv_sec_hi,
+                                      uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh, uint32_t seq_hi,
+                                      uint32_t seq_lo, uint32_t flags) {
+        (void)refresh;
+        (void)seq_hi;
+        (void)seq_lo;
+        (void)flags;
+        auto *slot = static_cast<PresentationSlot *>(data);
+        wp_presentation_feedback_destroy(feedback);
+
+        uint64_t seconds = (static_cast<uint64_t>(tv_sec_hi) << 32) | tv_sec_lo;
+        uint64_t presented = seconds * 1000000ULL + tv_nsec / 1000;
+
+        // Timestamps are in the compositor's presentation clock; move them onto CLOCK_MONOTONIC
+        // if that's a different one
+        clockid_t clock = static_cast<clockid_t>(slot->impl->callback_data.presentation_clock);
+        if (clock != CLOCK_MONOTONIC) {
+            struct timespec ts;
+            clock_gettime(clock, &ts);
+            uint64_t clock_now = static_cast<uint64_t>(ts.tv_sec) * 1000000ULL + ts.tv_nsec / 1000;
+            uint64_t age = clock_now > presented ? clock_now - presented : 0;
+            presented = monotonicMicros() - age;
+        }
+
+        slot->presented = presented;
+        slot->impl->finishPresentation(slot);
+    }
+
+    void GUI::Impl::feedbackDiscarded(void *data, struct wp_presentation_feedback *feedback) {
+        auto *slot = static_cast<PresentationSlot *>(data);
+        wp_presentation_feedback_destroy(feedback);
+        slot->presented = 0;
+        slot->impl->finishPresentation(slot);
+    }
+
+    void GUI::Impl::frameDone(void *data, struct wl_callback *callback, uint32_t time) {
+        (void)time;
+        Impl *impl = static_cast<Impl *>(data);
+        wl_callback_destroy(callback);
+
+        // The compositor is ready for the next frame: let the render thread draw the latest one
+        impl->frame_callback_pending = false;
+        impl->thread_manager.notifyRender();
+    }
+
+    void GUI::Impl::signalExit() {
+        {
+            std::lock_guard<std::mutex> lock(exit_mutex);
+            exit_requested = true;
+        }
+        exit_cv.notify_all();
+    }
+
     void GUI::Impl::processSurfaceUpdates() {
         // Process any pending surface update requests
         SurfaceCommitRequest request;
         while (surface_update_queue.pop(request)) {
             switch (request.type) {
                 case SurfaceCommitRequest::ATTACH_BUFFER:
-                    if (surface && buffer) {
-                        wl_surface_attach(surface, buffer, 0, 0);
+                    if (surface && presented_buffer >= 0) {
+                        wl_surface_attach(surface, shm_buffers[presented_buffer].buffer, 0, 0);
                     }
                     break;
                 case SurfaceCommitRequest::DAMAGE:
@@ -1125,68 +1798,99 @@ namespace openterface {
 
     void GUI::Impl::inputThreadFunction() {
         log("Input processing thread started");
-        
-        // Track last processed mouse position
-        int last_processed_x = 0;
-        int last_processed_y = 0;
-        
-        while (thread_manager.input_thread_running.load()) {
-            
-            // Poll current mouse position from callback data (non-blocking)
-            if (callback_data.mouse_over && callback_data.input_active) {
-                int current_x = callback_data.last_mouse_x;
-                int current_y = callback_data.last_mouse_y;
-                
-                // Check if position changed
-                if (current_x != last_processed_x || current_y != last_processed_y) {
-                    // Forward mouse movement using ABSOLUTE coordinates (same as clicks!)
-                    if (serial && serial->isConnected()) {
-                        // Get window and video dimensions for coordinate transformation
-                        int window_width = info.window_width;
-                        int window_height = info.window_height;
-                        int video_width = (current_frame.width > 0) ? current_frame.width : window_width;
-                        int video_height = (current_frame.height > 0) ? current_frame.height : window_height;
-                        
-                        // Use the same coordinate normalization as mouse clicks
-                        // Clamp to window bounds
-                        int clamped_x = std::max(0, std::min(current_x, window_width - 1));
-                        int clamped_y = std::max(0, std::min(current_y, window_height - 1));
-                        
-                        // CH9329 coordinate mapping: Direct scaling from window to 0-4095 range
-                        int ch9329_x = static_cast<int>((static_cast<double>(clamped_x) / (window_width - 1)) * 4095);
-                        int ch9329_y = static_cast<int>((static_cast<double>(clamped_y) / (window_height - 1)) * 4095);
-                        
-                        // Clamp to CH9329 coordinate bounds (0-4095)
-                        ch9329_x = std::max(0, std::min(ch9329_x, 4095));
-                        ch9329_y = std::max(0, std::min(ch9329_y, 4095));
-                        
-                        // Send ABSOLUTE coordinates (not relative!)
-                        serial->sendMouseMove(ch9329_x, ch9329_y, true);
-                        if (debug_input) {
-                            log("[INPUT] Mouse motion forwarded (ABSOLUTE): window(" + 
-                                std::to_string(current_x) + "," + std::to_string(current_y) + 
-                                ") -> CH9329(" + std::to_string(ch9329_x) + "," + std::to_string(ch9329_y) + ")");
-                        }
-                    }
-                    
-                    last_processed_x = current_x;
-                    last_processed_y = current_y;
+
+        // Sleeps until the Wayland thread queues something, then forwards everything queued since
+        // in arrival order. The swap keeps the lock for as little as the push takes.
+        std::vector<InputEvent> batch;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(thread_manager.input_mutex);
+                thread_manager.input_cv.wait(lock, [this] {
+                    return !input_queue.empty() || !thread_manager.input_thread_running.load();
+                });
+                if (!thread_manager.input_thread_running.load()) {
+                    break;
                 }
+                batch.swap(input_queue);
             }
-            
-            // Sleep to avoid busy waiting
-            std::this_thread::sleep_for(std::chrono::milliseconds(5)); // 200Hz polling
+
+            for (size_t i = 0; i < batch.size(); i++) {
+                // A move superseded by the next one (the serial writes fell behind) is skipped
+                if (batch[i].type == InputEvent::MOUSE_MOVE && i + 1 < batch.size() &&
+                    batch[i + 1].type == InputEvent::MOUSE_MOVE) {
+                    continue;
+                }
+                forwardInputEvent(batch[i]);
+            }
+            batch.clear();
         }
         
         log("Input processing thread stopped");
     }
 
+    void GUI::Impl::forwardInputEvent(const InputEvent &event) {
+        if (!input || !serial || !input->isForwardingEnabled() || !serial->isConnected()) {
+            return;
+        }
+
+        bool success = true;
+        switch (event.type) {
+            case InputEvent::MOUSE_MOVE:
+                success = serial->sendMouseMove(event.x, event.y, true);
+                break;
+            case InputEvent::MOUSE_BUTTON:
+                success = serial->sendMouseButton(event.button, event.pressed, event.x, event.y, true);
+                break;
+            case InputEvent::MOUSE_SCROLL:
+                success = input->injectMouseScroll(0, event.scroll);
+                break;
+            case InputEvent::KEY_PRESS:
+                success = serial->sendKeyPress(event.key, event.modifiers);
+                break;
+            case InputEvent::KEY_RELEASE:
+                success = serial->sendKeyRelease(event.key, event.modifiers);
+                break;
+        }
+
+        auto queued = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                             event.timestamp);
+        pipeline_stats.recordInput(static_cast<uint64_t>(queued.count()));
+
+        // Formatting costs more than the send itself, so only build the text when it gets logged
+        if (debug_input || !success) {
+            std::string what;
+            switch (event.type) {
+                case InputEvent::MOUSE_MOVE:
+                    what = "Mouse motion (" + std::to_string(event.x) + "," + std::to_string(event.y) + ")";
+                    break;
+                case InputEvent::MOUSE_BUTTON:
+                    what = "Mouse button " + std::to_string(event.button) + (event.pressed ? " pressed" : " released") +
+                           " (" + std::to_string(event.x) + "," + std::to_string(event.y) + ")";
+                    break;
+                case InputEvent::MOUSE_SCROLL:
+                    what = "Mouse scroll (" + std::to_string(event.scroll) + ")";
+                    break;
+                case InputEvent::KEY_PRESS:
+                    what = "Key press " + std::to_string(event.key);
+                    break;
+                case InputEvent::KEY_RELEASE:
+                    what = "Key release " + std::to_string(event.key);
+                    break;
+            }
+            std::string msg = "[INPUT] " + what + " forwarded after " + std::to_string(queued.count()) + " us";
+            if (!success) {
+                msg += " [FAILED]";
+            }
+            log(msg);
+        }
+    }
+
     void GUI::Impl::queueInputEvent(const InputEvent& event) {
         {
-            std::lock_guard<std::mutex> lock(input_queue_mutex);
-            input_queue.push(event);
+            std::lock_guard<std::mutex> lock(thread_manager.input_mutex);
+            input_queue.push_back(event);
         }
-        thread_manager.notifyInput();
+        thread_manager.input_cv.notify_one();
     }
 
     // Wayland registry callbacks
@@ -1,4 +1,7 @@
 #include "openterface/gui_threading.hpp"
+#include <cstdint>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 namespace openterface {
 
@@ -31,10 +34,31 @@ namespace openterface {
     }
 
     // ThreadManager implementation
+    ThreadManager::ThreadManager() : wayland_wake_fd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+
     ThreadManager::~ThreadManager() {
         stopWaylandEventThread();
+        stopDecodeThread();
         stopRenderThread();
         stopInputThread();
+
+        if (wayland_wake_fd >= 0) {
+            close(wayland_wake_fd);
+        }
+    }
+
+    void ThreadManager::wakeWayland() {
+        uint64_t one = 1;
+        if (wayland_wake_fd >= 0 && write(wayland_wake_fd, &one, sizeof(one)) < 0) {
+            // EAGAIN: the counter is already non-zero, so a wakeup is pending anyway
+        }
+    }
+
+    void ThreadManager::clearWaylandWake() {
+        uint64_t count;
+        if (wayland_wake_fd >= 0 && read(wayland_wake_fd, &count, sizeof(count)) < 0) {
+            // EAGAIN: nothing pending
+        }
     }
 
     void ThreadManager::startWaylandEventThread(std::function<void()> func) {
@@ -48,12 +72,31 @@ namespace openterface {
         if (!wayland_thread_running.load()) return;
         
         wayland_thread_running = false;
+        wakeWayland();
         
         if (wayland_event_thread.joinable()) {
             wayland_event_thread.join();
         }
     }
 
+    void ThreadManager::startDecodeThread(std::function<void()> func) {
+        if (decode_thread_running.load()) return;
+
+        decode_thread_running = true;
+        decode_thread = std::thread(func);
+    }
+
+    void ThreadManager::stopDecodeThread() {
+        if (!decode_thread_running.load()) return;
+
+        decode_thread_running = false;
+        notifyDecode();
+
+        if (decode_thread.joinable()) {
+            decode_thread.join();
+        }
+    }
+
     void ThreadManager::startRenderThread(std::function<void()> func) {
         if (render_thread_running.load()) return;
         
@@ -65,7 +108,7 @@ namespace openterface {
         if (!render_thread_running.load()) return;
         
         render_thread_running = false;
-        render_cv.notify_all();
+        notifyRender();
         
         if (render_thread.joinable()) {
             render_thread.join();
@@ -83,7 +126,7 @@ namespace openterface {
         if (!input_thread_running.load()) return;
         
         input_thread_running = false;
-        input_cv.notify_all();
+        notifyInput();
         
         if (input_thread.joinable()) {
             input_thread.join();
@@ -1,124 +1,326 @@
 #include "openterface/gui_video.hpp"
 #include "openterface/jpeg_decoder.hpp"
+#include "openterface/pixel_scale.hpp"
 #include "openterface/video.hpp"
+#include "openterface/yuv_convert.hpp"
 #include <cstring>
 #include <algorithm>
+#include <iostream>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/videodev2.h>
+#endif
 
 namespace openterface {
 
-    VideoProcessor::VideoProcessor() : jpeg_decoder(std::make_unique<JpegDecoder>()) {}
+    namespace {
+        // FNV-1a style 64-bit hash taken a word at a time: enough to tell encoder output apart,
+        // and the frame is read once instead of being copied and compared
+        uint64_t hashPayload(const uint8_t *data, size_t size) {
+            constexpr uint64_t kPrime = 0x100000001b3ULL;
+            uint64_t hash = 0xcbf29ce484222325ULL ^ size;
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t word;
+                memcpy(&word, data + i, 8);
+                hash = (hash ^ word) * kPrime;
+                hash ^= hash >> 29;
+            }
+            for (; i < size; i++) {
+                hash = (hash ^ data[i]) * kPrime;
+            }
+            return hash;
+        }
+    }
+
+    VideoProcessor::VideoProcessor() : jpeg_decoder(JpegDecoder::create(DecoderBackend::Libjpeg)) {}
 
     VideoProcessor::~VideoProcessor() = default;
 
+    bool VideoProcessor::setOutputFormat(PixelFormat format) {
+        resetChangeDetection();
+        if (!jpeg_decoder->setOutputFormat(format)) {
+            last_error = jpeg_decoder->getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    PixelFormat VideoProcessor::getOutputFormat() const {
+        return jpeg_decoder->getOutputFormat();
+    }
+
+    void VideoProcessor::setDecoderBackend(DecoderBackend backend) {
+        resetChangeDetection();
+        PixelFormat format = jpeg_decoder->getOutputFormat();
+        jpeg_decoder = JpegDecoder::create(backend);
+        if (jpeg_decoder->getBackend() == DecoderBackend::Libjpeg && decode_threads > 1) {
+            jpeg_decoder = createSoftwareDecoder();
+        }
+        if (!jpeg_decoder->setOutputFormat(format)) {
+            jpeg_decoder->setOutputFormat(PixelFormat::RGB24);
+        }
+        jpeg_decoder->setScaleTarget(target_width, target_height);
+    }
+
+    DecoderBackend VideoProcessor::getDecoderBackend() const {
+        return jpeg_decoder->getBackend();
+    }
+
+    void VideoProcessor::setDecodeThreads(int threads) {
+        if (threads <= 0) {
+            threads = std::clamp(static_cast<int>(std::thread::hardware_concurrency()), 1, 4);
+        }
+        decode_threads = threads;
+
+        // Hardware decoders keep their own threading
+        if (jpeg_decoder->getBackend() == DecoderBackend::Libjpeg) {
+            PixelFormat format = jpeg_decoder->getOutputFormat();
+            jpeg_decoder = createSoftwareDecoder();
+            jpeg_decoder->setOutputFormat(format);
+            jpeg_decoder->setScaleTarget(target_width, target_height);
+        }
+    }
+
+    void VideoProcessor::setTargetSize(int width, int height) {
+        if (width == target_width && height == target_height) {
+            return;
+        }
+        target_width = width;
+        target_height = height;
+        jpeg_decoder->setScaleTarget(width, height);
+        // The same payload now decodes to a different size
+        resetChangeDetection();
+    }
+
+    std::unique_ptr<JpegDecoder> VideoProcessor::createSoftwareDecoder() const {
+        if (decode_threads > 1) {
+            return createSliceJpegDecoder(decode_threads);
+        }
+        return JpegDecoder::create(DecoderBackend::Libjpeg);
+    }
+
     bool VideoProcessor::processFrame(const FrameData& frame, VideoFrame& output) {
-        // Clear previous frame data first
-        output.data.clear();
-        output.width = 0;
-        output.height = 0;
+        uint64_t payload_hash = 0;
+        if (change_detection && isRepeatedPayload(frame, payload_hash)) {
+            output.is_rgb = false;
+            output.has_dmabuf = false;
+            output.dmabuf.hold.reset();
+            output.is_yuv = false;
+            output.is_yuyv = false;
+            output.unchanged = true;
+            return true;
+        }
+
+        output.unchanged = false;
+        if (!decodeFrame(frame, output)) {
+            return false;
+        }
+        trackChanges(frame, payload_hash, output);
+        return true;
+    }
+
+    bool VideoProcessor::isRepeatedPayload(const FrameData& frame, uint64_t& payload_hash) const {
+        // Same camera, same picture, same encoder: a static screen usually compresses to the very same
+        // bytes. YUYV frames are the pixels themselves and go through the tile comparison instead.
+#ifdef __linux__
+        if (frame.pixel_format == V4L2_PIX_FMT_YUYV) {
+            return false;
+        }
+#endif
+        if (!frame.data || frame.size == 0) {
+            return false;
+        }
+        payload_hash = hashPayload(frame.data, frame.size);
+        return frame.size == last_payload_size && payload_hash == last_payload_hash;
+    }
+
+    void VideoProcessor::trackChanges(const FrameData& frame, uint64_t payload_hash, VideoFrame& output) {
+        if (!change_detection) {
+            output.sequence = 0;
+            output.full_damage = true;
+            output.damage.clear();
+            return;
+        }
+
+        // A different payload that decodes to the same pixels still counts as unchanged
+        output.unchanged = !change_detector.update(output);
+        if (!output.unchanged) {
+            output.sequence = ++sequence;
+        }
+
+#ifdef __linux__
+        if (frame.pixel_format == V4L2_PIX_FMT_YUYV) {
+            last_payload_size = 0;
+            return;
+        }
+#endif
+        last_payload_hash = payload_hash;
+        last_payload_size = frame.size;
+    }
+
+    void VideoProcessor::resetChangeDetection() {
+        // The sequence keeps counting so older frame numbers never become ambiguous
+        last_payload_size = 0;
+        change_detector.reset();
+    }
+
+    bool VideoProcessor::decodeFrame(const FrameData& frame, VideoFrame& output) {
+        // Invalidate the previous frame but keep its storage - it is the next decode target
         output.is_rgb = false;
+        output.has_dmabuf = false;
+        output.dmabuf.hold.reset();  // Hands the decoder its buffer back before it decodes again
+        output.is_yuv = false;
+        output.is_yuyv = false;
 
         if (!frame.data || frame.size == 0) {
             last_error = "Invalid frame data";
             return false;
         }
 
-        // Try to decode MJPEG frame
-        DecodedFrame decoded_frame;
-        if (jpeg_decoder->decode(frame.data, frame.size, decoded_frame)) {
-            // Successfully decoded MJPEG to RGB
-            output.data.resize(decoded_frame.rgb_data.size());
-            memcpy(output.data.data(), decoded_frame.rgb_data.data(), decoded_frame.rgb_data.size());
-            output.width = decoded_frame.width;
-            output.height = decoded_frame.height;
-            output.is_rgb = true;
+#ifdef __linux__
+        if (frame.pixel_format == V4L2_PIX_FMT_YUYV) {
+            return processYuyvFrame(frame, output);
+        }
+#endif
+
+        // Zero-copy: let a hardware decoder keep the picture in GPU-visible memory
+        if (zero_copy && jpeg_decoder->getBackend() != DecoderBackend::Libjpeg &&
+            jpeg_decoder->decodeToDmaBuf(frame.data, frame.size, output.dmabuf)) {
+            output.width = output.dmabuf.width;
+            output.height = output.dmabuf.height;
+            output.has_dmabuf = true;
             return true;
-        } else {
+        }
+
+        // GPU conversion: skip the CPU colour conversion and upsampling stages entirely.
+        // Frames libjpeg can't output as planes (e.g. greyscale) take the RGB path below.
+        if (yuv_output && jpeg_decoder->decodeToYuvPlanes(frame.data, frame.size, output.data, output.planes)) {
+            output.width = output.planes.width;
+            output.height = output.planes.height;
+            output.is_yuv = true;
+            return true;
+        }
+
+        // Decode MJPEG straight from the capture buffer into the persistent output storage.
+        // The vector is lent to the decoder and handed back (pointer swap, no copy); it is
+        // only reallocated when the stream geometry changes.
+        DecodedFrame decoded_frame;
+        decoded_frame.rgb_data.swap(output.data);
+        bool decoded = jpeg_decoder->decode(frame.data, frame.size, decoded_frame);
+
+        // Hardware decoders can reject streams the driver doesn't handle. If libjpeg copes with the
+        // same frame the problem is the hardware path, so switch to software for good.
+        if (!decoded && jpeg_decoder->getBackend() != DecoderBackend::Libjpeg) {
+            auto fallback = createSoftwareDecoder();
+            if (!fallback->setOutputFormat(jpeg_decoder->getOutputFormat())) {
+                fallback->setOutputFormat(PixelFormat::RGB24);
+            }
+            fallback->setScaleTarget(target_width, target_height);
+            if (fallback->decode(frame.data, frame.size, decoded_frame)) {
+                std::cerr << "[VIDEO] " << decoderBackendName(jpeg_decoder->getBackend()) << " decode failed ("
+                          << jpeg_decoder->getLastError() << "), switching to libjpeg" << std::endl;
+                jpeg_decoder = std::move(fallback);
+                decoded = true;
+            }
+        }
+        output.data.swap(decoded_frame.rgb_data);
+
+        if (!decoded) {
+            output.width = 0;
+            output.height = 0;
             last_error = "MJPEG decode failed: " + jpeg_decoder->getLastError();
             return false;
         }
+
+        // Successfully decoded MJPEG
+        output.width = decoded_frame.width;
+        output.height = decoded_frame.height;
+        output.format = decoded_frame.format;
+        output.is_rgb = true;
+        return true;
+    }
+
+    bool VideoProcessor::processYuyvFrame(const FrameData& frame, VideoFrame& output) {
+#ifdef __linux__
+        size_t stride = frame.bytesperline ? frame.bytesperline : (size_t)frame.width * 2;
+        if (frame.width <= 0 || frame.height <= 0 || stride < (size_t)frame.width * 2 ||
+            frame.size < stride * frame.height) {
+            last_error = "Truncated YUYV frame";
+            return false;
+        }
+
+        // The GPU converts YUYV itself; pack the rows so they upload in one call
+        if (yuv_output) {
+            size_t row_bytes = (size_t)frame.width * 2;
+            output.data.resize(row_bytes * frame.height);
+            if (stride == row_bytes) {
+                memcpy(output.data.data(), frame.data, row_bytes * frame.height);
+            } else {
+                for (int y = 0; y < frame.height; y++) {
+                    memcpy(output.data.data() + y * row_bytes, frame.data + y * stride, row_bytes);
+                }
+            }
+            output.width = frame.width;
+            output.height = frame.height;
+            output.is_yuv = true;
+            output.is_yuyv = true;
+            return true;
+        }
+
+        YuvImage image;
+        image.layout = YuvLayout::YUYV;
+        image.width = frame.width;
+        image.height = frame.height;
+        image.planes[0] = frame.data;
+        image.strides[0] = stride;
+        image.full_range = false;
+
+        PixelFormat format = jpeg_decoder->getOutputFormat();
+        size_t dst_stride = (size_t)frame.width * bytesPerPixel(format);
+        output.data.resize(dst_stride * frame.height);
+        if (!convertYuvToPixels(image, format, output.data.data(), dst_stride)) {
+            output.width = 0;
+            output.height = 0;
+            last_error = "YUYV conversion failed";
+            return false;
+        }
+
+        output.width = frame.width;
+        output.height = frame.height;
+        output.format = format;
+        output.is_rgb = true;
+        return true;
+#else
+        (void)frame;
+        (void)output;
+        last_error = "YUYV capture not supported on this platform";
+        return false;
+#endif
     }
 
     void renderVideoToBuffer(void* buffer, int buffer_width, int buffer_height,
-                            const VideoFrame& frame) {
+                            const VideoFrame& frame, const DamageRect* region) {
         if (!buffer || buffer_width <= 0 || buffer_height <= 0 || 
             !frame.is_rgb || frame.data.empty() || frame.width <= 0 || frame.height <= 0) {
             return;
         }
 
-        uint32_t* pixels = static_cast<uint32_t*>(buffer);
-        const uint8_t* rgb_data = frame.data.data();
+        const size_t src_stride = (size_t)frame.width * bytesPerPixel(frame.format);
 
-        // Validate RGB data size
-        size_t expected_rgb_size = (size_t)(frame.width * frame.height * 3);
-        if (frame.data.size() != expected_rgb_size) {
+        // Validate pixel data size
+        size_t expected_size = src_stride * frame.height;
+        if (frame.data.size() != expected_size) {
             return;
         }
 
-        // Clear buffer to black
-        size_t buffer_size = buffer_width * buffer_height * 4;
-        memset(pixels, 0, buffer_size);
-
-        // Calculate scaling to FILL the entire buffer (may stretch/warp to use full window)
-        float scale_x = (float)buffer_width / (float)frame.width;
-        float scale_y = (float)buffer_height / (float)frame.height;
-        
-        // Use full window space - scale independently for X and Y axes
-        int scaled_width = buffer_width;   // Fill entire width
-        int scaled_height = buffer_height; // Fill entire height
-        int offset_x = 0; // No horizontal offset - use full width
-        int offset_y = 0; // No vertical offset - use full height
-        
-        // OPTIMIZATION: Use fast 1:1 copy when no scaling needed (like QT does)
-        if (scale_x >= 0.99f && scale_x <= 1.01f && scale_y >= 0.99f && scale_y <= 1.01f &&
-            frame.width == buffer_width && frame.height == buffer_height) {
-            // Direct copy - no scaling needed (fastest path)
-            for (int y = 0; y < frame.height; y++) {
-                const uint8_t* src_row = rgb_data + y * frame.width * 3;
-                uint32_t* dst_row = pixels + y * buffer_width;
-                
-                for (int x = 0; x < frame.width; x++) {
-                    const uint8_t* src_pixel = src_row + x * 3;
-                    dst_row[x] = (0xFF << 24) | (src_pixel[0] << 16) | (src_pixel[1] << 8) | src_pixel[2];
-                }
-            }
-            return;
-        }
-
-        // Optimized rendering with line-based processing (similar to QT's approach)
-        // Pre-calculate source row pointers and scaling factors for better performance
-        int* src_x_map = new int[scaled_width];
-        for (int x = 0; x < scaled_width; x++) {
-            src_x_map[x] = (x * frame.width) / scaled_width;
-        }
-        
-        for (int y = 0; y < scaled_height; y++) {
-            int dst_y = y + offset_y;
-            if (dst_y < 0 || dst_y >= buffer_height) continue;
-            
-            // Calculate source row
-            int src_y = (y * frame.height) / scaled_height;
-            if (src_y >= frame.height) continue;
-            
-            // Get pointers to destination and source rows
-            uint32_t* dst_row = pixels + dst_y * buffer_width + offset_x;
-            const uint8_t* src_row = rgb_data + src_y * frame.width * 3;
-            
-            // Process entire row at once for better cache performance
-            for (int x = 0; x < scaled_width; x++) {
-                int src_x = src_x_map[x];
-                if (src_x < frame.width) {
-                    const uint8_t* src_pixel = src_row + src_x * 3;
-                    uint8_t red = src_pixel[0];
-                    uint8_t green = src_pixel[1];
-                    uint8_t blue = src_pixel[2];
-                    
-                    // XRGB8888 format: 0xAARRGGBB
-                    dst_row[x] = (0xFF << 24) | (red << 16) | (green << 8) | blue;
-                }
-            }
-        }
-        
-        delete[] src_x_map;
+        // Stretch to FILL the entire buffer (may warp to use the full window). Every destination
+        // pixel is written, so there's no clearing pass; the scaler keeps its sampling tables
+        // between frames of the same size. One per thread - only the render thread calls this.
+        thread_local PixelScaler scaler;
+        scaler.scale(frame.data.data(), frame.width, frame.height, src_stride, frame.format,
+                     static_cast<uint32_t*>(buffer), buffer_width, buffer_height, (size_t)buffer_width * 4, region);
     }
 
     void fillBufferWithPattern(void* buffer, int width, int height, uint8_t frame_counter) {
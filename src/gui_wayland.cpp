@@ -2,6 +2,7 @@
 #include "openterface/gui_input.hpp"
 #include "openterface/input.hpp"
 #include "openterface/serial.hpp"
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <chrono>
@@ -51,6 +52,19 @@ namespace openterface {
             callback_data->log_func(msg);
         }
 
+        // The governor throttles windows that aren't focused or can't be seen
+        bool activated = false;
+        bool suspended = false;
+        if (states) {
+            const auto *state = static_cast<const uint32_t *>(states->data);
+            for (size_t i = 0; i < states->size / sizeof(uint32_t); i++) {
+                activated |= state[i] == XDG_TOPLEVEL_STATE_ACTIVATED;
+                suspended |= state[i] == XDG_TOPLEVEL_STATE_SUSPENDED;
+            }
+        }
+        callback_data->window_activated = activated;
+        callback_data->window_suspended = suspended;
+
         // Validate pointers before dereferencing
         if (!callback_data->current_width || !callback_data->current_height || !callback_data->needs_resize) {
             if (callback_data->log_func) {
@@ -64,14 +78,14 @@ namespace openterface {
             if (*callback_data->current_width != width || *callback_data->current_height != height) {
                 // Only update if we haven't resized very recently (prevent rapid resizes)
                 auto now = std::chrono::steady_clock::now();
-                static auto last_update = std::chrono::steady_clock::time_point{};
-                auto time_since_last = std::chrono::duration_cast<std::chrono::milliseconds>(now - last_update);
+                auto time_since_last =
+                    std::chrono::duration_cast<std::chrono::milliseconds>(now - callback_data->last_configure);
 
                 if (time_since_last.count() > 16) { // Limit to ~60 FPS
                     *callback_data->current_width = width;
                     *callback_data->current_height = height;
                     *callback_data->needs_resize = true;
-                    last_update = now;
+                    callback_data->last_configure = now;
                     if (callback_data->log_func) {
                         callback_data->log_func("Window resize triggered: " + std::to_string(width) + "x" +
                                                 std::to_string(height));
@@ -127,8 +141,9 @@ namespace openterface {
         auto *callback_data = static_cast<WaylandCallbackData *>(data);
 
         if (strcmp(interface, wl_compositor_interface.name) == 0) {
-            callback_data->compositor =
-                static_cast<wl_compositor *>(wl_registry_bind(registry, id, &wl_compositor_interface, 1));
+            callback_data->compositor_version = std::min(version, 4u);
+            callback_data->compositor = static_cast<wl_compositor *>(
+                wl_registry_bind(registry, id, &wl_compositor_interface, callback_data->compositor_version));
             if (callback_data->log_func)
                 callback_data->log_func("Found compositor");
         } else if (strcmp(interface, wl_shell_interface.name) == 0) {
@@ -140,14 +155,24 @@ namespace openterface {
             if (callback_data->log_func)
                 callback_data->log_func("Found shared memory");
         } else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
-            callback_data->xdg_wm_base =
-                static_cast<xdg_wm_base *>(wl_registry_bind(registry, id, &xdg_wm_base_interface, 1));
+            // Version 6 reports suspended (fully hidden) windows in the toplevel configure states
+            callback_data->xdg_wm_base = static_cast<xdg_wm_base *>(
+                wl_registry_bind(registry, id, &xdg_wm_base_interface, std::min(version, 6u)));
             if (callback_data->log_func)
                 callback_data->log_func("Found xdg_wm_base");
         } else if (strcmp(interface, wl_seat_interface.name) == 0) {
-            callback_data->seat = static_cast<wl_seat *>(wl_registry_bind(registry, id, &wl_seat_interface, 1));
+            // Version 5 brings wl_pointer.frame, which input forwarding batches motion on
+            callback_data->seat_version = std::min(version, 5u);
+            callback_data->seat =
+                static_cast<wl_seat *>(wl_registry_bind(registry, id, &wl_seat_interface, callback_data->seat_version));
             if (callback_data->log_func)
                 callback_data->log_func("Found seat");
+        } else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+            callback_data->presentation =
+                static_cast<wp_presentation *>(wl_registry_bind(registry, id, &wp_presentation_interface, 1));
+            wp_presentation_add_listener(callback_data->presentation, &presentation_listener, callback_data);
+            if (callback_data->log_func)
+                callback_data->log_func("Found wp_presentation");
         }
     }
 
@@ -160,6 +185,16 @@ namespace openterface {
         registry_global_remove
     };
 
+    // Sent once after binding: the clock the presented timestamps are in
+    void presentation_clock_id(void *data, struct wp_presentation * /*presentation*/, uint32_t clk_id) {
+        auto *callback_data = static_cast<WaylandCallbackData *>(data);
+        callback_data->presentation_clock = clk_id;
+    }
+
+    const struct wp_presentation_listener presentation_listener = {
+        presentation_clock_id,
+    };
+
     // Seat callbacks
     void simple_seat_capabilities(void *data, struct wl_seat *seat, uint32_t capabilities) {
         auto *callback_data = static_cast<WaylandCallbackData *>(data);
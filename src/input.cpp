@@ -1,10 +1,10 @@
 #include "openterface/input.hpp"
+#include "openterface/keymap.hpp"
 #include "openterface/serial.hpp"
 #include <atomic>
 #include <chrono>
 #include <cstring>
 #include <iostream>
-#include <map>
 #include <memory>
 #include <thread>
 
@@ -80,7 +80,6 @@ namespace openterface {
         void eventLoop();
 
         // Key code conversion (Linux input codes to USB HID)
-        uint8_t linuxToHidKeycode(uint32_t linux_code);
         uint8_t waylandToHidButton(uint32_t wayland_button);
     };
 
@@ -162,7 +161,7 @@ namespace openterface {
             return false;
         }
 
-        uint8_t hid_code = pImpl->linuxToHidKeycode(key_code);
+        uint8_t hid_code = evdevToHid(key_code);
         return pImpl->serial->sendKeyPress(hid_code, modifiers);
     }
 
@@ -171,7 +170,7 @@ namespace openterface {
             return false;
         }
 
-        uint8_t hid_code = pImpl->linuxToHidKeycode(key_code);
+        uint8_t hid_code = evdevToHid(key_code);
         return pImpl->serial->sendKeyRelease(hid_code, modifiers);
     }
 
@@ -251,7 +250,7 @@ namespace openterface {
 
         // Forward to serial if enabled
         if (impl->forwarding_enabled && impl->serial && impl->serial->isConnected()) {
-            uint8_t hid_code = impl->linuxToHidKeycode(key);
+            uint8_t hid_code = evdevToHid(key);
             if (event.pressed) {
                 impl->serial->sendKeyPress(hid_code, event.modifiers);
             } else {
@@ -338,27 +337,6 @@ namespace openterface {
         // Input event loop ended (silent)
     }
 
-    // Key code conversion from Linux input codes to USB HID
-    uint8_t Input::Impl::linuxToHidKeycode(uint32_t linux_code) {
-        // This is a simplified mapping - would need a complete translation table
-        static const std::map<uint32_t, uint8_t> keymap = {
-            {KEY_A, 0x04},         {KEY_B, 0x05},          {KEY_C, 0x06},         {KEY_D, 0x07},
-            {KEY_E, 0x08},         {KEY_F, 0x09},          {KEY_G, 0x0A},         {KEY_H, 0x0B},
-            {KEY_I, 0x0C},         {KEY_J, 0x0D},          {KEY_K, 0x0E},         {KEY_L, 0x0F},
-            {KEY_M, 0x10},         {KEY_N, 0x11},          {KEY_O, 0x12},         {KEY_P, 0x13},
-            {KEY_Q, 0x14},         {KEY_R, 0x15},          {KEY_S, 0x16},         {KEY_T, 0x17},
-            {KEY_U, 0x18},         {KEY_V, 0x19},          {KEY_W, 0x1A},         {KEY_X, 0x1B},
-            {KEY_Y, 0x1C},         {KEY_Z, 0x1D},          {KEY_1, 0x1E},         {KEY_2, 0x1F},
-            {KEY_3, 0x20},         {KEY_4, 0x21},          {KEY_5, 0x22},         {KEY_6, 0x23},
-            {KEY_7, 0x24},         {KEY_8, 0x25},          {KEY_9, 0x26},         {KEY_0, 0x27},
-            {KEY_ENTER, 0x28},     {KEY_ESC, 0x29},        {KEY_BACKSPACE, 0x2A}, {KEY_TAB, 0x2B},
-            {KEY_SPACE, 0x2C},     {KEY_LEFTCTRL, 0xE0},   {KEY_LEFTSHIFT, 0xE1}, {KEY_LEFTALT, 0xE2},
-            {KEY_RIGHTCTRL, 0xE4}, {KEY_RIGHTSHIFT, 0xE5}, {KEY_RIGHTALT, 0xE6},  {KEY_DELETE, 0x4C}};
-
-        auto it = keymap.find(linux_code);
-        return (it != keymap.end()) ? it->second : 0;
-    }
-
     uint8_t Input::Impl::waylandToHidButton(uint32_t wayland_button) {
         // Convert Wayland button codes to standard mouse button numbers
         // BTN_LEFT = 0x110, BTN_RIGHT = 0x111, BTN_MIDDLE = 0x112
@@ -402,24 +380,10 @@ namespace openterface {
             return false;
         }
 
-        // Send mouse wheel command directly using CH9329 protocol
         if (scroll_y == 0) return true; // Nothing to scroll
 
-        std::vector<uint8_t> cmd = {0x57, 0xAB, 0x00, 0x05, 0x05, 0x01}; // Relative mouse command
-        cmd.push_back(0x00); // No button pressed
-        cmd.push_back(0x00); // No X movement
-        cmd.push_back(0x00); // No Y movement
-        
-        // Map scroll direction to wheel value based on original Qt implementation
-        uint8_t wheel_value = 0;
-        if (scroll_y > 0) {
-            wheel_value = 0x01; // Scroll up
-        } else if (scroll_y < 0) {
-            wheel_value = 0xFF; // Scroll down (-1 as unsigned byte)
-        }
-        cmd.push_back(wheel_value);
-
-        return pImpl->serial->sendData(cmd);
+        // One wheel notch per event, as the original Qt implementation sends
+        return pImpl->serial->sendMouseWheel(scroll_y > 0 ? 1 : -1);
     }
     bool Input::injectEscape() { return injectKeyPress(KEY_ESC); }
     bool Input::injectTab() { return injectKeyPress(KEY_TAB); }
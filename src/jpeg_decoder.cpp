@@ -1,15 +1,30 @@
 #include "openterface/jpeg_decoder.hpp"
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 #include <setjmp.h>
+#include <unistd.h>
 
 extern "C" {
 #include <jpeglib.h>
 #include <jerror.h>
 }
 
+// libjpeg-turbo can emit 4-byte pixels itself (JCS_EXT_*), which removes the RGB24 -> XRGB
+// repack from the render path. Detected by CMake, double-checked against the header in use.
+#if defined(OPENTERFACE_HAVE_JPEG_TURBO) && defined(JCS_EXTENSIONS)
+#define OPENTERFACE_JPEG_EXT_COLORSPACES 1
+#endif
+
 namespace openterface {
 
+// Upper bound on rows requested per jpeg_read_scanlines() call (rec_outbuf_height is at most
+// max_v_samp_factor, i.e. 4 for legal JPEGs)
+static constexpr JDIMENSION kMaxRowsPerRead = 16;
+
+// Rows per component in one raw-data iMCU row (v_samp_factor * DCTSIZE, v_samp_factor <= 4)
+static constexpr int kMaxRawRows = 4 * DCTSIZE;
+
 // Custom error handler for libjpeg  
 struct JpegErrorMgr {
     struct jpeg_error_mgr pub;
@@ -27,48 +42,261 @@ void jpegErrorHandler(j_common_ptr cinfo) {
     longjmp(err->setjmp_buffer, 1);
 }
 
-JpegDecoder::JpegDecoder() = default;
+// Long-lived libjpeg state: one decompressor per JpegDecoder, reused for every frame so the
+// permanent pool (source manager, quant/Huffman table storage) survives between frames
+struct LibjpegDecoder::State {
+    struct jpeg_decompress_struct cinfo;
+    JpegErrorMgr jerr;
+    bool created = false;
+};
+
+const char* decoderBackendName(DecoderBackend backend) {
+    switch (backend) {
+    case DecoderBackend::Libjpeg:
+        return "libjpeg";
+    case DecoderBackend::Vaapi:
+        return "vaapi";
+    case DecoderBackend::V4l2M2m:
+        return "v4l2m2m";
+    case DecoderBackend::Auto:
+        return "auto";
+    }
+    return "unknown";
+}
+
+bool parseDecoderBackend(const std::string& name, DecoderBackend& backend) {
+    for (DecoderBackend candidate : {DecoderBackend::Libjpeg, DecoderBackend::Vaapi, DecoderBackend::V4l2M2m,
+                                     DecoderBackend::Auto}) {
+        if (name == decoderBackendName(candidate)) {
+            backend = candidate;
+            return true;
+        }
+    }
+    return false;
+}
 
 JpegDecoder::~JpegDecoder() = default;
 
+std::unique_ptr<JpegDecoder> JpegDecoder::create(DecoderBackend backend) {
+    std::string error;
+
+    if (backend == DecoderBackend::Vaapi || backend == DecoderBackend::Auto) {
+        if (auto decoder = createVaapiJpegDecoder(error)) {
+            return decoder;
+        }
+        std::cerr << "[VIDEO] VA-API JPEG decoder unavailable: " << error << std::endl;
+    }
+
+    if (backend == DecoderBackend::V4l2M2m || backend == DecoderBackend::Auto) {
+        if (auto decoder = createV4l2M2mJpegDecoder(error)) {
+            return decoder;
+        }
+        std::cerr << "[VIDEO] V4L2 M2M JPEG decoder unavailable: " << error << std::endl;
+    }
+
+    if (backend != DecoderBackend::Libjpeg) {
+        std::cerr << "[VIDEO] Falling back to libjpeg software decoding" << std::endl;
+    }
+    return std::make_unique<LibjpegDecoder>();
+}
+
+bool JpegDecoder::setOutputFormat(PixelFormat format) {
+    if (!supportsFormat(format)) {
+        last_error = std::string("Output format not supported by the ") + decoderBackendName(getBackend()) +
+                     " decoder (32-bit output needs libjpeg-turbo extended colour spaces)";
+        return false;
+    }
+    output_format = format;
+    return true;
+}
+
+void JpegDecoder::setScaleTarget(int width, int height) {
+    scale_target_width = std::max(width, 0);
+    scale_target_height = std::max(height, 0);
+}
+
+int JpegDecoder::scaleDenominator(int width, int height) const {
+    if (fixed_scale_denom > 0) {
+        return fixed_scale_denom;
+    }
+    if (scale_target_width <= 0 || scale_target_height <= 0) {
+        return 1;
+    }
+    for (int denom : {8, 4, 2}) {
+        if ((width + denom - 1) / denom >= scale_target_width && (height + denom - 1) / denom >= scale_target_height) {
+            return denom;
+        }
+    }
+    return 1;
+}
+
 bool JpegDecoder::decode(const uint8_t* jpeg_data, size_t jpeg_size, DecodedFrame& output) {
+    int width = 0;
+    int height = 0;
+    if (!decodeFrame(jpeg_data, jpeg_size, &output.rgb_data, nullptr, 0, 0, width, height)) {
+        return false;
+    }
+
+    output.width = width;
+    output.height = height;
+    output.channels = bytesPerPixel(output_format);
+    output.format = output_format;
+    return true;
+}
+
+bool JpegDecoder::decodeInto(const uint8_t* jpeg_data, size_t jpeg_size, uint8_t* dst, size_t dst_capacity,
+                             size_t dst_stride, int& width, int& height) {
+    if (!dst) {
+        last_error = "Invalid destination buffer";
+        return false;
+    }
+    return decodeFrame(jpeg_data, jpeg_size, nullptr, dst, dst_capacity, dst_stride, width, height);
+}
+
+DmaBufLease::~DmaBufLease() {
+    for (int fd : fds) {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+std::shared_ptr<void> DmaBufLease::lend(const std::shared_ptr<DmaBufLease>& lease) {
+    lease->lent.store(true, std::memory_order_relaxed);
+    // The token shares ownership, so the fds outlive a decoder that is torn down mid-frame
+    return std::shared_ptr<void>(lease.get(), [lease](void*) {
+        lease->lent.store(false, std::memory_order_release);
+    });
+}
+
+bool JpegDecoder::decodeToDmaBuf(const uint8_t*, size_t, DmaBufFrame&) {
+    last_error = std::string("DMA-BUF export not supported by the ") + decoderBackendName(getBackend()) + " decoder";
+    return false;
+}
+
+bool JpegDecoder::decodeToYuvPlanes(const uint8_t*, size_t, std::vector<uint8_t>&, YuvPlanes&) {
+    last_error = std::string("Planar YCbCr output not supported by the ") + decoderBackendName(getBackend()) +
+                 " decoder";
+    return false;
+}
+
+uint8_t* JpegDecoder::prepareTarget(int width, int height, std::vector<uint8_t>* grow_buffer, uint8_t* dst,
+                                    size_t dst_capacity, size_t dst_stride, size_t& row_stride) {
+    size_t row_bytes = static_cast<size_t>(width) * bytesPerPixel(output_format);
+    row_stride = dst_stride ? dst_stride : row_bytes;
+    if (row_stride < row_bytes) {
+        last_error = "Destination stride too small: " + std::to_string(row_stride) + " < " + std::to_string(row_bytes);
+        return nullptr;
+    }
+
+    // Validate calculated buffer size
+    size_t buffer_size = static_cast<size_t>(height - 1) * row_stride + row_bytes;
+    if (buffer_size > 200 * 1024 * 1024) { // 200MB limit
+        last_error = "JPEG buffer size too large: " + std::to_string(buffer_size) + " bytes";
+        return nullptr;
+    }
+
+    // Grow the owned buffer only when the geometry changes; steady-state frames reuse it as-is
+    if (grow_buffer) {
+        if (grow_buffer->size() != buffer_size) {
+            grow_buffer->resize(buffer_size);
+        }
+        dst = grow_buffer->data();
+        dst_capacity = grow_buffer->size();
+    }
+
+    if (dst_capacity < buffer_size) {
+        last_error = "Destination buffer too small: " + std::to_string(dst_capacity) + " < " +
+                     std::to_string(buffer_size) + " bytes";
+        return nullptr;
+    }
+
+    return dst;
+}
+
+std::string JpegDecoder::getLastError() const {
+    return last_error;
+}
+
+LibjpegDecoder::LibjpegDecoder() : state(std::make_unique<State>()) {
+    state->cinfo.err = jpeg_std_error(&state->jerr.pub);
+    state->jerr.pub.error_exit = jpegErrorHandler;
+
+    if (setjmp(state->jerr.setjmp_buffer)) {
+        last_error = std::string("Failed to create JPEG decompressor: ") + state->jerr.last_error;
+        return;
+    }
+
+    jpeg_create_decompress(&state->cinfo);
+    state->created = true;
+}
+
+LibjpegDecoder::~LibjpegDecoder() {
+    if (state && state->created) {
+        jpeg_destroy_decompress(&state->cinfo);
+    }
+}
+
+bool LibjpegDecoder::supportsFormat(PixelFormat format) const {
+#ifdef OPENTERFACE_JPEG_EXT_COLORSPACES
+    (void)format;
+    return true;
+#else
+    return format == PixelFormat::RGB24;
+#endif
+}
+
+bool LibjpegDecoder::decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                                 uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) {
     if (!jpeg_data || jpeg_size == 0) {
         last_error = "Invalid JPEG data";
         return false;
     }
 
-    struct jpeg_decompress_struct cinfo;
-    JpegErrorMgr jerr;
+    if (!state->created) {
+        last_error = "JPEG decompressor not available";
+        return false;
+    }
 
-    // Set up error handling
-    cinfo.err = jpeg_std_error(&jerr.pub);
-    jerr.pub.error_exit = jpegErrorHandler;
+    struct jpeg_decompress_struct& cinfo = state->cinfo;
 
-    if (setjmp(jerr.setjmp_buffer)) {
-        // Error occurred during JPEG processing
-        last_error = std::string("JPEG decode error: ") + jerr.last_error;
-        jpeg_destroy_decompress(&cinfo);
+    if (setjmp(state->jerr.setjmp_buffer)) {
+        // Error occurred during JPEG processing - reset the decompressor but keep it alive
+        last_error = std::string("JPEG decode error: ") + state->jerr.last_error;
+        jpeg_abort_decompress(&cinfo);
         return false;
     }
 
-    // Initialize decompression
-    jpeg_create_decompress(&cinfo);
-
-    // Set up input source
+    // Point the existing source manager at this frame (allocated once, on the first frame)
     jpeg_mem_src(&cinfo, const_cast<unsigned char*>(jpeg_data), jpeg_size);
 
     // Read JPEG header
     int header_result = jpeg_read_header(&cinfo, TRUE);
     if (header_result != JPEG_HEADER_OK) {
         last_error = "Failed to read JPEG header";
-        jpeg_destroy_decompress(&cinfo);
+        jpeg_abort_decompress(&cinfo);
         return false;
     }
 
-    // Set decompression parameters for RGB output with performance optimizations
-    cinfo.out_color_space = JCS_RGB;
-    cinfo.output_components = 3;
-    
+    // Set decompression parameters for the requested output layout with performance optimizations
+    switch (output_format) {
+#ifdef OPENTERFACE_JPEG_EXT_COLORSPACES
+    case PixelFormat::XRGB8888:
+        cinfo.out_color_space = JCS_EXT_BGRX;
+        break;
+    case PixelFormat::RGBX8888:
+        cinfo.out_color_space = JCS_EXT_RGBX;
+        break;
+#endif
+    default:
+        cinfo.out_color_space = JCS_RGB;
+        break;
+    }
+
+    // Reduced-size decode for small windows: the IDCT itself produces fewer samples
+    cinfo.scale_num = 1;
+    cinfo.scale_denom = scaleDenominator(cinfo.image_width, cinfo.image_height);
+
     // Performance optimizations (like ffplay)
     cinfo.do_fancy_upsampling = FALSE;  // Disable fancy upsampling for speed
     cinfo.do_block_smoothing = FALSE;   // Disable block smoothing for speed
@@ -77,74 +305,202 @@ bool JpegDecoder::decode(const uint8_t* jpeg_data, size_t jpeg_size, DecodedFram
     // Start decompression
     if (!jpeg_start_decompress(&cinfo)) {
         last_error = "Failed to start JPEG decompression";
-        jpeg_destroy_decompress(&cinfo);
+        jpeg_abort_decompress(&cinfo);
         return false;
     }
 
-    // Validate decoded dimensions
-    if (cinfo.output_width <= 0 || cinfo.output_height <= 0) {
-        last_error = "Invalid JPEG dimensions: " + std::to_string(cinfo.output_width) + "x" + std::to_string(cinfo.output_height);
-        jpeg_destroy_decompress(&cinfo);
+    // Geometry checks on the parsed header: a few compares, so they run on every frame
+    if (!validateLayout()) {
+        jpeg_abort_decompress(&cinfo);
         return false;
     }
-    
-    // Reasonable size limits to prevent memory issues
-    if (cinfo.output_width > 8192 || cinfo.output_height > 8192) {
-        last_error = "JPEG dimensions too large: " + std::to_string(cinfo.output_width) + "x" + std::to_string(cinfo.output_height);
-        jpeg_destroy_decompress(&cinfo);
+
+    width = cinfo.output_width;
+    height = cinfo.output_height;
+
+    size_t row_stride = 0;
+    uint8_t* target = prepareTarget(width, height, grow_buffer, dst, dst_capacity, dst_stride, row_stride);
+    if (!target) {
+        jpeg_abort_decompress(&cinfo);
         return false;
     }
-    
-    // Validate output components (should be 3 for RGB)
-    if (cinfo.output_components != 3) {
-        last_error = "Unexpected JPEG output components: " + std::to_string(cinfo.output_components) + " (expected 3 for RGB)";
-        jpeg_destroy_decompress(&cinfo);
+
+    // Read a full row group per call (rec_outbuf_height rows, e.g. 2 for merged 4:2:0 upsampling)
+    // so libjpeg writes straight into the target instead of through its spare-row buffer
+    JSAMPROW row_pointers[kMaxRowsPerRead];
+    JDIMENSION rows_per_read = std::clamp<JDIMENSION>(cinfo.rec_outbuf_height, 1, kMaxRowsPerRead);
+
+    while (cinfo.output_scanline < cinfo.output_height) {
+        JDIMENSION rows = std::min(rows_per_read, cinfo.output_height - cinfo.output_scanline);
+        for (JDIMENSION i = 0; i < rows; i++) {
+            row_pointers[i] = target + static_cast<size_t>(cinfo.output_scanline + i) * row_stride;
+        }
+
+        JDIMENSION rows_read = jpeg_read_scanlines(&cinfo, row_pointers, rows);
+        if (rows_read == 0) {
+            last_error = "Failed to read JPEG scanline";
+            jpeg_abort_decompress(&cinfo);
+            return false;
+        }
+    }
+
+    // Finish decompression - releases the per-image pool, the decompressor itself stays alive
+    jpeg_finish_decompress(&cinfo);
+
+    return true;
+}
+
+bool LibjpegDecoder::decodeToYuvPlanes(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>& storage,
+                                       YuvPlanes& planes) {
+    return decodeRaw(jpeg_data, jpeg_size, &storage, nullptr, nullptr, planes);
+}
+
+bool LibjpegDecoder::decodeYuvPlanesInto(const uint8_t* jpeg_data, size_t jpeg_size,
+                                         uint8_t* const dst[YuvPlanes::kNumPlanes],
+                                         const size_t dst_capacity[YuvPlanes::kNumPlanes], YuvPlanes& planes) {
+    return decodeRaw(jpeg_data, jpeg_size, nullptr, dst, dst_capacity, planes);
+}
+
+bool LibjpegDecoder::decodeRaw(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* storage,
+                               uint8_t* const* dst, const size_t* dst_capacity, YuvPlanes& planes) {
+    if (!jpeg_data || jpeg_size == 0) {
+        last_error = "Invalid JPEG data";
         return false;
     }
 
-    // Allocate output buffer
-    output.width = cinfo.output_width;
-    output.height = cinfo.output_height;
-    output.channels = cinfo.output_components;
-    
-    int row_stride = output.width * output.channels;
-    
-    // Validate calculated buffer size
-    size_t buffer_size = static_cast<size_t>(output.height) * static_cast<size_t>(row_stride);
-    if (buffer_size > 200 * 1024 * 1024) { // 200MB limit
-        last_error = "JPEG buffer size too large: " + std::to_string(buffer_size) + " bytes";
-        jpeg_destroy_decompress(&cinfo);
+    if (!state->created) {
+        last_error = "JPEG decompressor not available";
         return false;
     }
-    
-    output.rgb_data.resize(buffer_size);
 
-    // Read scanlines one at a time (safer, still fast with other optimizations)
-    JSAMPROW row_pointers[1];
-    int current_row = 0;
-    
+    struct jpeg_decompress_struct& cinfo = state->cinfo;
+
+    if (setjmp(state->jerr.setjmp_buffer)) {
+        last_error = std::string("JPEG decode error: ") + state->jerr.last_error;
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    jpeg_mem_src(&cinfo, const_cast<unsigned char*>(jpeg_data), jpeg_size);
+
+    if (jpeg_read_header(&cinfo, TRUE) != JPEG_HEADER_OK) {
+        last_error = "Failed to read JPEG header";
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    // The shaders expect full-resolution luma and one sample per chroma block (4:2:0, 4:2:2, 4:4:4...)
+    const jpeg_component_info* comp = cinfo.comp_info;
+    if (cinfo.num_components != YuvPlanes::kNumPlanes || cinfo.jpeg_color_space != JCS_YCbCr ||
+        comp[0].h_samp_factor != cinfo.max_h_samp_factor || comp[0].v_samp_factor != cinfo.max_v_samp_factor ||
+        comp[1].h_samp_factor != 1 || comp[1].v_samp_factor != 1 || comp[2].h_samp_factor != 1 ||
+        comp[2].v_samp_factor != 1) {
+        last_error = "JPEG layout not supported for planar YCbCr output";
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    cinfo.raw_data_out = TRUE;
+    cinfo.out_color_space = JCS_YCbCr;
+    cinfo.do_block_smoothing = FALSE;
+    cinfo.dct_method = JDCT_IFAST;
+
+    if (!jpeg_start_decompress(&cinfo)) {
+        last_error = "Failed to start JPEG decompression";
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    if (cinfo.output_width > 8192 || cinfo.output_height > 8192) {
+        last_error = "JPEG dimensions too large: " + std::to_string(cinfo.output_width) + "x" +
+                     std::to_string(cinfo.output_height);
+        jpeg_abort_decompress(&cinfo);
+        return false;
+    }
+
+    // jpeg_read_raw_data() emits whole iMCU rows: v_samp_factor * DCTSIZE rows of each component,
+    // each width_in_blocks * DCTSIZE samples wide
+    planes.width = cinfo.output_width;
+    planes.height = cinfo.output_height;
+    planes.subsample_x = cinfo.max_h_samp_factor;
+    planes.subsample_y = cinfo.max_v_samp_factor;
+    size_t total_size = 0;
+    for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+        planes.plane_widths[c] = comp[c].width_in_blocks * DCTSIZE;
+        planes.plane_heights[c] = cinfo.total_iMCU_rows * comp[c].v_samp_factor * DCTSIZE;
+        planes.offsets[c] = total_size;
+        total_size += static_cast<size_t>(planes.plane_widths[c]) * planes.plane_heights[c];
+    }
+    uint8_t* bases[YuvPlanes::kNumPlanes];
+    if (storage) {
+        if (storage->size() != total_size) {
+            storage->resize(total_size);
+        }
+        for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+            bases[c] = storage->data() + planes.offsets[c];
+        }
+    } else {
+        for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+            size_t plane_size = static_cast<size_t>(planes.plane_widths[c]) * planes.plane_heights[c];
+            if (dst_capacity[c] < plane_size) {
+                last_error = "Destination plane too small: " + std::to_string(dst_capacity[c]) + " < " +
+                             std::to_string(plane_size) + " bytes";
+                jpeg_abort_decompress(&cinfo);
+                return false;
+            }
+            bases[c] = dst[c];
+        }
+    }
+
+    JSAMPROW rows[YuvPlanes::kNumPlanes][kMaxRawRows];
+    JSAMPARRAY plane_rows[YuvPlanes::kNumPlanes] = {rows[0], rows[1], rows[2]};
+    const JDIMENSION lines_per_read = cinfo.max_v_samp_factor * DCTSIZE;
+
     while (cinfo.output_scanline < cinfo.output_height) {
-        row_pointers[0] = &output.rgb_data[current_row * row_stride];
-        
-        int rows_read = jpeg_read_scanlines(&cinfo, row_pointers, 1);
-        if (rows_read != 1) {
-            last_error = "Failed to read JPEG scanline";
-            jpeg_destroy_decompress(&cinfo);
+        JDIMENSION imcu_row = cinfo.output_scanline / lines_per_read;
+        for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+            int plane_rows_per_read = comp[c].v_samp_factor * DCTSIZE;
+            uint8_t* base = bases[c];
+            for (int i = 0; i < plane_rows_per_read; i++) {
+                rows[c][i] = base + (static_cast<size_t>(imcu_row) * plane_rows_per_read + i) * planes.plane_widths[c];
+            }
+        }
+
+        if (jpeg_read_raw_data(&cinfo, plane_rows, lines_per_read) == 0) {
+            last_error = "Failed to read JPEG raw data";
+            jpeg_abort_decompress(&cinfo);
             return false;
         }
-        
-        current_row++;
     }
 
-    // Finish decompression
     jpeg_finish_decompress(&cinfo);
-    jpeg_destroy_decompress(&cinfo);
 
     return true;
 }
 
-std::string JpegDecoder::getLastError() const {
-    return last_error;
+bool LibjpegDecoder::validateLayout() {
+    const struct jpeg_decompress_struct& cinfo = state->cinfo;
+
+    // Validate decoded dimensions
+    if (cinfo.output_width <= 0 || cinfo.output_height <= 0) {
+        last_error = "Invalid JPEG dimensions: " + std::to_string(cinfo.output_width) + "x" + std::to_string(cinfo.output_height);
+        return false;
+    }
+    
+    // Reasonable size limits to prevent memory issues
+    if (cinfo.output_width > 8192 || cinfo.output_height > 8192) {
+        last_error = "JPEG dimensions too large: " + std::to_string(cinfo.output_width) + "x" + std::to_string(cinfo.output_height);
+        return false;
+    }
+    
+    // Validate output components against the requested layout (3 for RGB24, 4 for XRGB/RGBX)
+    if (cinfo.output_components != bytesPerPixel(output_format)) {
+        last_error = "Unexpected JPEG output components: " + std::to_string(cinfo.output_components) +
+                     " (expected " + std::to_string(bytesPerPixel(output_format)) + ")";
+        return false;
+    }
+
+    return true;
 }
 
 } // namespace openterface
\ No newline at end of file
@@ -0,0 +1,343 @@
+#include "openterface/jpeg_decoder.hpp"
+#include "openterface/jpeg_parser.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace openterface {
+
+// Run of whole MCU rows between two restart markers. Every restart interval resets the DC
+// predictors and starts byte-aligned, so a strip is a valid scan on its own: the header with the
+// frame height patched, the strip's entropy data with its RSTn renumbered from RST0, and EOI.
+struct SliceRange {
+    int first_mcu_row = 0;
+    int first_row = 0;       // Pixel rows covered by the strip
+    int rows = 0;
+    size_t data_begin = 0;   // Entropy-coded data, after the preceding RSTn
+    size_t data_end = 0;     // Up to the next strip's RSTn (or the end of the scan)
+};
+
+class SliceJpegDecoder : public JpegDecoder {
+public:
+    explicit SliceJpegDecoder(int threads);
+    ~SliceJpegDecoder() override;
+
+    DecoderBackend getBackend() const override { return DecoderBackend::Libjpeg; }
+    bool supportsFormat(PixelFormat format) const override { return workers[0]->decoder.supportsFormat(format); }
+
+    bool decodeToYuvPlanes(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>& storage,
+                           YuvPlanes& planes) override;
+
+protected:
+    bool decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                     uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) override;
+
+private:
+    struct Worker {
+        LibjpegDecoder decoder;
+        std::vector<uint8_t> strip;  // Standalone JPEG for the worker's slice, reused between frames
+        bool ok = false;
+        std::thread thread;
+    };
+
+    bool planSlices(const uint8_t* jpeg_data, size_t jpeg_size);
+    void buildStrip(const SliceRange& slice, std::vector<uint8_t>& strip) const;
+    bool decodeSlice(int index);
+    bool runSlices();
+    void workerLoop(int index);
+
+    std::vector<std::unique_ptr<Worker>> workers;  // workers[0] runs on the calling thread
+
+    // Current frame
+    const uint8_t* frame_data = nullptr;
+    JpegHeaderInfo header;
+    std::vector<size_t> restart_positions;
+    std::vector<SliceRange> slices;
+
+    // Destination: packed pixels, or planes when planar is set
+    bool planar = false;
+    uint8_t* target = nullptr;
+    size_t target_capacity = 0;
+    size_t target_stride = 0;
+    int target_denom = 1;
+    uint8_t* plane_targets[YuvPlanes::kNumPlanes] = {};
+    size_t plane_capacity[YuvPlanes::kNumPlanes] = {};
+    int plane_widths[YuvPlanes::kNumPlanes] = {};
+
+    std::mutex mutex;
+    std::condition_variable start_cv;
+    std::condition_variable done_cv;
+    uint64_t generation = 0;
+    int active_slices = 0;  // Slice count of the current generation; planSlices rewrites `slices` unlocked
+    int pending = 0;
+    bool stopping = false;
+};
+
+SliceJpegDecoder::SliceJpegDecoder(int threads) {
+    int count = std::max(threads, 1);
+    for (int i = 0; i < count; i++) {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (int i = 1; i < count; i++) {
+        workers[i]->thread = std::thread(&SliceJpegDecoder::workerLoop, this, i);
+    }
+}
+
+SliceJpegDecoder::~SliceJpegDecoder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    start_cv.notify_all();
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+}
+
+bool SliceJpegDecoder::planSlices(const uint8_t* jpeg_data, size_t jpeg_size) {
+    slices.clear();
+    if (workers.size() < 2 || !jpeg_data || jpeg_size == 0) {
+        return false;
+    }
+
+    // Anything unusual (progressive, non-interleaved, broken headers) goes to the whole-frame path,
+    // which also produces the proper libjpeg error
+    std::string error;
+    if (!parseJpegHeader(jpeg_data, jpeg_size, header, error) || !header.baseline || header.restart_interval <= 0 ||
+        header.scan_num_components != header.num_components || header.sof_offset + 7 > header.scan_offset ||
+        (header.num_components == 1 && (header.max_h_samp != 1 || header.max_v_samp != 1))) {
+        return false;
+    }
+
+    // A stream with missing or extra markers can't be cut reliably
+    const int64_t mcus_per_row = header.mcusPerRow();
+    const int mcu_rows = header.mcuRows();
+    const int64_t interval = header.restart_interval;
+    findRestartMarkers(jpeg_data, header, restart_positions);
+    if (static_cast<int64_t>(restart_positions.size()) != (mcus_per_row * mcu_rows - 1) / interval) {
+        return false;
+    }
+
+    const int mcu_height = 8 * header.max_v_samp;
+    auto addSlice = [&](int first_mcu_row, int end_mcu_row, size_t begin, size_t end) {
+        SliceRange slice;
+        slice.first_mcu_row = first_mcu_row;
+        slice.first_row = first_mcu_row * mcu_height;
+        slice.rows = std::min(header.height, end_mcu_row * mcu_height) - slice.first_row;
+        slice.data_begin = begin;
+        slice.data_end = end;
+        slices.push_back(slice);
+    };
+
+    // Cut at the first marker that starts an MCU row at or past each even share of the rows
+    const int wanted = std::min(static_cast<int>(workers.size()), mcu_rows);
+    int first_mcu_row = 0;
+    size_t begin = header.scan_offset;
+    for (size_t k = 1; k <= restart_positions.size() && static_cast<int>(slices.size()) + 1 < wanted; k++) {
+        int64_t mcu = static_cast<int64_t>(k) * interval;
+        if (mcu % mcus_per_row != 0) {
+            continue;
+        }
+        int row = static_cast<int>(mcu / mcus_per_row);
+        if (row < (static_cast<int>(slices.size()) + 1) * mcu_rows / wanted) {
+            continue;
+        }
+        addSlice(first_mcu_row, row, begin, restart_positions[k - 1]);
+        first_mcu_row = row;
+        begin = restart_positions[k - 1] + 2;
+    }
+    if (slices.empty()) {
+        return false;
+    }
+    addSlice(first_mcu_row, mcu_rows, begin, header.scan_offset + header.scan_size);
+
+    frame_data = jpeg_data;
+    return true;
+}
+
+void SliceJpegDecoder::buildStrip(const SliceRange& slice, std::vector<uint8_t>& strip) const {
+    const size_t header_size = header.scan_offset;
+    const size_t data_size = slice.data_end - slice.data_begin;
+    strip.resize(header_size + data_size + 2);
+    uint8_t* out = strip.data();
+
+    memcpy(out, frame_data, header_size);
+    out[header.sof_offset + 5] = static_cast<uint8_t>(slice.rows >> 8);
+    out[header.sof_offset + 6] = static_cast<uint8_t>(slice.rows & 0xFF);
+
+    // libjpeg expects the markers to count up from RST0 again
+    uint8_t* entropy = out + header_size;
+    memcpy(entropy, frame_data + slice.data_begin, data_size);
+    auto marker = std::lower_bound(restart_positions.begin(), restart_positions.end(), slice.data_begin);
+    for (int n = 0; marker != restart_positions.end() && *marker < slice.data_end; ++marker, n++) {
+        entropy[*marker - slice.data_begin + 1] = static_cast<uint8_t>(0xD0 + (n & 7));
+    }
+
+    out[header_size + data_size] = 0xFF;
+    out[header_size + data_size + 1] = 0xD9;
+}
+
+bool SliceJpegDecoder::decodeSlice(int index) {
+    Worker& worker = *workers[index];
+    const SliceRange& slice = slices[index];
+    buildStrip(slice, worker.strip);
+
+    if (planar) {
+        uint8_t* dst[YuvPlanes::kNumPlanes];
+        size_t capacity[YuvPlanes::kNumPlanes];
+        for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+            size_t offset = static_cast<size_t>(slice.first_mcu_row) * header.components[c].v_samp * 8 *
+                            plane_widths[c];
+            dst[c] = plane_targets[c] + offset;
+            capacity[c] = plane_capacity[c] - offset;
+        }
+        YuvPlanes strip_planes;
+        return worker.decoder.decodeYuvPlanesInto(worker.strip.data(), worker.strip.size(), dst, capacity,
+                                                  strip_planes);
+    }
+
+    // Strips start on MCU rows (multiples of 8 pixel rows), so every scaled strip starts on a whole row
+    size_t offset = static_cast<size_t>(slice.first_row / target_denom) * target_stride;
+    int width = 0;
+    int height = 0;
+    worker.decoder.setOutputFormat(output_format);
+    worker.decoder.setScaleDenominator(target_denom);
+    return worker.decoder.decodeInto(worker.strip.data(), worker.strip.size(), target + offset,
+                                     target_capacity - offset, target_stride, width, height);
+}
+
+bool SliceJpegDecoder::runSlices() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        active_slices = static_cast<int>(slices.size());
+        pending = active_slices - 1;
+        generation++;
+    }
+    start_cv.notify_all();
+
+    workers[0]->ok = decodeSlice(0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [this] { return pending == 0; });
+
+    for (size_t i = 0; i < slices.size(); i++) {
+        if (!workers[i]->ok) {
+            last_error = "Slice " + std::to_string(i) + ": " + workers[i]->decoder.getLastError();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SliceJpegDecoder::workerLoop(int index) {
+    uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        start_cv.wait(lock, [this, seen] { return stopping || generation != seen; });
+        if (stopping) {
+            return;
+        }
+        seen = generation;
+        if (index >= active_slices) {
+            continue;
+        }
+
+        lock.unlock();
+        workers[index]->ok = decodeSlice(index);
+        lock.lock();
+
+        if (--pending == 0) {
+            done_cv.notify_one();
+        }
+    }
+}
+
+bool SliceJpegDecoder::decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                                   uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) {
+    if (!planSlices(jpeg_data, jpeg_size)) {
+        // No usable restart markers: plain single-threaded decode
+        LibjpegDecoder& decoder = workers[0]->decoder;
+        decoder.setOutputFormat(output_format);
+        decoder.setScaleTarget(scale_target_width, scale_target_height);
+        decoder.setScaleDenominator(0);
+        bool decoded;
+        if (grow_buffer) {
+            DecodedFrame frame;
+            frame.rgb_data.swap(*grow_buffer);
+            decoded = decoder.decode(jpeg_data, jpeg_size, frame);
+            grow_buffer->swap(frame.rgb_data);
+            width = frame.width;
+            height = frame.height;
+        } else {
+            decoded = decoder.decodeInto(jpeg_data, jpeg_size, dst, dst_capacity, dst_stride, width, height);
+        }
+        if (!decoded) {
+            last_error = decoder.getLastError();
+        }
+        return decoded;
+    }
+
+    target_denom = scaleDenominator(header.width, header.height);
+    width = (header.width + target_denom - 1) / target_denom;
+    height = (header.height + target_denom - 1) / target_denom;
+    size_t row_stride = 0;
+    target = prepareTarget(width, height, grow_buffer, dst, dst_capacity, dst_stride, row_stride);
+    if (!target) {
+        return false;
+    }
+    target_capacity = grow_buffer ? grow_buffer->size() : dst_capacity;
+    target_stride = row_stride;
+    planar = false;
+    return runSlices();
+}
+
+bool SliceJpegDecoder::decodeToYuvPlanes(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>& storage,
+                                         YuvPlanes& planes) {
+    // Same geometry as LibjpegDecoder: full-resolution luma, one chroma sample per block
+    const JpegHeaderInfo::Component* comp = header.components;
+    if (!planSlices(jpeg_data, jpeg_size) || header.num_components != YuvPlanes::kNumPlanes ||
+        comp[0].h_samp != header.max_h_samp || comp[0].v_samp != header.max_v_samp || comp[1].h_samp != 1 ||
+        comp[1].v_samp != 1 || comp[2].h_samp != 1 || comp[2].v_samp != 1) {
+        LibjpegDecoder& decoder = workers[0]->decoder;
+        if (!decoder.decodeToYuvPlanes(jpeg_data, jpeg_size, storage, planes)) {
+            last_error = decoder.getLastError();
+            return false;
+        }
+        return true;
+    }
+
+    planes.width = header.width;
+    planes.height = header.height;
+    planes.subsample_x = header.max_h_samp;
+    planes.subsample_y = header.max_v_samp;
+    size_t total_size = 0;
+    for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+        int blocks = (header.width * comp[c].h_samp + 8 * header.max_h_samp - 1) / (8 * header.max_h_samp);
+        planes.plane_widths[c] = blocks * 8;
+        planes.plane_heights[c] = header.mcuRows() * comp[c].v_samp * 8;
+        planes.offsets[c] = total_size;
+        total_size += static_cast<size_t>(planes.plane_widths[c]) * planes.plane_heights[c];
+    }
+    if (storage.size() != total_size) {
+        storage.resize(total_size);
+    }
+
+    for (int c = 0; c < YuvPlanes::kNumPlanes; c++) {
+        plane_targets[c] = storage.data() + planes.offsets[c];
+        plane_capacity[c] = static_cast<size_t>(planes.plane_widths[c]) * planes.plane_heights[c];
+        plane_widths[c] = planes.plane_widths[c];
+    }
+    planar = true;
+    return runSlices();
+}
+
+std::unique_ptr<JpegDecoder> createSliceJpegDecoder(int threads) {
+    return std::make_unique<SliceJpegDecoder>(threads);
+}
+
+} // namespace openterface
@@ -0,0 +1,695 @@
+#include "openterface/jpeg_decoder.hpp"
+#include "openterface/jpeg_parser.hpp"
+#include "openterface/yuv_convert.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+// Linux V4L2 headers for the mem2mem JPEG decoder
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace openterface {
+
+#ifdef __linux__
+
+static constexpr uint32_t drmFourcc(char a, char b, char c, char d) {
+    return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) | (static_cast<uint32_t>(c) << 16) |
+           (static_cast<uint32_t>(d) << 24);
+}
+
+// Decoded (CAPTURE) formats we can read back or export, in order of preference
+struct CaptureFormat {
+    uint32_t v4l2_fourcc;
+    YuvLayout layout;
+    uint32_t drm_fourcc;
+    int mem_planes;  // Separate memory planes (the "M" multi-planar variants)
+};
+
+static const CaptureFormat kCaptureFormats[] = {
+    {V4L2_PIX_FMT_NV12, YuvLayout::NV12, drmFourcc('N', 'V', '1', '2'), 1},
+    {V4L2_PIX_FMT_NV12M, YuvLayout::NV12, drmFourcc('N', 'V', '1', '2'), 2},
+    {V4L2_PIX_FMT_YUYV, YuvLayout::YUYV, drmFourcc('Y', 'U', 'Y', 'V'), 1},
+    {V4L2_PIX_FMT_NV16, YuvLayout::NV16, drmFourcc('N', 'V', '1', '6'), 1},
+    {V4L2_PIX_FMT_NV16M, YuvLayout::NV16, drmFourcc('N', 'V', '1', '6'), 2},
+    {V4L2_PIX_FMT_YUV420, YuvLayout::I420, drmFourcc('Y', 'U', '1', '2'), 1},
+    {V4L2_PIX_FMT_YUV420M, YuvLayout::I420, drmFourcc('Y', 'U', '1', '2'), 3},
+    {V4L2_PIX_FMT_YUV422P, YuvLayout::I422, drmFourcc('Y', 'U', '1', '6'), 1},
+    {V4L2_PIX_FMT_GREY, YuvLayout::Gray, drmFourcc('R', '8', ' ', ' '), 1},
+};
+
+static const CaptureFormat* findCaptureFormat(uint32_t fourcc) {
+    for (const auto& format : kCaptureFormats) {
+        if (format.v4l2_fourcc == fourcc) {
+            return &format;
+        }
+    }
+    return nullptr;
+}
+
+static int xioctl(int fd, unsigned long request, void* arg) {
+    int r;
+    do {
+        r = ioctl(fd, request, arg);
+    } while (r == -1 && errno == EINTR);
+    return r;
+}
+
+// Stateful V4L2 mem2mem JPEG decoder (JPEG in on the OUTPUT queue, YUV out on CAPTURE),
+// as found on i.MX8 (mxc-jpeg), MediaTek (mtk-jpeg) and Samsung (s5p-jpeg) SoCs
+class V4l2M2mJpegDecoder : public JpegDecoder {
+public:
+    ~V4l2M2mJpegDecoder() override;
+
+    bool open(std::string& error);
+
+    DecoderBackend getBackend() const override { return DecoderBackend::V4l2M2m; }
+    bool supportsFormat(PixelFormat) const override { return true; }
+    bool decodeToDmaBuf(const uint8_t* jpeg_data, size_t jpeg_size, DmaBufFrame& frame) override;
+
+protected:
+    bool decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                     uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) override;
+
+private:
+    struct Buffer {
+        void* start[VIDEO_MAX_PLANES] = {};
+        size_t length[VIDEO_MAX_PLANES] = {};
+        int dmabuf_fd[VIDEO_MAX_PLANES] = {-1, -1, -1, -1, -1, -1, -1, -1};
+        unsigned num_planes = 0;
+        std::shared_ptr<DmaBufLease> lease;  // Owns dmabuf_fd; lent while the renderer shows the picture
+        bool dequeued = false;               // Returned by the driver and not queued back yet
+    };
+
+    // Capture buffers: the driver needs some queued while the pipeline holds decoded pictures
+    // (one queued for rendering, one on screen)
+    static constexpr unsigned kCaptureBuffers = 6;
+
+    bool probeDevice(const std::string& path);
+    bool configure(int width, int height, size_t jpeg_size);
+    bool setupCapture();
+    void releaseBuffers(std::vector<Buffer>& buffers, uint32_t type);
+    void teardown();
+    bool mapBuffers(std::vector<Buffer>& buffers, uint32_t type, unsigned count, bool export_dmabuf);
+    bool queueBuffer(uint32_t type, unsigned index, size_t bytesused);
+    bool recycleCaptures();
+    bool dequeueBuffer(uint32_t type, unsigned& index, bool& error_flag);
+    bool handleEvents();
+    bool runDecode(const uint8_t* jpeg_data, size_t jpeg_size, int& width, int& height);
+    bool ioctlError(const std::string& what);
+
+    int fd = -1;
+    std::string device_path;
+    bool mplane = false;
+    uint32_t output_type = 0;
+    uint32_t capture_type = 0;
+    uint32_t jpeg_fourcc = V4L2_PIX_FMT_JPEG;
+
+    std::vector<Buffer> output_buffers;
+    std::vector<Buffer> capture_buffers;
+    bool streaming = false;
+
+    // Negotiated geometry
+    int configured_width = 0;
+    int configured_height = 0;
+    size_t output_capacity = 0;
+    const CaptureFormat* capture_format = nullptr;
+    int capture_width = 0;   // Coded (aligned) size reported by the driver
+    int capture_height = 0;
+    uint32_t capture_bytesperline[VIDEO_MAX_PLANES] = {};
+
+    int held_capture = -1;  // Capture buffer of the latest decode
+};
+
+V4l2M2mJpegDecoder::~V4l2M2mJpegDecoder() {
+    teardown();
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+bool V4l2M2mJpegDecoder::ioctlError(const std::string& what) {
+    last_error = "V4L2 M2M " + what + " failed on " + device_path + ": " + strerror(errno);
+    return false;
+}
+
+bool V4l2M2mJpegDecoder::probeDevice(const std::string& path) {
+    int dev = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (dev < 0) {
+        return false;
+    }
+
+    struct v4l2_capability cap;
+    memset(&cap, 0, sizeof(cap));
+    if (xioctl(dev, VIDIOC_QUERYCAP, &cap) == -1) {
+        close(dev);
+        return false;
+    }
+
+    uint32_t caps = (cap.capabilities & V4L2_CAP_DEVICE_CAPS) ? cap.device_caps : cap.capabilities;
+    bool is_mplane = caps & V4L2_CAP_VIDEO_M2M_MPLANE;
+    if (!(caps & V4L2_CAP_STREAMING) || !(is_mplane || (caps & V4L2_CAP_VIDEO_M2M))) {
+        close(dev);
+        return false;
+    }
+
+    // A decoder takes JPEG on its OUTPUT (source) queue; encoders list it on CAPTURE instead
+    uint32_t type = is_mplane ? V4L2_BUF_TYPE_VIDEO_OUTPUT_MPLANE : V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    struct v4l2_fmtdesc desc;
+    memset(&desc, 0, sizeof(desc));
+    desc.type = type;
+    for (desc.index = 0; xioctl(dev, VIDIOC_ENUM_FMT, &desc) == 0; desc.index++) {
+        if (desc.pixelformat == V4L2_PIX_FMT_JPEG || desc.pixelformat == V4L2_PIX_FMT_MJPEG) {
+            fd = dev;
+            device_path = path;
+            mplane = is_mplane;
+            output_type = type;
+            capture_type = is_mplane ? V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE : V4L2_BUF_TYPE_VIDEO_CAPTURE;
+            jpeg_fourcc = desc.pixelformat;
+            return true;
+        }
+    }
+
+    close(dev);
+    return false;
+}
+
+bool V4l2M2mJpegDecoder::open(std::string& error) {
+    for (int i = 0; i < 64 && fd < 0; i++) {
+        probeDevice("/dev/video" + std::to_string(i));
+    }
+    if (fd < 0) {
+        error = "no V4L2 mem2mem device accepting JPEG input";
+        return false;
+    }
+
+    // Stateful decoders report the decoded format through a source-change event
+    struct v4l2_event_subscription sub;
+    memset(&sub, 0, sizeof(sub));
+    sub.type = V4L2_EVENT_SOURCE_CHANGE;
+    xioctl(fd, VIDIOC_SUBSCRIBE_EVENT, &sub);
+
+    std::cerr << "[VIDEO] Using V4L2 M2M JPEG decoder " << device_path << std::endl;
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::mapBuffers(std::vector<Buffer>& buffers, uint32_t type, unsigned count,
+                                    bool export_dmabuf) {
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.count = count;
+    req.type = type;
+    req.memory = V4L2_MEMORY_MMAP;
+    if (xioctl(fd, VIDIOC_REQBUFS, &req) == -1 || req.count == 0) {
+        return ioctlError("REQBUFS");
+    }
+
+    buffers.resize(req.count);
+    for (unsigned i = 0; i < req.count; i++) {
+        struct v4l2_buffer buf;
+        struct v4l2_plane planes[VIDEO_MAX_PLANES];
+        memset(&buf, 0, sizeof(buf));
+        memset(planes, 0, sizeof(planes));
+        buf.type = type;
+        buf.memory = V4L2_MEMORY_MMAP;
+        buf.index = i;
+        if (mplane) {
+            buf.m.planes = planes;
+            buf.length = VIDEO_MAX_PLANES;
+        }
+        if (xioctl(fd, VIDIOC_QUERYBUF, &buf) == -1) {
+            return ioctlError("QUERYBUF");
+        }
+
+        Buffer& buffer = buffers[i];
+        buffer.num_planes = mplane ? buf.length : 1;
+        for (unsigned p = 0; p < buffer.num_planes; p++) {
+            size_t length = mplane ? planes[p].length : buf.length;
+            off_t offset = mplane ? planes[p].m.mem_offset : buf.m.offset;
+            void* start = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+            if (start == MAP_FAILED) {
+                return ioctlError("mmap");
+            }
+            buffer.start[p] = start;
+            buffer.length[p] = length;
+
+            if (export_dmabuf) {
+                struct v4l2_exportbuffer expbuf;
+                memset(&expbuf, 0, sizeof(expbuf));
+                expbuf.type = type;
+                expbuf.index = i;
+                expbuf.plane = p;
+                expbuf.flags = O_RDONLY | O_CLOEXEC;
+                if (xioctl(fd, VIDIOC_EXPBUF, &expbuf) == 0) {
+                    buffer.dmabuf_fd[p] = expbuf.fd;
+                    if (!buffer.lease) {
+                        buffer.lease = std::make_shared<DmaBufLease>();
+                    }
+                    buffer.lease->fds.push_back(expbuf.fd);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+void V4l2M2mJpegDecoder::releaseBuffers(std::vector<Buffer>& buffers, uint32_t type) {
+    for (auto& buffer : buffers) {
+        for (unsigned p = 0; p < buffer.num_planes; p++) {
+            if (buffer.start[p]) {
+                munmap(buffer.start[p], buffer.length[p]);
+            }
+        }
+        // A picture still on screen keeps its fds open until the renderer lets go
+        buffer.lease.reset();
+    }
+    buffers.clear();
+
+    struct v4l2_requestbuffers req;
+    memset(&req, 0, sizeof(req));
+    req.type = type;
+    req.memory = V4L2_MEMORY_MMAP;
+    xioctl(fd, VIDIOC_REQBUFS, &req);
+}
+
+void V4l2M2mJpegDecoder::teardown() {
+    if (fd < 0) {
+        return;
+    }
+    if (streaming) {
+        uint32_t type = capture_type;
+        xioctl(fd, VIDIOC_STREAMOFF, &type);
+        type = output_type;
+        xioctl(fd, VIDIOC_STREAMOFF, &type);
+        streaming = false;
+    }
+    releaseBuffers(capture_buffers, capture_type);
+    releaseBuffers(output_buffers, output_type);
+    configured_width = configured_height = 0;
+    capture_format = nullptr;
+    held_capture = -1;
+}
+
+bool V4l2M2mJpegDecoder::setupCapture() {
+    // Ask for the most convenient decoded format the driver offers at this size
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = capture_type;
+    if (xioctl(fd, VIDIOC_G_FMT, &fmt) == -1) {
+        return ioctlError("G_FMT(capture)");
+    }
+
+    for (const auto& candidate : kCaptureFormats) {
+        struct v4l2_format want = fmt;
+        if (mplane) {
+            want.fmt.pix_mp.pixelformat = candidate.v4l2_fourcc;
+            want.fmt.pix_mp.width = configured_width;
+            want.fmt.pix_mp.height = configured_height;
+        } else {
+            want.fmt.pix.pixelformat = candidate.v4l2_fourcc;
+            want.fmt.pix.width = configured_width;
+            want.fmt.pix.height = configured_height;
+        }
+        if (xioctl(fd, VIDIOC_S_FMT, &want) == 0 &&
+            (mplane ? want.fmt.pix_mp.pixelformat : want.fmt.pix.pixelformat) == candidate.v4l2_fourcc) {
+            fmt = want;
+            break;
+        }
+    }
+
+    uint32_t fourcc = mplane ? fmt.fmt.pix_mp.pixelformat : fmt.fmt.pix.pixelformat;
+    capture_format = findCaptureFormat(fourcc);
+    if (!capture_format) {
+        last_error = "V4L2 M2M decoder produces an unsupported format on " + device_path;
+        return false;
+    }
+
+    capture_width = mplane ? fmt.fmt.pix_mp.width : fmt.fmt.pix.width;
+    capture_height = mplane ? fmt.fmt.pix_mp.height : fmt.fmt.pix.height;
+    memset(capture_bytesperline, 0, sizeof(capture_bytesperline));
+    if (mplane) {
+        for (unsigned p = 0; p < fmt.fmt.pix_mp.num_planes && p < VIDEO_MAX_PLANES; p++) {
+            capture_bytesperline[p] = fmt.fmt.pix_mp.plane_fmt[p].bytesperline;
+        }
+    } else {
+        capture_bytesperline[0] = fmt.fmt.pix.bytesperline;
+    }
+
+    if (!mapBuffers(capture_buffers, capture_type, kCaptureBuffers, true)) {
+        return false;
+    }
+    for (unsigned i = 0; i < capture_buffers.size(); i++) {
+        if (!queueBuffer(capture_type, i, 0)) {
+            return false;
+        }
+    }
+
+    uint32_t type = capture_type;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1) {
+        return ioctlError("STREAMON(capture)");
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::configure(int width, int height, size_t jpeg_size) {
+    teardown();
+
+    // Size OUTPUT buffers for a worst-case MJPEG frame at this resolution
+    size_t sizeimage = std::max(jpeg_size * 2, static_cast<size_t>(width) * height * 2);
+
+    struct v4l2_format fmt;
+    memset(&fmt, 0, sizeof(fmt));
+    fmt.type = output_type;
+    if (mplane) {
+        fmt.fmt.pix_mp.pixelformat = jpeg_fourcc;
+        fmt.fmt.pix_mp.width = width;
+        fmt.fmt.pix_mp.height = height;
+        fmt.fmt.pix_mp.num_planes = 1;
+        fmt.fmt.pix_mp.plane_fmt[0].sizeimage = sizeimage;
+    } else {
+        fmt.fmt.pix.pixelformat = jpeg_fourcc;
+        fmt.fmt.pix.width = width;
+        fmt.fmt.pix.height = height;
+        fmt.fmt.pix.sizeimage = sizeimage;
+    }
+    if (xioctl(fd, VIDIOC_S_FMT, &fmt) == -1) {
+        return ioctlError("S_FMT(output)");
+    }
+
+    if (!mapBuffers(output_buffers, output_type, 2, false)) {
+        return false;
+    }
+    output_capacity = output_buffers[0].length[0];
+
+    uint32_t type = output_type;
+    if (xioctl(fd, VIDIOC_STREAMON, &type) == -1) {
+        return ioctlError("STREAMON(output)");
+    }
+    streaming = true;
+
+    configured_width = width;
+    configured_height = height;
+    return setupCapture();
+}
+
+bool V4l2M2mJpegDecoder::queueBuffer(uint32_t type, unsigned index, size_t bytesused) {
+    struct v4l2_buffer buf;
+    struct v4l2_plane planes[VIDEO_MAX_PLANES];
+    memset(&buf, 0, sizeof(buf));
+    memset(planes, 0, sizeof(planes));
+    buf.type = type;
+    buf.memory = V4L2_MEMORY_MMAP;
+    buf.index = index;
+
+    std::vector<Buffer>& buffers = type == output_type ? output_buffers : capture_buffers;
+    if (mplane) {
+        buf.m.planes = planes;
+        buf.length = buffers[index].num_planes;
+        planes[0].bytesused = bytesused;
+    } else {
+        buf.bytesused = bytesused;
+    }
+
+    if (xioctl(fd, VIDIOC_QBUF, &buf) == -1) {
+        return ioctlError("QBUF");
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::dequeueBuffer(uint32_t type, unsigned& index, bool& error_flag) {
+    struct v4l2_buffer buf;
+    struct v4l2_plane planes[VIDEO_MAX_PLANES];
+    memset(&buf, 0, sizeof(buf));
+    memset(planes, 0, sizeof(planes));
+    buf.type = type;
+    buf.memory = V4L2_MEMORY_MMAP;
+    if (mplane) {
+        buf.m.planes = planes;
+        buf.length = VIDEO_MAX_PLANES;
+    }
+
+    if (xioctl(fd, VIDIOC_DQBUF, &buf) == -1) {
+        return false;
+    }
+    index = buf.index;
+    if (type == capture_type) {
+        capture_buffers[index].dequeued = true;
+    }
+    error_flag = buf.flags & V4L2_BUF_FLAG_ERROR;
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::recycleCaptures() {
+    // Give back every decoded picture nobody is holding; lent ones wait for the renderer
+    unsigned queued = 0;
+    for (unsigned i = 0; i < capture_buffers.size(); i++) {
+        Buffer& buffer = capture_buffers[i];
+        if (buffer.dequeued && (!buffer.lease || buffer.lease->available())) {
+            if (!queueBuffer(capture_type, i, 0)) {
+                return false;
+            }
+            buffer.dequeued = false;
+        }
+        queued += buffer.dequeued ? 0 : 1;
+    }
+    held_capture = -1;
+    if (queued == 0) {
+        last_error = "Every V4L2 M2M capture buffer is still held by the renderer";
+        return false;
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::handleEvents() {
+    struct v4l2_event event;
+    memset(&event, 0, sizeof(event));
+    while (xioctl(fd, VIDIOC_DQEVENT, &event) == 0) {
+        if (event.type == V4L2_EVENT_SOURCE_CHANGE &&
+            (event.u.src_change.changes & V4L2_EVENT_SRC_CH_RESOLUTION)) {
+            // Decoded geometry/format changed: rebuild the CAPTURE side only
+            uint32_t type = capture_type;
+            xioctl(fd, VIDIOC_STREAMOFF, &type);
+            releaseBuffers(capture_buffers, capture_type);
+            held_capture = -1;
+            if (!setupCapture()) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::runDecode(const uint8_t* jpeg_data, size_t jpeg_size, int& width, int& height) {
+    if (!jpeg_data || jpeg_size == 0) {
+        last_error = "Invalid JPEG data";
+        return false;
+    }
+
+    // The header is only needed for the frame size that the OUTPUT queue is configured with
+    JpegHeaderInfo header;
+    std::string parse_error;
+    if (!parseJpegHeader(jpeg_data, jpeg_size, header, parse_error)) {
+        last_error = "JPEG header: " + parse_error;
+        return false;
+    }
+    width = header.width;
+    height = header.height;
+
+    if (!streaming || width != configured_width || height != configured_height || jpeg_size > output_capacity) {
+        if (!configure(width, height, jpeg_size)) {
+            teardown();
+            return false;
+        }
+    }
+
+    if (!recycleCaptures()) {
+        return false;
+    }
+
+    // One frame in flight: OUTPUT buffer 0 carries the JPEG, CAPTURE returns the YUV picture
+    memcpy(output_buffers[0].start[0], jpeg_data, jpeg_size);
+    if (!queueBuffer(output_type, 0, jpeg_size)) {
+        return false;
+    }
+
+    bool have_output = false;
+    bool have_capture = false;
+    unsigned capture_index = 0;
+    bool capture_error = false;
+
+    while (!have_output || !have_capture) {
+        struct pollfd pfd = {fd, POLLIN | POLLOUT | POLLPRI, 0};
+        int r = poll(&pfd, 1, 1000);
+        if (r == -1 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            last_error = "V4L2 M2M decode timed out on " + device_path;
+            teardown();
+            return false;
+        }
+        if ((pfd.revents & POLLPRI) && !handleEvents()) {
+            teardown();
+            return false;
+        }
+
+        unsigned index = 0;
+        bool error_flag = false;
+        if (!have_capture && dequeueBuffer(capture_type, index, error_flag)) {
+            have_capture = true;
+            capture_index = index;
+            capture_error = error_flag;
+        }
+        if (!have_output && dequeueBuffer(output_type, index, error_flag)) {
+            have_output = true;
+        }
+    }
+
+    held_capture = static_cast<int>(capture_index);
+    if (capture_error) {
+        last_error = "V4L2 M2M decoder reported a corrupt frame";
+        return false;
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                                     uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) {
+    if (!runDecode(jpeg_data, jpeg_size, width, height)) {
+        return false;
+    }
+
+    size_t row_stride = 0;
+    uint8_t* target = prepareTarget(width, height, grow_buffer, dst, dst_capacity, dst_stride, row_stride);
+    if (!target) {
+        return false;
+    }
+
+    // Locate the planes inside the capture buffer (single allocation or one per plane)
+    const Buffer& buffer = capture_buffers[held_capture];
+    YuvImage image;
+    image.layout = capture_format->layout;
+    image.width = width;
+    image.height = height;
+
+    const uint8_t* base = static_cast<const uint8_t*>(buffer.start[0]);
+    size_t luma_stride = capture_bytesperline[0] ? capture_bytesperline[0] : static_cast<size_t>(capture_width);
+    image.planes[0] = base;
+    image.strides[0] = luma_stride;
+
+    if (capture_format->mem_planes > 1) {
+        for (int p = 1; p < capture_format->mem_planes && p < 3; p++) {
+            image.planes[p] = static_cast<const uint8_t*>(buffer.start[p]);
+            image.strides[p] = capture_bytesperline[p] ? capture_bytesperline[p] : luma_stride / 2;
+        }
+        if (image.layout == YuvLayout::NV12 || image.layout == YuvLayout::NV16) {
+            image.strides[1] = capture_bytesperline[1] ? capture_bytesperline[1] : luma_stride;
+        }
+    } else {
+        size_t luma_size = luma_stride * capture_height;
+        switch (image.layout) {
+        case YuvLayout::NV12:
+        case YuvLayout::NV16:
+            image.planes[1] = base + luma_size;
+            image.strides[1] = luma_stride;
+            break;
+        case YuvLayout::I420:
+            image.planes[1] = base + luma_size;
+            image.strides[1] = luma_stride / 2;
+            image.planes[2] = image.planes[1] + image.strides[1] * (capture_height / 2);
+            image.strides[2] = luma_stride / 2;
+            break;
+        case YuvLayout::I422:
+            image.planes[1] = base + luma_size;
+            image.strides[1] = luma_stride / 2;
+            image.planes[2] = image.planes[1] + image.strides[1] * capture_height;
+            image.strides[2] = luma_stride / 2;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (!convertYuvToPixels(image, output_format, target, row_stride)) {
+        last_error = "Failed to convert decoded V4L2 M2M frame";
+        return false;
+    }
+    return true;
+}
+
+bool V4l2M2mJpegDecoder::decodeToDmaBuf(const uint8_t* jpeg_data, size_t jpeg_size, DmaBufFrame& frame) {
+    int width = 0;
+    int height = 0;
+    if (!runDecode(jpeg_data, jpeg_size, width, height)) {
+        return false;
+    }
+
+    const Buffer& buffer = capture_buffers[held_capture];
+    if (buffer.dmabuf_fd[0] < 0) {
+        last_error = "V4L2 M2M decoder does not support VIDIOC_EXPBUF";
+        return false;
+    }
+
+    frame = DmaBufFrame();
+    frame.width = width;
+    frame.height = height;
+    frame.drm_format = capture_format->drm_fourcc;
+
+    uint32_t luma_stride = capture_bytesperline[0] ? capture_bytesperline[0] : capture_width;
+    YuvLayout layout = capture_format->layout;
+    int planes = (layout == YuvLayout::YUYV || layout == YuvLayout::Gray) ? 1
+                 : (layout == YuvLayout::NV12 || layout == YuvLayout::NV16) ? 2 : 3;
+    frame.num_planes = planes;
+
+    uint32_t offset = 0;
+    for (int p = 0; p < planes; p++) {
+        bool separate = capture_format->mem_planes > 1;
+        frame.fds[p] = separate ? buffer.dmabuf_fd[p] : buffer.dmabuf_fd[0];
+        if (frame.fds[p] < 0) {
+            last_error = "V4L2 M2M plane export failed";
+            return false;
+        }
+
+        uint32_t pitch = p == 0 ? luma_stride
+                         : (planes == 2 ? luma_stride : luma_stride / 2);
+        if (separate && capture_bytesperline[p]) {
+            pitch = capture_bytesperline[p];
+        }
+        frame.pitches[p] = pitch;
+        frame.offsets[p] = separate ? 0 : offset;
+
+        // Rows in this plane (4:2:0 chroma is half height)
+        bool half_height = p > 0 && (layout == YuvLayout::NV12 || layout == YuvLayout::I420);
+        offset += pitch * (half_height ? capture_height / 2 : capture_height);
+    }
+    frame.hold = DmaBufLease::lend(buffer.lease);
+    return true;
+}
+
+std::unique_ptr<JpegDecoder> createV4l2M2mJpegDecoder(std::string& error) {
+    auto decoder = std::make_unique<V4l2M2mJpegDecoder>();
+    if (!decoder->open(error)) {
+        return nullptr;
+    }
+    return decoder;
+}
+
+#else
+
+std::unique_ptr<JpegDecoder> createV4l2M2mJpegDecoder(std::string& error) {
+    error = "V4L2 is only available on Linux";
+    return nullptr;
+}
+
+#endif
+
+} // namespace openterface
@@ -0,0 +1,479 @@
+#include "openterface/jpeg_decoder.hpp"
+#include "openterface/jpeg_parser.hpp"
+#include "openterface/yuv_convert.hpp"
+#include <algorithm>
+#include <iostream>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#ifdef OPENTERFACE_HAVE_VAAPI
+#include <fcntl.h>
+#include <unistd.h>
+#include <va/va.h>
+#include <va/va_drm.h>
+#include <va/va_drmcommon.h>
+#endif
+
+namespace openterface {
+
+#ifdef OPENTERFACE_HAVE_VAAPI
+
+// VA-API baseline JPEG decoder (Intel iHD/i965, AMD radeonsi). The headers are parsed on the CPU
+// and handed over as picture/IQ/Huffman/slice buffers; the entropy decode and IDCT run on the GPU.
+class VaapiJpegDecoder : public JpegDecoder {
+public:
+    ~VaapiJpegDecoder() override;
+
+    bool open(std::string& error);
+
+    DecoderBackend getBackend() const override { return DecoderBackend::Vaapi; }
+    bool supportsFormat(PixelFormat) const override { return true; }
+    bool decodeToDmaBuf(const uint8_t* jpeg_data, size_t jpeg_size, DmaBufFrame& frame) override;
+
+protected:
+    bool decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                     uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) override;
+
+private:
+    bool check(VAStatus status, const char* what);
+    bool openDevice(const std::string& path);
+    bool ensureSurface(int width, int height, unsigned int rt_format);
+    void destroySurface();
+    bool pickSurface();
+    bool submit(const uint8_t* jpeg_data, size_t jpeg_size, int& width, int& height);
+
+    int drm_fd = -1;
+    std::string device_path;
+    VADisplay display = nullptr;
+    VAConfigID config = VA_INVALID_ID;
+    unsigned int supported_rt_formats = 0;
+
+    // Decode targets, recreated only when the geometry or chroma format changes. Exported surfaces
+    // stay with the renderer until it has shown them: pipeline depth (one queued, one on screen)
+    // plus the one being decoded, and a spare so a just-released surface isn't overwritten at once.
+    static constexpr int kSurfaceCount = 4;
+    VAContextID context = VA_INVALID_ID;
+    VASurfaceID surfaces[kSurfaceCount] = {VA_INVALID_SURFACE, VA_INVALID_SURFACE, VA_INVALID_SURFACE,
+                                           VA_INVALID_SURFACE};
+    int current = -1;  // Surface of the latest decode
+    int surface_width = 0;
+    int surface_height = 0;
+    unsigned int surface_rt_format = 0;
+
+    // Readback image for drivers without vaDeriveImage support
+    VAImage readback_image;
+    bool have_readback_image = false;
+
+    // DMA-BUF export of each surface, done once per surface; the lease owns the fds
+    VADRMPRIMESurfaceDescriptor primes[kSurfaceCount];
+    std::shared_ptr<DmaBufLease> leases[kSurfaceCount];
+};
+
+VaapiJpegDecoder::~VaapiJpegDecoder() {
+    destroySurface();
+    if (display) {
+        if (config != VA_INVALID_ID) {
+            vaDestroyConfig(display, config);
+        }
+        vaTerminate(display);
+    }
+    if (drm_fd >= 0) {
+        close(drm_fd);
+    }
+}
+
+bool VaapiJpegDecoder::check(VAStatus status, const char* what) {
+    if (status == VA_STATUS_SUCCESS) {
+        return true;
+    }
+    last_error = std::string("VA-API ") + what + " failed: " + vaErrorStr(status);
+    return false;
+}
+
+bool VaapiJpegDecoder::openDevice(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    VADisplay dpy = vaGetDisplayDRM(fd);
+    int major = 0, minor = 0;
+    if (!dpy || vaInitialize(dpy, &major, &minor) != VA_STATUS_SUCCESS) {
+        close(fd);
+        return false;
+    }
+
+    // The driver must expose a VLD entrypoint for baseline JPEG
+    std::vector<VAEntrypoint> entrypoints(vaMaxNumEntrypoints(dpy));
+    int num_entrypoints = 0;
+    bool has_vld = false;
+    if (vaQueryConfigEntrypoints(dpy, VAProfileJPEGBaseline, entrypoints.data(), &num_entrypoints) ==
+        VA_STATUS_SUCCESS) {
+        for (int i = 0; i < num_entrypoints; i++) {
+            has_vld |= entrypoints[i] == VAEntrypointVLD;
+        }
+    }
+
+    VAConfigAttrib attrib;
+    attrib.type = VAConfigAttribRTFormat;
+    if (!has_vld ||
+        vaGetConfigAttributes(dpy, VAProfileJPEGBaseline, VAEntrypointVLD, &attrib, 1) != VA_STATUS_SUCCESS ||
+        vaCreateConfig(dpy, VAProfileJPEGBaseline, VAEntrypointVLD, &attrib, 1, &config) != VA_STATUS_SUCCESS) {
+        vaTerminate(dpy);
+        close(fd);
+        return false;
+    }
+
+    drm_fd = fd;
+    display = dpy;
+    device_path = path;
+    supported_rt_formats = attrib.value;
+    return true;
+}
+
+bool VaapiJpegDecoder::open(std::string& error) {
+    for (int i = 128; i < 136 && !display; i++) {
+        openDevice("/dev/dri/renderD" + std::to_string(i));
+    }
+    if (!display) {
+        error = "no render node with VA-API baseline JPEG decode";
+        return false;
+    }
+
+    std::cerr << "[VIDEO] Using VA-API JPEG decoder on " << device_path << std::endl;
+    return true;
+}
+
+void VaapiJpegDecoder::destroySurface() {
+    if (!display) {
+        return;
+    }
+    // Frames still on screen keep their lease, so those fds close when the renderer lets go
+    for (auto& lease : leases) {
+        lease.reset();
+    }
+    if (have_readback_image) {
+        vaDestroyImage(display, readback_image.image_id);
+        have_readback_image = false;
+    }
+    if (context != VA_INVALID_ID) {
+        vaDestroyContext(display, context);
+        context = VA_INVALID_ID;
+    }
+    if (surfaces[0] != VA_INVALID_SURFACE) {
+        vaDestroySurfaces(display, surfaces, kSurfaceCount);
+        std::fill(std::begin(surfaces), std::end(surfaces), VA_INVALID_SURFACE);
+    }
+    current = -1;
+    surface_width = surface_height = 0;
+}
+
+bool VaapiJpegDecoder::ensureSurface(int width, int height, unsigned int rt_format) {
+    if (surfaces[0] != VA_INVALID_SURFACE && width == surface_width && height == surface_height &&
+        rt_format == surface_rt_format) {
+        return true;
+    }
+
+    destroySurface();
+    if (!check(vaCreateSurfaces(display, rt_format, width, height, surfaces, kSurfaceCount, nullptr, 0),
+               "vaCreateSurfaces")) {
+        std::fill(std::begin(surfaces), std::end(surfaces), VA_INVALID_SURFACE);
+        return false;
+    }
+    if (!check(vaCreateContext(display, config, width, height, VA_PROGRESSIVE, surfaces, kSurfaceCount, &context),
+               "vaCreateContext")) {
+        context = VA_INVALID_ID;
+        return false;
+    }
+
+    surface_width = width;
+    surface_height = height;
+    surface_rt_format = rt_format;
+    return true;
+}
+
+bool VaapiJpegDecoder::pickSurface() {
+    // Round-robin over the surfaces the renderer isn't holding, so the one it released last is
+    // rewritten as late as possible
+    for (int i = 1; i <= kSurfaceCount; i++) {
+        int index = (current + i) % kSurfaceCount;
+        if (!leases[index] || leases[index]->available()) {
+            current = index;
+            return true;
+        }
+    }
+    last_error = "Every VA-API surface is still held by the renderer";
+    return false;
+}
+
+bool VaapiJpegDecoder::submit(const uint8_t* jpeg_data, size_t jpeg_size, int& width, int& height) {
+    if (!jpeg_data || jpeg_size == 0) {
+        last_error = "Invalid JPEG data";
+        return false;
+    }
+
+    JpegHeaderInfo header;
+    std::string parse_error;
+    if (!parseJpegHeader(jpeg_data, jpeg_size, header, parse_error)) {
+        last_error = "JPEG header: " + parse_error;
+        return false;
+    }
+    if (!header.baseline || header.scan_num_components != header.num_components) {
+        last_error = "VA-API decodes only single-scan baseline JPEG";
+        return false;
+    }
+    width = header.width;
+    height = header.height;
+
+    // Chroma format follows the luma sampling factors (chroma components are 1x1 in MJPEG)
+    unsigned int rt_format = 0;
+    if (header.num_components == 1) {
+        rt_format = VA_RT_FORMAT_YUV400;
+    } else if (header.components[0].h_samp == 2 && header.components[0].v_samp == 2) {
+        rt_format = VA_RT_FORMAT_YUV420;
+    } else if (header.components[0].h_samp == 2 && header.components[0].v_samp == 1) {
+        rt_format = VA_RT_FORMAT_YUV422;
+    } else if (header.components[0].h_samp == 1 && header.components[0].v_samp == 1) {
+        rt_format = VA_RT_FORMAT_YUV444;
+    }
+    if (!(rt_format & supported_rt_formats)) {
+        last_error = "JPEG chroma subsampling not supported by the VA-API driver";
+        return false;
+    }
+
+    if (!ensureSurface(width, height, rt_format) || !pickSurface()) {
+        return false;
+    }
+    VASurfaceID surface = surfaces[current];
+
+    VAPictureParameterBufferJPEGBaseline picture;
+    memset(&picture, 0, sizeof(picture));
+    picture.picture_width = width;
+    picture.picture_height = height;
+    picture.num_components = header.num_components;
+    for (int c = 0; c < header.num_components; c++) {
+        picture.components[c].component_id = header.components[c].id;
+        picture.components[c].h_sampling_factor = header.components[c].h_samp;
+        picture.components[c].v_sampling_factor = header.components[c].v_samp;
+        picture.components[c].quantiser_table_selector = header.components[c].quant_table;
+    }
+
+    // Quantiser tables stay in zig-zag order, as VA-API expects
+    VAIQMatrixBufferJPEGBaseline iq;
+    memset(&iq, 0, sizeof(iq));
+    for (int t = 0; t < JpegHeaderInfo::kMaxTables; t++) {
+        if (header.quant_present[t]) {
+            iq.load_quantiser_table[t] = 1;
+            memcpy(iq.quantiser_table[t], header.quant_tables[t], 64);
+        }
+    }
+
+    VAHuffmanTableBufferJPEGBaseline huffman;
+    memset(&huffman, 0, sizeof(huffman));
+    for (int t = 0; t < 2; t++) {
+        huffman.load_huffman_table[t] = 1;
+        memcpy(huffman.huffman_table[t].num_dc_codes, header.dc_tables[t].bits, 16);
+        memcpy(huffman.huffman_table[t].dc_values, header.dc_tables[t].values, header.dc_tables[t].num_values);
+        memcpy(huffman.huffman_table[t].num_ac_codes, header.ac_tables[t].bits, 16);
+        memcpy(huffman.huffman_table[t].ac_values, header.ac_tables[t].values, header.ac_tables[t].num_values);
+    }
+
+    VASliceParameterBufferJPEGBaseline slice;
+    memset(&slice, 0, sizeof(slice));
+    slice.slice_data_size = header.scan_size;
+    slice.slice_data_offset = 0;
+    slice.slice_data_flag = VA_SLICE_DATA_FLAG_ALL;
+    slice.num_components = header.scan_num_components;
+    for (int c = 0; c < header.scan_num_components; c++) {
+        slice.components[c].component_selector = header.scan_components[c].id;
+        slice.components[c].dc_table_selector = header.scan_components[c].dc_table;
+        slice.components[c].ac_table_selector = header.scan_components[c].ac_table;
+    }
+    slice.restart_interval = header.restart_interval;
+    slice.num_mcus = header.mcusPerRow() * header.mcuRows();
+
+    struct {
+        VABufferType type;
+        unsigned int size;
+        void* data;
+    } params[] = {
+        {VAPictureParameterBufferType, sizeof(picture), &picture},
+        {VAIQMatrixBufferType, sizeof(iq), &iq},
+        {VAHuffmanTableBufferType, sizeof(huffman), &huffman},
+        {VASliceParameterBufferType, sizeof(slice), &slice},
+        {VASliceDataBufferType, static_cast<unsigned int>(header.scan_size),
+         const_cast<uint8_t*>(jpeg_data + header.scan_offset)},
+    };
+
+    VABufferID buffers[5];
+    int num_buffers = 0;
+    bool ok = true;
+    for (const auto& param : params) {
+        if (!check(vaCreateBuffer(display, context, param.type, param.size, 1, param.data, &buffers[num_buffers]),
+                   "vaCreateBuffer")) {
+            ok = false;
+            break;
+        }
+        num_buffers++;
+    }
+
+    ok = ok && check(vaBeginPicture(display, context, surface), "vaBeginPicture") &&
+         check(vaRenderPicture(display, context, buffers, num_buffers), "vaRenderPicture") &&
+         check(vaEndPicture(display, context), "vaEndPicture");
+
+    for (int i = 0; i < num_buffers; i++) {
+        vaDestroyBuffer(display, buffers[i]);
+    }
+
+    return ok && check(vaSyncSurface(display, surface), "vaSyncSurface");
+}
+
+bool VaapiJpegDecoder::decodeFrame(const uint8_t* jpeg_data, size_t jpeg_size, std::vector<uint8_t>* grow_buffer,
+                                   uint8_t* dst, size_t dst_capacity, size_t dst_stride, int& width, int& height) {
+    if (!submit(jpeg_data, jpeg_size, width, height)) {
+        return false;
+    }
+
+    size_t row_stride = 0;
+    uint8_t* target = prepareTarget(width, height, grow_buffer, dst, dst_capacity, dst_stride, row_stride);
+    if (!target) {
+        return false;
+    }
+
+    // Map the surface directly when the driver allows it, otherwise copy into an NV12 image
+    VASurfaceID surface = surfaces[current];
+    VAImage derived;
+    bool is_derived = vaDeriveImage(display, surface, &derived) == VA_STATUS_SUCCESS;
+    if (!is_derived && !have_readback_image) {
+        VAImageFormat nv12;
+        memset(&nv12, 0, sizeof(nv12));
+        nv12.fourcc = VA_FOURCC_NV12;
+        nv12.bits_per_pixel = 12;
+        if (!check(vaCreateImage(display, &nv12, width, height, &readback_image), "vaCreateImage")) {
+            return false;
+        }
+        have_readback_image = true;
+    }
+    if (!is_derived && !check(vaGetImage(display, surface, 0, 0, width, height, readback_image.image_id),
+                              "vaGetImage")) {
+        return false;
+    }
+    const VAImage& image = is_derived ? derived : readback_image;
+
+    void* mapped = nullptr;
+    if (!check(vaMapBuffer(display, image.buf, &mapped), "vaMapBuffer")) {
+        if (is_derived) {
+            vaDestroyImage(display, derived.image_id);
+        }
+        return false;
+    }
+
+    const uint8_t* base = static_cast<const uint8_t*>(mapped);
+    YuvImage yuv;
+    yuv.width = width;
+    yuv.height = height;
+    for (uint32_t p = 0; p < image.num_planes && p < 3; p++) {
+        yuv.planes[p] = base + image.offsets[p];
+        yuv.strides[p] = image.pitches[p];
+    }
+
+    bool known = true;
+    switch (image.format.fourcc) {
+    case VA_FOURCC_NV12:
+        yuv.layout = YuvLayout::NV12;
+        break;
+    case VA_FOURCC_I420:
+    case VA_FOURCC_IMC3:
+        yuv.layout = YuvLayout::I420;
+        break;
+    case VA_FOURCC_YV12:
+        yuv.layout = YuvLayout::I420;
+        std::swap(yuv.planes[1], yuv.planes[2]);
+        std::swap(yuv.strides[1], yuv.strides[2]);
+        break;
+    case VA_FOURCC_422H:
+        yuv.layout = YuvLayout::I422;
+        break;
+    case VA_FOURCC_444P:
+        yuv.layout = YuvLayout::I444;
+        break;
+    case VA_FOURCC_YUY2:
+        yuv.layout = YuvLayout::YUYV;
+        break;
+    case VA_FOURCC_Y800:
+        yuv.layout = YuvLayout::Gray;
+        break;
+    default:
+        known = false;
+        break;
+    }
+
+    bool ok = known && convertYuvToPixels(yuv, output_format, target, row_stride);
+    if (!ok) {
+        last_error = known ? "Failed to convert VA-API surface" : "Unsupported VA-API image format";
+    }
+
+    vaUnmapBuffer(display, image.buf);
+    if (is_derived) {
+        vaDestroyImage(display, derived.image_id);
+    }
+    return ok;
+}
+
+bool VaapiJpegDecoder::decodeToDmaBuf(const uint8_t* jpeg_data, size_t jpeg_size, DmaBufFrame& frame) {
+    int width = 0;
+    int height = 0;
+    if (!submit(jpeg_data, jpeg_size, width, height)) {
+        return false;
+    }
+
+    // Surfaces are reused round-robin, so each export stays valid until the geometry changes
+    const VADRMPRIMESurfaceDescriptor& prime = primes[current];
+    std::shared_ptr<DmaBufLease>& lease = leases[current];
+    if (!lease) {
+        if (!check(vaExportSurfaceHandle(display, surfaces[current], VA_SURFACE_ATTRIB_MEM_TYPE_DRM_PRIME_2,
+                                         VA_EXPORT_SURFACE_READ_ONLY | VA_EXPORT_SURFACE_COMPOSED_LAYERS,
+                                         &primes[current]),
+                   "vaExportSurfaceHandle")) {
+            return false;
+        }
+        lease = std::make_shared<DmaBufLease>();
+        for (uint32_t i = 0; i < prime.num_objects; i++) {
+            lease->fds.push_back(prime.objects[i].fd);
+        }
+    }
+
+    frame = DmaBufFrame();
+    frame.width = width;
+    frame.height = height;
+    frame.drm_format = prime.layers[0].drm_format;
+    frame.modifier = prime.objects[0].drm_format_modifier;
+    frame.num_planes = std::min<int>(prime.layers[0].num_planes, DmaBufFrame::kMaxPlanes);
+    for (int p = 0; p < frame.num_planes; p++) {
+        frame.fds[p] = prime.objects[prime.layers[0].object_index[p]].fd;
+        frame.offsets[p] = prime.layers[0].offset[p];
+        frame.pitches[p] = prime.layers[0].pitch[p];
+    }
+    frame.hold = DmaBufLease::lend(lease);
+    return true;
+}
+
+std::unique_ptr<JpegDecoder> createVaapiJpegDecoder(std::string& error) {
+    auto decoder = std::make_unique<VaapiJpegDecoder>();
+    if (!decoder->open(error)) {
+        return nullptr;
+    }
+    return decoder;
+}
+
+#else
+
+std::unique_ptr<JpegDecoder> createVaapiJpegDecoder(std::string& error) {
+    error = "built without VA-API support (libva/libva-drm not found)";
+    return nullptr;
+}
+
+#endif
+
+} // namespace openterface
@@ -0,0 +1,325 @@
+#include "openterface/jpeg_parser.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace openterface {
+
+// Standard Huffman tables from ITU-T T.81 Annex K.3 (used by MJPEG streams that omit DHT)
+static const uint8_t kDcLumaBits[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+static const uint8_t kDcChromaBits[16] = {0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0};
+static const uint8_t kDcValues[12] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+
+static const uint8_t kAcLumaBits[16] = {0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d};
+static const uint8_t kAcLumaValues[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+static const uint8_t kAcChromaBits[16] = {0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77};
+static const uint8_t kAcChromaValues[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa};
+
+static void setHuffmanTable(JpegHeaderInfo::HuffmanTable& table, const uint8_t* bits, const uint8_t* values,
+                            int num_values) {
+    table.present = true;
+    memcpy(table.bits, bits, sizeof(table.bits));
+    memcpy(table.values, values, num_values);
+    table.num_values = num_values;
+}
+
+static uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+// Find the EOI that terminates the entropy-coded scan starting at `pos`. Inside the scan 0xFF is
+// only followed by 0x00 (stuffing), RSTn or fill bytes, so the first other marker ends it.
+static size_t findScanEnd(const uint8_t* data, size_t size, size_t pos) {
+    while (pos + 1 < size) {
+        const uint8_t* ff = static_cast<const uint8_t*>(memchr(data + pos, 0xFF, size - pos - 1));
+        if (!ff) {
+            break;
+        }
+        pos = static_cast<size_t>(ff - data);
+        uint8_t next = data[pos + 1];
+        if (next != 0x00 && next != 0xFF && (next < 0xD0 || next > 0xD7)) {
+            return pos;
+        }
+        pos += (next == 0xFF) ? 1 : 2;
+    }
+    return size;
+}
+
+bool parseJpegHeader(const uint8_t* data, size_t size, JpegHeaderInfo& info, std::string& error) {
+    info = JpegHeaderInfo();
+
+    if (!data || size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        error = "Not a JPEG (missing SOI)";
+        return false;
+    }
+
+    bool have_frame = false;
+    size_t pos = 2;
+
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            error = "Corrupt JPEG marker at offset " + std::to_string(pos);
+            return false;
+        }
+
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {  // Fill byte
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {  // Standalone markers
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9) {
+            error = "JPEG ends before the first scan";
+            return false;
+        }
+
+        size_t length = readU16(data + pos + 2);
+        if (length < 2 || pos + 2 + length > size) {
+            error = "Truncated JPEG segment";
+            return false;
+        }
+        const uint8_t* seg = data + pos + 4;
+        size_t seg_len = length - 2;
+
+        switch (marker) {
+        case 0xDB: {  // DQT
+            size_t i = 0;
+            while (i < seg_len) {
+                int precision = seg[i] >> 4;
+                int id = seg[i] & 0x0F;
+                if (precision != 0) {
+                    error = "16-bit quantisation tables are not supported";
+                    return false;
+                }
+                if (id >= JpegHeaderInfo::kMaxTables || i + 65 > seg_len) {
+                    error = "Invalid DQT segment";
+                    return false;
+                }
+                memcpy(info.quant_tables[id], seg + i + 1, 64);
+                info.quant_present[id] = true;
+                i += 65;
+            }
+            break;
+        }
+        case 0xC4: {  // DHT
+            size_t i = 0;
+            while (i < seg_len) {
+                if (i + 17 > seg_len) {
+                    error = "Invalid DHT segment";
+                    return false;
+                }
+                int table_class = seg[i] >> 4;
+                int id = seg[i] & 0x0F;
+                int count = 0;
+                for (int b = 0; b < 16; b++) {
+                    count += seg[i + 1 + b];
+                }
+                int max_values = table_class == 0 ? 12 : 162;
+                if (table_class > 1 || id >= JpegHeaderInfo::kMaxTables || count > max_values ||
+                    i + 17 + count > seg_len) {
+                    error = "Invalid DHT segment";
+                    return false;
+                }
+                auto& table = table_class == 0 ? info.dc_tables[id] : info.ac_tables[id];
+                setHuffmanTable(table, seg + i + 1, seg + i + 17, count);
+                i += 17 + count;
+            }
+            break;
+        }
+        case 0xC0:
+        case 0xC1:
+        case 0xC2:
+        case 0xC3:
+        case 0xC5:
+        case 0xC6:
+        case 0xC7:
+        case 0xC9:
+        case 0xCA:
+        case 0xCB:
+        case 0xCD:
+        case 0xCE:
+        case 0xCF: {  // SOFn
+            if (seg_len < 6) {
+                error = "Invalid SOF segment";
+                return false;
+            }
+            info.sof_offset = pos;
+            info.baseline = (marker == 0xC0 || marker == 0xC1) && seg[0] == 8;
+            info.height = readU16(seg + 1);
+            info.width = readU16(seg + 3);
+            info.num_components = seg[5];
+            if (info.num_components < 1 || info.num_components > JpegHeaderInfo::kMaxComponents ||
+                seg_len < 6 + 3 * static_cast<size_t>(info.num_components)) {
+                error = "Unsupported JPEG component count: " + std::to_string(info.num_components);
+                return false;
+            }
+            for (int c = 0; c < info.num_components; c++) {
+                auto& comp = info.components[c];
+                comp.id = seg[6 + 3 * c];
+                comp.h_samp = seg[7 + 3 * c] >> 4;
+                comp.v_samp = seg[7 + 3 * c] & 0x0F;
+                comp.quant_table = seg[8 + 3 * c];
+                if (comp.h_samp < 1 || comp.h_samp > 4 || comp.v_samp < 1 || comp.v_samp > 4 ||
+                    comp.quant_table >= JpegHeaderInfo::kMaxTables) {
+                    error = "Invalid JPEG component parameters";
+                    return false;
+                }
+                info.max_h_samp = std::max<int>(info.max_h_samp, comp.h_samp);
+                info.max_v_samp = std::max<int>(info.max_v_samp, comp.v_samp);
+            }
+            have_frame = true;
+            break;
+        }
+        case 0xDD:  // DRI
+            if (seg_len < 2) {
+                error = "Invalid DRI segment";
+                return false;
+            }
+            info.restart_interval = readU16(seg);
+            break;
+        case 0xDA: {  // SOS
+            if (!have_frame) {
+                error = "JPEG scan before frame header";
+                return false;
+            }
+            int ns = seg_len > 0 ? seg[0] : 0;
+            if (ns < 1 || ns > JpegHeaderInfo::kMaxComponents || seg_len < 4 + 2 * static_cast<size_t>(ns)) {
+                error = "Invalid SOS segment";
+                return false;
+            }
+            info.scan_num_components = ns;
+            for (int c = 0; c < ns; c++) {
+                info.scan_components[c].id = seg[1 + 2 * c];
+                info.scan_components[c].dc_table = seg[2 + 2 * c] >> 4;
+                info.scan_components[c].ac_table = seg[2 + 2 * c] & 0x0F;
+            }
+
+            info.scan_offset = pos + 2 + length;
+            info.scan_size = findScanEnd(data, size, info.scan_offset) - info.scan_offset;
+
+            if (info.width <= 0 || info.height <= 0) {
+                error = "Invalid JPEG dimensions: " + std::to_string(info.width) + "x" + std::to_string(info.height);
+                return false;
+            }
+
+            // MJPEG commonly leaves out DHT and relies on the standard tables
+            if (!info.dc_tables[0].present) setHuffmanTable(info.dc_tables[0], kDcLumaBits, kDcValues, 12);
+            if (!info.dc_tables[1].present) setHuffmanTable(info.dc_tables[1], kDcChromaBits, kDcValues, 12);
+            if (!info.ac_tables[0].present) setHuffmanTable(info.ac_tables[0], kAcLumaBits, kAcLumaValues, 162);
+            if (!info.ac_tables[1].present) setHuffmanTable(info.ac_tables[1], kAcChromaBits, kAcChromaValues, 162);
+            return true;
+        }
+        default:  // APPn, COM and anything else we don't need
+            break;
+        }
+
+        pos += 2 + length;
+    }
+
+    error = "JPEG has no scan";
+    return false;
+}
+
+void findRestartMarkers(const uint8_t* data, const JpegHeaderInfo& info, std::vector<size_t>& positions) {
+    positions.clear();
+    size_t pos = info.scan_offset;
+    size_t end = info.scan_offset + info.scan_size;
+    while (pos + 1 < end) {
+        const uint8_t* ff = static_cast<const uint8_t*>(memchr(data + pos, 0xFF, end - pos - 1));
+        if (!ff) {
+            break;
+        }
+        pos = static_cast<size_t>(ff - data);
+        uint8_t next = data[pos + 1];
+        if (next >= 0xD0 && next <= 0xD7) {
+            positions.push_back(pos);
+        }
+        pos += (next == 0xFF) ? 1 : 2;
+    }
+}
+
+size_t findMissingHuffmanTables(const uint8_t* data, size_t size) {
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8) {
+        return 0;
+    }
+
+    size_t pos = 2;
+    while (pos + 4 <= size) {
+        if (data[pos] != 0xFF) {
+            return 0;
+        }
+        uint8_t marker = data[pos + 1];
+        if (marker == 0xFF) {  // Fill byte
+            pos++;
+            continue;
+        }
+        if (marker == 0xC4) {
+            return 0;
+        }
+        if (marker == 0xDA) {
+            return pos;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {  // No length field
+            pos += 2;
+            continue;
+        }
+        pos += 2 + readU16(data + pos + 2);
+    }
+    return 0;
+}
+
+const std::vector<uint8_t>& standardHuffmanSegment() {
+    static const std::vector<uint8_t> segment = [] {
+        struct Table {
+            uint8_t class_id;  // Class (0 = DC, 1 = AC) << 4 | table id
+            const uint8_t* bits;
+            const uint8_t* values;
+            size_t num_values;
+        };
+        const Table tables[] = {
+            {0x00, kDcLumaBits, kDcValues, 12},
+            {0x10, kAcLumaBits, kAcLumaValues, 162},
+            {0x01, kDcChromaBits, kDcValues, 12},
+            {0x11, kAcChromaBits, kAcChromaValues, 162},
+        };
+
+        std::vector<uint8_t> dht = {0xFF, 0xC4, 0, 0};
+        for (const auto& table : tables) {
+            dht.push_back(table.class_id);
+            dht.insert(dht.end(), table.bits, table.bits + 16);
+            dht.insert(dht.end(), table.values, table.values + table.num_values);
+        }
+        size_t length = dht.size() - 2;
+        dht[2] = static_cast<uint8_t>(length >> 8);
+        dht[3] = static_cast<uint8_t>(length & 0xFF);
+        return dht;
+    }();
+    return segment;
+}
+
+} // namespace openterface
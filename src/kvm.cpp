@@ -1,12 +1,10 @@
 #include "openterface/kvm.hpp"
+#include "openterface/device_discovery.hpp"
 #include "openterface/gui.hpp"
 #include "openterface/input.hpp"
 #include "openterface/serial.hpp"
 #include "openterface/video.hpp"
-#include <filesystem>
-#include <fstream>
 #include <iostream>
-#include <regex>
 
 namespace openterface {
 
@@ -19,19 +17,11 @@ namespace openterface {
 
         KVMDeviceInfo device_info;
         bool kvm_session_active = false;
+        std::string window_title = "Openterface KVM";
+        int window_width = 1920;
+        int window_height = 1080;
 
         void log(const std::string &msg) { std::cout << "[KVM] " << msg << std::endl; }
-
-        // Check if a device is an Openterface device by vendor/product ID
-        bool isOpenterfaceDevice(const std::string &vid, const std::string &pid) {
-            // Openterface Mini KVM USB identifiers
-            // Note: These would need to be verified with actual hardware
-            return (vid == "6666" && pid == "6666") || // Example IDs
-                   (vid == "534d" && pid == "2109");   // Another possible set
-        }
-
-        std::vector<KVMDevice> scanUSBDevices();
-        std::string readFileContent(const std::string &path);
     };
 
     KVMManager::KVMManager() : pImpl(std::make_unique<Impl>()) {
@@ -49,15 +39,17 @@ namespace openterface {
 
     KVMManager::~KVMManager() { disconnect(); }
 
-    std::vector<KVMDevice> KVMManager::scanForDevices() {
-        pImpl->log("Scanning for Openterface devices...");
-        return pImpl->scanUSBDevices();
+    std::vector<KVMDevice> KVMManager::scanForDevices(bool refresh) {
+        auto devices = DeviceDiscovery::shared().getDevices(refresh);
+        for (const auto &device : devices) {
+            pImpl->log("Found " + device.description + " at " + device.device_id);
+        }
+        return devices;
     }
 
     bool KVMManager::isOpenterfaceDevice(const std::string &device_path) {
-        // This would check device attributes to identify Openterface devices
-        pImpl->log("Checking if " + device_path + " is an Openterface device");
-        return true; // Placeholder implementation
+        KVMDevice device;
+        return DeviceDiscovery::shared().findByPath(device_path, device);
     }
 
     bool KVMManager::connect(const std::string &device_id) {
@@ -70,9 +62,14 @@ namespace openterface {
                 return false;
             }
 
-            // Use the first device found
-            const auto &device = devices[0];
-            return connectByPaths(device.serial_path, device.video_path);
+            // Use the first unit with both functions present
+            for (const auto &device : devices) {
+                if (!device.serial_path.empty() && !device.video_path.empty()) {
+                    return connectByPaths(device.serial_path, device.video_path);
+                }
+            }
+            pImpl->log("No Openterface device has both its video and serial node");
+            return false;
         } else {
             // Connect by specific device ID
             auto devices = scanForDevices();
@@ -91,11 +88,12 @@ namespace openterface {
         pImpl->log("  Serial: " + serial_path);
         pImpl->log("  Video: " + video_path);
 
-        // Connect serial (for keyboard/mouse control)
-        if (!pImpl->serial->connect(serial_path, 115200)) {
+        // Connect serial (for keyboard/mouse control), at the rate the chip answered at last time
+        if (!pImpl->serial->connect(serial_path, DeviceDiscovery::baudRateHint(serial_path))) {
             pImpl->log("Failed to connect to serial device");
             return false;
         }
+        DeviceDiscovery::rememberBaudRate(serial_path, pImpl->serial->getInfo().baudrate);
 
         // Connect video (for capture)
         if (!pImpl->video->connect(video_path)) {
@@ -110,6 +108,8 @@ namespace openterface {
             // This is not fatal - we can still do manual input via CLI
         }
 
+        KVMDevice device;
+        pImpl->device_info.device_id = DeviceDiscovery::shared().findByPath(serial_path, device) ? device.device_id : "";
         pImpl->device_info.serial_path = serial_path;
         pImpl->device_info.video_path = video_path;
         pImpl->device_info.connected = true;
@@ -143,6 +143,27 @@ namespace openterface {
         pImpl->log("KVM device disconnected");
     }
 
+    bool KVMManager::reconnect(int timeout_ms) {
+        std::string device_id = pImpl->device_info.device_id;
+        if (device_id.empty()) {
+            pImpl->log("No discovered device to reconnect to");
+            return false;
+        }
+
+        bool restart_session = pImpl->kvm_session_active;
+        disconnect();
+
+        KVMDevice device;
+        if (!DeviceDiscovery::shared().waitForDevice(device_id, timeout_ms, device)) {
+            pImpl->log("Device " + device_id + " did not come back");
+            return false;
+        }
+        if (!connectByPaths(device.serial_path, device.video_path)) {
+            return false;
+        }
+        return !restart_session || startKVMSession();
+    }
+
     bool KVMManager::isConnected() const { return pImpl->device_info.connected; }
 
     std::shared_ptr<Serial> KVMManager::getSerial() const { return pImpl->serial; }
@@ -210,7 +231,7 @@ namespace openterface {
             return false;
         }
 
-        if (!pImpl->gui->createWindow("Openterface KVM", 1920, 1080)) {
+        if (!pImpl->gui->createWindow(pImpl->window_title, pImpl->window_width, pImpl->window_height)) {
             pImpl->log("Failed to create GUI window");
             return false;
         }
@@ -285,89 +306,29 @@ namespace openterface {
 
     bool KVMManager::isKVMSessionActive() const { return pImpl->kvm_session_active; }
 
-    KVMDeviceInfo KVMManager::getDeviceInfo() const { return pImpl->device_info; }
-
-    std::string KVMManager::getDeviceDescription() const { return pImpl->device_info.description; }
-
-    // Implementation of USB device scanning
-    std::vector<KVMDevice> KVMManager::Impl::scanUSBDevices() {
-        std::vector<KVMDevice> devices;
-
-        try {
-            // Scan /sys/bus/usb/devices for USB devices
-            const std::string usb_devices_path = "/sys/bus/usb/devices";
-
-            if (!std::filesystem::exists(usb_devices_path)) {
-                log("USB devices path not found: " + usb_devices_path);
-                return devices;
-            }
+    void KVMManager::setSharedResources(std::shared_ptr<DecodePool> pool, std::shared_ptr<WaylandConnection> connection) {
+        pImpl->gui->setDecodePool(pool);
+        pImpl->gui->setWaylandConnection(connection);
+    }
 
-            for (const auto &entry : std::filesystem::directory_iterator(usb_devices_path)) {
-                if (!entry.is_directory())
-                    continue;
-
-                std::string device_path = entry.path().string();
-                std::string vendor_id = readFileContent(device_path + "/idVendor");
-                std::string product_id = readFileContent(device_path + "/idProduct");
-
-                if (vendor_id.empty() || product_id.empty())
-                    continue;
-
-                // Check if this is an Openterface device
-                if (isOpenterfaceDevice(vendor_id, product_id)) {
-                    KVMDevice device;
-                    device.device_id = std::filesystem::path(device_path).filename();
-                    device.vendor_id = vendor_id;
-                    device.product_id = product_id;
-                    device.serial_number = readFileContent(device_path + "/serial");
-                    device.description = "Openterface Mini KVM (" + vendor_id + ":" + product_id + ")";
-
-                    // Try to find corresponding /dev entries
-                    // This is simplified - real implementation would need better device mapping
-                    device.serial_path = "/dev/ttyUSB0"; // First guess
-                    device.video_path = "/dev/video0";   // First guess
-
-                    devices.push_back(device);
-                    log("Found Openterface device: " + device.description);
-                }
-            }
-        } catch (const std::exception &e) {
-            log("Error scanning USB devices: " + std::string(e.what()));
-        }
+    void KVMManager::setWindow(const std::string &title, int width, int height) {
+        pImpl->window_title = title;
+        pImpl->window_width = width;
+        pImpl->window_height = height;
+    }
 
-        // Fallback: Add a default device for testing
-        if (devices.empty()) {
-            KVMDevice device;
-            device.device_id = "default";
-            device.vendor_id = "unknown";
-            device.product_id = "unknown";
-            device.serial_path = "/dev/ttyUSB0";
-            device.video_path = "/dev/video0";
-            device.description = "Default Openterface Device";
-            devices.push_back(device);
-            log("No devices found, using default configuration");
+    int KVMManager::runEventLoop() {
+        if (!pImpl->device_info.gui_active) {
+            pImpl->log("GUI not started");
+            return 1;
         }
-
-        return devices;
+        return pImpl->gui->runEventLoop();
     }
 
-    std::string KVMManager::Impl::readFileContent(const std::string &path) {
-        try {
-            std::ifstream file(path);
-            if (!file.is_open())
-                return "";
+    void KVMManager::requestExit() { pImpl->gui->requestExit(); }
 
-            std::string content;
-            std::getline(file, content);
-
-            // Remove whitespace
-            content.erase(0, content.find_first_not_of(" \t\n\r"));
-            content.erase(content.find_last_not_of(" \t\n\r") + 1);
+    KVMDeviceInfo KVMManager::getDeviceInfo() const { return pImpl->device_info; }
 
-            return content;
-        } catch (...) {
-            return "";
-        }
-    }
+    std::string KVMManager::getDeviceDescription() const { return pImpl->device_info.description; }
 
 } // namespace openterface
@@ -0,0 +1,410 @@
+#include "openterface/pixel_scale.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define OPENTERFACE_PIXEL_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define OPENTERFACE_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace openterface {
+
+// Row kernels. Every implementation produces bit-identical output:
+//   rgb24/rgbx -> XRGB8888 is a byte shuffle with X forced to 0xFF
+//   blend = (a * (128 - w) + b * w + 64) >> 7 per byte, w in 0..128
+struct PixelKernels {
+    const char* name;
+    void (*rgb24_to_xrgb)(const uint8_t* src, uint32_t* dst, int width);
+    void (*rgbx_to_xrgb)(const uint8_t* src, uint32_t* dst, int width);
+    void (*blend_rows)(const uint32_t* a, const uint32_t* b, uint32_t* dst, int width, int weight);
+};
+
+static inline uint32_t packXrgb(uint8_t r, uint8_t g, uint8_t b) {
+    return 0xFF000000u | (static_cast<uint32_t>(r) << 16) | (static_cast<uint32_t>(g) << 8) | b;
+}
+
+static void rgb24ToXrgbScalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 3) {
+        dst[x] = packXrgb(src[0], src[1], src[2]);
+    }
+}
+
+static void rgbxToXrgbScalar(const uint8_t* src, uint32_t* dst, int width) {
+    for (int x = 0; x < width; x++, src += 4) {
+        dst[x] = packXrgb(src[0], src[1], src[2]);
+    }
+}
+
+static void blendRowsScalar(const uint32_t* a, const uint32_t* b, uint32_t* dst, int width, int weight) {
+    const uint8_t* pa = reinterpret_cast<const uint8_t*>(a);
+    const uint8_t* pb = reinterpret_cast<const uint8_t*>(b);
+    uint8_t* out = reinterpret_cast<uint8_t*>(dst);
+    const int inverse = 128 - weight;
+    for (int i = 0; i < width * 4; i++) {
+        out[i] = static_cast<uint8_t>((pa[i] * inverse + pb[i] * weight + 64) >> 7);
+    }
+}
+
+static const PixelKernels kScalarKernels = {"scalar", rgb24ToXrgbScalar, rgbxToXrgbScalar, blendRowsScalar};
+
+#ifdef OPENTERFACE_PIXEL_X86
+
+// Byte order within each 16-byte lane: BGR + zero for four pixels
+#define OPENTERFACE_RGB24_SHUFFLE 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1
+#define OPENTERFACE_RGBX_SHUFFLE 2, 1, 0, -1, 6, 5, 4, -1, 10, 9, 8, -1, 14, 13, 12, -1
+
+__attribute__((target("sse4.1"))) static void rgb24ToXrgbSse41(const uint8_t* src, uint32_t* dst, int width) {
+    const __m128i shuffle = _mm_setr_epi8(OPENTERFACE_RGB24_SHUFFLE);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    int x = 0;
+    // 16-byte loads cover 4 pixels plus 4 bytes of the next; stop while they stay inside the row
+    for (; x + 6 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    rgb24ToXrgbScalar(src + x * 3, dst + x, width - x);
+}
+
+__attribute__((target("sse4.1"))) static void rgbxToXrgbSse41(const uint8_t* src, uint32_t* dst, int width) {
+    const __m128i shuffle = _mm_setr_epi8(OPENTERFACE_RGBX_SHUFFLE);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    rgbxToXrgbScalar(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("sse4.1"))) static void blendRowsSse41(const uint32_t* a, const uint32_t* b, uint32_t* dst,
+                                                             int width, int weight) {
+    const __m128i wa = _mm_set1_epi16(static_cast<short>(128 - weight));
+    const __m128i wb = _mm_set1_epi16(static_cast<short>(weight));
+    const __m128i round = _mm_set1_epi16(64);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + x));
+        __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + x));
+        __m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(va), wa),
+                                   _mm_mullo_epi16(_mm_cvtepu8_epi16(vb), wb));
+        __m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(va, 8)), wa),
+                                   _mm_mullo_epi16(_mm_cvtepu8_epi16(_mm_srli_si128(vb, 8)), wb));
+        lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 7);
+        hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 7);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(lo, hi));
+    }
+    blendRowsScalar(a + x, b + x, dst + x, width - x, weight);
+}
+
+__attribute__((target("avx2"))) static void rgb24ToXrgbAvx2(const uint8_t* src, uint32_t* dst, int width) {
+    const __m256i shuffle = _mm256_setr_epi8(OPENTERFACE_RGB24_SHUFFLE, OPENTERFACE_RGB24_SHUFFLE);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    int x = 0;
+    // Two 16-byte loads, 12 bytes apart, put 4 pixels in each lane (the shuffle can't cross lanes)
+    for (; x + 10 <= width; x += 8) {
+        const uint8_t* p = src + x * 3;
+        __m256i pixels = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 12)), 1);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    rgb24ToXrgbSse41(src + x * 3, dst + x, width - x);
+}
+
+__attribute__((target("avx2"))) static void rgbxToXrgbAvx2(const uint8_t* src, uint32_t* dst, int width) {
+    const __m256i shuffle = _mm256_setr_epi8(OPENTERFACE_RGBX_SHUFFLE, OPENTERFACE_RGBX_SHUFFLE);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x * 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x),
+                            _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+    }
+    rgbxToXrgbSse41(src + x * 4, dst + x, width - x);
+}
+
+__attribute__((target("avx2"))) static void blendRowsAvx2(const uint32_t* a, const uint32_t* b, uint32_t* dst,
+                                                          int width, int weight) {
+    const __m256i wa = _mm256_set1_epi16(static_cast<short>(128 - weight));
+    const __m256i wb = _mm256_set1_epi16(static_cast<short>(weight));
+    const __m256i round = _mm256_set1_epi16(64);
+    const __m256i zero = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + x));
+        __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + x));
+        // Unpack and pack both work per 128-bit lane, so the byte order comes back unchanged
+        __m256i lo = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(va, zero), wa),
+                                      _mm256_mullo_epi16(_mm256_unpacklo_epi8(vb, zero), wb));
+        __m256i hi = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(va, zero), wa),
+                                      _mm256_mullo_epi16(_mm256_unpackhi_epi8(vb, zero), wb));
+        lo = _mm256_srli_epi16(_mm256_add_epi16(lo, round), 7);
+        hi = _mm256_srli_epi16(_mm256_add_epi16(hi, round), 7);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_packus_epi16(lo, hi));
+    }
+    blendRowsSse41(a + x, b + x, dst + x, width - x, weight);
+}
+
+static const PixelKernels kSse41Kernels = {"sse4.1", rgb24ToXrgbSse41, rgbxToXrgbSse41, blendRowsSse41};
+static const PixelKernels kAvx2Kernels = {"avx2", rgb24ToXrgbAvx2, rgbxToXrgbAvx2, blendRowsAvx2};
+
+#endif // OPENTERFACE_PIXEL_X86
+
+#ifdef OPENTERFACE_PIXEL_NEON
+
+static void rgb24ToXrgbNeon(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x3_t rgb = vld3_u8(src + x * 3);
+        uint8x8x4_t bgrx = {{rgb.val[2], rgb.val[1], rgb.val[0], vdup_n_u8(0xFF)}};
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + x), bgrx);
+    }
+    rgb24ToXrgbScalar(src + x * 3, dst + x, width - x);
+}
+
+static void rgbxToXrgbNeon(const uint8_t* src, uint32_t* dst, int width) {
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        uint8x8x4_t rgbx = vld4_u8(src + x * 4);
+        uint8x8x4_t bgrx = {{rgbx.val[2], rgbx.val[1], rgbx.val[0], vdup_n_u8(0xFF)}};
+        vst4_u8(reinterpret_cast<uint8_t*>(dst + x), bgrx);
+    }
+    rgbxToXrgbScalar(src + x * 4, dst + x, width - x);
+}
+
+static void blendRowsNeon(const uint32_t* a, const uint32_t* b, uint32_t* dst, int width, int weight) {
+    const uint8x8_t wa = vdup_n_u8(static_cast<uint8_t>(128 - weight));
+    const uint8x8_t wb = vdup_n_u8(static_cast<uint8_t>(weight));
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        uint8x16_t va = vld1q_u8(reinterpret_cast<const uint8_t*>(a + x));
+        uint8x16_t vb = vld1q_u8(reinterpret_cast<const uint8_t*>(b + x));
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(va), wa), vget_low_u8(vb), wb);
+        uint16x8_t hi = vmlal_u8(vmull_u8(vget_high_u8(va), wa), vget_high_u8(vb), wb);
+        // vrshrn adds the 64 rounding term before shifting
+        vst1q_u8(reinterpret_cast<uint8_t*>(dst + x), vcombine_u8(vrshrn_n_u16(lo, 7), vrshrn_n_u16(hi, 7)));
+    }
+    blendRowsScalar(a + x, b + x, dst + x, width - x, weight);
+}
+
+static const PixelKernels kNeonKernels = {"neon", rgb24ToXrgbNeon, rgbxToXrgbNeon, blendRowsNeon};
+
+#endif // OPENTERFACE_PIXEL_NEON
+
+static const PixelKernels* findKernels(const std::string& name) {
+#ifdef OPENTERFACE_PIXEL_X86
+    if (name == "avx2") {
+        return __builtin_cpu_supports("avx2") ? &kAvx2Kernels : nullptr;
+    }
+    if (name == "sse4.1") {
+        return __builtin_cpu_supports("sse4.1") ? &kSse41Kernels : nullptr;
+    }
+#endif
+#ifdef OPENTERFACE_PIXEL_NEON
+    if (name == "neon") {
+        return &kNeonKernels;
+    }
+#endif
+    return name == "scalar" ? &kScalarKernels : nullptr;
+}
+
+static std::atomic<const PixelKernels*>& activeKernels() {
+    static std::atomic<const PixelKernels*> active = [] {
+        for (const char* name : {"avx2", "sse4.1", "neon"}) {
+            if (const PixelKernels* kernels = findKernels(name)) {
+                return kernels;
+            }
+        }
+        return &kScalarKernels;
+    }();
+    return active;
+}
+
+static const PixelKernels& kernels() {
+    return *activeKernels().load(std::memory_order_relaxed);
+}
+
+const char* pixelKernelName() {
+    return kernels().name;
+}
+
+bool selectPixelKernels(const std::string& name) {
+    const PixelKernels* selected = findKernels(name);
+    if (!selected) {
+        return false;
+    }
+    activeKernels().store(selected, std::memory_order_relaxed);
+    return true;
+}
+
+void convertRowToXrgb(const uint8_t* src, PixelFormat format, uint32_t* dst, int width) {
+    switch (format) {
+    case PixelFormat::XRGB8888:
+        memcpy(dst, src, static_cast<size_t>(width) * 4);
+        break;
+    case PixelFormat::RGBX8888:
+        kernels().rgbx_to_xrgb(src, dst, width);
+        break;
+    default:
+        kernels().rgb24_to_xrgb(src, dst, width);
+        break;
+    }
+}
+
+// Horizontal blend of two XRGB pixels: R/B and X/G pairs in 16-bit lanes of one 32-bit word
+static inline uint32_t blendPixel(uint32_t a, uint32_t b, int weight) {
+    const uint32_t inverse = 128 - weight;
+    uint32_t rb = ((a & 0x00FF00FF) * inverse + (b & 0x00FF00FF) * weight + 0x00400040) >> 7;
+    uint32_t xg = (((a >> 8) & 0x00FF00FF) * inverse + ((b >> 8) & 0x00FF00FF) * weight + 0x00400040) >> 7;
+    return (rb & 0x00FF00FF) | ((xg & 0x00FF00FF) << 8);
+}
+
+// Centre-aligned sample positions in 1/128 steps. The last tap is clamped so index + 1 stays
+// inside the source (weight 128 selects it exactly).
+void PixelScaler::buildTaps(std::vector<Tap>& taps, int src, int dst, bool bilinear) {
+    taps.resize(dst);
+    for (int i = 0; i < dst; i++) {
+        if (!bilinear) {
+            taps[i] = {static_cast<int>(static_cast<int64_t>(i) * src / dst), 0};
+            continue;
+        }
+        int64_t position = ((2 * static_cast<int64_t>(i) + 1) * src * 128) / (2 * dst) - 64;
+        position = std::clamp<int64_t>(position, 0, static_cast<int64_t>(src - 1) * 128);
+        int index = static_cast<int>(position >> 7);
+        int weight = static_cast<int>(position & 127);
+        if (index >= src - 1) {
+            index = src - 2;
+            weight = 128;
+        }
+        taps[i] = {index, weight};
+    }
+}
+
+void PixelScaler::prepare(int src_width, int src_height, int dst_width, int dst_height, ScaleFilter active) {
+    if (src_width == src_w && src_height == src_h && dst_width == dst_w && dst_height == dst_h &&
+        active == prepared_filter) {
+        return;
+    }
+    src_w = src_width;
+    src_h = src_height;
+    dst_w = dst_width;
+    dst_h = dst_height;
+    prepared_filter = active;
+
+    bool bilinear = active == ScaleFilter::Bilinear;
+    buildTaps(x_taps, src_w, dst_w, bilinear);
+    buildTaps(y_taps, src_h, dst_h, bilinear);
+
+    for (auto& row : converted) {
+        row.resize(src_w);
+    }
+    blended.resize(src_w);
+}
+
+const uint32_t* PixelScaler::sourceRow(int y) {
+    const uint8_t* row = frame + static_cast<size_t>(y) * frame_stride;
+    if (frame_format == PixelFormat::XRGB8888) {
+        return reinterpret_cast<const uint32_t*>(row);
+    }
+
+    // Adjacent rows land in different slots, so a bilinear row pair converts each row once. Only
+    // the sampled span is converted; it stays at its own offset so the taps index it unchanged.
+    int slot = y & 1;
+    if (converted_row[slot] != y) {
+        convertRowToXrgb(row + static_cast<size_t>(span_begin) * bytesPerPixel(frame_format), frame_format,
+                         converted[slot].data() + span_begin, span_end - span_begin);
+        converted_row[slot] = y;
+    }
+    return converted[slot].data();
+}
+
+void PixelScaler::scale(const uint8_t* src, int src_width, int src_height, size_t src_stride, PixelFormat format,
+                        uint32_t* dst, int dst_width, int dst_height, size_t dst_stride, const DamageRect* region) {
+    if (!src || !dst || src_width <= 0 || src_height <= 0 || dst_width <= 0 || dst_height <= 0) {
+        return;
+    }
+
+    int x0 = 0, y0 = 0, x1 = dst_width, y1 = dst_height;
+    if (region) {
+        x0 = std::clamp(region->x, 0, dst_width);
+        y0 = std::clamp(region->y, 0, dst_height);
+        x1 = std::clamp(region->x + region->width, x0, dst_width);
+        y1 = std::clamp(region->y + region->height, y0, dst_height);
+        if (x0 == x1 || y0 == y1) {
+            return;
+        }
+    }
+    const int width = x1 - x0;
+
+    auto dstRow = [&](int y) {
+        return reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(dst) + static_cast<size_t>(y) * dst_stride) +
+               x0;
+    };
+
+    // 1:1 - straight conversion into the destination
+    if (src_width == dst_width && src_height == dst_height) {
+        const size_t offset = static_cast<size_t>(x0) * bytesPerPixel(format);
+        for (int y = y0; y < y1; y++) {
+            convertRowToXrgb(src + static_cast<size_t>(y) * src_stride + offset, format, dstRow(y), width);
+        }
+        return;
+    }
+
+    // Bilinear needs two samples along each axis
+    ScaleFilter active = (src_width < 2 || src_height < 2) ? ScaleFilter::Nearest : filter;
+    prepare(src_width, src_height, dst_width, dst_height, active);
+    frame = src;
+    frame_stride = src_stride;
+    frame_format = format;
+    converted_row[0] = converted_row[1] = -1;
+    span_begin = x_taps[x0].index;
+    span_end = std::min(src_width, x_taps[x1 - 1].index + 2);
+
+    if (active == ScaleFilter::Nearest) {
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* row = sourceRow(y_taps[y].index);
+            uint32_t* out = dstRow(y);
+            if (src_width == dst_width) {
+                memcpy(out, row + x0, static_cast<size_t>(width) * 4);
+                continue;
+            }
+            for (int x = x0; x < x1; x++) {
+                out[x - x0] = row[x_taps[x].index];
+            }
+        }
+        return;
+    }
+
+    for (int y = y0; y < y1; y++) {
+        const Tap& ty = y_taps[y];
+        const uint32_t* row;
+        if (ty.weight == 0) {
+            row = sourceRow(ty.index);
+        } else if (ty.weight == 128) {
+            row = sourceRow(ty.index + 1);
+        } else {
+            const uint32_t* top = sourceRow(ty.index);
+            const uint32_t* bottom = sourceRow(ty.index + 1);
+            kernels().blend_rows(top + span_begin, bottom + span_begin, blended.data() + span_begin,
+                                 span_end - span_begin, ty.weight);
+            row = blended.data();
+        }
+
+        uint32_t* out = dstRow(y);
+        if (src_width == dst_width) {
+            memcpy(out, row + x0, static_cast<size_t>(width) * 4);
+            continue;
+        }
+        for (int x = x0; x < x1; x++) {
+            const Tap& tx = x_taps[x];
+            out[x - x0] = blendPixel(row[tx.index], row[tx.index + 1], tx.weight);
+        }
+    }
+}
+
+} // namespace openterface
@@ -1,6 +1,13 @@
 #include "openterface/serial.hpp"
+#include "openterface/ch9329.hpp"
+#include "openterface/text_input.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <cstdio>
 #include <cstring>
 
 // Linux serial port headers
@@ -9,12 +16,194 @@
 #include <termios.h>
 #include <unistd.h>
 #include <errno.h>
-#include <cstdio>
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <poll.h>
 #endif
 
 namespace openterface {
 
+    namespace {
+
+        // Input commands (keyboard 14 bytes, absolute mouse 13 with checksum) fit a fixed slot;
+        // larger configuration commands are written synchronously
+        constexpr size_t kMaxTxPacket = 32;
+
+        struct TxPacket {
+            uint8_t size = 0;
+            uint32_t order = 0;  // Submission order relative to absolute moves (kOrderMask bits)
+            uint8_t bytes[kMaxTxPacket];
+        };
+
+        // Bounded lock-free multi-producer/single-consumer FIFO. Each cell carries a sequence number
+        // telling producers whether it is free for position `pos` (== pos) and the consumer whether
+        // it holds the value for `pos` (== pos + 1), so no producer waits for another.
+        template <typename T, size_t Capacity>
+        class TxQueue {
+            static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+        public:
+            TxQueue() {
+                for (size_t i = 0; i < Capacity; i++) {
+                    cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            // Any thread. Fails only when the queue is full.
+            bool push(const T &value) {
+                size_t pos = tail.load(std::memory_order_relaxed);
+                while (true) {
+                    Cell &cell = cells[pos & (Capacity - 1)];
+                    size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                    intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+                    if (diff == 0) {
+                        if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            cell.value = value;
+                            cell.sequence.store(pos + 1, std::memory_order_release);
+                            return true;
+                        }
+                    } else if (diff < 0) {
+                        return false; // The consumer hasn't freed this cell from the previous lap
+                    } else {
+                        pos = tail.load(std::memory_order_relaxed);
+                    }
+                }
+            }
+
+            // Writer thread only
+            bool pop(T &value) {
+                size_t pos = head.load(std::memory_order_relaxed);
+                Cell &cell = cells[pos & (Capacity - 1)];
+                if (cell.sequence.load(std::memory_order_acquire) != pos + 1) {
+                    return false;
+                }
+                value = cell.value;
+                cell.sequence.store(pos + Capacity, std::memory_order_release);
+                head.store(pos + 1, std::memory_order_release);
+                return true;
+            }
+
+            bool empty() const {
+                return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+            }
+
+        private:
+            struct Cell {
+                std::atomic<size_t> sequence;
+                T value;
+            };
+
+            std::array<Cell, Capacity> cells;
+            alignas(64) std::atomic<size_t> head{0};
+            alignas(64) std::atomic<size_t> tail{0};
+        };
+
+        // Pending absolute move: valid flag, 31-bit submission order, 16-bit x and y
+        constexpr uint64_t kMotionPending = 1ULL << 63;
+        constexpr uint32_t kOrderMask = 0x7FFFFFFF;
+
+        uint64_t packMotion(int x, int y, uint32_t order) {
+            return kMotionPending | (static_cast<uint64_t>(order & kOrderMask) << 32) |
+                   (static_cast<uint64_t>(x & 0xFFFF) << 16) | static_cast<uint64_t>(y & 0xFFFF);
+        }
+
+        uint32_t motionOrder(uint64_t motion) { return static_cast<uint32_t>(motion >> 32) & kOrderMask; }
+
+        // Whether submission `a` came before `b` (orders wrap)
+        bool submittedBefore(uint32_t a, uint32_t b) {
+            uint32_t distance = (b - a) & kOrderMask;
+            return distance != 0 && distance < kOrderMask / 2;
+        }
+
+        // Pending relative motion: accumulated dx (high half) and dy (low half)
+        uint64_t packDelta(int32_t dx, int32_t dy) {
+            return (static_cast<uint64_t>(static_cast<uint32_t>(dx)) << 32) | static_cast<uint32_t>(dy);
+        }
+
+        void unpackDelta(uint64_t packed, int32_t &dx, int32_t &dy) {
+            dx = static_cast<int32_t>(static_cast<uint32_t>(packed >> 32));
+            dy = static_cast<int32_t>(static_cast<uint32_t>(packed));
+        }
+
+        // UART rates tried by negotiateBaudRate(), fastest first. The chip rejects or fails to
+        // verify the ones it (or the USB bridge) can't hold, which moves on to the next.
+        constexpr int kLinkBaudRates[] = {921600, 460800, 230400, 115200};
+
+        // GET_INFO round trips a new rate has to pass before it is kept
+        constexpr int kVerifyRoundTrips = 32;
+
+        // Byte of the parameter configuration (CMD_GET_PARA_CFG payload) where the 32-bit
+        // big-endian UART rate starts; mode, serial mode and address come before it
+        constexpr size_t kConfigBaudOffset = 3;
+        constexpr size_t kConfigSize = 50;
+
+        // Upper bound for the chip to answer again after CMD_RESET; it's polled, not slept
+        constexpr int kChipRestartMs = 500;
+
+        // Replies nobody waits for, kept for readData()
+        constexpr size_t kMaxUnclaimedBytes = 4096;
+
+        // Keyboard reports a text stream keeps in flight beyond the chip's last acknowledgement:
+        // enough to keep the UART busy, few enough that a long paste doesn't flood the queue
+        constexpr size_t kTextWindow = 8;
+
+    #ifdef __linux__
+        bool baudToSpeed(int baud, speed_t &speed) {
+            switch (baud) {
+                case 9600: speed = B9600; return true;
+                case 19200: speed = B19200; return true;
+                case 38400: speed = B38400; return true;
+                case 57600: speed = B57600; return true;
+                case 115200: speed = B115200; return true;
+                case 230400: speed = B230400; return true;
+                case 460800: speed = B460800; return true;
+                case 921600: speed = B921600; return true;
+                default: return false;
+            }
+        }
+    #endif
+
+        // Incremental parser splitting the chip's byte stream into response frames (57 AB 00
+        // <command> <length> <payload> <checksum>), however reads happen to cut it. Bytes that don't
+        // start a frame, implausible lengths and bad checksums - line noise, or a frame cut in half
+        // by a rate change - are dropped, and the parser resynchronises on the next header.
+        class FrameParser {
+        public:
+            // Longest reply the chip sends (CMD_GET_PARA_CFG); longer lengths are noise
+            static constexpr size_t kMaxPayload = 64;
+
+            // Consume one byte; true when it completed a valid frame, readable until the next push()
+            bool push(uint8_t byte) {
+                buffer[fill++] = byte;
+                if (fill == 1 && byte != ch9329::kHeader0) {
+                    fill = 0;
+                } else if (fill == 2 && byte != ch9329::kHeader1) {
+                    fill = byte == ch9329::kHeader0 ? 1 : 0;
+                } else if (fill == 5 && buffer[4] > kMaxPayload) {
+                    fill = byte == ch9329::kHeader0 ? 1 : 0;
+                } else if (fill >= 5 && fill == buffer[4] + ch9329::kFrameOverhead) {
+                    fill = 0;
+                    return ch9329::checksum(buffer, buffer[4] + ch9329::kFrameOverhead - 1) ==
+                           buffer[buffer[4] + ch9329::kFrameOverhead - 1];
+                }
+                return false;
+            }
+
+            void reset() { fill = 0; }
+
+            uint8_t command() const { return buffer[3]; }
+            uint8_t length() const { return buffer[4]; }
+            const uint8_t *payload() const { return buffer + 5; }
+            const uint8_t *data() const { return buffer; }
+            size_t size() const { return buffer[4] + ch9329::kFrameOverhead; }
+
+        private:
+            uint8_t buffer[kMaxPayload + ch9329::kFrameOverhead];
+            size_t fill = 0;
+        };
+
+    } // namespace
+
     struct Serial::Impl {
         std::string port_name;
         int baudrate = 115200;
@@ -22,6 +211,42 @@ namespace openterface {
         std::atomic<bool> target_connected{false};
         std::atomic<bool> connecting{false};
         int fd = -1;  // File descriptor for serial port
+
+        // Transmit path. At 115200 baud a packet takes about a millisecond on the wire, so callers
+        // (Wayland callbacks, the input thread) only queue it and tx_thread writes it out:
+        // - commands go through tx_queue in order; tx_order keeps them in order with absolute moves too
+        // - absolute moves coalesce into tx_motion (latest position wins), relative moves add up
+        //   in tx_delta, while the previous packet is still being transmitted
+        TxQueue<TxPacket, 256> tx_queue;
+        std::atomic<uint64_t> tx_motion{0};
+        std::atomic<uint32_t> tx_order{0};     // Numbers queued commands and moves, so they keep their order
+        std::atomic<uint64_t> tx_delta{0};
+        std::atomic<uint8_t> buttons_held{0};  // Button mask carried by motion packets (drags)
+        std::atomic<uint32_t> tx_signal{0};    // Bumped (and notified) for every submission
+        std::atomic<bool> tx_running{false};
+        std::atomic<bool> tx_busy{false};      // Writer holds packets that aren't on the wire yet
+        std::thread tx_thread;
+        std::mutex write_mutex;                // One writer on the fd at a time (tx_thread or a synchronous command)
+        std::atomic<bool> verbose{false};      // Per-packet logging (hex dumps, every key and click)
+
+        // Receive path. rx_thread reassembles the chip's replies and completes the request waiting
+        // for each (matched by command code, oldest first); input acknowledgements are only counted.
+        struct Response {
+            bool ok = false;  // false: the chip answered with an error frame
+            std::vector<uint8_t> payload;
+        };
+        struct PendingRequest {
+            uint8_t command = 0;
+            std::promise<Response> reply;
+        };
+        std::thread rx_thread;
+        std::atomic<bool> rx_running{false};
+        std::atomic<bool> rx_resync{false};     // Drop any partial frame (rate change)
+        int rx_wake_fd = -1;
+        std::mutex rx_mutex;                    // pending, rx_unclaimed
+        std::vector<std::shared_ptr<PendingRequest>> pending;
+        std::vector<uint8_t> rx_unclaimed;
+        std::atomic<uint32_t> input_acks{0};
         
         // Threading support
         std::thread connection_thread;
@@ -29,6 +254,17 @@ namespace openterface {
         ConnectionCallback connection_callback;
         
         void log(const std::string &msg) { std::cout << "[SERIAL] " << msg << std::endl; }
+
+        // Hex dump of a transfer; callers check `verbose` first so quiet runs format nothing
+        void logHex(const char *what, const uint8_t *data, size_t size) {
+            std::string hex_str = std::string(what) + " " + std::to_string(size) + " bytes: ";
+            for (size_t i = 0; i < size; i++) {
+                char hex[4];
+                snprintf(hex, sizeof(hex), "%02X ", data[i]);
+                hex_str += hex;
+            }
+            log(hex_str);
+        }
         
         // Calculate checksum for CH9329 commands (matches Qt implementation)
         uint8_t calculateChecksum(const std::vector<uint8_t> &data) {
@@ -39,48 +275,246 @@ namespace openterface {
             return static_cast<uint8_t>(sum % 256);
         }
         
-        // Send command with proper checksum
+        // Send command with proper checksum (caller-built commands; the CH9329 commands this
+        // class sends itself come from ch9329.hpp with the checksum already in place)
         bool sendCommandWithChecksum(const std::vector<uint8_t> &cmd_base) {
             auto cmd = cmd_base;  // Copy the command
             uint8_t checksum = calculateChecksum(cmd);
             cmd.push_back(checksum);  // Add checksum as last byte
-            return sendDataRaw(cmd);
+            return sendPacket(cmd.data(), cmd.size());
         }
-        
-        // Raw data send without checksum (for mouse commands that don't use checksums)
-        bool sendDataRaw(const std::vector<uint8_t> &data) {
+
+        template <size_t N>
+        bool sendPacket(const std::array<uint8_t, N> &packet) {
+            static_assert(N <= kMaxTxPacket, "Input packets must fit a transmit slot");
+            return sendPacket(packet.data(), N);
+        }
+
+        // Send a complete packet (checksum included). Queued for the writer thread while it runs,
+        // written directly otherwise (connection setup).
+        bool sendPacket(const uint8_t *data, size_t size) {
             if (!connected)
                 return false;
 
+            if (tx_running.load() && size <= kMaxTxPacket) {
+                TxPacket packet;
+                packet.size = static_cast<uint8_t>(size);
+                memcpy(packet.bytes, data, size);
+                packet.order = tx_order.fetch_add(1, std::memory_order_relaxed) & kOrderMask;
+                if (!tx_queue.push(packet)) {
+                    log("Transmit queue full, dropping " + std::to_string(size) + " byte command");
+                    return false;
+                }
+                wakeWriter();
+                return true;
+            }
+
+            // Keep the order with anything already queued
+            waitTxIdle();
+            return writePackets(data, size);
+        }
+
+        // Write and wait until the bytes have left the UART; callers are serialized by write_mutex
+        bool writePackets(const uint8_t *data, size_t size) {
+            std::lock_guard<std::mutex> lock(write_mutex);
+
     #ifdef __linux__
-            // Log the hex data being sent
-            std::string hex_str = "Sending " + std::to_string(data.size()) + " bytes: ";
-            for (auto byte : data) {
-                char hex[4];
-                sprintf(hex, "%02X ", byte);
-                hex_str += hex;
+            if (verbose.load(std::memory_order_relaxed)) {
+                logHex("Sending", data, size);
             }
-            log(hex_str);
 
-            // Actually write to serial port
-            ssize_t bytes_written = write(fd, data.data(), data.size());
-            if (bytes_written != static_cast<ssize_t>(data.size())) {
-                log("Failed to write all bytes to serial port: " + std::string(strerror(errno)));
-                return false;
+            // Actually write to serial port; the fd is non-blocking, so a full tty buffer is waited out
+            size_t written = 0;
+            while (written < size) {
+                ssize_t result = write(fd, data + written, size - written);
+                if (result > 0) {
+                    written += static_cast<size_t>(result);
+                } else if (result < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                    struct pollfd pfd = {fd, POLLOUT, 0};
+                    poll(&pfd, 1, 100);
+                } else if (result < 0 && errno == EINTR) {
+                    continue;
+                } else {
+                    log("Failed to write all bytes to serial port: " + std::string(strerror(errno)));
+                    return false;
+                }
             }
-            
-            // Flush the output
+
+            // Wait for transmission: this is what paces the writer thread, and the time during
+            // which pending motion coalesces
             if (tcdrain(fd) != 0) {
                 log("Failed to flush serial port: " + std::string(strerror(errno)));
                 return false;
             }
-            
+
             return true;
     #else
-            log("Sending " + std::to_string(data.size()) + " bytes (simulation)");
+            (void)data;
+            log("Sending " + std::to_string(size) + " bytes (simulation)");
             return true;
     #endif
         }
+
+        void wakeWriter() {
+            tx_signal.fetch_add(1, std::memory_order_release);
+            tx_signal.notify_one();
+        }
+
+        // Latest absolute position replaces any move the writer hasn't picked up yet
+        void queueMotion(int x, int y) {
+            tx_motion.store(packMotion(x, y, tx_order.fetch_add(1, std::memory_order_relaxed)), std::memory_order_release);
+            wakeWriter();
+        }
+
+        void queueDelta(int dx, int dy) {
+            uint64_t pending = tx_delta.load(std::memory_order_relaxed);
+            uint64_t updated;
+            do {
+                int32_t sum_x, sum_y;
+                unpackDelta(pending, sum_x, sum_y);
+                updated = packDelta(std::clamp(sum_x + dx, -32767, 32767), std::clamp(sum_y + dy, -32767, 32767));
+            } while (!tx_delta.compare_exchange_weak(pending, updated, std::memory_order_acq_rel));
+            wakeWriter();
+        }
+
+        // Append a finished packet to a write batch
+        template <size_t N>
+        static size_t appendPacket(uint8_t *out, const std::array<uint8_t, N> &packet) {
+            memcpy(out, packet.data(), N);
+            return N;
+        }
+
+        static constexpr size_t kRelativeReportSize = std::tuple_size_v<ch9329::RelativeMousePacket>;
+
+        // Turn accumulated relative motion into reports of at most +-127 per axis
+        size_t takeDeltaReports(uint8_t *out, size_t capacity) {
+            uint64_t pending = tx_delta.exchange(0, std::memory_order_acq_rel);
+            int32_t dx, dy;
+            unpackDelta(pending, dx, dy);
+            size_t size = 0;
+            while ((dx != 0 || dy != 0) && size + kMaxTxPacket <= capacity) {
+                int step_x = std::clamp(dx, -127, 127);
+                int step_y = std::clamp(dy, -127, 127);
+                size += appendPacket(out + size, ch9329::relativeMouse(buttons_held.load(), step_x, step_y));
+                dx -= step_x;
+                dy -= step_y;
+            }
+            if (dx != 0 || dy != 0) {
+                queueDelta(dx, dy); // Didn't fit this batch
+            }
+            return size;
+        }
+
+        // Relative reports are cumulative, so motion that happened before a click must go out before
+        // it: move the pending deltas into the ordered queue
+        void queuePendingDelta() {
+            uint8_t reports[kMaxTxPacket * 8];
+            size_t size = takeDeltaReports(reports, sizeof(reports));
+            for (size_t offset = 0; offset < size; offset += kRelativeReportSize) {
+                TxPacket packet;
+                packet.size = kRelativeReportSize;
+                memcpy(packet.bytes, reports + offset, kRelativeReportSize);
+                packet.order = tx_order.fetch_add(1, std::memory_order_relaxed) & kOrderMask;
+                tx_queue.push(packet);
+            }
+        }
+
+        size_t appendMotion(uint8_t *out, uint64_t motion) {
+            return appendPacket(out, ch9329::absoluteMouse(buttons_held.load(), static_cast<int>((motion >> 16) & 0xFFFF),
+                                                           static_cast<int>(motion & 0xFFFF)));
+        }
+
+        // Writer: queued commands and the coalesced move in the order they were submitted, then the
+        // relative motion, in one write per batch
+        bool drainTx() {
+            uint8_t batch[512];
+            size_t size = 0;
+            tx_busy = true;
+
+            // The move is taken first: commands queued after it must follow it on the wire, commands
+            // queued before it (pushed by now) go ahead of it
+            uint64_t motion = tx_motion.exchange(0, std::memory_order_acq_rel);
+            bool full = false;
+            TxPacket packet;
+            while (true) {
+                if (size + 2 * kMaxTxPacket > sizeof(batch)) {
+                    full = true;  // Room is kept for the move
+                    break;
+                }
+                if (!tx_queue.pop(packet)) {
+                    break;
+                }
+                if ((motion & kMotionPending) && submittedBefore(motionOrder(motion), packet.order)) {
+                    size += appendMotion(batch + size, motion);
+                    motion = 0;
+                }
+                memcpy(batch + size, packet.bytes, packet.size);
+                size += packet.size;
+            }
+
+            if (motion & kMotionPending) {
+                if (full) {
+                    // Older commands may still be queued: the move waits for the next batch unless a
+                    // newer one replaced it meanwhile
+                    uint64_t none = 0;
+                    tx_motion.compare_exchange_strong(none, motion, std::memory_order_acq_rel);
+                } else {
+                    size += appendMotion(batch + size, motion);
+                }
+            }
+            if (!full) {
+                size += takeDeltaReports(batch + size, sizeof(batch) - size);
+            }
+
+            if (size > 0) {
+                writePackets(batch, size);
+            }
+            tx_busy = false;
+            return size > 0;
+        }
+
+        void txThreadFunction() {
+            while (true) {
+                uint32_t signal = tx_signal.load(std::memory_order_acquire);
+                if (drainTx()) {
+                    continue;
+                }
+                // Everything submitted before stopTx() has been written
+                if (!tx_running.load()) {
+                    break;
+                }
+                tx_signal.wait(signal, std::memory_order_acquire);
+            }
+        }
+
+        void startTx() {
+            if (tx_thread.joinable()) {
+                return;
+            }
+            tx_running = true;
+            tx_thread = std::thread([this]() { txThreadFunction(); });
+        }
+
+        void stopTx() {
+            if (!tx_thread.joinable()) {
+                return;
+            }
+            tx_running = false;
+            wakeWriter();
+            tx_thread.join();
+        }
+
+        // Block until the writer has sent everything queued so far (synchronous commands)
+        void waitTxIdle() {
+            if (std::this_thread::get_id() == tx_thread.get_id()) {
+                return;
+            }
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            while (tx_running.load() && (!tx_queue.empty() || tx_motion.load() || tx_delta.load() || tx_busy.load()) &&
+                   std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
         
         // Helper method to open serial port at specific baud rate
         bool openSerialPort(int baud_rate) {
@@ -103,14 +537,11 @@ namespace openterface {
             
             // Set baud rate
             speed_t speed;
-            switch (baud_rate) {
-                case 9600: speed = B9600; break;
-                case 115200: speed = B115200; break;
-                default:
-                    log("Unsupported baud rate: " + std::to_string(baud_rate));
-                    close(fd);
-                    fd = -1;
-                    return false;
+            if (!baudToSpeed(baud_rate, speed)) {
+                log("Unsupported baud rate: " + std::to_string(baud_rate));
+                close(fd);
+                fd = -1;
+                return false;
             }
             
             cfsetospeed(&tty, speed);
@@ -150,49 +581,318 @@ namespace openterface {
             log("Resetting CH9329 chip...");
             
             // Send reset command
-            std::vector<uint8_t> reset_cmd = {0x57, 0xAB, 0x00, 0x0F, 0x00};
-            if (!sendCommandWithChecksum(reset_cmd)) {
+            constexpr auto reset_cmd = ch9329::command<ch9329::CMD_RESET>();
+            if (!sendPacket(reset_cmd)) {
                 log("Failed to send reset command");
                 return false;
             }
+            waitForChip(kChipRestartMs);
             
-            usleep(100000); // 100ms delay for reset
-            
-            // Send configuration command to set proper mode (0x82) and 115200 baud
-            std::vector<uint8_t> config_cmd = {
-                0x57, 0xAB, 0x00, 0x09, 0x32, // Header
-                0x82, 0x80, 0x00, 0x00,       // Mode and address
-                0x00, 0x01, 0xC2, 0x00,       // Baud rate 115200 (little endian)
+            // Configuration with proper mode (0x82) and 115200 baud
+            std::vector<uint8_t> config = {
+                0x82, 0x80, 0x00,             // Mode, serial mode and address
+                0x00, 0x01, 0xC2, 0x00,       // Baud rate 115200 (big endian)
                 0x08, 0x00, 0x00, 0x03,       // Reserved and intervals
                 0x86, 0x1A, 0x29, 0xE1,       // VID/PID
                 0x00, 0x00, 0x00, 0x01,       // Timeouts 
                 0x00, 0x0D, 0x00, 0x00,       // Enter key and filters
-                0x00, 0x00, 0x00, 0x00,
-                0x00, 0x00, 0x00, 0x00, 
-                0x00, 0x00, 0x00, 0x00,
-                0x00, 0x00, 0x00, 0x00,
-                0x00, 0x00, 0x00, 0x00,
-                0x00, 0x00, 0x00, 0x00
             };
+            config.resize(kConfigSize, 0x00);
             
-            if (!sendCommandWithChecksum(config_cmd)) {
-                log("Failed to send configuration command");
-                return false; 
+            if (!writeConfig(config)) {
+                log("Configuration command not confirmed, resetting anyway");
             }
             
-            usleep(50000); // 50ms delay
-            
             // Send final reset to apply configuration
-            if (!sendCommandWithChecksum(reset_cmd)) {
+            if (!sendPacket(reset_cmd)) {
                 log("Failed to send final reset command");
                 return false;
             }
             
-            usleep(200000); // 200ms delay for chip to restart
+            // The configuration above runs the chip at 115200
+            if (baudrate != 115200 && setPortSpeed(115200)) {
+                baudrate = 115200;
+            }
+            if (!waitForChip(kChipRestartMs)) {
+                log("CH9329 not answering after reconfiguration");
+            }
             log("CH9329 chip reset and reconfigured successfully");
             return true;
         }
         
+        // Switch the host side of the link; bytes in flight at the old rate are discarded
+        bool setPortSpeed(int baud) {
+    #ifdef __linux__
+            speed_t speed;
+            struct termios options;
+            if (!baudToSpeed(baud, speed) || tcgetattr(fd, &options) != 0) {
+                log("Cannot switch serial port to " + std::to_string(baud) + " baud");
+                return false;
+            }
+            cfsetispeed(&options, speed);
+            cfsetospeed(&options, speed);
+            if (tcsetattr(fd, TCSANOW, &options) != 0) {
+                log("Failed to switch serial port to " + std::to_string(baud) + " baud: " + std::string(strerror(errno)));
+                return false;
+            }
+            tcflush(fd, TCIFLUSH);
+            rx_resync = true;
+            return true;
+    #else
+            (void)baud;
+            return false;
+    #endif
+        }
+
+        void rxThreadFunction() {
+    #ifdef __linux__
+            FrameParser parser;
+            uint8_t buffer[256];
+            struct pollfd fds[2] = {{fd, POLLIN, 0}, {rx_wake_fd, POLLIN, 0}};
+            while (rx_running.load()) {
+                if (poll(fds, 2, -1) < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    log("Serial reader poll failed: " + std::string(strerror(errno)));
+                    linkLost();
+                    break;
+                }
+                if (fds[1].revents & POLLIN) {
+                    uint64_t value;
+                    (void)!read(rx_wake_fd, &value, sizeof(value));
+                    continue;
+                }
+                if (fds[0].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                    log("Serial port stopped delivering data (unplugged?), link is down");
+                    linkLost();
+                    break;
+                }
+
+                ssize_t bytes_read = read(fd, buffer, sizeof(buffer));
+                if (bytes_read <= 0) {
+                    continue;
+                }
+                if (verbose.load(std::memory_order_relaxed)) {
+                    logHex("Received", buffer, static_cast<size_t>(bytes_read));
+                }
+                if (rx_resync.exchange(false)) {
+                    parser.reset();
+                }
+                for (ssize_t i = 0; i < bytes_read; i++) {
+                    if (parser.push(buffer[i])) {
+                        dispatchFrame(parser);
+                    }
+                }
+            }
+    #endif
+        }
+
+        // The port went away under the reader: nothing more gets sent or answered. The fd and the
+        // threads stay until disconnect() (or the next connect()) closes them.
+        void linkLost() {
+            connected = false;
+            target_connected = false;
+            failPending();
+        }
+
+        // Complete every waiting request as failed rather than letting each run into its timeout
+        void failPending() {
+            std::vector<std::shared_ptr<PendingRequest>> waiting;
+            {
+                std::lock_guard<std::mutex> lock(rx_mutex);
+                waiting.swap(pending);
+            }
+            for (auto &request : waiting) {
+                request->reply.set_value(Response());
+            }
+        }
+
+        // Replies carry the request's command code with bit 7 set, plus bit 6 for errors
+        void dispatchFrame(const FrameParser &frame) {
+            uint8_t command = frame.command() & 0x3F;
+            bool ok = (frame.command() & 0xC0) == 0x80;
+
+            // Byte 1 of the info reply is the target's USB enumeration state
+            if (command == ch9329::CMD_GET_INFO && ok && frame.length() >= 2) {
+                target_connected = frame.payload()[1] != 0;
+            }
+
+            std::shared_ptr<PendingRequest> waiting;
+            {
+                std::lock_guard<std::mutex> lock(rx_mutex);
+                auto match = std::find_if(pending.begin(), pending.end(),
+                                          [command](const auto &request) { return request->command == command; });
+                if (match != pending.end()) {
+                    waiting = *match;
+                    pending.erase(match);
+                } else if (command == ch9329::CMD_SEND_KB_GENERAL_DATA || command == ch9329::CMD_SEND_MS_ABS_DATA ||
+                           command == ch9329::CMD_SEND_MS_REL_DATA) {
+                    input_acks.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                } else if (rx_unclaimed.size() + frame.size() <= kMaxUnclaimedBytes) {
+                    rx_unclaimed.insert(rx_unclaimed.end(), frame.data(), frame.data() + frame.size());
+                    return;
+                }
+            }
+
+            if (waiting) {
+                Response response;
+                response.ok = ok;
+                response.payload.assign(frame.payload(), frame.payload() + frame.length());
+                waiting->reply.set_value(std::move(response));
+            }
+        }
+
+        bool startRx() {
+    #ifdef __linux__
+            rx_wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if (rx_wake_fd < 0) {
+                log("Failed to create serial reader wakeup: " + std::string(strerror(errno)));
+                return false;
+            }
+            rx_running = true;
+            rx_thread = std::thread([this]() { rxThreadFunction(); });
+            return true;
+    #else
+            return false;
+    #endif
+        }
+
+        void stopRx() {
+    #ifdef __linux__
+            if (rx_thread.joinable()) {
+                rx_running = false;
+                uint64_t value = 1;
+                (void)!write(rx_wake_fd, &value, sizeof(value));
+                rx_thread.join();
+            }
+            if (rx_wake_fd >= 0) {
+                close(rx_wake_fd);
+                rx_wake_fd = -1;
+            }
+    #endif
+            failPending();
+            std::lock_guard<std::mutex> lock(rx_mutex);
+            rx_unclaimed.clear();
+        }
+
+        // Stop both threads and close the port
+        void closePort() {
+            stopTx();
+            stopRx();
+    #ifdef __linux__
+            if (fd != -1) {
+                close(fd);
+                fd = -1;
+            }
+    #endif
+            connected = false;
+        }
+
+        // Send a complete packet and wait up to timeout_ms for the chip's reply. Returns false on
+        // timeout or an error reply.
+        bool request(const uint8_t *data, size_t size, int timeout_ms, Response *response = nullptr) {
+            auto waiting = std::make_shared<PendingRequest>();
+            waiting->command = data[3];
+            std::future<Response> reply = waiting->reply.get_future();
+            {
+                std::lock_guard<std::mutex> lock(rx_mutex);
+                pending.push_back(waiting);
+            }
+
+            if (sendPacket(data, size) &&
+                reply.wait_for(std::chrono::milliseconds(timeout_ms)) == std::future_status::ready) {
+                Response result = reply.get();
+                bool ok = result.ok;
+                if (response) {
+                    *response = std::move(result);
+                }
+                return ok;
+            }
+
+            std::lock_guard<std::mutex> lock(rx_mutex);
+            pending.erase(std::remove(pending.begin(), pending.end(), waiting), pending.end());
+            return false;
+        }
+
+        template <size_t N>
+        bool request(const std::array<uint8_t, N> &packet, int timeout_ms, Response *response = nullptr) {
+            return request(packet.data(), N, timeout_ms, response);
+        }
+
+        // One CMD_GET_INFO exchange, timed from submission to the complete reply
+        bool roundTrip(double &milliseconds, int timeout_ms = 100) {
+            auto start = std::chrono::steady_clock::now();
+            if (!request(ch9329::command<ch9329::CMD_GET_INFO>(), timeout_ms)) {
+                return false;
+            }
+            milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            return true;
+        }
+
+        bool verifyLink(int round_trips) {
+            double milliseconds;
+            for (int i = 0; i < round_trips; i++) {
+                if (!roundTrip(milliseconds)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Poll until the chip answers again after a reset
+        bool waitForChip(int timeout_ms) {
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+            double milliseconds;
+            do {
+                if (roundTrip(milliseconds, 20)) {
+                    return true;
+                }
+            } while (std::chrono::steady_clock::now() < deadline);
+            return false;
+        }
+
+        // Write a full parameter configuration (CMD_SET_PARA_CFG); the chip keeps it in flash
+        bool writeConfig(const std::vector<uint8_t> &config) {
+            std::vector<uint8_t> cmd = {ch9329::kHeader0, ch9329::kHeader1, ch9329::kAddress, ch9329::CMD_SET_PARA_CFG,
+                                        static_cast<uint8_t>(config.size())};
+            cmd.insert(cmd.end(), config.begin(), config.end());
+            cmd.push_back(ch9329::checksum(cmd.data(), cmd.size()));
+            Response response;
+            return request(cmd.data(), cmd.size(), 200, &response) && !response.payload.empty() &&
+                   response.payload[0] == 0x00;
+        }
+
+        // Reconfigure the chip's UART to `baud`, follow it, and check the link holds. On failure
+        // the previous configuration is restored and false returned.
+        bool switchBaudRate(const std::vector<uint8_t> &config, int baud) {
+            int previous = baudrate;
+            std::vector<uint8_t> updated = config;
+            for (int i = 0; i < 4; i++) {
+                updated[kConfigBaudOffset + i] = static_cast<uint8_t>((static_cast<uint32_t>(baud) >> (24 - 8 * i)) & 0xFF);
+            }
+
+            if (!writeConfig(updated)) {
+                log("CH9329 rejected " + std::to_string(baud) + " baud");
+                return false;
+            }
+            // The new rate takes effect when the chip restarts
+            sendPacket(ch9329::command<ch9329::CMD_RESET>());
+            if (setPortSpeed(baud) && waitForChip(kChipRestartMs) && verifyLink(kVerifyRoundTrips)) {
+                baudrate = baud;
+                return true;
+            }
+
+            log(std::to_string(baud) + " baud failed verification, restoring " + std::to_string(previous));
+            writeConfig(config);  // Often still gets through on a marginal link
+            sendPacket(ch9329::command<ch9329::CMD_RESET>());
+            if (!setPortSpeed(previous) || !waitForChip(kChipRestartMs)) {
+                log("CH9329 not answering at " + std::to_string(previous) + " baud - reconnect to recover the link");
+            }
+            return false;
+        }
+
         // Hardware factory reset using RTS pin (like old QT software)
         bool factoryResetChip() {
             log("Performing hardware factory reset using RTS pin...");
@@ -228,7 +928,7 @@ namespace openterface {
             }
             
             log("RTS released - factory reset complete");
-            usleep(500000); // Wait 500ms for chip to restart
+            waitForChip(kChipRestartMs);
             
             return true;
     #else
@@ -250,11 +950,18 @@ namespace openterface {
     }
 
     bool Serial::connect(const std::string &port, int baudrate) {
+        disconnect();  // Including what is left of a link that died
         pImpl->port_name = port;
         pImpl->baudrate = baudrate;
         
-        // Try primary baud rate first, then fallback to 9600 (matching Qt implementation)
+        // Try primary baud rate first, then the rates negotiateBaudRate() may have left the chip
+        // at, then fallback to 9600 (matching Qt implementation)
         std::vector<int> baud_rates = {baudrate};
+        for (int baud : kLinkBaudRates) {
+            if (baud != baudrate) {
+                baud_rates.push_back(baud);
+            }
+        }
         if (baudrate != 9600) {
             baud_rates.push_back(9600);  // Add fallback baud rate
         }
@@ -262,7 +969,6 @@ namespace openterface {
         for (int baud : baud_rates) {
             pImpl->log("Connecting to " + port + " @ " + std::to_string(baud));
             if (connectAtBaudRate(port, baud)) {
-                pImpl->baudrate = baud;  // Store successful baud rate
                 return true;
             }
         }
@@ -334,13 +1040,11 @@ namespace openterface {
         
         // Set baud rate
         speed_t speed = B115200;
-        switch (baudrate) {
-            case 9600: speed = B9600; break;
-            case 19200: speed = B19200; break;
-            case 38400: speed = B38400; break;
-            case 57600: speed = B57600; break;
-            case 115200: speed = B115200; break;
-            default: speed = B115200; break;
+        if (!baudToSpeed(baudrate, speed)) {
+            pImpl->log("Unsupported baud rate: " + std::to_string(baudrate));
+            close(pImpl->fd);
+            pImpl->fd = -1;
+            return false;
         }
         cfsetispeed(&options, speed);
         cfsetospeed(&options, speed);
@@ -372,75 +1076,65 @@ namespace openterface {
             return false;
         }
 
+        pImpl->baudrate = baudrate;
         pImpl->connected = true;
-        
-        // Send CH9329 initialization commands - improved sequence matching QT implementation
-        pImpl->log("Initializing CH9329 chip...");
-        
-        // Small delay to let port settle
-        usleep(50000); // 50ms
-        
-        // Send CMD_GET_PARA_CFG to check chip configuration
-        std::vector<uint8_t> get_para_cmd = {0x57, 0xAB, 0x00, 0x08, 0x00};
-        if (!pImpl->sendCommandWithChecksum(get_para_cmd)) {
-            pImpl->log("Failed to send parameter config command");
-            close(pImpl->fd);
-            pImpl->fd = -1;
-            pImpl->connected = false;
+        if (!pImpl->startRx()) {
+            pImpl->closePort();
             return false;
         }
         
-        usleep(100000); // 100ms delay to allow response
+        // Send CH9329 initialization commands - improved sequence matching QT implementation.
+        // Every step waits for the chip's reply rather than a fixed delay.
+        pImpl->log("Initializing CH9329 chip...");
         
-        // Read response to check configuration  
-        auto config_response = readData();
+        // Send CMD_GET_PARA_CFG to check chip configuration; the first packet after opening the
+        // port gets a second chance
+        Impl::Response config_response;
+        bool config_answered = false;
+        for (int attempt = 0; attempt < 2 && !config_answered; attempt++) {
+            config_answered = pImpl->request(ch9329::command<ch9329::CMD_GET_PARA_CFG>(), 100, &config_response);
+        }
         bool config_ok = false;
         
-        if (!config_response.empty() && config_response.size() >= 6) {
-            pImpl->log("Got parameter config response (" + std::to_string(config_response.size()) + " bytes)");
+        if (config_answered && !config_response.payload.empty()) {
+            pImpl->log("Got parameter config response (" + std::to_string(config_response.payload.size()) + " bytes)");
             
-            // Check if mode is correct (byte 5 should be 0x82)
-            if (config_response.size() > 5 && config_response[5] == 0x82) {
+            // Check if mode is correct (first configuration byte should be 0x82)
+            if (config_response.payload[0] == 0x82) {
                 pImpl->log("CH9329 is in correct mode (0x82)");
                 config_ok = true;
             } else {
                 pImpl->log("CH9329 mode incorrect (got 0x" + 
-                          std::to_string(config_response[5]) + "), attempting reset");
+                          std::to_string(config_response.payload[0]) + "), attempting reset");
                           
                 // Reset and reconfigure chip to proper mode
                 if (pImpl->resetChip()) {
                     config_ok = true;
                 } else {
                     pImpl->log("Failed to reset CH9329 chip");
-                    close(pImpl->fd);
-                    pImpl->fd = -1;
-                    pImpl->connected = false;
+                    pImpl->closePort();
                     return false;
                 }
             }
         } else {
             pImpl->log("No response to parameter config command at " + std::to_string(baudrate) + " baud");
             
-            // If this is 115200 baud and no response, try reconfiguring at 9600
-            if (baudrate == 115200) {
+            // No response above 9600: the chip may be at another rate, else reconfigure at 9600
+            if (baudrate != 9600) {
                 pImpl->log("Will try fallback to 9600 baud for reconfiguration");
-                close(pImpl->fd);
-                pImpl->fd = -1;
-                pImpl->connected = false;
+                pImpl->closePort();
                 return false; // Let connect() try next baud rate
             } else {
                 // If we're at 9600 and still no response, try hardware factory reset first
                 pImpl->log("No response at 9600 baud - attempting hardware factory reset");
                 if (pImpl->factoryResetChip()) {
                     // After factory reset, try software reset sequence
-                    sleep(1); // Wait 1 second for complete reset
+                    pImpl->waitForChip(1000); // Up to 1 second for complete reset
                     if (pImpl->resetChip()) {
                         config_ok = true;
                     } else {
                         pImpl->log("Failed to reset CH9329 chip after factory reset");
-                        close(pImpl->fd);
-                        pImpl->fd = -1;
-                        pImpl->connected = false;
+                        pImpl->closePort();
                         return false;
                     }
                 } else {
@@ -450,9 +1144,7 @@ namespace openterface {
                         config_ok = true;
                     } else {
                         pImpl->log("Failed to reset CH9329 chip at 9600 baud");
-                        close(pImpl->fd);
-                        pImpl->fd = -1;
-                        pImpl->connected = false;
+                        pImpl->closePort();
                         return false;
                     }
                 }
@@ -461,31 +1153,22 @@ namespace openterface {
         
         if (!config_ok) {
             pImpl->log("CH9329 configuration failed");
-            close(pImpl->fd);
-            pImpl->fd = -1;
-            pImpl->connected = false;
+            pImpl->closePort();
             return false;
         }
         
-        // Send CMD_GET_INFO to check target connection status
-        std::vector<uint8_t> get_info_cmd = {0x57, 0xAB, 0x00, 0x01, 0x00};
-        if (pImpl->sendCommandWithChecksum(get_info_cmd)) {
-            usleep(50000); // 50ms delay
-            auto info_response = readData();
-            if (!info_response.empty()) {
-                pImpl->log("CH9329 info command successful - device ready");
-                pImpl->target_connected = true;
-            } else {
-                pImpl->log("Warning: No response from CH9329 to info command");
-                pImpl->target_connected = false;
-            }
+        // Send CMD_GET_INFO to check target connection status (the reader records it)
+        if (refreshInfo()) {
+            pImpl->log(std::string("CH9329 info command successful - device ready, target ") +
+                       (pImpl->target_connected ? "connected" : "not connected"));
         } else {
-            pImpl->log("Failed to send info command");
+            pImpl->log("Warning: No response from CH9329 to info command");
             // Don't fail here - device might still work
             pImpl->target_connected = false;
         }
         
         pImpl->log("CH9329 initialized successfully");
+        pImpl->startTx();
         return true;
 #else
         pImpl->log("Serial communication not supported on this platform");
@@ -494,15 +1177,12 @@ namespace openterface {
     }
 
     void Serial::disconnect() {
-        if (pImpl->connected) {
+        // A link that died is no longer connected but still has its fd and threads
+        if (pImpl->connected || pImpl->fd != -1) {
             pImpl->log("Disconnecting from " + pImpl->port_name);
-#ifdef __linux__
-            if (pImpl->fd != -1) {
-                close(pImpl->fd);
-                pImpl->fd = -1;
-            }
-#endif
-            pImpl->connected = false;
+
+            // Queued input still goes out before the port closes
+            pImpl->closePort();
             pImpl->target_connected = false;
         }
     }
@@ -519,26 +1199,10 @@ namespace openterface {
             return {};
 
 #ifdef __linux__
+        // Frames the reader thread received that no request was waiting for
         std::vector<uint8_t> buffer;
-        uint8_t byte_buffer[256];
-        
-        // Use non-blocking read
-        ssize_t bytes_read = read(pImpl->fd, byte_buffer, sizeof(byte_buffer));
-        if (bytes_read > 0) {
-            buffer.assign(byte_buffer, byte_buffer + bytes_read);
-            
-            // Log received data
-            std::string hex_str = "Received " + std::to_string(bytes_read) + " bytes: ";
-            for (auto byte : buffer) {
-                char hex[4];
-                sprintf(hex, "%02X ", byte);
-                hex_str += hex;
-            }
-            pImpl->log(hex_str);
-        } else if (bytes_read == -1 && errno != EAGAIN && errno != EWOULDBLOCK) {
-            pImpl->log("Error reading from serial port: " + std::string(strerror(errno)));
-        }
-        
+        std::lock_guard<std::mutex> lock(pImpl->rx_mutex);
+        buffer.swap(pImpl->rx_unclaimed);
         return buffer;
 #else
         // Simulate reading some data
@@ -550,117 +1214,135 @@ namespace openterface {
         if (!pImpl->connected)
             return false;
 
-        pImpl->log("Sending key press: " + std::to_string(key_code) + " (mod: " + std::to_string(modifiers) + ")");
+        if (pImpl->verbose.load(std::memory_order_relaxed)) {
+            pImpl->log("Sending key press: " + std::to_string(key_code) + " (mod: " + std::to_string(modifiers) + ")");
+        }
 
-        // CH9329 keyboard command format: 57 AB 00 02 08 [mod] 00 [key1-6]
-        std::vector<uint8_t> cmd = {
-            0x57, 0xAB, 0x00, 0x02, 0x08,
-            static_cast<uint8_t>(modifiers), // Byte 5: modifiers (Ctrl=0x01, Shift=0x02, Alt=0x04, Meta=0x08)
-            0x00,                            // Byte 6: reserved
-            static_cast<uint8_t>(key_code),  // Byte 7: first key
-            0x00, 0x00, 0x00, 0x00, 0x00     // Bytes 8-12: remaining keys (up to 6 total)
-        };
-        return sendData(cmd);
+        // Modifiers: Ctrl=0x01, Shift=0x02, Alt=0x04, Meta=0x08
+        return pImpl->sendPacket(ch9329::keyboard(static_cast<uint8_t>(modifiers), static_cast<uint8_t>(key_code)));
     }
 
     bool Serial::sendKeyRelease(int key_code, int modifiers) {
         if (!pImpl->connected)
             return false;
 
-        pImpl->log("Sending key release: " + std::to_string(key_code));
+        if (pImpl->verbose.load(std::memory_order_relaxed)) {
+            pImpl->log("Sending key release: " + std::to_string(key_code));
+        }
 
         // Send all zeros to release
-        std::vector<uint8_t> cmd = {0x57, 0xAB, 0x00, 0x02, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
-        return sendData(cmd);
+        constexpr auto release = ch9329::keyboard(0, 0);
+        return pImpl->sendPacket(release);
     }
 
     bool Serial::sendMouseMove(int x, int y, bool absolute) {
         if (!pImpl->connected)
             return false;
 
-        pImpl->log("Mouse move: " + std::to_string(x) + "," + std::to_string(y) + (absolute ? " (abs)" : " (rel)"));
-
-        // EXACT Qt implementation approach: build command without checksum, then sendData adds it
-        std::vector<uint8_t> cmd;
-        if (absolute) {
-            // Absolute mouse prefix: 57 AB 00 04 07 02
-            cmd = {0x57, 0xAB, 0x00, 0x04, 0x07, 0x02};
-            cmd.push_back(0x00); // mouse_event (no button for move)
-            cmd.push_back(static_cast<uint8_t>(x & 0xFF));        // x_low
-            cmd.push_back(static_cast<uint8_t>((x >> 8) & 0xFF)); // x_high  
-            cmd.push_back(static_cast<uint8_t>(y & 0xFF));        // y_low
-            cmd.push_back(static_cast<uint8_t>((y >> 8) & 0xFF)); // y_high
-            cmd.push_back(0x00); // wheel (no wheel for move)
-        } else {
-            // Relative mouse prefix: 57 AB 00 05 05 01  
-            cmd = {0x57, 0xAB, 0x00, 0x05, 0x05, 0x01};
-            cmd.push_back(0x00); // mouse_event (no button for move)
-            
-            // Handle signed 8-bit values for relative movement (matching QT implementation)
-            int8_t dx = static_cast<int8_t>(std::max(-127, std::min(127, x)));
-            int8_t dy = static_cast<int8_t>(std::max(-127, std::min(127, y)));
-            
-            cmd.push_back(static_cast<uint8_t>(dx)); // dx as signed byte
-            cmd.push_back(static_cast<uint8_t>(dy)); // dy as signed byte  
-            cmd.push_back(0x00); // wheel (no wheel for move)
+        // Moves coalesce in the writer thread: only the newest position (or the summed deltas) is
+        // sent once the previous packet has left the UART
+        if (pImpl->tx_running.load()) {
+            if (absolute) {
+                pImpl->queueMotion(x, y);
+            } else {
+                pImpl->queueDelta(x, y);
+            }
+            return true;
         }
 
-        // sendData will add checksum (matching Qt's sendCommandAsync behavior)
-        return sendData(cmd);
+        uint8_t buttons = pImpl->buttons_held.load();
+        return absolute ? pImpl->sendPacket(ch9329::absoluteMouse(buttons, x, y))
+                        : pImpl->sendPacket(ch9329::relativeMouse(buttons, std::clamp(x, -127, 127),
+                                                                  std::clamp(y, -127, 127)));
     }
 
     bool Serial::sendMouseButton(int button, bool pressed, int x, int y, bool absolute) {
         if (!pImpl->connected)
             return false;
 
-        pImpl->log("Mouse button " + std::to_string(button) + (pressed ? " pressed" : " released"));
-
-        // CH9329 mouse button command based on original Qt implementation
-        std::vector<uint8_t> cmd;
-        if (absolute) {
-            // Absolute mouse: 57 AB 00 04 07 02 [button] [x_low] [x_high] [y_low] [y_high] [wheel] [checksum]
-            cmd = {0x57, 0xAB, 0x00, 0x04, 0x07, 0x02};
-        } else {
-            // Relative mouse: 57 AB 00 05 05 01 [button] [dx] [dy] [wheel] [checksum]
-            cmd = {0x57, 0xAB, 0x00, 0x05, 0x05, 0x01};
+        if (pImpl->verbose.load(std::memory_order_relaxed)) {
+            pImpl->log("Mouse button " + std::to_string(button) + (pressed ? " pressed" : " released"));
         }
-        
-        // Button mapping based on Qt::MouseButton values: 1=left, 2=right, 4=middle
-        uint8_t button_mask = 0;
-        if (pressed) {
-            switch (button) {
-                case 1: button_mask = 0x01; break; // Left button (Qt::LeftButton)
-                case 2: button_mask = 0x02; break; // Right button (Qt::RightButton)  
-                case 3: case 4: button_mask = 0x04; break; // Middle button (Qt::MiddleButton)
-            }
+
+        // Button mapping based on Qt::MouseButton values: 1=left, 2=right, 4=middle. The report
+        // carries every held button, so drags and chords survive the other button's events.
+        uint8_t button_bit = 0;
+        switch (button) {
+            case 1: button_bit = 0x01; break; // Left button (Qt::LeftButton)
+            case 2: button_bit = 0x02; break; // Right button (Qt::RightButton)
+            case 3: case 4: button_bit = 0x04; break; // Middle button (Qt::MiddleButton)
         }
-        
-        cmd.push_back(button_mask);
+        uint8_t button_mask = pressed ? pImpl->buttons_held.fetch_or(button_bit) | button_bit
+                                      : pImpl->buttons_held.fetch_and(static_cast<uint8_t>(~button_bit)) & ~button_bit;
+
         if (absolute) {
-            cmd.push_back(static_cast<uint8_t>(x & 0xFF));
-            cmd.push_back(static_cast<uint8_t>((x >> 8) & 0xFF));
-            cmd.push_back(static_cast<uint8_t>(y & 0xFF));
-            cmd.push_back(static_cast<uint8_t>((y >> 8) & 0xFF));
-            cmd.push_back(0x00); // No wheel movement
-        } else {
-            cmd.push_back(static_cast<uint8_t>(x & 0xFF));
-            cmd.push_back(static_cast<uint8_t>(y & 0xFF));
-            cmd.push_back(0x00); // No wheel movement
+            // The click moves the pointer to its own position, which supersedes an older pending move
+            pImpl->tx_motion.store(0, std::memory_order_release);
+            return pImpl->sendPacket(ch9329::absoluteMouse(button_mask, x, y));
         }
+        pImpl->queuePendingDelta();
+        return pImpl->sendPacket(
+            ch9329::relativeMouse(button_mask, std::clamp(x, -127, 127), std::clamp(y, -127, 127)));
+    }
+
+    bool Serial::sendMouseWheel(int steps) {
+        if (!pImpl->connected)
+            return false;
 
-        return sendData(cmd);
+        // Relative report without motion; held buttons stay down
+        int8_t wheel = static_cast<int8_t>(std::clamp(steps, -127, 127));
+        return pImpl->sendPacket(ch9329::relativeMouse(pImpl->buttons_held.load(), 0, 0, wheel));
     }
 
     bool Serial::sendText(const std::string &text) {
         if (!pImpl->connected)
             return false;
 
-        pImpl->log("Sending text: '" + text + "'");
+        // Never the text itself: this is used for passwords
+        if (pImpl->verbose.load(std::memory_order_relaxed)) {
+            pImpl->log("Sending text (" + std::to_string(text.size()) + " bytes)");
+        }
+
+        TextEncoder encoder;
+        std::vector<KeyboardReport> reports;
+        size_t skipped = encoder.encode(text, reports);
+        if (skipped > 0) {
+            pImpl->log("Skipping " + std::to_string(skipped) + " characters the keyboard layout can't type");
+        }
+        return sendKeyboardReports(reports);
+    }
+
+    bool Serial::sendKeyboardReports(const std::vector<KeyboardReport> &reports) {
+        if (!pImpl->connected)
+            return false;
+
+        // Paced by the chip's acknowledgements; a chip that doesn't send them is paced by the
+        // transmit queue draining instead
+        uint32_t acks_base = pImpl->input_acks.load();
+        bool acknowledged = true;
+        for (size_t i = 0; i < reports.size(); i++) {
+            if (acknowledged) {
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(100);
+                // Acknowledgements of other input (the mouse) may count too, which only loosens it
+                auto in_flight = [&]() {
+                    size_t acked = pImpl->input_acks.load() - acks_base;
+                    return i > acked ? i - acked : 0;
+                };
+                while (in_flight() >= kTextWindow) {
+                    if (std::chrono::steady_clock::now() > deadline) {
+                        pImpl->log("No acknowledgements from CH9329, pacing text by the transmit queue");
+                        acknowledged = false;
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+                }
+            } else if (i % kTextWindow == 0) {
+                pImpl->waitTxIdle();
+            }
 
-        // Send each character as a key press/release
-        for (char c : text) {
-            sendKeyPress(static_cast<int>(c), 0);
-            sendKeyRelease(static_cast<int>(c), 0);
+            if (!pImpl->sendPacket(ch9329::keyboard(reports[i].modifiers, reports[i].keys))) {
+                return false;
+            }
         }
         return true;
     }
@@ -683,9 +1365,7 @@ namespace openterface {
 
         pImpl->log("Resetting CH9329 HID");
 
-        // CH9329 reset command
-        std::vector<uint8_t> cmd = {0x57, 0xAB, 0x00, 0x0F, 0x00};
-        return sendData(cmd);
+        return pImpl->sendPacket(ch9329::command<ch9329::CMD_RESET>());
     }
 
     bool Serial::factoryReset() {
@@ -695,13 +1375,14 @@ namespace openterface {
         }
 
         pImpl->log("Performing factory reset of CH9329 chip");
+        pImpl->waitTxIdle();
         
         // Perform hardware factory reset using RTS pin
         bool hardware_reset_success = pImpl->factoryResetChip();
         
         if (hardware_reset_success) {
             // After hardware reset, perform software reconfiguration
-            sleep(1); // Wait 1 second for complete reset
+            pImpl->waitForChip(1000); // Up to 1 second for complete reset
             
             bool software_reset_success = pImpl->resetChip();
             
@@ -718,6 +1399,107 @@ namespace openterface {
         }
     }
 
+    void Serial::setVerbose(bool enabled) { pImpl->verbose = enabled; }
+
+    bool Serial::negotiateBaudRate(int max_baud) {
+        if (!pImpl->connected)
+            return false;
+
+        // Exclusive use of the port while the rate changes under it
+        pImpl->stopTx();
+
+        Impl::Response config;
+        if (!pImpl->request(ch9329::command<ch9329::CMD_GET_PARA_CFG>(), 200, &config) ||
+            config.payload.size() < kConfigBaudOffset + 4) {
+            pImpl->log("Could not read CH9329 configuration for baud negotiation");
+            pImpl->startTx();
+            return false;
+        }
+
+        int initial = pImpl->baudrate;
+        for (int baud : kLinkBaudRates) {
+            if (baud <= initial) {
+                break;
+            }
+            if (max_baud > 0 && baud > max_baud) {
+                continue;
+            }
+            pImpl->log("Trying " + std::to_string(baud) + " baud");
+            if (pImpl->switchBaudRate(config.payload, baud)) {
+                break;
+            }
+        }
+
+        if (pImpl->baudrate != initial) {
+            pImpl->log("Serial link running at " + std::to_string(pImpl->baudrate) + " baud (saved on the CH9329)");
+        } else {
+            pImpl->log("Serial link staying at " + std::to_string(initial) + " baud");
+        }
+        pImpl->startTx();
+        return pImpl->baudrate != initial;
+    }
+
+    bool Serial::runBenchmark(int round_trips, int packets, SerialBenchmark &result) {
+        result = SerialBenchmark();
+        if (!pImpl->connected)
+            return false;
+        result.baudrate = pImpl->baudrate;
+
+        pImpl->waitTxIdle();
+
+        // Latency: command out, reply in, one at a time
+        for (int i = 0; i < round_trips; i++) {
+            double milliseconds;
+            if (pImpl->roundTrip(milliseconds)) {
+                result.latencies_ms.push_back(milliseconds);
+            } else {
+                result.timeouts++;
+            }
+        }
+        std::sort(result.latencies_ms.begin(), result.latencies_ms.end());
+
+        // Throughput: back-to-back motion-free relative reports, as fast as the link takes them,
+        // counted until the chip has acknowledged the last one
+        constexpr auto report = ch9329::relativeMouse(0, 0, 0);
+        constexpr int kBatch = 16;
+        uint8_t batch[report.size() * kBatch];
+        for (int i = 0; i < kBatch; i++) {
+            memcpy(batch + i * report.size(), report.data(), report.size());
+        }
+
+        uint32_t acks_before = pImpl->input_acks.load();
+        auto start = std::chrono::steady_clock::now();
+        while (result.packets_sent < packets) {
+            int count = std::min(kBatch, packets - result.packets_sent);
+            if (!pImpl->writePackets(batch, report.size() * count)) {
+                break;
+            }
+            result.packets_sent += count;
+        }
+
+        // The reader counts acknowledgements; stop once they stall for 100 ms
+        auto last = std::chrono::steady_clock::now();
+        uint32_t acked = pImpl->input_acks.load() - acks_before;
+        while (acked < static_cast<uint32_t>(result.packets_sent) &&
+               std::chrono::steady_clock::now() - last < std::chrono::milliseconds(100)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            uint32_t now_acked = pImpl->input_acks.load() - acks_before;
+            if (now_acked != acked) {
+                acked = now_acked;
+                last = std::chrono::steady_clock::now();
+            }
+        }
+        result.packets_acked = static_cast<int>(acked);
+        result.seconds = std::chrono::duration<double>(last - start).count();
+        return result.packets_sent == packets;
+    }
+
+    bool Serial::refreshInfo(int timeout_ms) {
+        if (!pImpl->connected)
+            return false;
+        return pImpl->request(ch9329::command<ch9329::CMD_GET_INFO>(), timeout_ms);
+    }
+
     SerialInfo Serial::getInfo() const {
         SerialInfo info;
         info.port_name = pImpl->port_name;
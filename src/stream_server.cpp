@@ -0,0 +1,878 @@
+#include "openterface/stream_server.hpp"
+#include "openterface/jpeg_parser.hpp"
+#include "openterface/serial.hpp"
+#include "openterface/video.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <linux/videodev2.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace openterface {
+
+    namespace {
+        constexpr size_t kMaxRequestSize = 8192;
+        constexpr size_t kMaxWebSocketMessage = 4096;  // Input commands are a few bytes
+        // Connections that aren't viewers (yet) must be done by then, or they would hold a
+        // max_clients slot: one that never finishes its request, or never reads its response
+        constexpr auto kRequestTimeout = std::chrono::seconds(10);
+        constexpr const char *kWebSocketGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+        constexpr const char *kBoundary = "openterface-frame";
+
+        // epoll ids of the two non-client descriptors; clients count up from kFirstClientId
+        constexpr uint64_t kListenId = 0;
+        constexpr uint64_t kWakeId = 1;
+        constexpr uint64_t kFirstClientId = 2;
+
+        constexpr const char *kIndexPage =
+            "<!DOCTYPE html><html><head><meta charset=\"utf-8\"><title>Openterface KVM</title>"
+            "<style>html,body{margin:0;height:100%;background:#000}"
+            "img{width:100%;height:100%;object-fit:contain}</style></head>"
+            "<body><img src=\"/stream\" alt=\"Openterface KVM\"></body></html>";
+
+        // A published frame, shared by every viewer sending it
+        struct StreamFrame {
+            std::vector<uint8_t> data;
+            uint64_t sequence = 0;
+        };
+
+        enum class ClientKind {
+            Request,    // Request not complete yet
+            Response,   // One fixed response (page, error) and close
+            Snapshot,   // The next frame as a single image, then close
+            Multipart,  // multipart/x-mixed-replace stream
+            WebSocket,
+        };
+
+        struct Client {
+            int fd = -1;
+            ClientKind kind = ClientKind::Request;
+            std::chrono::steady_clock::time_point deadline;  // Closed then unless it became a viewer
+            std::string input;  // Request bytes, then WebSocket frames from the viewer
+
+            // Message in flight: prefix (HTTP header, part header or WebSocket frame header), the
+            // shared payload, then suffix. `sent` counts over all three.
+            std::string prefix;
+            std::shared_ptr<const StreamFrame> frame;
+            std::string suffix;
+            size_t sent = 0;
+
+            uint64_t last_sequence = 0;  // Newest frame queued to this viewer
+            std::string control;         // WebSocket control frames waiting for the message in flight
+            bool close_after_send = false;
+            bool want_write = false;     // EPOLLOUT registered
+
+            size_t pending() const { return prefix.size() + (frame ? frame->data.size() : 0) + suffix.size(); }
+            bool isViewer() const { return kind == ClientKind::Multipart || kind == ClientKind::WebSocket; }
+        };
+
+        uint32_t rotateLeft(uint32_t value, int bits) { return (value << bits) | (value >> (32 - bits)); }
+
+        // SHA-1 for the WebSocket handshake (RFC 6455 section 4.2.2), nothing security-relevant
+        std::array<uint8_t, 20> sha1(const std::string &message) {
+            uint32_t h[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+            std::string data = message;
+            uint64_t bit_length = static_cast<uint64_t>(message.size()) * 8;
+            data.push_back(static_cast<char>(0x80));
+            while (data.size() % 64 != 56) {
+                data.push_back('\0');
+            }
+            for (int shift = 56; shift >= 0; shift -= 8) {
+                data.push_back(static_cast<char>((bit_length >> shift) & 0xFF));
+            }
+
+            for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+                uint32_t w[80];
+                for (int i = 0; i < 16; i++) {
+                    const auto *p = reinterpret_cast<const uint8_t *>(data.data() + chunk + i * 4);
+                    w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+                }
+                for (int i = 16; i < 80; i++) {
+                    w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+                }
+
+                uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+                for (int i = 0; i < 80; i++) {
+                    uint32_t f, k;
+                    if (i < 20) {
+                        f = (b & c) | (~b & d);
+                        k = 0x5A827999;
+                    } else if (i < 40) {
+                        f = b ^ c ^ d;
+                        k = 0x6ED9EBA1;
+                    } else if (i < 60) {
+                        f = (b & c) | (b & d) | (c & d);
+                        k = 0x8F1BBCDC;
+                    } else {
+                        f = b ^ c ^ d;
+                        k = 0xCA62C1D6;
+                    }
+                    uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+                    e = d;
+                    d = c;
+                    c = rotateLeft(b, 30);
+                    b = a;
+                    a = temp;
+                }
+                h[0] += a;
+                h[1] += b;
+                h[2] += c;
+                h[3] += d;
+                h[4] += e;
+            }
+
+            std::array<uint8_t, 20> digest;
+            for (int i = 0; i < 20; i++) {
+                digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+            }
+            return digest;
+        }
+
+        std::string base64(const uint8_t *data, size_t size) {
+            static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+            std::string out;
+            for (size_t i = 0; i < size; i += 3) {
+                uint32_t group = uint32_t(data[i]) << 16;
+                if (i + 1 < size) group |= uint32_t(data[i + 1]) << 8;
+                if (i + 2 < size) group |= data[i + 2];
+                out.push_back(kAlphabet[(group >> 18) & 0x3F]);
+                out.push_back(kAlphabet[(group >> 12) & 0x3F]);
+                out.push_back(i + 1 < size ? kAlphabet[(group >> 6) & 0x3F] : '=');
+                out.push_back(i + 2 < size ? kAlphabet[group & 0x3F] : '=');
+            }
+            return out;
+        }
+
+        // Server-to-viewer frame header: final fragment, unmasked
+        std::string webSocketHeader(uint8_t opcode, size_t size) {
+            std::string header(1, static_cast<char>(0x80 | opcode));
+            if (size < 126) {
+                header.push_back(static_cast<char>(size));
+            } else if (size <= 0xFFFF) {
+                header.push_back(static_cast<char>(126));
+                header.push_back(static_cast<char>(size >> 8));
+                header.push_back(static_cast<char>(size & 0xFF));
+            } else {
+                header.push_back(static_cast<char>(127));
+                for (int shift = 56; shift >= 0; shift -= 8) {
+                    header.push_back(static_cast<char>((static_cast<uint64_t>(size) >> shift) & 0xFF));
+                }
+            }
+            return header;
+        }
+
+        std::string lowercase(std::string text) {
+            std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return std::tolower(c); });
+            return text;
+        }
+
+        // Browsers send Origin on every WebSocket handshake, so a page from another site opening /ws
+        // (and driving the target through it) shows up as an Origin whose host differs from Host.
+        // Clients that aren't browsers send none and aren't subject to cross-site requests.
+        bool sameOrigin(const std::string &origin, const std::string &host) {
+            if (origin.empty()) {
+                return true;
+            }
+            size_t scheme_end = origin.find("://");
+            if (scheme_end == std::string::npos || host.empty()) {
+                return false;  // Includes the opaque "null" origin of sandboxed pages and file:// URLs
+            }
+            std::string authority = origin.substr(scheme_end + 3);
+            authority = authority.substr(0, authority.find('/'));
+            return lowercase(authority) == lowercase(host);
+        }
+
+        std::string httpResponse(const char *status, const char *content_type, size_t content_length) {
+            return std::string("HTTP/1.1 ") + status + "\r\nContent-Type: " + content_type +
+                   "\r\nContent-Length: " + std::to_string(content_length) +
+                   "\r\nCache-Control: no-store\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n";
+        }
+    } // namespace
+
+    class StreamServer::Impl {
+      public:
+        int listen_fd = -1;
+        int epoll_fd = -1;
+        int wake_fd = -1;  // eventfd: a frame was published, or stop()
+        std::thread io_thread;
+        std::atomic<bool> running{false};
+
+        int max_clients = 32;
+        std::shared_ptr<Serial> serial;
+        std::string last_error;
+
+        // Sockets, owned by the I/O thread
+        std::map<uint64_t, Client> clients;
+        uint64_t next_client_id = kFirstClientId;
+        std::atomic<int> connections{0};  // clients.size(), for publishFrame
+
+        std::mutex frame_mutex;
+        std::shared_ptr<const StreamFrame> latest;
+        uint64_t next_sequence = 0;
+
+        std::atomic<int> viewers{0};
+        std::atomic<uint64_t> frames_published{0};
+        std::atomic<uint64_t> frames_sent{0};
+        std::atomic<uint64_t> frames_dropped{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> input_events{0};
+
+        void log(const std::string &msg) { std::cout << "[STREAM] " << msg << std::endl; }
+
+        std::shared_ptr<const StreamFrame> latestFrame() {
+            std::lock_guard<std::mutex> lock(frame_mutex);
+            return latest;
+        }
+
+        void closeDescriptors();
+        void ioLoop();
+        void acceptClients();
+        void closeClient(uint64_t id);
+        // Close the connections past their deadline; milliseconds to the next one, -1 = none
+        int expireClients();
+        bool readClient(Client &client);
+        bool handleRequest(Client &client);
+        bool handleWebSocketInput(Client &client);
+        void handleInputCommand(const std::string &command);
+        bool queueFrame(Client &client);
+        // Write as much as the socket takes, queueing the next frame or control message whenever
+        // the one in flight is out. False = close the connection.
+        bool flush(Client &client);
+        void updateInterest(uint64_t id, Client &client);
+    };
+
+    void StreamServer::Impl::closeDescriptors() {
+        for (int *fd : {&listen_fd, &epoll_fd, &wake_fd}) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+
+    void StreamServer::Impl::ioLoop() {
+        epoll_event events[64];
+        while (running) {
+            int count = epoll_wait(epoll_fd, events, 64, expireClients());
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                log("epoll_wait failed: " + std::string(strerror(errno)));
+                break;
+            }
+
+            for (int i = 0; i < count && running; i++) {
+                uint64_t id = events[i].data.u64;
+
+                if (id == kWakeId) {
+                    uint64_t value;
+                    if (read(wake_fd, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+                        log("Wake-up read failed: " + std::string(strerror(errno)));
+                    }
+                    // New frame: every idle viewer starts on it, busy ones pick it up when done
+                    std::vector<uint64_t> failed;
+                    for (auto &[client_id, client] : clients) {
+                        if (client.pending() > 0) {
+                            continue;
+                        }
+                        if (flush(client)) {
+                            updateInterest(client_id, client);
+                        } else {
+                            failed.push_back(client_id);
+                        }
+                    }
+                    for (uint64_t client_id : failed) {
+                        closeClient(client_id);
+                    }
+                    continue;
+                }
+                if (id == kListenId) {
+                    acceptClients();
+                    continue;
+                }
+
+                auto it = clients.find(id);
+                if (it == clients.end()) {
+                    continue;  // Closed earlier in this batch
+                }
+                Client &client = it->second;
+                bool ok = !(events[i].events & (EPOLLERR | EPOLLHUP));
+                if (ok && (events[i].events & EPOLLIN)) {
+                    ok = readClient(client);
+                }
+                if (ok && (events[i].events & EPOLLOUT)) {
+                    ok = flush(client);
+                }
+                if (ok) {
+                    updateInterest(id, client);
+                } else {
+                    closeClient(id);
+                }
+            }
+        }
+    }
+
+    void StreamServer::Impl::acceptClients() {
+        while (true) {
+            int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    log("accept failed: " + std::string(strerror(errno)));
+                }
+                return;
+            }
+
+            if (static_cast<int>(clients.size()) >= max_clients) {
+                std::string busy = httpResponse("503 Service Unavailable", "text/plain", 0);
+                send(fd, busy.data(), busy.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                close(fd);
+                continue;
+            }
+
+            // Frame tails go out at once instead of waiting for Nagle
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            uint64_t id = next_client_id++;
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u64 = id;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+                close(fd);
+                continue;
+            }
+            clients[id].fd = fd;
+            clients[id].deadline = std::chrono::steady_clock::now() + kRequestTimeout;
+            connections = static_cast<int>(clients.size());
+        }
+    }
+
+    int StreamServer::Impl::expireClients() {
+        auto now = std::chrono::steady_clock::now();
+        std::vector<uint64_t> expired;
+        auto next = std::chrono::steady_clock::time_point::max();
+        for (auto &[id, client] : clients) {
+            if (client.isViewer()) {
+                continue;
+            }
+            if (client.deadline <= now) {
+                expired.push_back(id);
+            } else {
+                next = std::min(next, client.deadline);
+            }
+        }
+        for (uint64_t id : expired) {
+            closeClient(id);
+        }
+        if (!expired.empty()) {
+            log("Closed " + std::to_string(expired.size()) + " connection(s) that didn't complete a request in time");
+        }
+
+        if (next == std::chrono::steady_clock::time_point::max()) {
+            return -1;
+        }
+        // Rounded up, so the wake-up doesn't land just before the deadline
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - now) + std::chrono::milliseconds(1);
+        return static_cast<int>(wait.count());
+    }
+
+    void StreamServer::Impl::closeClient(uint64_t id) {
+        auto it = clients.find(id);
+        if (it == clients.end()) {
+            return;
+        }
+        if (it->second.isViewer()) {
+            viewers--;
+        }
+        close(it->second.fd);  // Also removes it from the epoll set
+        clients.erase(it);
+        connections = static_cast<int>(clients.size());
+
+        // Nobody left: frames stop being copied, so don't hand a stale one to the next viewer
+        if (clients.empty()) {
+            std::lock_guard<std::mutex> lock(frame_mutex);
+            latest.reset();
+        }
+    }
+
+    bool StreamServer::Impl::readClient(Client &client) {
+        char buffer[4096];
+        while (true) {
+            ssize_t n = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (n > 0) {
+                if (client.kind == ClientKind::Request || client.kind == ClientKind::WebSocket) {
+                    client.input.append(buffer, static_cast<size_t>(n));
+                }
+                if (client.input.size() > kMaxRequestSize + kMaxWebSocketMessage) {
+                    return false;
+                }
+                continue;
+            }
+            if (n == 0) {
+                return false;  // Viewer went away
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            return false;
+        }
+
+        if (client.kind == ClientKind::Request && !handleRequest(client)) {
+            return false;
+        }
+        if (client.kind == ClientKind::WebSocket && !handleWebSocketInput(client)) {
+            return false;
+        }
+        return flush(client);
+    }
+
+    bool StreamServer::Impl::handleRequest(Client &client) {
+        size_t end = client.input.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            return client.input.size() <= kMaxRequestSize;
+        }
+
+        std::istringstream lines(client.input.substr(0, end));
+        client.input.erase(0, end + 4);
+
+        std::string request_line;
+        std::getline(lines, request_line);
+        std::istringstream request(request_line);
+        std::string method, target;
+        request >> method >> target;
+
+        std::map<std::string, std::string> headers;
+        std::string line;
+        while (std::getline(lines, line)) {
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            size_t value_start = line.find_first_not_of(" \t", colon + 1);
+            size_t value_end = line.find_last_not_of(" \t\r");
+            headers[lowercase(line.substr(0, colon))] =
+                value_start == std::string::npos ? "" : line.substr(value_start, value_end - value_start + 1);
+        }
+
+        std::string path = target.substr(0, target.find('?'));
+        auto respond = [&client](const char *status, const char *content_type, const std::string &body) {
+            client.kind = ClientKind::Response;
+            client.prefix = httpResponse(status, content_type, body.size()) + body;
+            client.close_after_send = true;
+            return true;
+        };
+
+        if (method != "GET") {
+            return respond("405 Method Not Allowed", "text/plain", "Only GET is supported\n");
+        }
+
+        if (path == "/ws") {
+            const std::string &key = headers["sec-websocket-key"];
+            if (lowercase(headers["upgrade"]) != "websocket" || key.empty()) {
+                return respond("400 Bad Request", "text/plain", "WebSocket upgrade expected\n");
+            }
+            if (!sameOrigin(headers["origin"], headers["host"])) {
+                log("Rejected WebSocket upgrade from origin " + headers["origin"]);
+                return respond("403 Forbidden", "text/plain", "Cross-origin WebSocket not allowed\n");
+            }
+            auto digest = sha1(key + kWebSocketGuid);
+            client.kind = ClientKind::WebSocket;
+            client.prefix = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                            "Sec-WebSocket-Accept: " +
+                            base64(digest.data(), digest.size()) + "\r\n\r\n";
+            viewers++;
+            return true;
+        }
+        if (path == "/stream") {
+            client.kind = ClientKind::Multipart;
+            client.prefix = std::string("HTTP/1.1 200 OK\r\nContent-Type: multipart/x-mixed-replace; boundary=") +
+                            kBoundary +
+                            "\r\nCache-Control: no-store\r\nAccess-Control-Allow-Origin: *\r\nConnection: close\r\n\r\n";
+            client.input.clear();
+            viewers++;
+            return true;
+        }
+        if (path == "/snapshot") {
+            client.kind = ClientKind::Snapshot;
+            client.input.clear();
+            return true;
+        }
+        if (path == "/" || path == "/index.html") {
+            return respond("200 OK", "text/html; charset=utf-8", kIndexPage);
+        }
+        return respond("404 Not Found", "text/plain", "Not found\n");
+    }
+
+    bool StreamServer::Impl::handleWebSocketInput(Client &client) {
+        std::string &in = client.input;
+        while (in.size() >= 2) {
+            uint8_t first = static_cast<uint8_t>(in[0]);
+            uint8_t second = static_cast<uint8_t>(in[1]);
+            uint8_t opcode = first & 0x0F;
+            uint64_t length = second & 0x7F;
+            size_t pos = 2;
+            if (length == 126) {
+                if (in.size() < 4) {
+                    return true;
+                }
+                length = (uint64_t(uint8_t(in[2])) << 8) | uint8_t(in[3]);
+                pos = 4;
+            } else if (length == 127) {
+                if (in.size() < 10) {
+                    return true;
+                }
+                length = 0;
+                for (size_t i = 2; i < 10; i++) {
+                    length = (length << 8) | uint8_t(in[i]);
+                }
+                pos = 10;
+            }
+            // Viewers must mask their frames (RFC 6455 section 5.1)
+            if (!(second & 0x80) || length > kMaxWebSocketMessage) {
+                return false;
+            }
+            if (in.size() < pos + 4 + length) {
+                return true;
+            }
+
+            const char *mask = in.data() + pos;
+            std::string payload = in.substr(pos + 4, length);
+            for (size_t i = 0; i < payload.size(); i++) {
+                payload[i] ^= mask[i % 4];
+            }
+            in.erase(0, pos + 4 + length);
+
+            switch (opcode) {
+                case 0x1:  // Text: an input command (fragmented messages aren't used for those)
+                    if (first & 0x80) {
+                        handleInputCommand(payload);
+                    }
+                    break;
+                case 0x8:  // Close: echo the status code, then hang up
+                    client.control += webSocketHeader(0x8, std::min<size_t>(payload.size(), 2)) + payload.substr(0, 2);
+                    client.close_after_send = true;
+                    return true;
+                case 0x9:  // Ping
+                    client.control += webSocketHeader(0xA, payload.size()) + payload;
+                    break;
+                default:
+                    break;
+            }
+        }
+        return true;
+    }
+
+    void StreamServer::Impl::handleInputCommand(const std::string &command) {
+        if (!serial || !serial->isConnected()) {
+            return;
+        }
+
+        std::istringstream in(command);
+        std::string verb;
+        in >> verb;
+
+        bool sent = false;
+        if (verb == "key") {
+            int code = 0, modifiers = 0;
+            std::string state;
+            if (in >> code >> modifiers >> state) {
+                if (state == "down") {
+                    sent = serial->sendKeyPress(code, modifiers);
+                } else if (state == "up") {
+                    sent = serial->sendKeyRelease(code, modifiers);
+                }
+            }
+        } else if (verb == "move") {
+            int x = 0, y = 0;
+            if (in >> x >> y) {
+                sent = serial->sendMouseMove(std::clamp(x, 0, 4095), std::clamp(y, 0, 4095), true);
+            }
+        } else if (verb == "button") {
+            std::string name, state;
+            int x = 0, y = 0;
+            if (in >> name >> state >> x >> y) {
+                // Serial's button numbering: 1 = left, 2 = right, 4 = middle
+                int button = name == "left" ? 1 : name == "right" ? 2 : name == "middle" ? 4 : 0;
+                if (button != 0 && (state == "down" || state == "up")) {
+                    sent = serial->sendMouseButton(button, state == "down", std::clamp(x, 0, 4095),
+                                                   std::clamp(y, 0, 4095), true);
+                }
+            }
+        } else if (verb == "wheel") {
+            int steps = 0;
+            if (in >> steps && steps != 0) {
+                sent = serial->sendMouseWheel(steps);
+            }
+        }
+
+        if (sent) {
+            input_events++;
+        }
+    }
+
+    bool StreamServer::Impl::queueFrame(Client &client) {
+        if (client.kind != ClientKind::Snapshot && !client.isViewer()) {
+            return false;
+        }
+        auto frame = latestFrame();
+        if (!frame || frame->sequence == client.last_sequence) {
+            return false;
+        }
+
+        if (client.last_sequence != 0 && frame->sequence > client.last_sequence + 1) {
+            frames_dropped += frame->sequence - client.last_sequence - 1;
+        }
+        client.last_sequence = frame->sequence;
+
+        size_t size = frame->data.size();
+        switch (client.kind) {
+            case ClientKind::Multipart:
+                client.prefix = std::string("--") + kBoundary + "\r\nContent-Type: image/jpeg\r\nContent-Length: " +
+                                std::to_string(size) + "\r\n\r\n";
+                client.suffix = "\r\n";
+                break;
+            case ClientKind::WebSocket:
+                client.prefix = webSocketHeader(0x2, size);
+                break;
+            default:  // Snapshot
+                client.prefix = httpResponse("200 OK", "image/jpeg", size);
+                client.close_after_send = true;
+                break;
+        }
+        client.frame = std::move(frame);
+        return true;
+    }
+
+    bool StreamServer::Impl::flush(Client &client) {
+        while (true) {
+            if (client.pending() == 0) {
+                if (!client.control.empty()) {
+                    client.prefix.swap(client.control);
+                } else if (client.close_after_send) {
+                    return false;
+                } else if (!queueFrame(client)) {
+                    return true;  // Idle until the next frame
+                }
+            }
+
+            // Header, shared payload and trailer in one call, from wherever the last one stopped
+            iovec iov[3];
+            int count = 0;
+            size_t skip = client.sent;
+            auto add = [&](const void *data, size_t size) {
+                if (skip >= size) {
+                    skip -= size;
+                    return;
+                }
+                iov[count].iov_base = const_cast<uint8_t *>(static_cast<const uint8_t *>(data) + skip);
+                iov[count].iov_len = size - skip;
+                count++;
+                skip = 0;
+            };
+            add(client.prefix.data(), client.prefix.size());
+            if (client.frame) {
+                add(client.frame->data.data(), client.frame->data.size());
+            }
+            add(client.suffix.data(), client.suffix.size());
+
+            msghdr message = {};
+            message.msg_iov = iov;
+            message.msg_iovlen = count;
+            ssize_t n = sendmsg(client.fd, &message, MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return errno == EAGAIN || errno == EWOULDBLOCK;  // Full: EPOLLOUT resumes it
+            }
+
+            client.sent += static_cast<size_t>(n);
+            bytes_sent += static_cast<uint64_t>(n);
+            if (client.sent < client.pending()) {
+                continue;
+            }
+
+            if (client.frame) {
+                frames_sent++;
+            }
+            client.prefix.clear();
+            client.suffix.clear();
+            client.frame.reset();
+            client.sent = 0;
+        }
+    }
+
+    void StreamServer::Impl::updateInterest(uint64_t id, Client &client) {
+        bool want_write = client.pending() > 0;
+        if (want_write == client.want_write) {
+            return;
+        }
+        epoll_event event = {};
+        event.events = want_write ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        event.data.u64 = id;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, client.fd, &event) == 0) {
+            client.want_write = want_write;
+        }
+    }
+
+    StreamServer::StreamServer() : pImpl(std::make_unique<Impl>()) {}
+
+    StreamServer::~StreamServer() { stop(); }
+
+    bool StreamServer::start(const std::string &address, int port) {
+        if (pImpl->running) {
+            return true;
+        }
+
+        auto fail = [this](const std::string &message) {
+            pImpl->last_error = message + ": " + strerror(errno);
+            pImpl->log(pImpl->last_error);
+            pImpl->closeDescriptors();
+            return false;
+        };
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        if (inet_pton(AF_INET, address.c_str(), &addr.sin_addr) != 1) {
+            pImpl->last_error = "Not an IPv4 address: " + address;
+            pImpl->log(pImpl->last_error);
+            return false;
+        }
+
+        pImpl->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (pImpl->listen_fd < 0) {
+            return fail("Cannot create socket");
+        }
+        int one = 1;
+        setsockopt(pImpl->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(pImpl->listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+            return fail("Cannot bind " + address + ":" + std::to_string(port));
+        }
+        if (listen(pImpl->listen_fd, SOMAXCONN) < 0) {
+            return fail("Cannot listen");
+        }
+
+        pImpl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        pImpl->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (pImpl->epoll_fd < 0 || pImpl->wake_fd < 0) {
+            return fail("Cannot create epoll/eventfd");
+        }
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = kListenId;
+        epoll_ctl(pImpl->epoll_fd, EPOLL_CTL_ADD, pImpl->listen_fd, &event);
+        event.data.u64 = kWakeId;
+        epoll_ctl(pImpl->epoll_fd, EPOLL_CTL_ADD, pImpl->wake_fd, &event);
+
+        pImpl->running = true;
+        pImpl->io_thread = std::thread([this]() { pImpl->ioLoop(); });
+        return true;
+    }
+
+    void StreamServer::stop() {
+        if (!pImpl->running) {
+            return;
+        }
+
+        pImpl->running = false;
+        uint64_t one = 1;
+        if (write(pImpl->wake_fd, &one, sizeof(one)) < 0) {
+            pImpl->log("Cannot wake the I/O thread: " + std::string(strerror(errno)));
+        }
+        if (pImpl->io_thread.joinable()) {
+            pImpl->io_thread.join();
+        }
+
+        while (!pImpl->clients.empty()) {
+            pImpl->closeClient(pImpl->clients.begin()->first);
+        }
+        pImpl->closeDescriptors();
+    }
+
+    bool StreamServer::isRunning() const { return pImpl->running; }
+
+    void StreamServer::setMaxClients(int count) { pImpl->max_clients = std::max(1, count); }
+
+    void StreamServer::setInputTarget(std::shared_ptr<Serial> serial) { pImpl->serial = std::move(serial); }
+
+    void StreamServer::publishFrame(const FrameData &frame) {
+        // Nothing is copied while nobody is connected
+        if (!pImpl->running || pImpl->connections.load(std::memory_order_relaxed) == 0) {
+            return;
+        }
+        if (frame.pixel_format != 0 && frame.pixel_format != V4L2_PIX_FMT_MJPEG &&
+            frame.pixel_format != V4L2_PIX_FMT_JPEG) {
+            return;
+        }
+        if (frame.size < 4 || frame.data[0] != 0xFF || frame.data[1] != 0xD8) {
+            return;
+        }
+
+        // The capture buffer goes back to the driver when the callback returns, so this is the one
+        // copy; viewers share it. Frames without Huffman tables get the standard ones on the way.
+        auto shared = std::make_shared<StreamFrame>();
+        size_t sos = findMissingHuffmanTables(frame.data, frame.size);
+        if (sos > 0) {
+            const auto &dht = standardHuffmanSegment();
+            shared->data.reserve(frame.size + dht.size());
+            shared->data.insert(shared->data.end(), frame.data, frame.data + sos);
+            shared->data.insert(shared->data.end(), dht.begin(), dht.end());
+            shared->data.insert(shared->data.end(), frame.data + sos, frame.data + frame.size);
+        } else {
+            shared->data.assign(frame.data, frame.data + frame.size);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(pImpl->frame_mutex);
+            shared->sequence = ++pImpl->next_sequence;
+            pImpl->latest = std::move(shared);
+        }
+        pImpl->frames_published++;
+
+        uint64_t one = 1;
+        if (write(pImpl->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN) {
+            pImpl->log("Cannot wake the I/O thread: " + std::string(strerror(errno)));
+        }
+    }
+
+    StreamServerStats StreamServer::getStats() const {
+        StreamServerStats stats;
+        stats.clients = pImpl->viewers;
+        stats.frames_published = pImpl->frames_published;
+        stats.frames_sent = pImpl->frames_sent;
+        stats.frames_dropped = pImpl->frames_dropped;
+        stats.bytes_sent = pImpl->bytes_sent;
+        stats.input_events = pImpl->input_events;
+        return stats;
+    }
+
+    const std::string &StreamServer::getLastError() const { return pImpl->last_error; }
+
+} // namespace openterface
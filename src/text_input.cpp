@@ -0,0 +1,244 @@
+#include "openterface/text_input.hpp"
+#include <algorithm>
+
+namespace openterface {
+
+    namespace {
+
+        constexpr uint8_t kShift = 0x02;
+        constexpr uint8_t kAltGr = 0x40;  // Right Alt
+
+        // HID usages by position on the keyboard (US names)
+        constexpr uint8_t kUsageA = 0x04;
+        constexpr uint8_t kUsage1 = 0x1E;  // 1..9, then 0 at 0x27
+        constexpr uint8_t kUsageEnter = 0x28;
+        constexpr uint8_t kUsageTab = 0x2B;
+        constexpr uint8_t kUsageSpace = 0x2C;
+        constexpr uint8_t kUsageMinus = 0x2D;
+        constexpr uint8_t kUsageEqual = 0x2E;
+        constexpr uint8_t kUsageLeftBracket = 0x2F;
+        constexpr uint8_t kUsageRightBracket = 0x30;
+        constexpr uint8_t kUsageBackslash = 0x31;
+        constexpr uint8_t kUsageNonUsHash = 0x32;  // ISO key left of Enter
+        constexpr uint8_t kUsageSemicolon = 0x33;
+        constexpr uint8_t kUsageApostrophe = 0x34;
+        constexpr uint8_t kUsageGrave = 0x35;
+        constexpr uint8_t kUsageComma = 0x36;
+        constexpr uint8_t kUsageDot = 0x37;
+        constexpr uint8_t kUsageSlash = 0x38;
+        constexpr uint8_t kUsageNonUsBackslash = 0x64;  // ISO key right of left Shift
+
+        constexpr uint8_t letter(char c) { return static_cast<uint8_t>(kUsageA + (c - 'a')); }
+        constexpr uint8_t digit(char c) { return c == '0' ? 0x27 : static_cast<uint8_t>(kUsage1 + (c - '1')); }
+
+        struct Entry {
+            char32_t character;
+            uint8_t usage;
+            uint8_t modifiers;
+        };
+
+        // US punctuation; "gb" starts from it too
+        constexpr Entry kUsSymbols[] = {
+            {'!', digit('1'), kShift},        {'@', digit('2'), kShift},
+            {'#', digit('3'), kShift},        {'$', digit('4'), kShift},
+            {'%', digit('5'), kShift},        {'^', digit('6'), kShift},
+            {'&', digit('7'), kShift},        {'*', digit('8'), kShift},
+            {'(', digit('9'), kShift},        {')', digit('0'), kShift},
+            {'-', kUsageMinus, 0},            {'_', kUsageMinus, kShift},
+            {'=', kUsageEqual, 0},            {'+', kUsageEqual, kShift},
+            {'[', kUsageLeftBracket, 0},      {'{', kUsageLeftBracket, kShift},
+            {']', kUsageRightBracket, 0},     {'}', kUsageRightBracket, kShift},
+            {'\\', kUsageBackslash, 0},       {'|', kUsageBackslash, kShift},
+            {';', kUsageSemicolon, 0},        {':', kUsageSemicolon, kShift},
+            {'\'', kUsageApostrophe, 0},      {'"', kUsageApostrophe, kShift},
+            {'`', kUsageGrave, 0},            {'~', kUsageGrave, kShift},
+            {',', kUsageComma, 0},            {'<', kUsageComma, kShift},
+            {'.', kUsageDot, 0},              {'>', kUsageDot, kShift},
+            {'/', kUsageSlash, 0},            {'?', kUsageSlash, kShift},
+        };
+
+        // UK ISO differences from US
+        constexpr Entry kGbSymbols[] = {
+            {'"', digit('2'), kShift},        {U'£', digit('3'), kShift},
+            {'@', kUsageApostrophe, kShift},  {'#', kUsageNonUsHash, 0},
+            {'~', kUsageNonUsHash, kShift},   {'\\', kUsageNonUsBackslash, 0},
+            {'|', kUsageNonUsBackslash, kShift}, {U'¬', kUsageGrave, kShift},
+            {U'€', digit('4'), kAltGr},
+        };
+
+        // German QWERTZ ('y' and 'z' are swapped separately)
+        constexpr Entry kDeSymbols[] = {
+            {'!', digit('1'), kShift},        {'"', digit('2'), kShift},
+            {U'§', digit('3'), kShift},       {'$', digit('4'), kShift},
+            {'%', digit('5'), kShift},        {'&', digit('6'), kShift},
+            {'/', digit('7'), kShift},        {'(', digit('8'), kShift},
+            {')', digit('9'), kShift},        {'=', digit('0'), kShift},
+            {U'²', digit('2'), kAltGr},       {U'³', digit('3'), kAltGr},
+            {'{', digit('7'), kAltGr},        {'[', digit('8'), kAltGr},
+            {']', digit('9'), kAltGr},        {'}', digit('0'), kAltGr},
+            {U'ß', kUsageMinus, 0},           {'?', kUsageMinus, kShift},
+            {'\\', kUsageMinus, kAltGr},      {U'ü', kUsageLeftBracket, 0},
+            {U'Ü', kUsageLeftBracket, kShift}, {'+', kUsageRightBracket, 0},
+            {'*', kUsageRightBracket, kShift}, {'~', kUsageRightBracket, kAltGr},
+            {'#', kUsageNonUsHash, 0},        {'\'', kUsageNonUsHash, kShift},
+            {U'ö', kUsageSemicolon, 0},       {U'Ö', kUsageSemicolon, kShift},
+            {U'ä', kUsageApostrophe, 0},      {U'Ä', kUsageApostrophe, kShift},
+            {U'°', kUsageGrave, kShift},      {',', kUsageComma, 0},
+            {';', kUsageComma, kShift},       {'.', kUsageDot, 0},
+            {':', kUsageDot, kShift},         {'-', kUsageSlash, 0},
+            {'_', kUsageSlash, kShift},       {'<', kUsageNonUsBackslash, 0},
+            {'>', kUsageNonUsBackslash, kShift}, {'|', kUsageNonUsBackslash, kAltGr},
+            {'@', letter('q'), kAltGr},       {U'€', letter('e'), kAltGr},
+            {U'µ', letter('m'), kAltGr},
+        };
+
+        // German dead keys, typed as the accent followed by Space
+        constexpr Entry kDeDeadKeys[] = {
+            {'^', kUsageGrave, 0},
+            {U'´', kUsageEqual, 0},
+            {'`', kUsageEqual, kShift},
+        };
+
+        // Decode one UTF-8 sequence; false (one byte consumed) for malformed input
+        bool decodeUtf8(std::string_view text, size_t &pos, char32_t &out) {
+            auto byte = static_cast<uint8_t>(text[pos]);
+            size_t length = byte < 0x80 ? 1 : (byte >> 5) == 0x06 ? 2 : (byte >> 4) == 0x0E ? 3 : (byte >> 3) == 0x1E ? 4 : 0;
+            if (length == 0 || pos + length > text.size()) {
+                pos++;
+                return false;
+            }
+
+            char32_t value = length == 1 ? byte : byte & (0x7F >> length);
+            for (size_t i = 1; i < length; i++) {
+                auto next = static_cast<uint8_t>(text[pos + i]);
+                if ((next & 0xC0) != 0x80) {
+                    pos++;
+                    return false;
+                }
+                value = (value << 6) | (next & 0x3F);
+            }
+            pos += length;
+            out = value;
+            return true;
+        }
+
+    } // namespace
+
+    std::vector<std::string> textLayouts() { return {"us", "gb", "de"}; }
+
+    TextEncoder::TextEncoder() { setLayout("us"); }
+
+    bool TextEncoder::setLayout(const std::string &name) {
+        std::vector<std::string> known = textLayouts();
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            return false;
+        }
+
+        layout = name;
+        keymap.clear();
+        auto add = [this](char32_t character, uint8_t usage, uint8_t modifiers) {
+            Keys keys;
+            keys.strokes[0] = Stroke{usage, modifiers};
+            keys.count = 1;
+            keymap[character] = keys;
+        };
+
+        bool german = name == "de";
+        for (char c = 'a'; c <= 'z'; c++) {
+            char position = german && c == 'y' ? 'z' : german && c == 'z' ? 'y' : c;
+            add(static_cast<char32_t>(c), letter(position), 0);
+            add(static_cast<char32_t>(c - 'a' + 'A'), letter(position), kShift);
+        }
+        for (char c = '0'; c <= '9'; c++) {
+            add(static_cast<char32_t>(c), digit(c), 0);
+        }
+        add(' ', kUsageSpace, 0);
+        add('\n', kUsageEnter, 0);
+        add('\t', kUsageTab, 0);
+
+        if (german) {
+            for (const Entry &entry : kDeSymbols) {
+                add(entry.character, entry.usage, entry.modifiers);
+            }
+            for (const Entry &entry : kDeDeadKeys) {
+                Keys keys;
+                keys.strokes[0] = Stroke{entry.usage, entry.modifiers};
+                keys.strokes[1] = Stroke{kUsageSpace, 0};
+                keys.count = 2;
+                keymap[entry.character] = keys;
+            }
+        } else {
+            for (const Entry &entry : kUsSymbols) {
+                add(entry.character, entry.usage, entry.modifiers);
+            }
+            if (name == "gb") {
+                for (const Entry &entry : kGbSymbols) {
+                    add(entry.character, entry.usage, entry.modifiers);
+                }
+            }
+        }
+        return true;
+    }
+
+    void TextEncoder::setRollover(int keys) { rollover = std::clamp(keys, 1, 6); }
+
+    size_t TextEncoder::encode(std::string_view text, std::vector<KeyboardReport> &reports) const {
+        KeyboardReport current;
+        int used = 0;
+
+        // Pressed keys then all released; a key can't repeat within one report
+        auto flush = [&]() {
+            if (used > 0) {
+                reports.push_back(current);
+                reports.push_back(KeyboardReport{});
+                current = KeyboardReport{};
+                used = 0;
+            }
+        };
+        auto press = [&](const Stroke &stroke, bool alone) {
+            bool repeated = std::find(current.keys.begin(), current.keys.begin() + used, stroke.usage) !=
+                            current.keys.begin() + used;
+            if (used > 0 && (alone || used == rollover || current.modifiers != stroke.modifiers || repeated)) {
+                flush();
+            }
+            current.modifiers = stroke.modifiers;
+            current.keys[used++] = stroke.usage;
+            if (alone) {
+                flush();
+            }
+        };
+
+        size_t skipped = 0;
+        size_t pos = 0;
+        while (pos < text.size()) {
+            char32_t character;
+            if (!decodeUtf8(text, pos, character)) {
+                skipped++;
+                continue;
+            }
+            if (character == '\r') {
+                if (pos < text.size() && text[pos] == '\n') {
+                    continue; // The '\n' types the Enter
+                }
+                character = '\n';
+            }
+
+            auto found = keymap.find(character);
+            if (found == keymap.end()) {
+                skipped++;
+                continue;
+            }
+            const Keys &keys = found->second;
+            if (keys.count == 2) {
+                // Dead key and Space must arrive in this order, so neither shares a report
+                press(keys.strokes[0], true);
+                press(keys.strokes[1], true);
+            } else {
+                press(keys.strokes[0], false);
+            }
+        }
+        flush();
+        return skipped;
+    }
+
+} // namespace openterface
@@ -0,0 +1,177 @@
+#include "openterface/video_recording.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace openterface {
+
+    namespace {
+
+        // writev until everything is on disk (regular files only return short on ENOSPC/EINTR)
+        bool writeAll(int fd, struct iovec* iov, int count) {
+            while (count > 0) {
+                ssize_t written = writev(fd, iov, count);
+                if (written < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    return false;
+                }
+                while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+                    written -= iov->iov_len;
+                    iov++;
+                    count--;
+                }
+                if (count > 0) {
+                    iov->iov_base = static_cast<uint8_t*>(iov->iov_base) + written;
+                    iov->iov_len -= written;
+                }
+            }
+            return true;
+        }
+
+    } // namespace
+
+    RecordingWriter::~RecordingWriter() { close(); }
+
+    bool RecordingWriter::open(const std::string& path, int width, int height, uint32_t pixel_format) {
+        close();
+
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            last_error = "Cannot create " + path + ": " + strerror(errno);
+            return false;
+        }
+
+        recording::RecordingHeader header{};
+        memcpy(header.magic, recording::kMagic, sizeof(header.magic));
+        header.version = recording::kVersion;
+        header.pixel_format = pixel_format;
+        header.width = static_cast<uint32_t>(width);
+        header.height = static_cast<uint32_t>(height);
+
+        struct iovec iov = {&header, sizeof(header)};
+        if (!writeAll(fd, &iov, 1)) {
+            last_error = "Cannot write " + path + ": " + strerror(errno);
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+
+        frame_count = 0;
+        bytes_written = sizeof(header);
+        return true;
+    }
+
+    bool RecordingWriter::write(const FrameData& frame) {
+        if (fd < 0) {
+            return false;
+        }
+
+        static const uint8_t padding[8] = {};
+        recording::RecordedFrameHeader header{};
+        header.timestamp_us = frame.timestamp;
+        header.size = static_cast<uint32_t>(frame.size);
+
+        struct iovec iov[3] = {
+            {&header, sizeof(header)},
+            {frame.data, frame.size},
+            {const_cast<uint8_t*>(padding), recording::align(frame.size) - frame.size},
+        };
+        if (!writeAll(fd, iov, iov[2].iov_len > 0 ? 3 : 2)) {
+            last_error = std::string("Write failed: ") + strerror(errno);
+            return false;
+        }
+
+        frame_count++;
+        bytes_written += sizeof(header) + recording::align(frame.size);
+        return true;
+    }
+
+    void RecordingWriter::close() {
+        if (fd < 0) {
+            return;
+        }
+        pwrite(fd, &frame_count, sizeof(frame_count), offsetof(recording::RecordingHeader, frame_count));
+        ::close(fd);
+        fd = -1;
+    }
+
+    RecordingReader::~RecordingReader() { close(); }
+
+    bool RecordingReader::open(const std::string& path) {
+        close();
+
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            last_error = "Cannot open " + path + ": " + strerror(errno);
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0 || static_cast<size_t>(st.st_size) < sizeof(recording::RecordingHeader)) {
+            last_error = path + " is not a recording (too short)";
+            ::close(fd);
+            return false;
+        }
+
+        mapping_size = static_cast<size_t>(st.st_size);
+        mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            mapping = nullptr;
+            last_error = "Cannot map " + path + ": " + strerror(errno);
+            return false;
+        }
+        // Replay reads front to back once per pass
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+
+        const auto* base = static_cast<const uint8_t*>(mapping);
+        recording::RecordingHeader header;
+        memcpy(&header, base, sizeof(header));
+        if (memcmp(header.magic, recording::kMagic, sizeof(header.magic)) != 0 || header.version != recording::kVersion) {
+            last_error = path + " is not a version " + std::to_string(recording::kVersion) + " recording";
+            close();
+            return false;
+        }
+        width = static_cast<int>(header.width);
+        height = static_cast<int>(header.height);
+        pixel_format = header.pixel_format;
+
+        // Index the records; a truncated last record (recording cut short) is dropped
+        frames.reserve(std::min<uint64_t>(header.frame_count, mapping_size / sizeof(recording::RecordedFrameHeader)));
+        size_t offset = sizeof(header);
+        while (offset + sizeof(recording::RecordedFrameHeader) <= mapping_size) {
+            recording::RecordedFrameHeader record;
+            memcpy(&record, base + offset, sizeof(record));
+            offset += sizeof(record);
+            if (record.size == 0 || record.size > mapping_size - offset) {
+                break;
+            }
+            frames.push_back({base + offset, record.size, record.timestamp_us});
+            offset += recording::align(record.size);
+        }
+
+        if (frames.empty()) {
+            last_error = path + " contains no frames";
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void RecordingReader::close() {
+        if (mapping) {
+            munmap(mapping, mapping_size);
+            mapping = nullptr;
+        }
+        mapping_size = 0;
+        frames.clear();
+    }
+
+} // namespace openterface
@@ -0,0 +1,117 @@
+#include "openterface/yuv_convert.hpp"
+
+namespace openterface {
+
+// BT.601 coefficients in 16.16 fixed point
+struct YuvCoefficients {
+    int y_offset;
+    int y_scale;
+    int cr_to_r;
+    int cb_to_g;
+    int cr_to_g;
+    int cb_to_b;
+};
+
+static constexpr YuvCoefficients kFullRange = {0, 65536, 91881, 22554, 46802, 116130};      // JFIF
+static constexpr YuvCoefficients kLimitedRange = {16, 76309, 104597, 25675, 53279, 132201}; // Studio swing
+
+static inline uint8_t clamp8(int v) {
+    return static_cast<uint8_t>(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+template <PixelFormat Format>
+static inline void storePixel(uint8_t* out, const YuvCoefficients& k, int luma, int cb, int cr) {
+    // With full range this reduces to libjpeg's own integer colour conversion
+    int y = (luma - k.y_offset) * k.y_scale + 32768;
+    int r = (y + k.cr_to_r * cr) >> 16;
+    int g = (y - k.cb_to_g * cb - k.cr_to_g * cr) >> 16;
+    int b = (y + k.cb_to_b * cb) >> 16;
+
+    if constexpr (Format == PixelFormat::XRGB8888) {
+        out[0] = clamp8(b);
+        out[1] = clamp8(g);
+        out[2] = clamp8(r);
+        out[3] = 0xFF;
+    } else {
+        out[0] = clamp8(r);
+        out[1] = clamp8(g);
+        out[2] = clamp8(b);
+        if constexpr (Format == PixelFormat::RGBX8888) {
+            out[3] = 0xFF;
+        }
+    }
+}
+
+template <PixelFormat Format>
+static void convertRows(const YuvImage& src, uint8_t* dst, size_t dst_stride) {
+    constexpr int bpp = bytesPerPixel(Format);
+    const YuvCoefficients& k = src.full_range ? kFullRange : kLimitedRange;
+
+    // Chroma addressing: horizontal/vertical subsampling shift and byte step between samples
+    int shift_x = 0, shift_y = 0, step = 1;
+    switch (src.layout) {
+    case YuvLayout::I420: shift_x = 1; shift_y = 1; break;
+    case YuvLayout::NV12: shift_x = 1; shift_y = 1; step = 2; break;
+    case YuvLayout::I422: shift_x = 1; break;
+    case YuvLayout::NV16: shift_x = 1; step = 2; break;
+    default: break;
+    }
+    bool interleaved = src.layout == YuvLayout::NV12 || src.layout == YuvLayout::NV16;
+
+    for (int y = 0; y < src.height; y++) {
+        uint8_t* out = dst + static_cast<size_t>(y) * dst_stride;
+
+        if (src.layout == YuvLayout::YUYV) {
+            const uint8_t* row = src.planes[0] + static_cast<size_t>(y) * src.strides[0];
+            for (int x = 0; x < src.width; x++) {
+                const uint8_t* pair = row + (x >> 1) * 4;
+                storePixel<Format>(out + x * bpp, k, row[x * 2], pair[1] - 128, pair[3] - 128);
+            }
+            continue;
+        }
+
+        const uint8_t* y_row = src.planes[0] + static_cast<size_t>(y) * src.strides[0];
+        if (src.layout == YuvLayout::Gray) {
+            for (int x = 0; x < src.width; x++) {
+                storePixel<Format>(out + x * bpp, k, y_row[x], 0, 0);
+            }
+            continue;
+        }
+
+        size_t chroma_row = static_cast<size_t>(y >> shift_y);
+        const uint8_t* cb_row = src.planes[1] + chroma_row * src.strides[1];
+        const uint8_t* cr_row = interleaved ? cb_row + 1 : src.planes[2] + chroma_row * src.strides[2];
+        for (int x = 0; x < src.width; x++) {
+            int c = (x >> shift_x) * step;
+            storePixel<Format>(out + x * bpp, k, y_row[x], cb_row[c] - 128, cr_row[c] - 128);
+        }
+    }
+}
+
+bool convertYuvToPixels(const YuvImage& src, PixelFormat format, uint8_t* dst, size_t dst_stride) {
+    if (!dst || !src.planes[0] || src.width <= 0 || src.height <= 0 ||
+        dst_stride < static_cast<size_t>(src.width) * bytesPerPixel(format)) {
+        return false;
+    }
+
+    bool needs_cb = src.layout != YuvLayout::Gray && src.layout != YuvLayout::YUYV;
+    bool needs_cr = needs_cb && src.layout != YuvLayout::NV12 && src.layout != YuvLayout::NV16;
+    if ((needs_cb && !src.planes[1]) || (needs_cr && !src.planes[2])) {
+        return false;
+    }
+
+    switch (format) {
+    case PixelFormat::RGB24:
+        convertRows<PixelFormat::RGB24>(src, dst, dst_stride);
+        break;
+    case PixelFormat::XRGB8888:
+        convertRows<PixelFormat::XRGB8888>(src, dst, dst_stride);
+        break;
+    case PixelFormat::RGBX8888:
+        convertRows<PixelFormat::RGBX8888>(src, dst, dst_stride);
+        break;
+    }
+    return true;
+}
+
+} // namespace openterface